@@ -0,0 +1,102 @@
+// Frame aggregation demo for Teensy 4.x CAN1 and CAN3
+
+// CAN1 (CAN 2.0B) and CAN3 (CANFD) are configured in loop back mode: each module internally
+// receives every CAN frame it sends. Frames sent by CAN1 are received by CAN1, packed into CANFD
+// containers (identifier 0x7F0) and sent by CAN3. Containers received by CAN3 are unpacked, and
+// restored frames are checked.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+#include <ACAN_T4_FrameAggregator.h>
+
+//-----------------------------------------------------------------
+
+static ACAN_T4_FrameAggregator gAggregator (0x7F0) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 -> CAN3FD aggregation test") ;
+  ACAN_T4_Settings settings (500 * 1000) ; // 500 kbit/s
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  ACAN_T4FD_Settings settingsFD (1000 * 1000, DataBitRateFactor::x4) ; // 1 Mbit/s, 4 Mbit/s
+  settingsFD.mLoopBackMode = true ;
+  settingsFD.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) | ACAN_T4::can3.beginFD (settingsFD) ;
+  if (0 == errorCode) {
+    Serial.println ("can1, can3 ok") ;
+  }else{
+    Serial.print ("Error: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+  gAggregator.mMaxDelay = 2000 ; // 2 ms
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gRestoredCount = 0 ;
+static uint32_t gErrorCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", containers: ") ;
+    Serial.print (gAggregator.containerCount ()) ;
+    Serial.print (", restored: ") ;
+    Serial.print (gRestoredCount) ;
+    Serial.print (", errors: ") ;
+    Serial.println (gErrorCount) ;
+  }
+//--- Send frames on CAN1
+  CANMessage message ;
+  message.id = gSentCount & 0x7FF ;
+  message.len = 8 ;
+  message.data32 [0] = gSentCount ;
+  if (ACAN_T4::can1.tryToSend (message)) {
+    gSentCount += 1 ;
+  }
+//--- Pack frames received by CAN1, send containers with CAN3
+  gAggregator.gateway (ACAN_T4::can1, ACAN_T4::can3) ;
+//--- Unpack containers received by CAN3
+  CANFDMessage container ;
+  if (ACAN_T4::can3.receiveFD (container) && (container.id == 0x7F0)) {
+    ACAN_T4_FrameUnpacker unpacker (container) ;
+    while (unpacker.next (message)) {
+      if (message.data32 [0] != gRestoredCount) {
+        gErrorCount += 1 ;
+      }
+      gRestoredCount += 1 ;
+    }
+    if (unpacker.isMalformed ()) {
+      gErrorCount += 1 ;
+    }
+  }
+}
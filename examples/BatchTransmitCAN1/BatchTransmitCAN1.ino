@@ -0,0 +1,94 @@
+// Batch transmit demo for Teensy 4.x CAN1
+
+// Every millisecond, a burst of 20 frames is submitted with a single tryToSendBatch call, that
+// enqueues them within one critical section; frames that do not fit in the transmit buffer are
+// submitted again the next millisecond.
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static const uint32_t BURST_SIZE = 20 ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 batch transmit test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  settings.mTransmitBufferSize = BURST_SIZE ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static CANMessage gBurst [BURST_SIZE] ;
+static uint32_t gPendingCount = 0 ; // Frames of gBurst not yet accepted
+static uint32_t gBurstDate = 0 ;
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBurstDate <= millis ()) {
+    gBurstDate += 1 ;
+  //--- Build a new burst, if the previous one has been accepted
+    if (gPendingCount == 0) {
+      for (uint32_t i=0 ; i<BURST_SIZE ; i++) {
+        gBurst [i].id = 0x100 + i ;
+        gBurst [i].len = 8 ;
+        gBurst [i].data64 = gSentCount + i ;
+      }
+      gPendingCount = BURST_SIZE ;
+    }
+  //--- Submit pending frames
+    const uint32_t accepted = ACAN_T4::can1.tryToSendBatch (& gBurst [BURST_SIZE - gPendingCount], gPendingCount) ;
+    gPendingCount -= accepted ;
+    gSentCount += accepted ;
+  }
+  CANMessage frame ;
+  while (ACAN_T4::can1.receive (frame)) {
+    gReceivedCount += 1 ;
+  }
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", received: ") ;
+    Serial.println (gReceivedCount) ;
+  }
+}
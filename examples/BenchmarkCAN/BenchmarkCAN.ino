@@ -0,0 +1,216 @@
+// Throughput and latency benchmark for Teensy 4.x, CAN 2.0B
+
+// For 125 kbit/s, 250 kbit/s, 500 kbit/s and 1 Mbit/s, the sketch keeps the bus busy with
+// 8-byte standard data frames during TEST_DURATION_MS, and measures:
+//   - sustained frame rate, versus theoretical rate (unstuffed frames: 111 bits, including
+//     intermission), and bus utilization;
+//   - CPU time per frame: driver calls (tryToSend, receive) plus interrupt service routines
+//     (time stolen from an idle loop);
+//   - end-to-end latency percentiles, from tryToSend to receive (at most MAX_FRAMES_IN_FLIGHT
+//     frames are in flight, so latency includes queueing behind these frames).
+
+// Two modes:
+//   - CABLE_MODE == false: CAN1 in loop back mode, no external hardware required;
+//   - CABLE_MODE == true: CAN1 sends, CAN2 receives. Connect CRX1 (#23), CTX1 (#22),
+//     CRX2 (#0), CTX2 (#1) together (open collector outputs, pullup on Rx pins).
+
+// One report line per configuration, "key=value" fields separated by spaces, for example:
+//   BENCH mode=loopback protocol=CAN2.0B bitrate=500000 ... lat_p99_us=...
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static const bool CABLE_MODE = false ;
+static const uint32_t TEST_DURATION_MS = 2000 ;
+static const uint32_t MAX_FRAMES_IN_FLIGHT = 8 ;
+
+static const uint32_t BIT_RATE_COUNT = 4 ;
+static const uint32_t BIT_RATES [BIT_RATE_COUNT] = {125 * 1000, 250 * 1000, 500 * 1000, 1000 * 1000} ;
+
+//--- Standard data frame, 8 bytes: 44 + 64 bits, and 3 bits of intermission
+static const uint32_t FRAME_BIT_COUNT = 111 ;
+
+//-----------------------------------------------------------------
+//   LATENCY HISTOGRAM (1 µs bins, last bin collects larger values)
+//-----------------------------------------------------------------
+
+static const uint32_t HISTOGRAM_SIZE = 4096 ;
+static uint32_t gHistogram [HISTOGRAM_SIZE] ;
+static uint32_t gMaxLatency ;
+static uint32_t gLatencyCount ;
+
+//-----------------------------------------------------------------
+
+static void resetLatencies (void) {
+  for (uint32_t i=0 ; i<HISTOGRAM_SIZE ; i++) {
+    gHistogram [i] = 0 ;
+  }
+  gMaxLatency = 0 ;
+  gLatencyCount = 0 ;
+}
+
+//-----------------------------------------------------------------
+
+static void recordLatency (const uint32_t inCycles) {
+  const uint32_t latency = inCycles / (F_CPU_ACTUAL / 1000000) ; // In µs
+  gHistogram [(latency < HISTOGRAM_SIZE) ? latency : (HISTOGRAM_SIZE - 1)] += 1 ;
+  gLatencyCount += 1 ;
+  if (gMaxLatency < latency) {
+    gMaxLatency = latency ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t latencyPercentile (const uint32_t inPercent) {
+  const uint32_t threshold = uint32_t ((uint64_t (gLatencyCount) * inPercent + 99) / 100) ;
+  uint32_t count = 0 ;
+  uint32_t i = 0 ;
+  while ((i < (HISTOGRAM_SIZE - 1)) && ((count + gHistogram [i]) < threshold)) {
+    count += gHistogram [i] ;
+    i += 1 ;
+  }
+  return i ;
+}
+
+//-----------------------------------------------------------------
+//   ONE BENCHMARK RUN
+//-----------------------------------------------------------------
+
+static void runBenchmark (const uint32_t inBitRate) {
+  ACAN_T4_Settings settings (inBitRate) ;
+  settings.mTransmitBufferSize = MAX_FRAMES_IN_FLIGHT ;
+  uint32_t errorCode ;
+  if (CABLE_MODE) {
+    settings.mTxPinIsOpenCollector = true ;
+    settings.mRxPinConfiguration = ACAN_T4_Settings::PULLUP_22k ;
+    errorCode = ACAN_T4::can1.begin (settings) | ACAN_T4::can2.begin (settings) ;
+  }else{
+    settings.mLoopBackMode = true ;
+    settings.mSelfReceptionMode = true ;
+    errorCode = ACAN_T4::can1.begin (settings) ;
+  }
+  ACAN_T4 & receiver = CABLE_MODE ? ACAN_T4::can2 : ACAN_T4::can1 ;
+  resetLatencies () ;
+  uint32_t sentCount = 0 ;
+  uint32_t receivedCount = 0 ;
+  uint32_t sequenceErrorCount = 0 ;
+  uint64_t driverCycles = 0 ;
+  uint64_t stolenCycles = 0 ;
+  const uint32_t start = millis () ;
+  while ((errorCode == 0) && ((millis () - start) < TEST_DURATION_MS)) {
+    const uint32_t t0 = ARM_DWT_CYCCNT ;
+  //--- Send
+    if ((sentCount - receivedCount) < MAX_FRAMES_IN_FLIGHT) {
+      CANMessage frame ;
+      frame.id = 0x555 ;
+      frame.len = 8 ;
+      frame.data32 [0] = ARM_DWT_CYCCNT ;
+      frame.data32 [1] = sentCount ;
+      if (ACAN_T4::can1.tryToSend (frame)) {
+        sentCount += 1 ;
+      }
+    }
+  //--- Receive
+    CANMessage frame ;
+    while (receiver.receive (frame)) {
+      recordLatency (ARM_DWT_CYCCNT - frame.data32 [0]) ;
+      if (frame.data32 [1] != receivedCount) {
+        sequenceErrorCount += 1 ;
+      }
+      receivedCount += 1 ;
+    }
+    const uint32_t t1 = ARM_DWT_CYCCNT ;
+    driverCycles += t1 - t0 ;
+  //--- Idle loop: long gaps between two cycle counter readings are interrupt service routines
+    uint32_t previous = ARM_DWT_CYCCNT ;
+    for (uint32_t i=0 ; i<64 ; i++) {
+      const uint32_t now = ARM_DWT_CYCCNT ;
+      if ((now - previous) > 40) {
+        stolenCycles += now - previous ;
+      }
+      previous = now ;
+    }
+  }
+  const uint32_t duration = millis () - start ;
+//--- Report
+  const uint32_t theoreticalFrameRate = inBitRate / FRAME_BIT_COUNT ;
+  const uint32_t frameRate = uint32_t ((uint64_t (receivedCount) * 1000) / ((duration == 0) ? 1 : duration)) ;
+  const uint32_t cpuNanosecondsPerFrame = (receivedCount == 0) ? 0
+    : uint32_t (((driverCycles + stolenCycles) * 1000) / (uint64_t (F_CPU_ACTUAL / 1000000) * receivedCount))
+  ;
+  Serial.print ("BENCH mode=") ;
+  Serial.print (CABLE_MODE ? "cable" : "loopback") ;
+  Serial.print (" protocol=CAN2.0B bitrate=") ;
+  Serial.print (inBitRate) ;
+  Serial.print (" status=") ;
+  Serial.print ((errorCode == 0) ? "ok" : "begin_error") ;
+  Serial.print (" duration_ms=") ;
+  Serial.print (duration) ;
+  Serial.print (" sent=") ;
+  Serial.print (sentCount) ;
+  Serial.print (" received=") ;
+  Serial.print (receivedCount) ;
+  Serial.print (" sequence_errors=") ;
+  Serial.print (sequenceErrorCount) ;
+  Serial.print (" fps=") ;
+  Serial.print (frameRate) ;
+  Serial.print (" theoretical_fps=") ;
+  Serial.print (theoreticalFrameRate) ;
+  Serial.print (" utilization_pct=") ;
+  Serial.print ((frameRate * 100.0) / theoreticalFrameRate, 1) ;
+  Serial.print (" cpu_ns_per_frame=") ;
+  Serial.print (cpuNanosecondsPerFrame) ;
+  Serial.print (" lat_p50_us=") ;
+  Serial.print (latencyPercentile (50)) ;
+  Serial.print (" lat_p90_us=") ;
+  Serial.print (latencyPercentile (90)) ;
+  Serial.print (" lat_p99_us=") ;
+  Serial.print (latencyPercentile (99)) ;
+  Serial.print (" lat_max_us=") ;
+  Serial.println (gMaxLatency) ;
+  ACAN_T4::can1.end () ;
+  if (CABLE_MODE) {
+    ACAN_T4::can2.end () ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN 2.0B benchmark") ;
+  for (uint32_t i=0 ; i<BIT_RATE_COUNT ; i++) {
+    runBenchmark (BIT_RATES [i]) ;
+  }
+  Serial.println ("BENCH done") ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 500 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+}
+
+//-----------------------------------------------------------------
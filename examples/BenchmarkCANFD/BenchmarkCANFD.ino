@@ -0,0 +1,220 @@
+// Throughput and latency benchmark for Teensy 4.x CAN3, CANFD
+
+// For arbitration bit rates 500 kbit/s and 1 Mbit/s, and every data bit rate factor (x1 ... x10),
+// the sketch keeps the bus busy with 64-byte standard CANFD frames (with bit rate switch)
+// during TEST_DURATION_MS, and measures:
+//   - sustained frame rate, versus theoretical rate (unstuffed frames: 30 bits at arbitration
+//     bit rate, including intermission, and 549 bits at data bit rate), and bus utilization;
+//   - CPU time per frame: driver calls (tryToSendFD, receiveFD) plus interrupt service
+//     routines (time stolen from an idle loop);
+//   - end-to-end latency percentiles, from tryToSendFD to receiveFD (at most
+//     MAX_FRAMES_IN_FLIGHT frames are in flight, so latency includes queueing behind these
+//     frames).
+
+// Two modes:
+//   - CABLE_MODE == false: CAN3 in loop back mode, no external hardware required;
+//   - CABLE_MODE == true: CAN3 connected to a CANFD transceiver, on a bus with an other CANFD
+//     node that acknowledges frames (for example, a CANFD USB adapter); frames are received
+//     back by self reception.
+// Configurations whose bit timing cannot be achieved are reported with status=invalid.
+
+// One report line per configuration, "key=value" fields separated by spaces, for example:
+//   BENCH mode=loopback protocol=CANFD bitrate=1000000 data_bitrate=4000000 ... lat_p99_us=...
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static const bool CABLE_MODE = false ;
+static const uint32_t TEST_DURATION_MS = 2000 ;
+static const uint32_t MAX_FRAMES_IN_FLIGHT = 8 ;
+
+static const uint32_t BIT_RATE_COUNT = 2 ;
+static const uint32_t BIT_RATES [BIT_RATE_COUNT] = {500 * 1000, 1000 * 1000} ;
+
+//--- Standard CANFD frame, 64 bytes, with bit rate switch
+static const uint32_t ARBITRATION_PHASE_BIT_COUNT = 30 ; // SOF ... BRS, CRC delimiter ... intermission
+static const uint32_t DATA_PHASE_BIT_COUNT = 549 ; // ESI, DLC, data, stuff count, CRC 21 and fixed stuff bits
+
+//-----------------------------------------------------------------
+//   LATENCY HISTOGRAM (1 µs bins, last bin collects larger values)
+//-----------------------------------------------------------------
+
+static const uint32_t HISTOGRAM_SIZE = 4096 ;
+static uint32_t gHistogram [HISTOGRAM_SIZE] ;
+static uint32_t gMaxLatency ;
+static uint32_t gLatencyCount ;
+
+//-----------------------------------------------------------------
+
+static void resetLatencies (void) {
+  for (uint32_t i=0 ; i<HISTOGRAM_SIZE ; i++) {
+    gHistogram [i] = 0 ;
+  }
+  gMaxLatency = 0 ;
+  gLatencyCount = 0 ;
+}
+
+//-----------------------------------------------------------------
+
+static void recordLatency (const uint32_t inCycles) {
+  const uint32_t latency = inCycles / (F_CPU_ACTUAL / 1000000) ; // In µs
+  gHistogram [(latency < HISTOGRAM_SIZE) ? latency : (HISTOGRAM_SIZE - 1)] += 1 ;
+  gLatencyCount += 1 ;
+  if (gMaxLatency < latency) {
+    gMaxLatency = latency ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t latencyPercentile (const uint32_t inPercent) {
+  const uint32_t threshold = uint32_t ((uint64_t (gLatencyCount) * inPercent + 99) / 100) ;
+  uint32_t count = 0 ;
+  uint32_t i = 0 ;
+  while ((i < (HISTOGRAM_SIZE - 1)) && ((count + gHistogram [i]) < threshold)) {
+    count += gHistogram [i] ;
+    i += 1 ;
+  }
+  return i ;
+}
+
+//-----------------------------------------------------------------
+//   ONE BENCHMARK RUN
+//-----------------------------------------------------------------
+
+static void runBenchmark (const uint32_t inBitRate, const DataBitRateFactor inFactor) {
+  ACAN_T4FD_Settings settings (inBitRate, inFactor) ;
+  settings.mTransmitBufferSize = MAX_FRAMES_IN_FLIGHT ;
+  settings.mSelfReceptionMode = true ;
+  settings.mLoopBackMode = !CABLE_MODE ;
+  const uint32_t dataBitRate = inBitRate * uint32_t (inFactor) ;
+  uint32_t errorCode = settings.mBitSettingOk ? ACAN_T4::can3.beginFD (settings) : ACAN_T4::kCANBitConfiguration ;
+  resetLatencies () ;
+  uint32_t sentCount = 0 ;
+  uint32_t receivedCount = 0 ;
+  uint32_t sequenceErrorCount = 0 ;
+  uint64_t driverCycles = 0 ;
+  uint64_t stolenCycles = 0 ;
+  const uint32_t start = millis () ;
+  while ((errorCode == 0) && ((millis () - start) < TEST_DURATION_MS)) {
+    const uint32_t t0 = ARM_DWT_CYCCNT ;
+  //--- Send
+    if ((sentCount - receivedCount) < MAX_FRAMES_IN_FLIGHT) {
+      CANFDMessage frame ;
+      frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+      frame.id = 0x555 ;
+      frame.len = 64 ;
+      frame.data32 [0] = ARM_DWT_CYCCNT ;
+      frame.data32 [1] = sentCount ;
+      if (ACAN_T4::can3.tryToSendFD (frame)) {
+        sentCount += 1 ;
+      }
+    }
+  //--- Receive
+    CANFDMessage frame ;
+    while (ACAN_T4::can3.receiveFD (frame)) {
+      recordLatency (ARM_DWT_CYCCNT - frame.data32 [0]) ;
+      if (frame.data32 [1] != receivedCount) {
+        sequenceErrorCount += 1 ;
+      }
+      receivedCount += 1 ;
+    }
+    const uint32_t t1 = ARM_DWT_CYCCNT ;
+    driverCycles += t1 - t0 ;
+  //--- Idle loop: long gaps between two cycle counter readings are interrupt service routines
+    uint32_t previous = ARM_DWT_CYCCNT ;
+    for (uint32_t i=0 ; i<64 ; i++) {
+      const uint32_t now = ARM_DWT_CYCCNT ;
+      if ((now - previous) > 40) {
+        stolenCycles += now - previous ;
+      }
+      previous = now ;
+    }
+  }
+  const uint32_t duration = millis () - start ;
+//--- Report
+  const double frameDuration = // In µs
+    (ARBITRATION_PHASE_BIT_COUNT * 1.0e6) / inBitRate + (DATA_PHASE_BIT_COUNT * 1.0e6) / dataBitRate ;
+  const uint32_t theoreticalFrameRate = uint32_t (1.0e6 / frameDuration) ;
+  const uint32_t frameRate = uint32_t ((uint64_t (receivedCount) * 1000) / ((duration == 0) ? 1 : duration)) ;
+  const uint32_t cpuNanosecondsPerFrame = (receivedCount == 0) ? 0
+    : uint32_t (((driverCycles + stolenCycles) * 1000) / (uint64_t (F_CPU_ACTUAL / 1000000) * receivedCount))
+  ;
+  Serial.print ("BENCH mode=") ;
+  Serial.print (CABLE_MODE ? "cable" : "loopback") ;
+  Serial.print (" protocol=CANFD bitrate=") ;
+  Serial.print (inBitRate) ;
+  Serial.print (" data_bitrate=") ;
+  Serial.print (dataBitRate) ;
+  Serial.print (" status=") ;
+  Serial.print ((errorCode == 0) ? "ok" : "invalid") ;
+  Serial.print (" duration_ms=") ;
+  Serial.print (duration) ;
+  Serial.print (" sent=") ;
+  Serial.print (sentCount) ;
+  Serial.print (" received=") ;
+  Serial.print (receivedCount) ;
+  Serial.print (" sequence_errors=") ;
+  Serial.print (sequenceErrorCount) ;
+  Serial.print (" fps=") ;
+  Serial.print (frameRate) ;
+  Serial.print (" theoretical_fps=") ;
+  Serial.print (theoreticalFrameRate) ;
+  Serial.print (" utilization_pct=") ;
+  Serial.print ((frameRate * 100.0) / theoreticalFrameRate, 1) ;
+  Serial.print (" cpu_ns_per_frame=") ;
+  Serial.print (cpuNanosecondsPerFrame) ;
+  Serial.print (" lat_p50_us=") ;
+  Serial.print (latencyPercentile (50)) ;
+  Serial.print (" lat_p90_us=") ;
+  Serial.print (latencyPercentile (90)) ;
+  Serial.print (" lat_p99_us=") ;
+  Serial.print (latencyPercentile (99)) ;
+  Serial.print (" lat_max_us=") ;
+  Serial.println (gMaxLatency) ;
+  if (errorCode == 0) {
+    ACAN_T4::can3.end () ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CANFD benchmark") ;
+  for (uint32_t i=0 ; i<BIT_RATE_COUNT ; i++) {
+    for (uint32_t factor=1 ; factor<=10 ; factor++) {
+      runBenchmark (BIT_RATES [i], DataBitRateFactor (factor)) ;
+    }
+  }
+  Serial.println ("BENCH done") ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 500 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,102 @@
+// Bus logger for Teensy 4.1: captures all CAN1, CAN2 and CAN3 traffic to the built-in SD card
+
+// The three FlexCAN modules are configured in listen only mode.
+// Received frames are packed by the receive interrupt service routines into 512-byte blocks;
+// loop writes full blocks to the TRACE.BIN file.
+
+// Convert the trace on the host with extras/ACAN_T4_TraceConverter (candump or ASC format).
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.1"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+#include <SD.h>
+
+//-----------------------------------------------------------------
+// 32 blocks (16 kB) absorb SD card write latencies at full bus load
+
+static const uint32_t BLOCK_COUNT = 32 ;
+static uint8_t gBlockStorage [BLOCK_COUNT * ACAN_T4_TRACE_BLOCK_SIZE] __attribute__ ((aligned (4))) ;
+static ACAN_T4_TraceRecorder gRecorder ;
+static File gTraceFile ;
+
+//-----------------------------------------------------------------
+
+static void beginCAN (ACAN_T4 & inDriver, const char * inName) {
+  ACAN_T4_Settings settings (500 * 1000) ; // 500 kbit/s
+  settings.mListenOnlyMode = true ;
+  settings.mReceiveBufferSize = 1 ; // Frames are not read by loop
+  const uint32_t errorCode = inDriver.begin (settings) ;
+  if (0 == errorCode) {
+    inDriver.setTraceRecorder (& gRecorder) ;
+    Serial.print (inName) ;
+    Serial.println (" ok") ;
+  }else{
+    Serial.print ("Error ") ;
+    Serial.print (inName) ;
+    Serial.print (": 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("Capture to SD card") ;
+  if (!SD.begin (BUILTIN_SDCARD)) {
+    Serial.println ("SD card error") ;
+    while (1) {}
+  }
+  SD.remove ("TRACE.BIN") ;
+  gTraceFile = SD.open ("TRACE.BIN", FILE_WRITE) ;
+  gRecorder.begin (gBlockStorage, BLOCK_COUNT) ;
+  beginCAN (ACAN_T4::can1, "can1") ;
+  beginCAN (ACAN_T4::can2, "can2") ;
+  beginCAN (ACAN_T4::can3, "can3") ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gFlushDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Write full blocks
+  const uint8_t * block = gRecorder.fullBlock () ;
+  while (block != nullptr) {
+    gTraceFile.write (block, ACAN_T4_TRACE_BLOCK_SIZE) ;
+    gRecorder.releaseBlock () ;
+    block = gRecorder.fullBlock () ;
+  }
+//--- Every second, close the current block and sync the file
+  if (gFlushDate <= millis ()) {
+    gFlushDate += 1000 ;
+    gRecorder.flush () ;
+    gTraceFile.flush () ;
+  }
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 2000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Recorded: ") ;
+    Serial.print (gRecorder.recordedFrameCount ()) ;
+    Serial.print (", lost: ") ;
+    Serial.print (gRecorder.lostFrameCount ()) ;
+    Serial.print (", block peak: ") ;
+    Serial.println (gRecorder.fullBlockPeakCount ()) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,87 @@
+// Change filter demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. The sketch sends a frame with identifier 0x100 every 10 ms; its first byte changes every
+// second, its last byte is a rolling counter. A change filter is installed for 0x100, that ignores
+// the rolling counter (byte 7), with a 500 ms heartbeat: only 3 frames per second are stored in
+// the receive buffer, 97 are suppressed by the receive interrupt service routine.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static ACAN_T4_ChangeFilter gChangeFilters [1] = {
+  {kStandard, 0x100, 500, 0x00FFFFFFFFFFFFFFULL} // 500 ms heartbeat, byte 7 is not compared
+} ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 change filter test") ;
+  ACAN_T4_Settings settings (500 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+  ACAN_T4::can1.setChangeFilters (gChangeFilters, 1) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSendDate = 0 ;
+static uint32_t gSendCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += 10 ;
+    CANMessage frame ;
+    frame.id = 0x100 ;
+    frame.len = 8 ;
+    frame.data [0] = uint8_t (gSendCount / 100) ;
+    frame.data [7] = uint8_t (gSendCount) ;
+    gSendCount += 1 ;
+    ACAN_T4::can1.tryToSend (frame) ;
+    if ((gSendCount % 100) == 0) {
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+      Serial.print ("Sent: ") ;
+      Serial.print (gSendCount) ;
+      Serial.print (", received: ") ;
+      Serial.print (gReceivedCount) ;
+      Serial.print (", suppressed: ") ;
+      Serial.println (gChangeFilters [0].suppressedCount ()) ;
+    }
+  }
+  CANMessage frame ;
+  while (ACAN_T4::can1.receive (frame)) {
+    gReceivedCount += 1 ;
+  }
+}
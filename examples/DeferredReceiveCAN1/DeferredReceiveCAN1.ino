@@ -0,0 +1,86 @@
+// Deferred receive processing demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. With deferred receive processing, the CAN1 interrupt only moves received frames to a
+// small staging buffer and refills the transmit mailbox; received frames are processed (call
+// backs, storing in the receive buffer) by a software interrupt of lower priority. An interrupt
+// of intermediate priority (as a motor control timer) is then never delayed by frame processing,
+// only by the short CAN1 interrupt.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 deferred receive processing test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  settings.mInterruptPriority = 32 ; // CAN1 interrupt: high priority, short
+  settings.mDeferredReceiveProcessing = true ;
+  settings.mDeferredInterruptPriority = 208 ; // Frame processing: low priority
+  settings.mStagingBufferSize = 16 ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSendDate = 0 ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  //--- Send a burst of 10 frames
+    for (uint32_t i=0 ; i<10 ; i++) {
+      CANMessage frame ;
+      frame.id = 0x123 ;
+      frame.len = 4 ;
+      frame.data32 [0] = gSentCount ;
+      if (ACAN_T4::can1.tryToSend (frame)) {
+        gSentCount += 1 ;
+      }
+    }
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", staging buffer overflows: ") ;
+    Serial.println (ACAN_T4::can1.stagingBufferOverflowCount ()) ;
+  }
+  CANMessage frame ;
+  while (ACAN_T4::can1.receive (frame)) {
+    gReceivedCount += 1 ;
+  }
+}
@@ -0,0 +1,95 @@
+// Gateway demo for Teensy 4.x CAN1 and CAN2
+
+// CAN1 and CAN2 are configured in loop back mode: each module internally receives every CAN
+// frame it sends. Frames 0x100 received by CAN1 are forwarded by CAN2 with identifier 0x200,
+// directly by the CAN1 receive interrupt service routine (they are not stored in the CAN1 receive
+// buffer). Other frames received by CAN1 (0x101) are not routed, and are received by loop.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static ACAN_T4_Route gRoutes [] = {
+  ACAN_T4_Route (kStandard, 0x100, ACAN_T4::can2)
+} ;
+
+static const uint32_t ROUTE_COUNT = sizeof (gRoutes) / sizeof (gRoutes [0]) ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 -> CAN2 gateway test") ;
+  ACAN_T4_Settings settings (500 * 1000) ; // 500 kbit/s
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) | ACAN_T4::can2.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1, can2 ok") ;
+  }else{
+    Serial.print ("Error: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+//--- 0x100 is forwarded as 0x200
+  gRoutes [0].mRewriteMask = 0x7FF ;
+  gRoutes [0].mRewriteValue = 0x200 ;
+  ACAN_T4::can1.setRoutes (gRoutes, ROUTE_COUNT) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gSendDate = 0 ;
+static uint32_t gSentCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 500 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  CANMessage message ;
+  if (gSendDate <= millis ()) {
+    message.id = 0x100 + (gSentCount & 1) ;
+    message.len = 4 ;
+    message.data32 [0] = gSentCount ;
+    const bool ok = ACAN_T4::can1.tryToSend (message) ;
+    if (ok) {
+      gSendDate += 1000 ;
+      gSentCount += 1 ;
+    }
+  }
+  if (ACAN_T4::can1.receive (message)) {
+    Serial.print ("CAN1 received 0x") ;
+    Serial.println (message.id, HEX) ;
+  }
+  if (ACAN_T4::can2.receive (message)) {
+    Serial.print ("CAN2 received 0x") ;
+    Serial.print (message.id, HEX) ;
+    Serial.print (", forwarded: ") ;
+    Serial.print (gRoutes [0].mForwardedCount) ;
+    Serial.print (", dropped: ") ;
+    Serial.println (gRoutes [0].mDroppedCount) ;
+  }
+}
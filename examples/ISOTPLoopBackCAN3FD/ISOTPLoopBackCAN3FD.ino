@@ -0,0 +1,124 @@
+// ISO-TP (ISO 15765-2) demo for Teensy 4.x CAN3, CANFD
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. Two ISO-TP sessions exchange messages: session A sends with identifier 0x700 and
+// receives 0x708, session B sends with 0x708 and receives 0x700. Every second, A sends a
+// 10000-byte message to B (64-byte frames), and B sends a 100-byte message to A.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4_ISOTP.h>
+
+//-----------------------------------------------------------------
+
+static ACAN_T4_ISOTP gISOTP (ACAN_T4::can3) ;
+static ACAN_T4_ISOTPSession gSessionA (0x700, 0x708) ;
+static ACAN_T4_ISOTPSession gSessionB (0x708, 0x700) ;
+
+static const uint32_t MESSAGE_A_LENGTH = 10000 ;
+static const uint32_t MESSAGE_B_LENGTH = 100 ;
+static uint8_t gMessageA [MESSAGE_A_LENGTH] ;
+static uint8_t gMessageB [MESSAGE_B_LENGTH] ;
+static uint8_t gReceiveBufferA [MESSAGE_B_LENGTH] ;
+static uint8_t gReceiveBufferB [MESSAGE_A_LENGTH] ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN3 ISO-TP loopback test") ;
+  ACAN_T4FD_Settings settings (1000 * 1000, DataBitRateFactor::x4) ; // 1 Mbit/s, 4 Mbit/s
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can3.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can3 ok") ;
+  }else{
+    Serial.print ("Error can3: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+//--- Sessions
+  gSessionA.mFrameLength = 64 ;
+  gSessionB.mFrameLength = 64 ;
+  gSessionB.mBlockSize = 16 ;
+  gSessionA.setReceiveBuffer (gReceiveBufferA, MESSAGE_B_LENGTH) ;
+  gSessionB.setReceiveBuffer (gReceiveBufferB, MESSAGE_A_LENGTH) ;
+  gISOTP.addSession (gSessionA) ;
+  gISOTP.addSession (gSessionB) ;
+//--- Messages
+  for (uint32_t i=0 ; i<MESSAGE_A_LENGTH ; i++) {
+    gMessageA [i] = uint8_t (i) ;
+  }
+  for (uint32_t i=0 ; i<MESSAGE_B_LENGTH ; i++) {
+    gMessageB [i] = uint8_t (~ i) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSendDate = 0 ;
+static uint32_t gStartDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    gStartDate = micros () ;
+    gSessionA.startTransmission (gMessageA, MESSAGE_A_LENGTH) ;
+    gSessionB.startTransmission (gMessageB, MESSAGE_B_LENGTH) ;
+  }
+//--- Handle received frames, send pending frames
+  CANFDMessage frame ;
+  while (ACAN_T4::can3.receiveFD (frame)) {
+    gISOTP.handleFD (frame) ;
+  }
+  gISOTP.poll () ;
+//--- Completed receptions
+  uint32_t length ;
+  if (gSessionB.receptionCompleted (length)) {
+    bool ok = length == MESSAGE_A_LENGTH ;
+    for (uint32_t i=0 ; (i<length) && ok ; i++) {
+      ok = gReceiveBufferB [i] == gMessageA [i] ;
+    }
+    Serial.print ("B received ") ;
+    Serial.print (length) ;
+    Serial.print (" bytes in ") ;
+    Serial.print (micros () - gStartDate) ;
+    Serial.println (ok ? " us, ok" : " us, error") ;
+    gSessionB.releaseReception () ;
+  }
+  if (gSessionA.receptionCompleted (length)) {
+    Serial.print ("A received ") ;
+    Serial.print (length) ;
+    Serial.println (" bytes") ;
+    gSessionA.releaseReception () ;
+  }
+  if ((gSessionA.errors () | gSessionB.errors ()) != 0) {
+    Serial.print ("Errors: 0x") ;
+    Serial.print (gSessionA.errors (), HEX) ;
+    Serial.print (", 0x") ;
+    Serial.println (gSessionB.errors (), HEX) ;
+    gSessionA.resetErrors () ;
+    gSessionB.resetErrors () ;
+  }
+}
@@ -0,0 +1,104 @@
+// Interrupt call back demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. Filter #0 accepts the request frame 0x100; its call back routine is called from the
+// receive interrupt service routine (mCallBackInISR is true), and sends the response frame 0x101
+// immediately, without waiting for loop. Filter #1 accepts the response 0x101; its call back
+// routine is called by dispatchReceivedMessage, from loop, as usual.
+// The request date is sent in the request payload, so the response call back can compute the
+// request / response latency.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static void handleRequest (const CANMessage & inRequest) { // Called in interrupt context
+  CANMessage response = inRequest ;
+  response.id = 0x101 ;
+  response.data32 [1] = micros () ;
+  ACAN_T4::can1.tryToSend (response) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gResponseCount = 0 ;
+static uint32_t gMaxLatency = 0 ;
+
+//-----------------------------------------------------------------
+
+static void handleResponse (const CANMessage & inResponse) { // Called by dispatchReceivedMessage
+  gResponseCount += 1 ;
+  const uint32_t latency = inResponse.data32 [1] - inResponse.data32 [0] ;
+  if (gMaxLatency < latency) {
+    gMaxLatency = latency ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 interrupt call back test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const ACANPrimaryFilter primaryFilters [2] = {
+    ACANPrimaryFilter (kData, kStandard, 0x100, handleRequest, true), // Filter #0, interrupt call back
+    ACANPrimaryFilter (kData, kStandard, 0x101, handleResponse)       // Filter #1
+  } ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings, primaryFilters, 2) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gRequestDate = 0 ;
+static uint32_t gDisplayDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  ACAN_T4::can1.dispatchReceivedMessage () ;
+  if (gRequestDate <= millis ()) {
+    gRequestDate += 10 ;
+    CANMessage request ;
+    request.id = 0x100 ;
+    request.len = 8 ;
+    request.data32 [0] = micros () ;
+    ACAN_T4::can1.tryToSend (request) ;
+  }
+  if (gDisplayDate <= millis ()) {
+    gDisplayDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Responses: ") ;
+    Serial.print (gResponseCount) ;
+    Serial.print (", max request / response latency: ") ;
+    Serial.print (gMaxLatency) ;
+    Serial.println (" us") ;
+  }
+}
@@ -0,0 +1,185 @@
+// J1939 multi-packet transport demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. The receiving node has address 0x80. Every second, the sketch plays the part of two
+// other nodes:
+//   - node 0x20 sends a 100-byte message to node 0x80 (RTS/CTS transfer): the sketch sends the
+//     RTS frame, and then a data packet window every time the CTS frame sent by the transport
+//     layer is received;
+//   - node 0x30 broadcasts a 30-byte message (BAM transfer).
+// TP.CM and TP.DT frames are handled in the call back routines of two primary filters.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4_J1939.h>
+
+//-----------------------------------------------------------------
+
+static const uint8_t MY_ADDRESS = 0x80 ;
+static const uint8_t RTS_SENDER_ADDRESS = 0x20 ;
+static const uint8_t BAM_SENDER_ADDRESS = 0x30 ;
+static const uint32_t RTS_MESSAGE_LENGTH = 100 ;
+static const uint32_t BAM_MESSAGE_LENGTH = 30 ;
+static const uint32_t PGN = 0x0FECA ;
+
+static ACAN_T4_J1939Transport gTransport (ACAN_T4::can1, MY_ADDRESS) ;
+static ACAN_T4_J1939Slot gSlots [4] ;
+
+//-----------------------------------------------------------------
+
+static uint32_t gReceivedMessageCount = 0 ;
+static uint32_t gReceivedMessageErrorCount = 0 ;
+
+static void handleJ1939Message (const uint32_t inPGN,
+                                const uint8_t inSourceAddress,
+                                const uint8_t inDestinationAddress,
+                                const uint8_t inData [],
+                                const uint32_t inLength) {
+  const uint32_t expectedLength = (inSourceAddress == RTS_SENDER_ADDRESS) ? RTS_MESSAGE_LENGTH : BAM_MESSAGE_LENGTH ;
+  bool ok = (inPGN == PGN) && (inLength == expectedLength) ;
+  for (uint32_t i=0 ; (i<inLength) && ok ; i++) {
+    ok = inData [i] == uint8_t (i + inSourceAddress) ;
+  }
+  if (ok) {
+    gReceivedMessageCount += 1 ;
+  }else{
+    gReceivedMessageErrorCount += 1 ;
+  }
+}
+
+//-----------------------------------------------------------------
+//   SENDER SIDE (nodes 0x20 and 0x30)
+//-----------------------------------------------------------------
+
+static uint8_t gClearToSendPacketCount = 0 ;
+static uint8_t gClearToSendNextPacket = 0 ;
+
+//-----------------------------------------------------------------
+
+static void sendFrame (const uint8_t inPF, const uint8_t inDestination, const uint8_t inSource, const uint8_t inData [8]) {
+  CANMessage frame ;
+  frame.ext = true ;
+  frame.id = (7UL << 26) | (uint32_t (inPF) << 16) | (uint32_t (inDestination) << 8) | inSource ;
+  frame.len = 8 ;
+  for (uint32_t i=0 ; i<8 ; i++) {
+    frame.data [i] = inData [i] ;
+  }
+  while (!ACAN_T4::can1.tryToSend (frame)) {}
+}
+
+//-----------------------------------------------------------------
+
+static void sendConnectionManagement (const uint8_t inDestination, const uint8_t inSource,
+                                      const uint8_t inControl, const uint32_t inLength) {
+  const uint8_t data [8] = {
+    inControl, uint8_t (inLength), uint8_t (inLength >> 8), uint8_t ((inLength + 6) / 7),
+    (inControl == 32) ? uint8_t (0xFF) : uint8_t (8), // BAM: reserved; RTS: 8 packets per CTS
+    uint8_t (PGN), uint8_t (PGN >> 8), uint8_t (PGN >> 16)
+  } ;
+  sendFrame (0xEC, inDestination, inSource, data) ;
+}
+
+//-----------------------------------------------------------------
+
+static void sendDataPacket (const uint8_t inDestination, const uint8_t inSource,
+                            const uint8_t inSequenceNumber, const uint32_t inLength) {
+  uint8_t data [8] ;
+  data [0] = inSequenceNumber ;
+  for (uint32_t i=0 ; i<7 ; i++) {
+    const uint32_t offset = (inSequenceNumber - 1) * 7 + i ;
+    data [i + 1] = (offset < inLength) ? uint8_t (offset + inSource) : 0xFF ;
+  }
+  sendFrame (0xEB, inDestination, inSource, data) ;
+}
+
+//-----------------------------------------------------------------
+//   PRIMARY FILTERS
+//-----------------------------------------------------------------
+
+static void handleTransportFrame (const CANMessage & inMessage) {
+  if (!gTransport.handle (inMessage)) {
+  //--- Not for MY_ADDRESS: a CTS frame sent to node 0x20?
+    const bool clearToSend = (((inMessage.id >> 8) & 0xFF) == RTS_SENDER_ADDRESS) && (inMessage.data [0] == 17) ;
+    if (clearToSend) {
+      gClearToSendPacketCount = inMessage.data [1] ;
+      gClearToSendNextPacket = inMessage.data [2] ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 J1939 transport demo") ;
+  ACAN_T4_Settings settings (250 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const ACANPrimaryFilter primaryFilters [2] = {
+    ACAN_T4_J1939Transport::connectionManagementFilter (handleTransportFrame),
+    ACAN_T4_J1939Transport::dataTransferFilter (handleTransportFrame)
+  } ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings, primaryFilters, 2) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+  gTransport.begin (gSlots, 4, handleJ1939Message) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSendDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Received: ") ;
+    Serial.print (gReceivedMessageCount) ;
+    Serial.print (", errors: ") ;
+    Serial.print (gReceivedMessageErrorCount) ;
+    Serial.print (", aborted: ") ;
+    Serial.print (gTransport.abortedTransferCount ()) ;
+    Serial.print (", timeouts: ") ;
+    Serial.println (gTransport.timeoutCount ()) ;
+  //--- Start transfers
+    sendConnectionManagement (MY_ADDRESS, RTS_SENDER_ADDRESS, 16, RTS_MESSAGE_LENGTH) ;
+    sendConnectionManagement (0xFF, BAM_SENDER_ADDRESS, 32, BAM_MESSAGE_LENGTH) ;
+    for (uint8_t i=1 ; i<=(BAM_MESSAGE_LENGTH + 6) / 7 ; i++) {
+      sendDataPacket (0xFF, BAM_SENDER_ADDRESS, i, BAM_MESSAGE_LENGTH) ;
+    }
+  }
+//--- Received frames are handled by the filter call back routines
+  ACAN_T4::can1.dispatchReceivedMessage () ;
+//--- Node 0x20 sends the data packets requested by the last CTS
+  while (gClearToSendPacketCount > 0) {
+    sendDataPacket (MY_ADDRESS, RTS_SENDER_ADDRESS, gClearToSendNextPacket, RTS_MESSAGE_LENGTH) ;
+    gClearToSendNextPacket += 1 ;
+    gClearToSendPacketCount -= 1 ;
+  }
+//--- Time out stale transfers
+  gTransport.poll () ;
+}
@@ -0,0 +1,104 @@
+// Latest value slots demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. The sketch sends a frame with identifier 0x100 every millisecond, and a frame with
+// identifier 0x200 every 100 ms. A latest value slot is installed for 0x100: these frames never
+// go through the receive buffer, the slot keeps only the newest one. The loop reads the slot
+// every 500 ms, and prints how many frames have been overwritten since the previous read.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static ACAN_T4_LatestValueSlot gSlots [1] = {
+  {kStandard, 0x100}
+} ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 latest value slots test") ;
+  ACAN_T4_Settings settings (500 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+  ACAN_T4::can1.setLatestValueSlots (gSlots, 1) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gFastSendDate = 0 ;
+static uint32_t gSlowSendDate = 0 ;
+static uint32_t gReadDate = 0 ;
+static uint32_t gCounter = 0 ;
+static uint32_t gLastSequence = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  const uint32_t now = millis () ;
+  if (gFastSendDate <= now) {
+    gFastSendDate += 1 ;
+    CANMessage frame ;
+    frame.id = 0x100 ;
+    frame.len = 4 ;
+    frame.data32 [0] = gCounter ;
+    gCounter += 1 ;
+    ACAN_T4::can1.tryToSend (frame) ;
+  }
+  if (gSlowSendDate <= now) {
+    gSlowSendDate += 100 ;
+    CANMessage frame ;
+    frame.id = 0x200 ;
+    ACAN_T4::can1.tryToSend (frame) ;
+  }
+//--- Read slot
+  if (gReadDate <= now) {
+    gReadDate += 500 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    const uint32_t previousSequence = gLastSequence ;
+    CANMessage frame ;
+    uint32_t timestamp ;
+    if (gSlots [0].readIfNew (frame, gLastSequence, timestamp)) {
+      Serial.print ("0x100: counter ") ;
+      Serial.print (frame.data32 [0]) ;
+      Serial.print (", received at ") ;
+      Serial.print (timestamp) ;
+      Serial.print (" us, overwritten frames ") ;
+      Serial.print (gLastSequence - previousSequence - 1) ;
+      Serial.print (", receive buffer peak count ") ;
+      Serial.println (ACAN_T4::can1.receiveBufferPeakCount ()) ;
+    }
+  }
+//--- Other frames go through the receive buffer
+  CANMessage frame ;
+  while (ACAN_T4::can1.receive (frame)) {
+  }
+}
@@ -0,0 +1,113 @@
+// Periodic frames demo for Teensy 4.x CAN1
+
+// Two cyclic frames are sent by the periodic scheduler, from a 1 ms timer interrupt:
+//   - 0x100 every 10 ms, its payload is updated by loop;
+//   - 0x200 every 20 ms, 5 ms after 0x100; its update routine, called by the timer interrupt
+//     just before each sending, increments a rolling counter.
+// loop only updates payloads and displays the measured jitter.
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static void updateCounterFrame (CANFDMessage & ioMessage) { // Called by the timer interrupt
+  ioMessage.data [0] += 1 ;
+}
+
+//-----------------------------------------------------------------
+
+static CANMessage frame (const uint32_t inIdentifier, const uint8_t inLength) {
+  CANMessage result ;
+  result.id = inIdentifier ;
+  result.len = inLength ;
+  return result ;
+}
+
+//-----------------------------------------------------------------
+
+static ACAN_T4_PeriodicFrame gPeriodicFrames [2] = {
+  {frame (0x100, 4), 10},                        // 10 ms
+  {frame (0x200, 1), 20, 5, updateCounterFrame}  // 20 ms, phase 5 ms
+} ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 periodic frames test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+  ACAN_T4::can1.setPeriodicFrames (gPeriodicFrames, 2) ;
+  if (!ACAN_T4_PeriodicScheduler::begin ()) {
+    Serial.println ("No timer available") ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  CANMessage message ;
+  while (ACAN_T4::can1.receive (message)) {
+    gReceivedCount += 1 ;
+  }
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  //--- Update 0x100 payload
+    CANMessage update = frame (0x100, 4) ;
+    update.data32 [0] = millis () ;
+    gPeriodicFrames [0].update (update) ;
+  //--- Display statistics
+    Serial.print ("Received: ") ;
+    Serial.println (gReceivedCount) ;
+    for (uint32_t i=0 ; i<2 ; i++) {
+      Serial.print ("  frame ") ;
+      Serial.print (i) ;
+      Serial.print (": sent ") ;
+      Serial.print (gPeriodicFrames [i].sentCount ()) ;
+      Serial.print (", missed ") ;
+      Serial.print (gPeriodicFrames [i].missedCount ()) ;
+      Serial.print (", jitter max ") ;
+      Serial.print (gPeriodicFrames [i].maxJitter ()) ;
+      Serial.print (" us, average ") ;
+      Serial.print (gPeriodicFrames [i].averageJitter ()) ;
+      Serial.println (" us") ;
+    }
+  }
+}
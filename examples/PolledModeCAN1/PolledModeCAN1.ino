@@ -0,0 +1,97 @@
+// Polled mode demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. In polled mode, the CAN1 interrupt is not enabled: the control loop below runs every
+// 100 µs (10 kHz), and handles CAN1 at a defined point of each period by calling poll, so its
+// timing is not disturbed by CAN interrupts.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 polled mode test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  settings.mPolledMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t PERIOD = 100 ; // In µs
+static uint32_t gPeriodStart = 0 ;
+static uint32_t gCycleCount = 0 ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+static uint32_t gMaxPollDuration = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if ((micros () - gPeriodStart) >= PERIOD) {
+    gPeriodStart += PERIOD ;
+    gCycleCount += 1 ;
+  //--- Control computations would go here
+  //--- Send a frame every 10 cycles (1 kHz)
+    if ((gCycleCount % 10) == 0) {
+      CANMessage frame ;
+      frame.id = 0x123 ;
+      frame.len = 4 ;
+      frame.data32 [0] = gCycleCount ;
+      if (ACAN_T4::can1.tryToSend (frame)) {
+        gSentCount += 1 ;
+      }
+    }
+  //--- Handle CAN1 at a defined point of the period
+    const uint32_t pollStart = micros () ;
+    ACAN_T4::can1.poll () ;
+    CANMessage frame ;
+    while (ACAN_T4::can1.receive (frame)) {
+      gReceivedCount += 1 ;
+    }
+    const uint32_t pollDuration = micros () - pollStart ;
+    if (gMaxPollDuration < pollDuration) {
+      gMaxPollDuration = pollDuration ;
+    }
+  //--- Display every second
+    if ((gCycleCount % 10000) == 0) {
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+      Serial.print ("Sent: ") ;
+      Serial.print (gSentCount) ;
+      Serial.print (", received: ") ;
+      Serial.print (gReceivedCount) ;
+      Serial.print (", max CAN handling duration: ") ;
+      Serial.print (gMaxPollDuration) ;
+      Serial.println (" us") ;
+    }
+  }
+}
@@ -0,0 +1,104 @@
+// Transmit rate limit demo for Teensy 4.x CAN1
+
+// loop tries to flood the bus with frames 0x100 and 0x200 ... 0x20F; two token bucket limits
+// protect the bus load budget:
+//   - 0x100 is limited to 100 frames/s (burst of 5 frames), excess frames are rejected;
+//   - 0x200 ... 0x20F are limited to 500 frames/s (burst of 10 frames), excess frames are
+//     deferred in a 16 frame buffer, and released by the periodic scheduler 1 ms tick.
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static CANFDMessage gDeferBuffer [16] ;
+
+static ACAN_T4_RateLimit gRateLimits [2] = {
+  {kStandard, 0x100, 100, 5},                         // Reject
+  {kStandard, 0x7F0, 0x200, 500, 10, gDeferBuffer, 16} // Defer
+} ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 rate limit test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+  ACAN_T4::can1.setRateLimits (gRateLimits, 2) ;
+  if (!ACAN_T4_PeriodicScheduler::begin ()) { // Releases deferred frames
+    Serial.println ("No timer available") ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gReceivedCount = 0 ;
+static uint32_t gIdentifier = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Flood
+  CANMessage message ;
+  message.id = 0x100 ;
+  ACAN_T4::can1.tryToSend (message) ;
+  message.id = 0x200 + (gIdentifier & 0x0F) ;
+  if (ACAN_T4::can1.tryToSend (message)) {
+    gIdentifier += 1 ;
+  }
+//--- Receive
+  while (ACAN_T4::can1.receive (message)) {
+    gReceivedCount += 1 ;
+  }
+//--- Display statistics
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Received: ") ;
+    Serial.println (gReceivedCount) ;
+    for (uint32_t i=0 ; i<2 ; i++) {
+      Serial.print ("  limit ") ;
+      Serial.print (i) ;
+      Serial.print (": sent ") ;
+      Serial.print (gRateLimits [i].sentCount ()) ;
+      Serial.print (", deferred ") ;
+      Serial.print (gRateLimits [i].deferredCount ()) ;
+      Serial.print (", rejected ") ;
+      Serial.print (gRateLimits [i].rejectedCount ()) ;
+      Serial.print (", pending ") ;
+      Serial.println (gRateLimits [i].pendingCount ()) ;
+    }
+  }
+}
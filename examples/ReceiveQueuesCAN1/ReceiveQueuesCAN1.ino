@@ -0,0 +1,116 @@
+// Receive queues and overflow policies demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. Filter #0 accepts the chatty identifier 0x100 (sent 200 times per second), filter #1
+// accepts the safety identifier 0x010 (sent 10 times per second). 0x100 frames go to their own
+// small receive queue with the DROP_OLDEST policy, so they never fill the driver receive buffer,
+// and the newest 0x100 frames are kept. The loop reads the queues slowly, every 100 ms.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static CANMessage gChattyBuffer [8] ;
+static ACAN_T4_ReceiveQueue gChattyQueue (gChattyBuffer, 8, ACAN_T4_ReceiveOverflowPolicy::DROP_OLDEST) ;
+static ACAN_T4_ReceiveQueue * gQueues [1] = { & gChattyQueue } ; // Filter #0
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 receive queues test") ;
+  ACAN_T4_Settings settings (500 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  settings.mReceiveBufferSize = 16 ;
+  settings.mReceiveOverflowPolicy = ACAN_T4_ReceiveOverflowPolicy::OVERWRITE_SAME_ID ;
+  const ACANPrimaryFilter primaryFilters [2] = {
+    ACANPrimaryFilter (kData, kStandard, 0x100), // Filter #0
+    ACANPrimaryFilter (kData, kStandard, 0x010)  // Filter #1
+  } ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings, primaryFilters, 2) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+  ACAN_T4::can1.setReceiveQueues (gQueues, 1) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gChattySendDate = 0 ;
+static uint32_t gSafetySendDate = 0 ;
+static uint32_t gReadDate = 0 ;
+static uint32_t gChattyCounter = 0 ;
+static uint32_t gSafetyCounter = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  const uint32_t now = millis () ;
+  if (gChattySendDate <= now) {
+    gChattySendDate += 5 ;
+    CANMessage frame ;
+    frame.id = 0x100 ;
+    frame.len = 4 ;
+    frame.data32 [0] = gChattyCounter ;
+    gChattyCounter += 1 ;
+    ACAN_T4::can1.tryToSend (frame) ;
+  }
+  if (gSafetySendDate <= now) {
+    gSafetySendDate += 100 ;
+    CANMessage frame ;
+    frame.id = 0x010 ;
+    frame.len = 4 ;
+    frame.data32 [0] = gSafetyCounter ;
+    gSafetyCounter += 1 ;
+    ACAN_T4::can1.tryToSend (frame) ;
+  }
+  if (gReadDate <= now) {
+    gReadDate += 100 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANMessage frame ;
+    uint32_t chattyCount = 0 ;
+    uint32_t lastChatty = 0 ;
+    while (gChattyQueue.receive (frame)) {
+      chattyCount += 1 ;
+      lastChatty = frame.data32 [0] ;
+    }
+    uint32_t lastSafety = 0 ;
+    while (ACAN_T4::can1.receive (frame)) {
+      lastSafety = frame.data32 [0] ;
+    }
+    Serial.print ("0x100: ") ;
+    Serial.print (chattyCount) ;
+    Serial.print (" frames, last ") ;
+    Serial.print (lastChatty) ;
+    Serial.print (", lost ") ;
+    Serial.print (gChattyQueue.overflowCount ()) ;
+    Serial.print ("; 0x010: last ") ;
+    Serial.print (lastSafety) ;
+    Serial.print (", lost ") ;
+    Serial.println (ACAN_T4::can1.receiveBufferOverflowCount ()) ;
+  }
+}
@@ -0,0 +1,85 @@
+// Replays on CAN1 the CAN1 traffic of a trace recorded by the CaptureToSDCard sketch (Teensy 4.1)
+
+// Frames are sent with their original inter-frame timing. Trace blocks are read from the
+// TRACE.BIN file of the built-in SD card while replaying.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.1"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4_TraceReplayer.h>
+#include <SD.h>
+
+//-----------------------------------------------------------------
+
+static const uint32_t BLOCK_COUNT = 16 ;
+static uint8_t gBlockStorage [BLOCK_COUNT * ACAN_T4_TRACE_BLOCK_SIZE] __attribute__ ((aligned (4))) ;
+static ACAN_T4_TraceReplayer gReplayer ;
+static File gTraceFile ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("Replay from SD card") ;
+  if (!SD.begin (BUILTIN_SDCARD)) {
+    Serial.println ("SD card error") ;
+    while (1) {}
+  }
+  gTraceFile = SD.open ("TRACE.BIN", FILE_READ) ;
+  ACAN_T4_Settings settings (500 * 1000) ; // 500 kbit/s
+  settings.mTransmitBufferSize = 64 ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+//--- Replay CAN1 records (channel 0), at original speed
+  gReplayer.begin (ACAN_T4::can1, gBlockStorage, BLOCK_COUNT, 100, 0) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+//--- Send due frames
+  gReplayer.poll () ;
+//--- Read one block from the trace file, if there is room
+  uint8_t * block = gReplayer.freeBlock () ;
+  if (block != nullptr) {
+    if (gTraceFile.read (block, ACAN_T4_TRACE_BLOCK_SIZE) == ACAN_T4_TRACE_BLOCK_SIZE) {
+      gReplayer.commitBlock () ;
+    }else{
+      gReplayer.endOfTrace () ;
+    }
+  }
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 2000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print (gReplayer.done () ? "Done. Sent: " : "Sent: ") ;
+    Serial.print (gReplayer.sentFrameCount ()) ;
+    Serial.print (", dropped: ") ;
+    Serial.print (gReplayer.droppedFrameCount ()) ;
+    Serial.print (", timing error max: ") ;
+    Serial.print (gReplayer.maxTimingError ()) ;
+    Serial.print (" us, average: ") ;
+    Serial.print (gReplayer.averageTimingError ()) ;
+    Serial.println (" us") ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,92 @@
+// Signal encoding and decoding demo for Teensy 4.x CAN1
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends. The frame layout is declared once, as compile time constants (see ACAN_T4_Signal.h).
+// Every second, a frame is encoded and sent; the received frame is decoded.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+#include <ACAN_T4_Signal.h>
+
+//-----------------------------------------------------------------
+//   FRAME LAYOUT
+//-----------------------------------------------------------------
+
+namespace EngineStatus {
+  static const uint32_t kIdentifier = 0x0CF00400 ;
+  static constexpr ACAN_T4_Signal <24, 16> kEngineSpeed (0.125f) ; // rpm, Intel
+  static constexpr ACAN_T4_Signal <7, 12, ACAN_T4_ByteOrder::kMotorola, true> kTorque (0.5f, -100.0f) ; // %
+  static constexpr ACAN_T4_Signal <56, 8> kCounter ;
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 signals loopback test") ;
+  ACAN_T4_Settings settings (500 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSendDate = 0 ;
+static uint8_t gCounter = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate <= millis ()) {
+    gSendDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANMessage frame ;
+    frame.id = EngineStatus::kIdentifier ;
+    frame.ext = true ;
+    frame.len = 8 ;
+    EngineStatus::kEngineSpeed.setValue (frame, 800.0f + 10.0f * gCounter) ;
+    EngineStatus::kTorque.setValue (frame, -20.5f + gCounter) ;
+    EngineStatus::kCounter.setRaw (frame, gCounter) ;
+    gCounter += 1 ;
+    const bool ok = ACAN_T4::can1.tryToSend (frame) ;
+    if (!ok) {
+      Serial.println ("Send failure") ;
+    }
+  }
+  CANMessage frame ;
+  if (ACAN_T4::can1.receive (frame) && (frame.id == EngineStatus::kIdentifier)) {
+    Serial.print ("Counter ") ;
+    Serial.print (uint32_t (EngineStatus::kCounter.raw (frame))) ;
+    Serial.print (", engine speed ") ;
+    Serial.print (EngineStatus::kEngineSpeed.value (frame)) ;
+    Serial.print (" rpm, torque ") ;
+    Serial.print (EngineStatus::kTorque.value (frame)) ;
+    Serial.println (" %") ;
+  }
+}
@@ -0,0 +1,119 @@
+// Time triggered schedule demo for Teensy 4.x CAN1
+
+// CAN1 is the time master of a 4 basic cycle matrix; a basic cycle lasts 2 ms and starts with the
+// reference message 0x001, whose first byte is the basic cycle number. Exclusive windows:
+//   - 0x100 from 200 µs to 600 µs, in every basic cycle;
+//   - 0x200 from 800 µs to 1200 µs, in basic cycles 1 and 3;
+//   - 0x300 from 1400 µs to 1800 µs, in basic cycle 2.
+// Frames are written in dedicated Tx mailboxes by a 50 µs timer interrupt; a frame not sent at
+// the end of its window is aborted (overrun).
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static CANMessage frame (const uint32_t inIdentifier, const uint8_t inLength) {
+  CANMessage result ;
+  result.id = inIdentifier ;
+  result.len = inLength ;
+  return result ;
+}
+
+//-----------------------------------------------------------------
+
+static const uint32_t WINDOW_COUNT = 3 ;
+
+static ACAN_T4_TimeTriggeredWindow gWindows [WINDOW_COUNT] = {
+  {frame (0x100, 8),  200, 400},       // Every basic cycle
+  {frame (0x200, 4),  800, 400, 2, 1}, // Basic cycles 1 and 3
+  {frame (0x300, 2), 1400, 400, 4, 2}  // Basic cycle 2
+} ;
+
+static ACAN_T4_TimeTriggeredSchedule gSchedule (gWindows, WINDOW_COUNT,
+                                                2000, // Basic cycle, µs
+                                                4, // Basic cycle count
+                                                kStandard, 0x001, // Reference message
+                                                true) ; // Time master
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 time triggered schedule test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    errorCode = gSchedule.begin (ACAN_T4::can1) ;
+  }
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  CANMessage message ;
+  while (ACAN_T4::can1.receive (message)) {
+    gReceivedCount += 1 ;
+  }
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  //--- Update 0x100 payload
+    CANMessage update = frame (0x100, 8) ;
+    update.data32 [0] = millis () ;
+    gWindows [0].update (update) ;
+  //--- Display statistics
+    Serial.print ("Received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", reference messages: ") ;
+    Serial.println (gSchedule.referenceCount ()) ;
+    for (uint32_t i=0 ; i<WINDOW_COUNT ; i++) {
+      Serial.print ("  window ") ;
+      Serial.print (i) ;
+      Serial.print (": sent ") ;
+      Serial.print (gWindows [i].sentCount ()) ;
+      Serial.print (", overrun ") ;
+      Serial.print (gWindows [i].overrunCount ()) ;
+      Serial.print (", missed ") ;
+      Serial.print (gWindows [i].missedCount ()) ;
+      Serial.print (", max start latency ") ;
+      Serial.print (gWindows [i].maxStartLatency ()) ;
+      Serial.println (" us") ;
+    }
+  }
+}
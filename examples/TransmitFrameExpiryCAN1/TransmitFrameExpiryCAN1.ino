@@ -0,0 +1,102 @@
+// Transmit frame expiry demo for Teensy 4.x CAN1
+
+// Every second, a burst of 32 setpoint frames is submitted; at 125 kb/s, sending them takes more
+// than 20 ms. Frames stored in the transmit buffer expire 10 ms after their submission: the
+// frames still queued at that time are dropped instead of being sent, the expired frame call back
+// counts them.
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static const uint32_t BURST_SIZE = 32 ;
+
+static volatile uint32_t gExpiredCallBackCount = 0 ;
+
+//-----------------------------------------------------------------
+
+static void expiredFrame (const CANMessage & /* inMessage */) { // Called by the CAN interrupt
+  gExpiredCallBackCount += 1 ;
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 transmit frame expiry test") ;
+  ACAN_T4_Settings settings (125 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  settings.mTransmitBufferSize = BURST_SIZE ;
+  settings.mTransmitFrameExpiry = true ;
+  settings.mTransmitFrameLifetime = 10 ; // ms
+  settings.mExpiredTransmitFrameCallBack = expiredFrame ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gSubmittedCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  CANMessage message ;
+  while (ACAN_T4::can1.receive (message)) {
+    gReceivedCount += 1 ;
+  }
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  //--- Display statistics of previous burst
+    Serial.print ("Submitted: ") ;
+    Serial.print (gSubmittedCount) ;
+    Serial.print (", received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", expired: ") ;
+    Serial.print (ACAN_T4::can1.expiredTransmitFrameCount ()) ;
+    Serial.print (" (call back: ") ;
+    Serial.print (gExpiredCallBackCount) ;
+    Serial.println (")") ;
+  //--- Submit a burst
+    for (uint32_t i=0 ; i<BURST_SIZE ; i++) {
+      message.id = 0x100 + i ;
+      message.len = 8 ;
+      message.data32 [0] = millis () ;
+      if (ACAN_T4::can1.tryToSend (message)) {
+        gSubmittedCount += 1 ;
+      }
+    }
+  }
+}
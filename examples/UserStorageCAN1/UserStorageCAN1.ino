@@ -0,0 +1,90 @@
+// User provided storage demo for Teensy 4.x CAN1
+
+// The driver buffers are provided by the sketch instead of being allocated on the heap by begin:
+// the receive buffer is a global array, so it is in DTCM (the fastest memory), the transmit buffer
+// is placed in OCRAM by DMAMEM. end does not free them.
+
+// The FlexCAN module is configured in loop back mode: it internally receives every CAN frame it
+// sends.
+
+// No external hardware required.
+
+//-----------------------------------------------------------------
+
+#ifndef __IMXRT1062__
+  #error "This sketch should be compiled for Teensy 4.x"
+#endif
+
+//-----------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//-----------------------------------------------------------------
+
+static const uint16_t RECEIVE_BUFFER_SIZE = 64 ;
+static const uint16_t TRANSMIT_BUFFER_SIZE = 16 ;
+
+static CANMessage gReceiveBuffer [RECEIVE_BUFFER_SIZE] ; // DTCM
+DMAMEM static CANMessage gTransmitBuffer [TRANSMIT_BUFFER_SIZE] ; // OCRAM
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    delay (50) ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  }
+  Serial.println ("CAN1 user storage test") ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  settings.mReceiveBufferSize = RECEIVE_BUFFER_SIZE ;
+  settings.mReceiveBufferStorage = gReceiveBuffer ;
+  settings.mTransmitBufferSize = TRANSMIT_BUFFER_SIZE ;
+  settings.mTransmitBufferStorage = gTransmitBuffer ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("can1 ok") ;
+  }else{
+    Serial.print ("Error can1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+    while (1) {
+      delay (100) ;
+      Serial.println ("Invalid setting") ;
+      digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    }
+  }
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBlinkDate = 0 ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  CANMessage frame ;
+  frame.id = 0x542 ;
+  frame.len = 8 ;
+  frame.data64 = gSentCount ;
+  if (ACAN_T4::can1.tryToSend (frame)) {
+    gSentCount += 1 ;
+  }
+  while (ACAN_T4::can1.receive (frame)) {
+    gReceivedCount += 1 ;
+  }
+  if (gBlinkDate <= millis ()) {
+    gBlinkDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gSentCount) ;
+    Serial.print (", received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", receive buffer peak count: ") ;
+    Serial.println (ACAN_T4::can1.receiveBufferPeakCount ()) ;
+  }
+}
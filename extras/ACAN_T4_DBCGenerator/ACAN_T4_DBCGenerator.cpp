@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------------------
+// Host-side generator of ACAN_T4_Signal declarations from a DBC file
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Build (from this directory):
+//   c++ -std=c++11 -O2 -o acan_t4_dbc_generator ACAN_T4_DBCGenerator.cpp
+//
+// Usage:
+//   acan_t4_dbc_generator network.dbc > network.h
+//
+// Every message (BO_) is a namespace named after the message, that contains kIdentifier,
+// kExtended, kLength, and one ACAN_T4_Signal constant per signal (SG_), named k<signal name>.
+// Multiplexed signals are generated as plain signals, the multiplexor value is given in a comment.
+// Signals that ACAN_T4_Signal cannot handle (more than 8 consecutive bytes) are reported in a
+// comment, and on stderr.
+//--------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t LINE_SIZE = 4096 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void printFloat (const double inValue) {
+  char s [64] ;
+  snprintf (s, sizeof (s), "%.9g", inValue) ;
+  printf ("%s%sf", s, (strpbrk (s, ".e") == nullptr) ? ".0" : "") ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bool signalFits (const uint32_t inStartBit,
+                        const uint32_t inLength,
+                        const bool inMotorola,
+                        const uint32_t inFrameLength) {
+  const uint32_t size = (inFrameLength <= 8) ? 8 : 64 ;
+  const uint32_t firstBit = inMotorola ? ((inStartBit & ~ 7U) + 7 - (inStartBit & 7)) : inStartBit ;
+  const uint32_t lastBit = firstBit + inLength - 1 ;
+  const uint32_t firstByte = ((inStartBit / 8) < (size - 8)) ? (inStartBit / 8) : (size - 8) ;
+  return (inLength > 0) && (inLength <= 64) && (lastBit < (size * 8)) && ((lastBit - firstByte * 8) < 64) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (int argc, const char * argv []) {
+  if (argc != 2) {
+    fprintf (stderr, "Usage: %s network.dbc > network.h\n", argv [0]) ;
+    return 1 ;
+  }
+  FILE * f = fopen (argv [1], "r") ;
+  if (f == nullptr) {
+    fprintf (stderr, "Cannot open %s\n", argv [1]) ;
+    return 1 ;
+  }
+  printf ("// Generated by acan_t4_dbc_generator from %s\n\n", argv [1]) ;
+  printf ("#pragma once\n\n#include <ACAN_T4_Signal.h>\n") ;
+  char line [LINE_SIZE] ;
+  char messageName [LINE_SIZE] ;
+  bool inMessage = false ;
+  bool skipMessage = false ;
+  uint32_t frameLength = 0 ;
+  uint32_t errorCount = 0 ;
+  while (fgets (line, LINE_SIZE, f) != nullptr) {
+    const char * p = line ;
+    while ((*p == ' ') || (*p == '\t')) {
+      p += 1 ;
+    }
+    unsigned long identifier ;
+    unsigned length ;
+    if (sscanf (p, "BO_ %lu %[A-Za-z0-9_]: %u", &identifier, messageName, &length) == 3) {
+      if (inMessage) {
+        printf ("}\n") ;
+      }
+    //--- Pseudo message of signals that are not attached to a message
+      skipMessage = strcmp (messageName, "VECTOR__INDEPENDENT_SIG_MSG") == 0 ;
+      inMessage = !skipMessage ;
+      frameLength = length ;
+      if (inMessage) {
+        const bool extended = (identifier & 0x80000000UL) != 0 ;
+        printf ("\n//%s\n\n", "------------------------------------------------------------------------------------------------") ;
+        printf ("namespace %s {\n", messageName) ;
+        printf ("  static const uint32_t kIdentifier = 0x%lX ;\n", identifier & (extended ? 0x1FFFFFFFUL : 0x7FFUL)) ;
+        printf ("  static const bool kExtended = %s ;\n", extended ? "true" : "false") ;
+        printf ("  static const uint8_t kLength = %u ;\n", length) ;
+      }
+    }else if (strncmp (p, "SG_ ", 4) == 0) {
+      char signalName [LINE_SIZE] ;
+      char multiplex [LINE_SIZE] ;
+      unsigned startBit, bitLength, order ;
+      char sign ;
+      double factor, offset ;
+      bool ok = sscanf (p, "SG_ %[A-Za-z0-9_] : %u|%u@%u%c (%lf,%lf)",
+                        signalName, &startBit, &bitLength, &order, &sign, &factor, &offset) == 7 ;
+      multiplex [0] = '\0' ;
+      if (!ok) {
+        ok = sscanf (p, "SG_ %[A-Za-z0-9_] %[Mm0-9] : %u|%u@%u%c (%lf,%lf)",
+                     signalName, multiplex, &startBit, &bitLength, &order, &sign, &factor, &offset) == 8 ;
+      }
+      if (!ok) {
+        fprintf (stderr, "Cannot parse: %s", line) ;
+        errorCount += 1 ;
+      }else if (skipMessage) {
+      //--- Signal of VECTOR__INDEPENDENT_SIG_MSG: ignored
+      }else if (!inMessage) {
+        fprintf (stderr, "Signal %s outside message\n", signalName) ;
+        errorCount += 1 ;
+      }else if (!signalFits (startBit, bitLength, order == 0, frameLength)) {
+        printf ("  // %s (%u|%u@%u%c): not supported, more than 8 consecutive bytes\n",
+                signalName, startBit, bitLength, order, sign) ;
+        fprintf (stderr, "Signal %s of %s not supported\n", signalName, messageName) ;
+      }else{
+        if (multiplex [0] == 'M') {
+          printf ("  // Multiplexor\n") ;
+        }else if (multiplex [0] == 'm') {
+          printf ("  // Multiplexed, when multiplexor is %s\n", multiplex + 1) ;
+        }
+        printf ("  static constexpr ACAN_T4_Signal <%u, %u, ACAN_T4_ByteOrder::%s, %s> k%s (",
+                startBit, bitLength, (order == 0) ? "kMotorola" : "kIntel", (sign == '-') ? "true" : "false",
+                signalName) ;
+        printFloat (factor) ;
+        printf (", ") ;
+        printFloat (offset) ;
+        printf (") ;\n") ;
+      }
+    }
+  }
+  if (inMessage) {
+    printf ("}\n") ;
+  }
+  printf ("\n//%s\n", "------------------------------------------------------------------------------------------------") ;
+  fclose (f) ;
+  return (errorCount == 0) ? 0 : 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------------------
+// Host-side converter for traces written by ACAN_T4_TraceRecorder
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Build (from this directory):
+//   c++ -std=c++11 -O2 -I../../src -o acan_t4_trace_converter ACAN_T4_TraceConverter.cpp
+//
+// Usage:
+//   acan_t4_trace_converter candump trace.bin > trace.log   (candump -l format)
+//   acan_t4_trace_converter asc trace.bin > trace.asc       (Vector ASCII format)
+//
+// Channels are named can0 (CAN1), can1 (CAN2), can2 (CAN3) in candump output, and 1, 2, 3 in
+// ASC output. Timestamps are relative to the first record; 32-bit µs wrap-arounds are unfolded.
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_TraceFormat.h>
+#include <stdio.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t CANFD_LENGTH_CODE [16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t lengthCode (const uint32_t inLength) {
+  uint32_t code = 0 ;
+  while ((code < 15) && (CANFD_LENGTH_CODE [code] < inLength)) {
+    code += 1 ;
+  }
+  return code ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+enum class OutputFormat {CANDUMP, ASC} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void printCandumpRecord (const ACAN_T4_TraceRecord & inRecord,
+                                const uint64_t inTimestamp) {
+  printf ("(%llu.%06llu) can%u ",
+          (unsigned long long) (inTimestamp / 1000000),
+          (unsigned long long) (inTimestamp % 1000000),
+          inRecord.mChannel) ;
+  printf (inRecord.mExtended ? "%08X" : "%03X", inRecord.mIdentifier) ;
+  switch (inRecord.mType) {
+  case ACAN_T4_TRACE_REMOTE :
+    printf ("#R%u", inRecord.mLength) ;
+    break ;
+  case ACAN_T4_TRACE_DATA :
+    printf ("#") ;
+    break ;
+  case ACAN_T4_TRACE_FD_NO_BIT_RATE_SWITCH :
+    printf ("##0") ;
+    break ;
+  default :
+    printf ("##1") ; // BRS flag
+    break ;
+  }
+  if (inRecord.mType != ACAN_T4_TRACE_REMOTE) {
+    for (uint32_t i=0 ; i<inRecord.mLength ; i++) {
+      printf ("%02X", inRecord.mData [i]) ;
+    }
+  }
+  printf ("\n") ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void printASCRecord (const ACAN_T4_TraceRecord & inRecord,
+                            const uint64_t inTimestamp) {
+  const unsigned channel = inRecord.mChannel + 1U ;
+  char identifier [16] ;
+  snprintf (identifier, sizeof (identifier), inRecord.mExtended ? "%Xx" : "%X", inRecord.mIdentifier) ;
+  printf ("%11.6f ", double (inTimestamp) / 1.0e6) ;
+  switch (inRecord.mType) {
+  case ACAN_T4_TRACE_REMOTE :
+    printf ("%u  %-15s Rx   r %X\n", channel, identifier, inRecord.mLength) ;
+    break ;
+  case ACAN_T4_TRACE_DATA :
+    printf ("%u  %-15s Rx   d %X", channel, identifier, inRecord.mLength) ;
+    for (uint32_t i=0 ; i<inRecord.mLength ; i++) {
+      printf (" %02X", inRecord.mData [i]) ;
+    }
+    printf ("\n") ;
+    break ;
+  default :
+    printf ("CANFD %3u Rx   %8s %32s %u 0 %X %2u",
+            channel,
+            identifier,
+            "",
+            (inRecord.mType == ACAN_T4_TRACE_FD_WITH_BIT_RATE_SWITCH) ? 1U : 0U,
+            lengthCode (inRecord.mLength),
+            inRecord.mLength) ;
+    for (uint32_t i=0 ; i<inRecord.mLength ; i++) {
+      printf (" %02X", inRecord.mData [i]) ;
+    }
+    printf ("        0    0     3000        0        0        0        0        0\n") ;
+    break ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (int argc, char * argv []) {
+  OutputFormat format = OutputFormat::CANDUMP ;
+  bool argumentsOk = argc == 3 ;
+  if (argumentsOk) {
+    if (strcmp (argv [1], "asc") == 0) {
+      format = OutputFormat::ASC ;
+    }else if (strcmp (argv [1], "candump") != 0) {
+      argumentsOk = false ;
+    }
+  }
+  if (!argumentsOk) {
+    fprintf (stderr, "Usage: %s candump|asc <trace file>\n", argv [0]) ;
+    return 1 ;
+  }
+  FILE * f = fopen (argv [2], "rb") ;
+  if (f == nullptr) {
+    fprintf (stderr, "Cannot open '%s'\n", argv [2]) ;
+    return 1 ;
+  }
+  if (format == OutputFormat::ASC) {
+    printf ("date Thu Jan 1 00:00:00.000 am 1970\n") ;
+    printf ("base hex  timestamps absolute\n") ;
+    printf ("no internal events logged\n") ;
+    printf ("Begin Triggerblock\n") ;
+  }
+  uint8_t block [ACAN_T4_TRACE_BLOCK_SIZE] ;
+  uint32_t blockIndex = 0 ;
+  uint32_t invalidBlockCount = 0 ;
+  uint32_t expectedSequenceNumber = 0 ;
+  uint64_t lostFrameCount = 0 ;
+  uint64_t frameCount = 0 ;
+  bool firstRecord = true ;
+  uint32_t previousTimestamp = 0 ;
+  uint64_t timestamp = 0 ; // Unfolded, relative to first record
+  while (fread (block, ACAN_T4_TRACE_BLOCK_SIZE, 1, f) == 1) {
+    uint32_t sequenceNumber ;
+    uint32_t usedBytes ;
+    uint32_t recordCount ;
+    uint32_t lostFrames ;
+    if (!acanTraceReadBlockHeader (block, sequenceNumber, usedBytes, recordCount, lostFrames)) {
+      invalidBlockCount += 1 ;
+    }else{
+      if (sequenceNumber != expectedSequenceNumber) {
+        fprintf (stderr, "Block %u: sequence number %u, expected %u\n",
+                 blockIndex, sequenceNumber, expectedSequenceNumber) ;
+      }
+      expectedSequenceNumber = sequenceNumber + 1 ;
+      lostFrameCount += lostFrames ;
+      uint32_t offset = ACAN_T4_TRACE_BLOCK_HEADER_SIZE ;
+      for (uint32_t r=0 ; r<recordCount ; r++) {
+        ACAN_T4_TraceRecord record ;
+        const uint32_t size = acanTraceDecodeRecord (block + offset, usedBytes - offset, record) ;
+        if (size == 0) {
+          fprintf (stderr, "Block %u: malformed record %u\n", blockIndex, r) ;
+          break ;
+        }
+        offset += size ;
+        if (!firstRecord) {
+          timestamp += uint32_t (record.mTimestamp - previousTimestamp) ; // Modulo 2**32
+        }
+        firstRecord = false ;
+        previousTimestamp = record.mTimestamp ;
+        frameCount += 1 ;
+        if (format == OutputFormat::CANDUMP) {
+          printCandumpRecord (record, timestamp) ;
+        }else{
+          printASCRecord (record, timestamp) ;
+        }
+      }
+    }
+    blockIndex += 1 ;
+  }
+  fclose (f) ;
+  if (format == OutputFormat::ASC) {
+    printf ("End TriggerBlock\n") ;
+  }
+  fprintf (stderr, "%llu frames, %llu lost, %u blocks, %u invalid blocks\n",
+           (unsigned long long) frameCount,
+           (unsigned long long) lostFrameCount,
+           blockIndex,
+           invalidBlockCount) ;
+  return 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
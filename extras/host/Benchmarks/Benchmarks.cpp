@@ -0,0 +1,386 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: hot path benchmarks
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Measures on the host, in ns per frame (or per call) and frames (calls) per second:
+//   - receive buffer enqueue (interrupt service routine) and dequeue (receive, receiveFD);
+//   - transmit buffer enqueue (tryToSend) and refill (interrupt service routine);
+//   - dispatchReceivedMessage with 32 filters, dispatchReceivedMessageFD with 11 filters (one
+//     per Rx mailbox), and call backs;
+//   - filter encoding (ACANPrimaryFilter, ACANSecondaryFilter, ACANFDFilter constructors);
+//   - bit timing solvers (ACAN_T4_Settings, ACAN_T4FD_Settings constructors).
+// Driver paths run against simulated FlexCAN modules: register accesses are function calls,
+// so interrupt service routine figures include the simulation overhead. Use them for
+// comparing library versions or buffer sizes on the same machine, not as target figures.
+//
+// Results are written in JSON to the file given as first argument, or to standard output.
+//
+// Build (from this directory):
+//   c++ -std=c++11 -O2 -DACAN_T4_HOST_SIMULATION -I../simulation -I../../../src
+//       -o benchmarks Benchmarks.cpp ../simulation/*.cpp ../../../src/*.cpp
+// (a single command line)
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+#include <ACAN_T4_SimulatedFlexCAN.h>
+#include <stdio.h>
+#include <time.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t ROUND_COUNT = 200 ;
+static const uint32_t BUFFER_SIZE = 1024 ;
+static const uint32_t FILTER_COUNT = 32 ;
+
+//--------------------------------------------------------------------------------------------------
+//   RESULTS
+//--------------------------------------------------------------------------------------------------
+
+static uint64_t hostNanoseconds (void) {
+  struct timespec t ;
+  clock_gettime (CLOCK_MONOTONIC, & t) ;
+  return uint64_t (t.tv_sec) * 1000000000ULL + uint64_t (t.tv_nsec) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+class BenchmarkResult {
+  public: const char * mName ;
+  public: uint64_t mOperationCount ;
+  public: uint64_t mDuration ; // In ns
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t MAX_RESULT_COUNT = 32 ;
+static BenchmarkResult gResults [MAX_RESULT_COUNT] ;
+static uint32_t gResultCount = 0 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void addResult (const char * inName, const uint64_t inOperationCount, const uint64_t inDuration) {
+  if (gResultCount < MAX_RESULT_COUNT) {
+    gResults [gResultCount].mName = inName ;
+    gResults [gResultCount].mOperationCount = inOperationCount ;
+    gResults [gResultCount].mDuration = inDuration ;
+    gResultCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void writeJSON (FILE * inFile) {
+  fprintf (inFile, "{\n") ;
+  fprintf (inFile, "  \"library\": \"ACAN_T4\",\n") ;
+  fprintf (inFile, "  \"compiler\": \"%s\",\n", __VERSION__) ;
+  fprintf (inFile, "  \"buffer_size\": %u,\n", BUFFER_SIZE) ;
+  fprintf (inFile, "  \"filter_count\": %u,\n", FILTER_COUNT) ;
+  fprintf (inFile, "  \"benchmarks\": [\n") ;
+  for (uint32_t i=0 ; i<gResultCount ; i++) {
+    const BenchmarkResult & r = gResults [i] ;
+    const double nsPerOperation = (r.mOperationCount == 0) ? 0.0 : (double (r.mDuration) / double (r.mOperationCount)) ;
+    fprintf (inFile, "    {\"name\": \"%s\", \"count\": %llu, \"ns_per_frame\": %.2f, \"frames_per_second\": %.0f}%s\n",
+             r.mName,
+             (unsigned long long) r.mOperationCount,
+             nsPerOperation,
+             (nsPerOperation > 0.0) ? (1.0e9 / nsPerOperation) : 0.0,
+             (i < (gResultCount - 1)) ? "," : "") ;
+  }
+  fprintf (inFile, "  ]\n") ;
+  fprintf (inFile, "}\n") ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   SINKS (prevent the compiler from removing benchmarked code)
+//--------------------------------------------------------------------------------------------------
+
+static volatile uint32_t gSink ;
+static volatile uint32_t gCallBackCount ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void callBack (const CANMessage & inMessage) {
+  gCallBackCount = gCallBackCount + inMessage.id ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void callBackFD (const CANFDMessage & inMessage) {
+  gCallBackCount = gCallBackCount + inMessage.id ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   RECEIVE BUFFER
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkReceive (void) {
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mReceiveBufferSize = BUFFER_SIZE ;
+  ACAN_T4::can1.begin (settings) ;
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CAN_DATA ;
+  frame.len = 8 ;
+  uint64_t enqueueDuration = 0 ;
+  uint64_t dequeueDuration = 0 ;
+  for (uint32_t round=0 ; round<ROUND_COUNT ; round++) {
+    uint64_t start = hostNanoseconds () ;
+    for (uint32_t i=0 ; i<BUFFER_SIZE ; i++) {
+      frame.id = i & 0x7FF ;
+      ACAN_T4_SimulatedFlexCAN::flexcan1.receiveFrame (frame) ;
+    }
+    enqueueDuration += hostNanoseconds () - start ;
+    start = hostNanoseconds () ;
+    CANMessage message ;
+    while (ACAN_T4::can1.receive (message)) {
+      gSink = message.id ;
+    }
+    dequeueDuration += hostNanoseconds () - start ;
+  }
+  addResult ("receive_isr_enqueue", uint64_t (ROUND_COUNT) * BUFFER_SIZE, enqueueDuration) ;
+  addResult ("receive_dequeue", uint64_t (ROUND_COUNT) * BUFFER_SIZE, dequeueDuration) ;
+  ACAN_T4::can1.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkReceiveFD (void) {
+  ACAN_T4FD_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  settings.mReceiveBufferSize = BUFFER_SIZE ;
+  ACAN_T4::can3.beginFD (settings) ;
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  uint64_t enqueueDuration = 0 ;
+  uint64_t dequeueDuration = 0 ;
+  for (uint32_t round=0 ; round<ROUND_COUNT ; round++) {
+    uint64_t start = hostNanoseconds () ;
+    for (uint32_t i=0 ; i<BUFFER_SIZE ; i++) {
+      frame.id = i & 0x7FF ;
+      ACAN_T4_SimulatedFlexCAN::flexcan3.receiveFrame (frame) ;
+    }
+    enqueueDuration += hostNanoseconds () - start ;
+    start = hostNanoseconds () ;
+    while (ACAN_T4::can3.receiveFD (frame)) {
+      gSink = frame.id ;
+    }
+    dequeueDuration += hostNanoseconds () - start ;
+  }
+  addResult ("receive_fd64_isr_enqueue", uint64_t (ROUND_COUNT) * BUFFER_SIZE, enqueueDuration) ;
+  addResult ("receive_fd64_dequeue", uint64_t (ROUND_COUNT) * BUFFER_SIZE, dequeueDuration) ;
+  ACAN_T4::can3.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TRANSMIT BUFFER
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkTransmit (void) {
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mTransmitBufferSize = BUFFER_SIZE ;
+  ACAN_T4::can1.begin (settings) ;
+  CANMessage message ;
+  message.len = 8 ;
+  uint64_t enqueueDuration = 0 ;
+  uint64_t refillDuration = 0 ;
+  uint64_t refillCount = 0 ;
+  for (uint32_t round=0 ; round<ROUND_COUNT ; round++) {
+    uint64_t start = hostNanoseconds () ;
+    for (uint32_t i=0 ; i<BUFFER_SIZE ; i++) {
+      message.id = i & 0x7FF ;
+      ACAN_T4::can1.tryToSend (message) ;
+    }
+    enqueueDuration += hostNanoseconds () - start ;
+  //--- Every transmission completion refills Tx mailbox from transmit buffer
+    start = hostNanoseconds () ;
+    refillCount += ACAN_T4_SimulatedFlexCAN::flexcan1.transmitPendingFrames () ;
+    refillDuration += hostNanoseconds () - start ;
+  }
+  addResult ("transmit_enqueue", uint64_t (ROUND_COUNT) * BUFFER_SIZE, enqueueDuration) ;
+  addResult ("transmit_isr_refill", refillCount, refillDuration) ;
+  ACAN_T4::can1.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkTransmitFD (void) {
+  ACAN_T4FD_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  settings.mTransmitBufferSize = BUFFER_SIZE ;
+  ACAN_T4::can3.beginFD (settings) ;
+  CANFDMessage message ;
+  message.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  message.len = 64 ;
+  uint64_t enqueueDuration = 0 ;
+  uint64_t refillDuration = 0 ;
+  uint64_t refillCount = 0 ;
+  for (uint32_t round=0 ; round<ROUND_COUNT ; round++) {
+    uint64_t start = hostNanoseconds () ;
+    for (uint32_t i=0 ; i<BUFFER_SIZE ; i++) {
+      message.id = i & 0x7FF ;
+      ACAN_T4::can3.tryToSendFD (message) ;
+    }
+    enqueueDuration += hostNanoseconds () - start ;
+    start = hostNanoseconds () ;
+    refillCount += ACAN_T4_SimulatedFlexCAN::flexcan3.transmitPendingFrames () ;
+    refillDuration += hostNanoseconds () - start ;
+  }
+  addResult ("transmit_fd64_enqueue", uint64_t (ROUND_COUNT) * BUFFER_SIZE, enqueueDuration) ;
+  addResult ("transmit_fd64_isr_refill", refillCount, refillDuration) ;
+  ACAN_T4::can3.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   DISPATCH
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkDispatch (void) {
+//--- 16 primary filters (standard data frames), 16 secondary filters (extended data frames)
+  ACANPrimaryFilter primaryFilters [FILTER_COUNT / 2] = {
+    ACANPrimaryFilter (kData, kStandard, 0x100, callBack), ACANPrimaryFilter (kData, kStandard, 0x101, callBack),
+    ACANPrimaryFilter (kData, kStandard, 0x102, callBack), ACANPrimaryFilter (kData, kStandard, 0x103, callBack),
+    ACANPrimaryFilter (kData, kStandard, 0x104, callBack), ACANPrimaryFilter (kData, kStandard, 0x105, callBack),
+    ACANPrimaryFilter (kData, kStandard, 0x106, callBack), ACANPrimaryFilter (kData, kStandard, 0x107, callBack),
+    ACANPrimaryFilter (kData, kStandard, 0x108, callBack), ACANPrimaryFilter (kData, kStandard, 0x109, callBack),
+    ACANPrimaryFilter (kData, kStandard, 0x10A, callBack), ACANPrimaryFilter (kData, kStandard, 0x10B, callBack),
+    ACANPrimaryFilter (kData, kStandard, 0x10C, callBack), ACANPrimaryFilter (kData, kStandard, 0x10D, callBack),
+    ACANPrimaryFilter (kData, kStandard, 0x10E, callBack), ACANPrimaryFilter (kData, kExtended, callBack)
+  } ;
+  ACANSecondaryFilter secondaryFilters [FILTER_COUNT / 2] = {
+    ACANSecondaryFilter (kData, kExtended, 0x1000, callBack), ACANSecondaryFilter (kData, kExtended, 0x1001, callBack),
+    ACANSecondaryFilter (kData, kExtended, 0x1002, callBack), ACANSecondaryFilter (kData, kExtended, 0x1003, callBack),
+    ACANSecondaryFilter (kData, kExtended, 0x1004, callBack), ACANSecondaryFilter (kData, kExtended, 0x1005, callBack),
+    ACANSecondaryFilter (kData, kExtended, 0x1006, callBack), ACANSecondaryFilter (kData, kExtended, 0x1007, callBack),
+    ACANSecondaryFilter (kData, kExtended, 0x1008, callBack), ACANSecondaryFilter (kData, kExtended, 0x1009, callBack),
+    ACANSecondaryFilter (kData, kExtended, 0x100A, callBack), ACANSecondaryFilter (kData, kExtended, 0x100B, callBack),
+    ACANSecondaryFilter (kData, kExtended, 0x100C, callBack), ACANSecondaryFilter (kData, kExtended, 0x100D, callBack),
+    ACANSecondaryFilter (kData, kExtended, 0x100E, callBack), ACANSecondaryFilter (kData, kExtended, 0x100F, callBack)
+  } ;
+  ACAN_T4_Settings settings (1000 * 1000) ;
+  settings.mReceiveBufferSize = BUFFER_SIZE ;
+  ACAN_T4::can1.begin (settings, primaryFilters, FILTER_COUNT / 2, secondaryFilters, FILTER_COUNT / 2) ;
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CAN_DATA ;
+  frame.len = 8 ;
+  uint64_t duration = 0 ;
+  uint64_t count = 0 ;
+  for (uint32_t round=0 ; round<ROUND_COUNT ; round++) {
+    for (uint32_t i=0 ; i<BUFFER_SIZE ; i++) { // Half standard, half extended frames
+      frame.ext = (i & 1) != 0 ;
+      frame.id = frame.ext ? (0x1000 + ((i >> 1) % 16)) : (0x100 + ((i >> 1) % 15)) ;
+      ACAN_T4_SimulatedFlexCAN::flexcan1.receiveFrame (frame) ;
+    }
+    const uint64_t start = hostNanoseconds () ;
+    while (ACAN_T4::can1.dispatchReceivedMessage ()) {
+      count += 1 ;
+    }
+    duration += hostNanoseconds () - start ;
+  }
+  addResult ("dispatch_received_message", count, duration) ;
+  ACAN_T4::can1.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkDispatchFD (void) {
+  ACAN_T4FD_Settings settings (1000 * 1000, DataBitRateFactor::x4) ;
+  settings.mReceiveBufferSize = BUFFER_SIZE ;
+  const uint32_t filterCount = settings.mRxCANFDMBCount ; // One filter per Rx mailbox
+  ACANFDFilter filters [filterCount] ;
+  for (uint32_t i=0 ; i<filterCount ; i++) {
+    filters [i] = ACANFDFilter (kData, kStandard, 0x200 + i, callBackFD) ;
+  }
+  ACAN_T4::can3.beginFD (settings, filters, filterCount) ;
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  uint64_t duration = 0 ;
+  uint64_t count = 0 ;
+  for (uint32_t round=0 ; round<ROUND_COUNT ; round++) {
+    for (uint32_t i=0 ; i<BUFFER_SIZE ; i++) {
+      frame.id = 0x200 + (i % filterCount) ;
+      ACAN_T4_SimulatedFlexCAN::flexcan3.receiveFrame (frame) ;
+    }
+    const uint64_t start = hostNanoseconds () ;
+    while (ACAN_T4::can3.dispatchReceivedMessageFD ()) {
+      count += 1 ;
+    }
+    duration += hostNanoseconds () - start ;
+  }
+  addResult ("dispatch_received_message_fd", count, duration) ;
+  ACAN_T4::can3.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   FILTER ENCODING
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkFilterEncoding (void) {
+  const uint32_t count = ROUND_COUNT * BUFFER_SIZE ;
+  uint64_t start = hostNanoseconds () ;
+  for (uint32_t i=0 ; i<count ; i++) {
+    const ACANPrimaryFilter filter (kData, kExtended, 0x1FFFFF00, i & 0x1FFFFF00, callBack) ;
+    gSink = filter.mPrimaryAcceptanceFilter ;
+  }
+  addResult ("primary_filter_encoding", count, hostNanoseconds () - start) ;
+  start = hostNanoseconds () ;
+  for (uint32_t i=0 ; i<count ; i++) {
+    const ACANSecondaryFilter filter (kData, kStandard, i & 0x7FF, callBack) ;
+    gSink = filter.mSecondaryAcceptanceFilter ;
+  }
+  addResult ("secondary_filter_encoding", count, hostNanoseconds () - start) ;
+  start = hostNanoseconds () ;
+  for (uint32_t i=0 ; i<count ; i++) {
+    const ACANFDFilter filter (kData, kExtended, 0x1FFFFF00, i & 0x1FFFFF00, callBackFD) ;
+    gSink = filter.mAcceptanceMask ;
+  }
+  addResult ("fd_filter_encoding", count, hostNanoseconds () - start) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   BIT TIMING SOLVERS
+//--------------------------------------------------------------------------------------------------
+
+static void benchmarkBitTimingSolvers (void) {
+  static const uint32_t BIT_RATES [8] = {
+    125 * 1000, 250 * 1000, 500 * 1000, 1000 * 1000, 100 * 1000, 615 * 1000, 800 * 1000, 83333
+  } ;
+  const uint32_t count = ROUND_COUNT * 10 ;
+  uint64_t start = hostNanoseconds () ;
+  for (uint32_t i=0 ; i<count ; i++) {
+    const ACAN_T4_Settings settings (BIT_RATES [i % 8]) ;
+    gSink = settings.mBitRatePrescaler ;
+  }
+  addResult ("settings_bit_timing_solver", count, hostNanoseconds () - start) ;
+  start = hostNanoseconds () ;
+  for (uint32_t i=0 ; i<count ; i++) {
+    const ACAN_T4FD_Settings settings (BIT_RATES [i % 4], DataBitRateFactor ((i % 8) + 1)) ;
+    gSink = settings.mBitRatePrescaler ;
+  }
+  addResult ("fd_settings_bit_timing_solver", count, hostNanoseconds () - start) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (int argc, char * argv []) {
+  benchmarkReceive () ;
+  benchmarkReceiveFD () ;
+  benchmarkTransmit () ;
+  benchmarkTransmitFD () ;
+  benchmarkDispatch () ;
+  benchmarkDispatchFD () ;
+  benchmarkFilterEncoding () ;
+  benchmarkBitTimingSolvers () ;
+  FILE * f = (argc > 1) ? fopen (argv [1], "w") : stdout ;
+  if (f == nullptr) {
+    fprintf (stderr, "Cannot open %s\n", argv [1]) ;
+    return 1 ;
+  }
+  writeJSON (f) ;
+  if (f != stdout) {
+    fclose (f) ;
+  }
+  return 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
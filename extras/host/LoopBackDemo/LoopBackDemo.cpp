@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: loop back demo
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Same as the LoopBackDemoCAN1 and LoopBackDemoCAN3FDWithCheck sketches, running on the host with
+// simulated FlexCAN modules: CAN1 in CAN 2.0B loop back mode, CAN3 in CANFD loop back mode.
+// Every received frame is checked against the sent one. Exit status is 0 if all frames are
+// received back unchanged.
+//
+// Build (from this directory):
+//   c++ -std=c++11 -O2 -DACAN_T4_HOST_SIMULATION -I../simulation -I../../../src
+//       -o loopback_demo LoopBackDemo.cpp ../simulation/*.cpp ../../../src/*.cpp
+// (a single command line)
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+#include <ACAN_T4_SimulatedFlexCAN.h>
+#include <stdio.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t FRAME_COUNT = 1000 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static bool sameFrame (const CANMessage & inSent, const CANMessage & inReceived) {
+  bool same = (inSent.id == inReceived.id) && (inSent.ext == inReceived.ext)
+    && (inSent.rtr == inReceived.rtr) && (inSent.len == inReceived.len) ;
+  for (uint32_t i=0 ; (i<inSent.len) && same && !inSent.rtr ; i++) {
+    same = inSent.data [i] == inReceived.data [i] ;
+  }
+  return same ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bool sameFrame (const CANFDMessage & inSent, const CANFDMessage & inReceived) {
+  bool same = (inSent.id == inReceived.id) && (inSent.ext == inReceived.ext)
+    && (inSent.type == inReceived.type) && (inSent.len == inReceived.len) ;
+  for (uint32_t i=0 ; (i<inSent.len) && same && (inSent.type != CANFDMessage::CAN_REMOTE) ; i++) {
+    same = inSent.data [i] == inReceived.data [i] ;
+  }
+  return same ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t loopBackCAN1 (void) {
+  ACAN_T4_Settings settings (125 * 1000) ; // 125 kbit/s
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can1.begin (settings) ;
+  printf ("can1 begin: 0x%X, actual bit rate %u bit/s\n", errorCode, settings.actualBitRate ()) ;
+  uint32_t errorCount = (errorCode == 0) ? 0 : 1 ;
+  uint32_t receivedCount = 0 ;
+  for (uint32_t i=0 ; (i<FRAME_COUNT) && (errorCount == 0) ; i++) {
+    CANMessage sent ;
+    sent.ext = (i % 3) == 0 ;
+    sent.id = sent.ext ? ((i * 0x9E3779B1U) & 0x1FFFFFFF) : ((i * 37) & 0x7FF) ;
+    sent.rtr = (i % 7) == 0 ;
+    sent.len = uint8_t (i % 9) ;
+    for (uint32_t j=0 ; j<8 ; j++) {
+      sent.data [j] = uint8_t (i + j) ;
+    }
+    if (!ACAN_T4::can1.tryToSend (sent)) {
+      errorCount += 1 ;
+    }
+    ACAN_T4_SimulatedFlexCAN::flexcan1.transmitPendingFrames () ;
+    acanT4HostAdvanceTime (1000) ;
+    CANMessage received ;
+    if (ACAN_T4::can1.receive (received)) {
+      receivedCount += 1 ;
+      if (!sameFrame (sent, received)) {
+        errorCount += 1 ;
+      }
+    }else{
+      errorCount += 1 ;
+    }
+  }
+  printf ("can1: %u sent, %u received, %u errors\n", FRAME_COUNT, receivedCount, errorCount) ;
+  ACAN_T4::can1.end () ;
+  return errorCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t loopBackCAN3FD (void) {
+  ACAN_T4FD_Settings settings (1000 * 1000, DataBitRateFactor::x4) ; // 1 Mbit/s, 4 Mbit/s
+  settings.mLoopBackMode = true ;
+  settings.mSelfReceptionMode = true ;
+  const uint32_t errorCode = ACAN_T4::can3.beginFD (settings) ;
+  printf ("can3 beginFD: 0x%X, actual bit rates %u / %u bit/s\n",
+          errorCode, settings.actualArbitrationBitRate (), settings.actualDataBitRate ()) ;
+  uint32_t errorCount = (errorCode == 0) ? 0 : 1 ;
+  uint32_t receivedCount = 0 ;
+  for (uint32_t i=0 ; (i<FRAME_COUNT) && (errorCount == 0) ; i++) {
+    CANFDMessage sent ;
+    sent.ext = (i % 3) == 0 ;
+    sent.id = sent.ext ? ((i * 0x9E3779B1U) & 0x1FFFFFFF) : ((i * 37) & 0x7FF) ;
+    switch (i % 4) {
+    case 0 : sent.type = CANFDMessage::CAN_REMOTE ; sent.len = uint8_t (i % 9) ; break ;
+    case 1 : sent.type = CANFDMessage::CAN_DATA ; sent.len = uint8_t (i % 9) ; break ;
+    case 2 : sent.type = CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ; sent.len = uint8_t (i % 65) ; break ;
+    default : sent.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ; sent.len = uint8_t (i % 65) ; break ;
+    }
+    for (uint32_t j=0 ; j<64 ; j++) {
+      sent.data [j] = uint8_t (i + j) ;
+    }
+    sent.pad () ;
+    if (!ACAN_T4::can3.tryToSendFD (sent)) {
+      errorCount += 1 ;
+    }
+    ACAN_T4_SimulatedFlexCAN::flexcan3.transmitPendingFrames () ;
+    acanT4HostAdvanceTime (1000) ;
+    CANFDMessage received ;
+    if (ACAN_T4::can3.receiveFD (received)) {
+      receivedCount += 1 ;
+      if (!sameFrame (sent, received)) {
+        errorCount += 1 ;
+      }
+    }else{
+      errorCount += 1 ;
+    }
+  }
+  printf ("can3: %u sent, %u received, %u errors\n", FRAME_COUNT, receivedCount, errorCount) ;
+  ACAN_T4::can3.end () ;
+  return errorCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (void) {
+  uint32_t errorCount = loopBackCAN1 () ;
+  errorCount += loopBackCAN3FD () ;
+  printf ("Configuration register writes outside freeze mode: %u\n",
+          ACAN_T4_SimulatedFlexCAN::flexcan1.writeOutsideFreezeModeCount ()
+        + ACAN_T4_SimulatedFlexCAN::flexcan3.writeOutsideFreezeModeCount ()) ;
+  printf ("%s\n", (errorCount == 0) ? "OK" : "FAILED") ;
+  return (errorCount == 0) ? 0 : 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,262 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: trace recorder test
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// ACAN_T4_TraceRecorder is fed with CAN 2.0B and CANFD frames of the three channels, and its full
+// blocks are written to a file, as the CaptureToSDCard sketch writes them to the SD card. The card
+// is stalled from time to time: frames recorded while every block is full are lost. Then the file
+// is decoded with acanTraceReadBlockHeader / acanTraceDecodeRecord, and checked against the
+// recorded frames and the lost frame counts. Exit status is 0 if the trace is correct.
+//
+// Build (from this directory):
+//   c++ -std=c++11 -O2 -DACAN_T4_HOST_SIMULATION -I../simulation -I../../../src
+//       -o trace_recorder_test TraceRecorderTest.cpp ../simulation/*.cpp ../../../src/*.cpp
+// (a single command line)
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_TraceRecorder.h>
+#include <stdio.h>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t FRAME_COUNT = 5000 ;
+
+static const uint32_t BLOCK_COUNT = 4 ;
+
+static const char * TRACE_FILE_NAME = "trace_recorder_test.bin" ;
+
+//--------------------------------------------------------------------------------------------------
+//   FILE BACKED CARD: stands for the SD card, full blocks are appended to a file
+//--------------------------------------------------------------------------------------------------
+
+class FileBackedCard {
+  public: FileBackedCard (const char * inFileName) : mFile (fopen (inFileName, "wb")) {}
+  public: ~ FileBackedCard (void) { close () ; }
+
+  public: bool isOpen (void) const { return mFile != nullptr ; }
+
+//--- Same as the CaptureToSDCard loop: write and release every full block
+  public: uint32_t writeFullBlocks (ACAN_T4_TraceRecorder & ioRecorder) {
+    uint32_t writtenBlockCount = 0 ;
+    const uint8_t * block = ioRecorder.fullBlock () ;
+    while ((block != nullptr) && (mFile != nullptr)) {
+      fwrite (block, 1, ACAN_T4_TRACE_BLOCK_SIZE, mFile) ;
+      ioRecorder.releaseBlock () ;
+      writtenBlockCount += 1 ;
+      block = ioRecorder.fullBlock () ;
+    }
+    return writtenBlockCount ;
+  }
+
+  public: void close (void) {
+    if (mFile != nullptr) {
+      fclose (mFile) ;
+      mFile = nullptr ;
+    }
+  }
+
+  private: FILE * mFile ;
+
+  private: FileBackedCard (const FileBackedCard &) = delete ;
+  private: FileBackedCard & operator = (const FileBackedCard &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//   EXPECTED TRACE: recorded frames, and lost frames between them
+//--------------------------------------------------------------------------------------------------
+
+class ExpectedEvent {
+  public: bool mLost ;
+  public: ACAN_T4_TraceRecord mRecord ;
+  public: uint8_t mData [64] ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static CANFDMessage frameForIndex (const uint32_t inIndex) {
+  CANFDMessage frame ;
+  frame.ext = (inIndex % 3) == 0 ;
+  frame.id = frame.ext ? ((inIndex * 0x9E3779B1U) & 0x1FFFFFFF) : ((inIndex * 37) & 0x7FF) ;
+  switch (inIndex % 4) {
+  case 0 : frame.type = CANFDMessage::CAN_REMOTE ; frame.len = uint8_t (inIndex % 9) ; break ;
+  case 1 : frame.type = CANFDMessage::CAN_DATA ; frame.len = uint8_t (inIndex % 9) ; break ;
+  case 2 : frame.type = CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ; frame.len = uint8_t (inIndex % 65) ; break ;
+  default : frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ; frame.len = uint8_t (inIndex % 65) ; break ;
+  }
+  for (uint32_t i=0 ; i<64 ; i++) {
+    frame.data [i] = uint8_t (inIndex * 7 + i) ;
+  }
+  return frame ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void recordFrame (ACAN_T4_TraceRecorder & ioRecorder,
+                         const uint32_t inIndex,
+                         std::vector <ExpectedEvent> & ioExpected) {
+  const CANFDMessage frame = frameForIndex (inIndex) ;
+  const uint8_t channel = uint8_t (inIndex % 3) ;
+  const uint32_t timestamp = inIndex * 113 ;
+  const uint32_t lostCount = ioRecorder.lostFrameCount () ;
+  ExpectedEvent event ;
+//--- CAN 2.0B frames are recorded with record, CANFD frames with recordFD
+  if ((frame.type == CANFDMessage::CAN_REMOTE) || (frame.type == CANFDMessage::CAN_DATA)) {
+    CANMessage message ;
+    message.id = frame.id ;
+    message.ext = frame.ext ;
+    message.rtr = frame.type == CANFDMessage::CAN_REMOTE ;
+    message.len = frame.len ;
+    message.data64 = frame.data64 [0] ;
+    ioRecorder.record (message, channel, timestamp) ;
+  }else{
+    ioRecorder.recordFD (frame, channel, timestamp) ;
+  }
+  event.mLost = ioRecorder.lostFrameCount () != lostCount ;
+  event.mRecord.mTimestamp = timestamp ;
+  event.mRecord.mIdentifier = frame.id ;
+  event.mRecord.mExtended = frame.ext ;
+  event.mRecord.mType = uint8_t (frame.type) ;
+  event.mRecord.mLength = frame.len ;
+  event.mRecord.mChannel = channel ;
+  memcpy (event.mData, frame.data, 64) ;
+  ioExpected.push_back (event) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bool sameRecord (const ExpectedEvent & inExpected, const ACAN_T4_TraceRecord & inDecoded) {
+  const ACAN_T4_TraceRecord & expected = inExpected.mRecord ;
+  bool same = (expected.mTimestamp == inDecoded.mTimestamp)
+    && (expected.mIdentifier == inDecoded.mIdentifier)
+    && (expected.mExtended == inDecoded.mExtended)
+    && (expected.mType == inDecoded.mType)
+    && (expected.mLength == inDecoded.mLength)
+    && (expected.mChannel == inDecoded.mChannel) ;
+  if (same && (expected.mType != ACAN_T4_TRACE_REMOTE)) {
+    same = memcmp (inExpected.mData, inDecoded.mData, expected.mLength) == 0 ;
+  }
+  return same ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   DECODE THE FILE
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t checkTraceFile (const std::vector <ExpectedEvent> & inExpected) {
+  uint32_t errorCount = 0 ;
+  FILE * file = fopen (TRACE_FILE_NAME, "rb") ;
+  if (file == nullptr) {
+    printf ("cannot open %s\n", TRACE_FILE_NAME) ;
+    errorCount += 1 ;
+  }else{
+    uint8_t block [ACAN_T4_TRACE_BLOCK_SIZE] ;
+    uint32_t eventIndex = 0 ;
+    uint32_t blockCount = 0 ;
+    uint32_t recordCount = 0 ;
+    uint32_t lostCount = 0 ;
+    while ((errorCount == 0) && (fread (block, 1, ACAN_T4_TRACE_BLOCK_SIZE, file) == ACAN_T4_TRACE_BLOCK_SIZE)) {
+      uint32_t sequenceNumber, usedBytes, blockRecordCount, blockLostCount ;
+      if (!acanTraceReadBlockHeader (block, sequenceNumber, usedBytes, blockRecordCount, blockLostCount)) {
+        printf ("block %u: invalid header\n", blockCount) ;
+        errorCount += 1 ;
+      }else if (sequenceNumber != blockCount) {
+        printf ("block %u: sequence number %u\n", blockCount, sequenceNumber) ;
+        errorCount += 1 ;
+      }
+    //--- Records: the next recorded frames. A frame lost while the block is being filled is counted
+    //    by the block, smaller frames that still fit may follow it
+      uint32_t offset = ACAN_T4_TRACE_BLOCK_HEADER_SIZE ;
+      uint32_t lostInBlock = 0 ;
+      for (uint32_t i=0 ; (i<blockRecordCount) && (errorCount == 0) ; i++) {
+        while ((i > 0) && (eventIndex < inExpected.size ()) && inExpected [eventIndex].mLost) {
+          lostInBlock += 1 ;
+          eventIndex += 1 ;
+        }
+        ACAN_T4_TraceRecord record ;
+        const uint32_t size = acanTraceDecodeRecord (block + offset, usedBytes - offset, record) ;
+        if (size == 0) {
+          printf ("block %u, record %u: malformed\n", blockCount, i) ;
+          errorCount += 1 ;
+        }else if ((eventIndex >= inExpected.size ()) || inExpected [eventIndex].mLost
+               || !sameRecord (inExpected [eventIndex], record)) {
+          printf ("block %u, record %u: unexpected frame\n", blockCount, i) ;
+          errorCount += 1 ;
+        }
+        offset += size ;
+        eventIndex += 1 ;
+      }
+      if ((errorCount == 0) && (offset != usedBytes)) {
+        printf ("block %u: %u used bytes, %u decoded\n", blockCount, usedBytes, offset) ;
+        errorCount += 1 ;
+      }
+    //--- Lost frames: also the frames that follow the last record of the block
+      while ((eventIndex < inExpected.size ()) && inExpected [eventIndex].mLost) {
+        lostInBlock += 1 ;
+        eventIndex += 1 ;
+      }
+      if ((errorCount == 0) && (lostInBlock != blockLostCount)) {
+        printf ("block %u: %u lost frames, %u expected\n", blockCount, blockLostCount, lostInBlock) ;
+        errorCount += 1 ;
+      }
+      blockCount += 1 ;
+      recordCount += blockRecordCount ;
+      lostCount += blockLostCount ;
+    }
+    fclose (file) ;
+    if ((errorCount == 0) && (eventIndex != inExpected.size ())) {
+      printf ("%u frames missing in trace\n", uint32_t (inExpected.size ()) - eventIndex) ;
+      errorCount += 1 ;
+    }
+    printf ("trace: %u blocks, %u records, %u lost frames\n", blockCount, recordCount, lostCount) ;
+  }
+  return errorCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (void) {
+  static uint8_t blockStorage [BLOCK_COUNT * ACAN_T4_TRACE_BLOCK_SIZE] ;
+  ACAN_T4_TraceRecorder recorder ;
+  uint32_t errorCount = recorder.begin (blockStorage, BLOCK_COUNT) ? 0 : 1 ;
+  FileBackedCard card (TRACE_FILE_NAME) ;
+  if (!card.isOpen ()) {
+    printf ("cannot create %s\n", TRACE_FILE_NAME) ;
+    errorCount += 1 ;
+  }
+  std::vector <ExpectedEvent> expected ;
+  uint32_t writtenBlockCount = 0 ;
+//--- The card is stalled during 400 frames out of 1000: recording goes past the block count
+  for (uint32_t i=0 ; (i<FRAME_COUNT) && (errorCount == 0) ; i++) {
+    recordFrame (recorder, i, expected) ;
+    if ((i % 1000) < 600) {
+      writtenBlockCount += card.writeFullBlocks (recorder) ;
+    }
+  }
+//--- The last frames are recorded while the card is stalled: free a block for closing the current one
+  writtenBlockCount += card.writeFullBlocks (recorder) ;
+  recorder.flush () ;
+  writtenBlockCount += card.writeFullBlocks (recorder) ;
+  card.close () ;
+  printf ("recorder: %u frames recorded, %u lost, %u blocks written, %u full blocks peak\n",
+          recorder.recordedFrameCount (), recorder.lostFrameCount (), writtenBlockCount,
+          recorder.fullBlockPeakCount ()) ;
+  if ((recorder.lostFrameCount () == 0) || (recorder.fullBlockPeakCount () != (BLOCK_COUNT - 1))) {
+    printf ("no lost frame: the stall is too short\n") ;
+    errorCount += 1 ;
+  }
+  if ((recorder.recordedFrameCount () + recorder.lostFrameCount ()) != FRAME_COUNT) {
+    errorCount += 1 ;
+  }
+//--- Decode
+  if (errorCount == 0) {
+    errorCount += checkTraceFile (expected) ;
+  }
+  remove (TRACE_FILE_NAME) ;
+  printf ("%s\n", (errorCount == 0) ? "OK" : "FAILED") ;
+  return (errorCount == 0) ? 0 : 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,160 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: virtual bus demo
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// 1. CAN1 and CAN2 on a 500 kbit/s virtual bus: CAN1 sends as fast as its transmit buffer
+//    allows, CAN2 receives; then the same with injected errors.
+// 2. CAN3 in CANFD mode (1 Mbit/s, 4 Mbit/s) on an other bus, sending 64-byte frames to the
+//    external node.
+// Throughput, bus load and latency (from tryToSend to reception) are given for each run.
+//
+// Build (from this directory):
+//   c++ -std=c++11 -O2 -DACAN_T4_HOST_SIMULATION -I../simulation -I../../../src
+//       -o virtual_bus_demo VirtualBusDemo.cpp ../simulation/*.cpp ../../../src/*.cpp
+// (a single command line)
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+#include <ACAN_T4_VirtualBus.h>
+#include <stdio.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t FRAME_COUNT = 2000 ;
+
+//--------------------------------------------------------------------------------------------------
+//   LATENCY: send date is stored in the 4 first data bytes
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t gLatencySum = 0 ;
+static uint32_t gLatencyMax = 0 ;
+static uint32_t gLatencyCount = 0 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static void recordLatency (const uint32_t inSendDate) {
+  const uint32_t latency = micros () - inSendDate ;
+  gLatencySum += latency ;
+  gLatencyCount += 1 ;
+  if (gLatencyMax < latency) {
+    gLatencyMax = latency ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void externalNodeReception (const CANFDMessage & inFrame,
+                                   const uint32_t /* inTransmitterIndex */,
+                                   const uint64_t /* inStartDate */,
+                                   const uint64_t /* inEndDate */) {
+  recordLatency (inFrame.data32 [0]) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void printResults (const char * inTitle,
+                          const ACAN_T4_VirtualBus & inBus,
+                          const uint64_t inStartDate) {
+  const uint64_t duration = acanT4HostTime () - inStartDate ;
+  printf ("%s\n", inTitle) ;
+  printf ("  %u frames in %llu us: %llu frames/s, bus load %u.%u %%\n",
+          inBus.frameCount (), (unsigned long long) duration,
+          (unsigned long long) ((inBus.frameCount () * 1000000ULL) / duration),
+          inBus.busLoadPerMille () / 10, inBus.busLoadPerMille () % 10) ;
+  printf ("  error frames %u, ACK errors %u, arbitration losses %u\n",
+          inBus.errorFrameCount (), inBus.ackErrorCount (), inBus.arbitrationLossCount ()) ;
+  printf ("  latency: average %u us, max %u us\n",
+          (gLatencyCount == 0) ? 0 : (gLatencySum / gLatencyCount), gLatencyMax) ;
+  gLatencySum = 0 ;
+  gLatencyMax = 0 ;
+  gLatencyCount = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void can1ToCAN2 (const uint32_t inInjectedErrorCount) {
+  ACAN_T4_Settings settings (500 * 1000) ; // 500 kbit/s
+  ACAN_T4::can1.begin (settings) ;
+  ACAN_T4::can2.begin (settings) ;
+  ACAN_T4_VirtualBus bus (500 * 1000) ;
+  bus.attach (ACAN_T4_SimulatedFlexCAN::flexcan1) ;
+  bus.attach (ACAN_T4_SimulatedFlexCAN::flexcan2) ;
+  bus.mExternalNodeAcknowledges = false ;
+  bus.injectErrors (inInjectedErrorCount) ;
+  const uint64_t startDate = acanT4HostTime () ;
+  uint32_t sentCount = 0 ;
+  uint32_t receivedCount = 0 ;
+  while (receivedCount < FRAME_COUNT) {
+    CANMessage frame ;
+    frame.len = 8 ;
+    frame.id = sentCount & 0x7FF ;
+    frame.data32 [0] = micros () ;
+    frame.data32 [1] = sentCount ;
+    if ((sentCount < FRAME_COUNT) && ACAN_T4::can1.tryToSend (frame)) {
+      sentCount += 1 ;
+    }
+    while (ACAN_T4::can2.receive (frame)) {
+      recordLatency (frame.data32 [0]) ;
+      receivedCount += 1 ;
+    }
+    bus.run (10) ;
+  }
+  printResults ((inInjectedErrorCount == 0)
+                  ? "CAN1 -> CAN2, 500 kbit/s, 8-byte frames"
+                  : "CAN1 -> CAN2, 500 kbit/s, 8-byte frames, injected errors",
+                bus, startDate) ;
+  printf ("  can1 TEC %u, transmit buffer peak %u; can2 REC %u, receive buffer peak %u\n",
+          ACAN_T4_SimulatedFlexCAN::flexcan1.transmitErrorCounter (),
+          ACAN_T4::can1.transmitBufferPeakCount (),
+          ACAN_T4_SimulatedFlexCAN::flexcan2.receiveErrorCounter (),
+          ACAN_T4::can2.receiveBufferPeakCount ()) ;
+  ACAN_T4::can1.end () ;
+  ACAN_T4::can2.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void can3FDToExternalNode (void) {
+  ACAN_T4FD_Settings settings (1000 * 1000, DataBitRateFactor::x4) ; // 1 Mbit/s, 4 Mbit/s
+  ACAN_T4::can3.beginFD (settings) ;
+  ACAN_T4_VirtualBus bus (1000 * 1000, 4000 * 1000) ;
+  bus.attach (ACAN_T4_SimulatedFlexCAN::flexcan3) ;
+  bus.mFrameCallBack = externalNodeReception ;
+  const uint64_t startDate = acanT4HostTime () ;
+  uint32_t sentCount = 0 ;
+  while (bus.frameCount () < FRAME_COUNT) {
+    CANFDMessage frame ;
+    frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    frame.len = 64 ;
+    frame.id = 0x123 ;
+    frame.data32 [0] = micros () ;
+    if ((sentCount < FRAME_COUNT) && ACAN_T4::can3.tryToSendFD (frame)) {
+      sentCount += 1 ;
+    }
+    bus.run (10) ;
+  }
+  uint32_t nominalBitCount ;
+  uint32_t dataBitCount ;
+  CANFDMessage frame ;
+  frame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  frame.len = 64 ;
+  frame.id = 0x123 ;
+  ACAN_T4_VirtualBus::frameBitCount (frame, nominalBitCount, dataBitCount) ;
+  printResults ("CAN3 -> external node, CANFD 1 Mbit/s, 4 Mbit/s, 64-byte frames", bus, startDate) ;
+  printf ("  frame: %u nominal bits, %u data bits, %llu ns\n",
+          nominalBitCount, dataBitCount, (unsigned long long) bus.frameDuration (frame)) ;
+  ACAN_T4::can3.end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main (void) {
+  can1ToCAN2 (0) ;
+  can1ToCAN2 (20) ;
+  can3FDToExternalNode () ;
+  return 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
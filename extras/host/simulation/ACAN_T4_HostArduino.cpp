@@ -0,0 +1,170 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: minimal Arduino / Teensy 4.x environment
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include <ACAN_T4_SimulatedFlexCAN.h>
+
+//--------------------------------------------------------------------------------------------------
+//   TIME
+//--------------------------------------------------------------------------------------------------
+
+static uint64_t gHostTime = 0 ; // In µs
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t micros (void) {
+  return uint32_t (gHostTime) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t millis (void) {
+  return uint32_t (gHostTime / 1000) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t acanT4HostTime (void) {
+  return gHostTime ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void acanT4HostSetTime (const uint64_t inMicroseconds) {
+  gHostTime = inMicroseconds ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void acanT4HostAdvanceTime (const uint64_t inMicroseconds) {
+  const uint64_t targetDate = gHostTime + inMicroseconds ;
+  while (IntervalTimer::fireNextTimer (targetDate)) {}
+  gHostTime = targetDate ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   INTERVAL TIMERS (4 PIT channels)
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t PIT_CHANNEL_COUNT = 4 ;
+
+static IntervalTimer * gIntervalTimers [PIT_CHANNEL_COUNT] ;
+
+//--------------------------------------------------------------------------------------------------
+
+IntervalTimer::IntervalTimer (void) :
+mFunction (nullptr),
+mPeriod (0),
+mNextDate (0),
+mRunning (false) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+IntervalTimer::~IntervalTimer (void) {
+  end () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool IntervalTimer::begin (void (* inFunction) (void), const uint32_t inMicroseconds) {
+  end () ;
+  bool ok = (inFunction != nullptr) && (inMicroseconds > 0) ;
+  uint32_t channel = 0 ;
+  while (ok && (channel < PIT_CHANNEL_COUNT) && (gIntervalTimers [channel] != nullptr)) {
+    channel += 1 ;
+  }
+  ok = ok && (channel < PIT_CHANNEL_COUNT) ;
+  if (ok) {
+    gIntervalTimers [channel] = this ;
+    mFunction = inFunction ;
+    mPeriod = inMicroseconds ;
+    mNextDate = gHostTime + inMicroseconds ;
+    mRunning = true ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void IntervalTimer::end (void) {
+  for (uint32_t i=0 ; i<PIT_CHANNEL_COUNT ; i++) {
+    if (gIntervalTimers [i] == this) {
+      gIntervalTimers [i] = nullptr ;
+    }
+  }
+  mRunning = false ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void IntervalTimer::priority (const uint8_t /* inPriority */) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool IntervalTimer::fireNextTimer (const uint64_t inLimitDate) {
+  IntervalTimer * next = nullptr ;
+  for (uint32_t i=0 ; i<PIT_CHANNEL_COUNT ; i++) {
+    IntervalTimer * timer = gIntervalTimers [i] ;
+    if ((timer != nullptr) && (timer->mNextDate <= inLimitDate)
+     && ((next == nullptr) || (timer->mNextDate < next->mNextDate))) {
+      next = timer ;
+    }
+  }
+  if (next != nullptr) {
+    gHostTime = next->mNextDate ;
+    next->mNextDate += next->mPeriod ;
+    next->mFunction () ;
+  }
+  return next != nullptr ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   INTERRUPTS
+//--------------------------------------------------------------------------------------------------
+
+static bool gInterruptsEnabled = true ;
+
+//--------------------------------------------------------------------------------------------------
+
+void acanT4HostDisableInterrupts (void) {
+  gInterruptsEnabled = false ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void acanT4HostEnableInterrupts (void) {
+  gInterruptsEnabled = true ;
+  ACAN_T4_SimulatedFlexCAN::deliverPendingInterrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool acanT4HostInterruptsEnabled (void) {
+  return gInterruptsEnabled ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   NVIC, CCM AND PIN REGISTERS
+//--------------------------------------------------------------------------------------------------
+
+void (* _VectorsRam [NVIC_NUM_INTERRUPTS + 16]) (void) ;
+
+bool acanT4HostNVICEnabled [NVIC_NUM_INTERRUPTS] ;
+
+bool acanT4HostNVICPending [NVIC_NUM_INTERRUPTS] ;
+
+uint8_t acanT4HostNVICPriority [NVIC_NUM_INTERRUPTS] ;
+
+volatile uint32_t CCM_CSCMR2 ;
+volatile uint32_t CCM_CCGR0 ;
+volatile uint32_t CCM_CCGR7 ;
+
+volatile uint32_t acanT4HostPinRegisters [32] ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,714 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: simulated FlexCAN modules
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_SimulatedFlexCAN.h>
+
+//--------------------------------------------------------------------------------------------------
+//   REGISTER BITS
+//--------------------------------------------------------------------------------------------------
+
+//--- MCR
+static const uint32_t MCR_MDIS     = 1U << 31 ;
+static const uint32_t MCR_FRZ      = 1U << 30 ;
+static const uint32_t MCR_RFEN     = 1U << 29 ;
+static const uint32_t MCR_HALT     = 1U << 28 ;
+static const uint32_t MCR_NOT_RDY  = 1U << 27 ;
+static const uint32_t MCR_SOFT_RST = 1U << 25 ;
+static const uint32_t MCR_FRZ_ACK  = 1U << 24 ;
+static const uint32_t MCR_LPM_ACK  = 1U << 20 ;
+static const uint32_t MCR_SRX_DIS  = 1U << 17 ;
+static const uint32_t MCR_IRMQ     = 1U << 16 ;
+static const uint32_t MCR_FDEN     = 1U << 11 ;
+
+static const uint32_t MCR_POWER_ON_VALUE   = 0xD890000F ;
+static const uint32_t MCR_SOFT_RESET_VALUE = 0x5980000F ;
+
+//--- CTRL1
+static const uint32_t CTRL1_LOM = 1U << 3 ;
+static const uint32_t CTRL1_LPB = 1U << 12 ;
+
+//--- Mailbox CS field
+static const uint32_t MB_CS_RTR = 1U << 20 ;
+static const uint32_t MB_CS_IDE = 1U << 21 ;
+static const uint32_t MB_CS_SRR = 1U << 22 ;
+static const uint32_t MB_CS_BRS = 1U << 30 ;
+static const uint32_t MB_CS_EDL = 1U << 31 ;
+
+static const uint32_t MB_CODE_RX_FULL     = 0x2 ;
+static const uint32_t MB_CODE_RX_EMPTY    = 0x4 ;
+static const uint32_t MB_CODE_TX_INACTIVE = 0x8 ;
+static const uint32_t MB_CODE_TX_DATA     = 0xC ;
+
+//--- IFLAG1 bits in RxFIFO mode
+static const uint32_t IFLAG1_FIFO_FRAME_AVAILABLE = 1U << 5 ;
+static const uint32_t IFLAG1_FIFO_WARNING         = 1U << 6 ;
+static const uint32_t IFLAG1_FIFO_OVERFLOW        = 1U << 7 ;
+
+//--- RxFIFO filter table (format A) starts at offset 0xE0
+static const uint32_t RX_FIFO_FILTER_TABLE_WORD_OFFSET = (0xE0 - 0x80) / 4 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t CANFD_LENGTH_CODE [16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t lengthCode (const CANFDMessage & inFrame) {
+  uint32_t code = 0 ;
+  if ((inFrame.type == CANFDMessage::CAN_REMOTE) || (inFrame.type == CANFDMessage::CAN_DATA)) {
+    code = (inFrame.len <= 8) ? inFrame.len : 8 ;
+  }else{
+    while ((code < 15) && (CANFD_LENGTH_CODE [code] < inFrame.len)) {
+      code += 1 ;
+    }
+  }
+  return code ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bool isCANFDFrame (const CANFDMessage & inFrame) {
+  return (inFrame.type == CANFDMessage::CANFD_NO_BIT_RATE_SWITCH)
+      || (inFrame.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    MODULES
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_SimulatedFlexCAN ACAN_T4_SimulatedFlexCAN::flexcan1 (0x401D0000, IRQ_CAN1) ;
+ACAN_T4_SimulatedFlexCAN ACAN_T4_SimulatedFlexCAN::flexcan2 (0x401D4000, IRQ_CAN2) ;
+ACAN_T4_SimulatedFlexCAN ACAN_T4_SimulatedFlexCAN::flexcan3 (0x401D8000, IRQ_CAN3) ;
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_SimulatedFlexCAN & ACAN_T4_SimulatedFlexCAN::module (const uint32_t inBaseAddress) {
+  switch (inBaseAddress) {
+  case 0x401D0000 : return flexcan1 ;
+  case 0x401D4000 : return flexcan2 ;
+  default : return flexcan3 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    CONSTRUCTOR
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_SimulatedFlexCAN::ACAN_T4_SimulatedFlexCAN (const uint32_t inBaseAddress,
+                                                    const uint32_t inIRQ) :
+mBaseAddress (inBaseAddress),
+mIRQ (inIRQ),
+mMCR (MCR_POWER_ON_VALUE) {
+  for (uint32_t i=0 ; i<256 ; i++) {
+    mRAM [i] = 0 ;
+  }
+  for (uint32_t i=0 ; i<64 ; i++) {
+    mRXIMR [i] = 0 ;
+  }
+  softReset () ;
+  mMCR = MCR_POWER_ON_VALUE ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RESET (mailbox RAM and individual masks are not affected)
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::softReset (void) {
+  mMCR = MCR_SOFT_RESET_VALUE ;
+  mCTRL1 = 0 ;
+  mIMASK1 = 0 ;
+  mIMASK2 = 0 ;
+  mIFLAG1 = 0 ;
+  mIFLAG2 = 0 ;
+  mCTRL2 = 0x00B00000 ;
+  mRXFGMASK = 0xFFFFFFFF ;
+  mRXFIR = 0 ;
+  mCBT = 0 ;
+  mFDCTRL = 0x80000100 ;
+  mFDCBT = 0 ;
+  mRxFIFOReadIndex = 0 ;
+  mRxFIFOCount = 0 ;
+  mHasPeekedMailbox = false ;
+  mTransmitErrorCounter = 0 ;
+  mReceiveErrorCounter = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    MODULE STATE
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::isFrozen (void) const {
+  return (mMCR & MCR_FRZ_ACK) != 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::isRunning (void) const {
+  return (mMCR & MCR_NOT_RDY) == 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::isCANFDEnabled (void) const {
+  return (mMCR & MCR_FDEN) != 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::isLoopBackMode (void) const {
+  return (mCTRL1 & CTRL1_LPB) != 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::isListenOnlyMode (void) const {
+  return (mCTRL1 & CTRL1_LOM) != 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::isSelfReceptionEnabled (void) const {
+  return (mMCR & MCR_SRX_DIS) == 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    MCR HANDSHAKES
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::writeMCR (const uint32_t inValue) {
+  if ((inValue & MCR_SOFT_RST) != 0) {
+    softReset () ;
+  }else{
+    uint32_t mcr = inValue & ~ (MCR_NOT_RDY | MCR_SOFT_RST | MCR_FRZ_ACK | MCR_LPM_ACK) ;
+    const bool disabled = (mcr & MCR_MDIS) != 0 ;
+    if (disabled) {
+      mcr |= MCR_LPM_ACK ;
+    }else if (((mcr & MCR_FRZ) != 0) && ((mcr & MCR_HALT) != 0)) {
+      mcr |= MCR_FRZ_ACK ;
+    }
+    if (disabled || ((mcr & MCR_FRZ_ACK) != 0)) {
+      mcr |= MCR_NOT_RDY ;
+    }
+  //--- Leaving freeze mode cancels a transmission in progress
+    if ((mcr & MCR_NOT_RDY) != 0) {
+      mHasPeekedMailbox = false ;
+    }
+    mMCR = mcr ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    REGISTER ACCESS
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::readRegister (const uint32_t inOffset) {
+  uint32_t result = 0 ;
+  switch (inOffset) {
+  case 0x00 : result = mMCR ; break ;
+  case 0x04 : result = mCTRL1 ; break ;
+  case 0x08 : result = micros () & 0xFFFF ; break ;
+  case 0x1C :
+    result =
+      ((mTransmitErrorCounter > 255) ? 255 : mTransmitErrorCounter) |
+      (((mReceiveErrorCounter > 255) ? 255 : mReceiveErrorCounter) << 8)
+    ;
+    break ;
+  case 0x20 : // ESR1, FLTCONF field
+    if (mTransmitErrorCounter > 255) {
+      result = 2 << 4 ; // Bus off
+    }else if ((mTransmitErrorCounter > 127) || (mReceiveErrorCounter > 127)) {
+      result = 1 << 4 ; // Error passive
+    }
+    break ;
+  case 0x24 : result = mIMASK2 ; break ;
+  case 0x28 : result = mIMASK1 ; break ;
+  case 0x2C : result = mIFLAG2 ; break ;
+  case 0x30 : result = mIFLAG1 ; break ;
+  case 0x34 : result = mCTRL2 ; break ;
+  case 0x48 : result = mRXFGMASK ; break ;
+  case 0x4C : result = mRXFIR ; break ;
+  case 0x50 : result = mCBT ; break ;
+  case 0xC00 : result = mFDCTRL ; break ;
+  case 0xC04 : result = mFDCBT ; break ;
+  default :
+    if ((inOffset >= 0x80) && (inOffset < 0x480)) {
+      result = mRAM [(inOffset - 0x80) / 4] ;
+    }else if ((inOffset >= 0x880) && (inOffset < 0x980)) {
+      result = mRXIMR [(inOffset - 0x880) / 4] ;
+    }
+    break ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::writeRegister (const uint32_t inOffset, const uint32_t inValue) {
+//--- Configuration registers can only be written in freeze mode
+  const bool configurationRegister =
+    (inOffset == 0x04) || (inOffset == 0x34) || (inOffset == 0x48) || (inOffset == 0x50) ||
+    (inOffset == 0xC00) || (inOffset == 0xC04) || ((inOffset >= 0x880) && (inOffset < 0x980))
+  ;
+  if (configurationRegister && !isFrozen ()) {
+    mWriteOutsideFreezeModeCount += 1 ;
+  }
+  switch (inOffset) {
+  case 0x00 : writeMCR (inValue) ; break ;
+  case 0x04 : mCTRL1 = inValue ; break ;
+  case 0x1C : // ECR
+    mTransmitErrorCounter = inValue & 0xFF ;
+    mReceiveErrorCounter = (inValue >> 8) & 0xFF ;
+    break ;
+  case 0x24 : mIMASK2 = inValue ; break ;
+  case 0x28 : mIMASK1 = inValue ; break ;
+  case 0x2C : mIFLAG2 &= ~ inValue ; break ; // Write 1 to clear
+  case 0x30 : // Write 1 to clear; in RxFIFO mode, clearing frame available flag pops the RxFIFO
+    mIFLAG1 &= ~ inValue ;
+    if (((mMCR & MCR_RFEN) != 0) && ((inValue & IFLAG1_FIFO_FRAME_AVAILABLE) != 0) && (mRxFIFOCount > 0)) {
+      mRxFIFOReadIndex = (mRxFIFOReadIndex + 1) % RX_FIFO_DEPTH ;
+      mRxFIFOCount -= 1 ;
+      if (mRxFIFOCount > 0) {
+        loadRxFIFOOutput () ;
+      }
+    }
+    break ;
+  case 0x34 : mCTRL2 = inValue ; break ;
+  case 0x48 : mRXFGMASK = inValue ; break ;
+  case 0x50 : mCBT = inValue ; break ;
+  case 0xC00 : mFDCTRL = inValue ; break ;
+  case 0xC04 : mFDCBT = inValue ; break ;
+  default :
+    if ((inOffset >= 0x80) && (inOffset < 0x480)) {
+      mRAM [(inOffset - 0x80) / 4] = inValue ;
+    }else if ((inOffset >= 0x880) && (inOffset < 0x980)) {
+      mRXIMR [(inOffset - 0x880) / 4] = inValue ;
+    }
+    break ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    MAILBOXES
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::lastMailboxIndex (void) const {
+  return mMCR & 0x7F ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::firstTxMailboxIndex (void) const {
+  uint32_t result = 0 ;
+  if ((mMCR & MCR_RFEN) != 0) { // RxFIFO and its filter table occupy first mailboxes
+    const uint32_t RFFN = (mCTRL2 >> 24) & 0x0F ;
+    result = 8 + 2 * RFFN ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::mailboxDataWordCount (void) const {
+  return isCANFDEnabled () ? (2U << ((mFDCTRL >> 16) & 3)) : 2 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// In CANFD mode, mailbox size depends on payload; a mailbox never straddles a 512-byte RAM block
+
+uint32_t ACAN_T4_SimulatedFlexCAN::mailboxWordOffset (const uint32_t inMailboxIndex) const {
+  uint32_t result = 4 * inMailboxIndex ;
+  if (isCANFDEnabled ()) {
+    const uint32_t mailboxSize = 8 + 4 * mailboxDataWordCount () ;
+    const uint32_t mailboxesPerBlock = 512 / mailboxSize ;
+    const uint32_t byteOffset =
+      (inMailboxIndex / mailboxesPerBlock) * 512 + (inMailboxIndex % mailboxesPerBlock) * mailboxSize ;
+    result = byteOffset / 4 ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::writeFrameToMailbox (const CANFDMessage & inFrame,
+                                                    const uint32_t inWordOffset,
+                                                    const uint32_t inCode) {
+  uint32_t cs = (inCode << 24) | (lengthCode (inFrame) << 16) | (micros () & 0xFFFF) ;
+  if (inFrame.ext) {
+    cs |= MB_CS_IDE | MB_CS_SRR ;
+  }
+  switch (inFrame.type) {
+  case CANFDMessage::CAN_REMOTE : cs |= MB_CS_RTR ; break ;
+  case CANFDMessage::CAN_DATA : break ;
+  case CANFDMessage::CANFD_NO_BIT_RATE_SWITCH : cs |= MB_CS_EDL ; break ;
+  case CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH : cs |= MB_CS_EDL | MB_CS_BRS ; break ;
+  }
+  mRAM [inWordOffset + 1] = inFrame.ext ? (inFrame.id & 0x1FFFFFFF) : ((inFrame.id & 0x7FF) << 18) ;
+//--- Data registers are big endian; bytes beyond mailbox payload are lost
+  const uint32_t wordCount = mailboxDataWordCount () ;
+  for (uint32_t i=0 ; i<wordCount ; i++) {
+    mRAM [inWordOffset + 2 + i] = __builtin_bswap32 (inFrame.data32 [i]) ;
+  }
+  mRAM [inWordOffset] = cs ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::readFrameFromMailbox (const uint32_t inWordOffset,
+                                                     CANFDMessage & outFrame) const {
+  const uint32_t cs = mRAM [inWordOffset] ;
+  const uint32_t dlc = (cs >> 16) & 0x0F ;
+  outFrame.ext = (cs & MB_CS_IDE) != 0 ;
+  if ((cs & MB_CS_RTR) != 0) {
+    outFrame.type = CANFDMessage::CAN_REMOTE ;
+  }else if ((cs & MB_CS_EDL) == 0) {
+    outFrame.type = CANFDMessage::CAN_DATA ;
+  }else if ((cs & MB_CS_BRS) == 0) {
+    outFrame.type = CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ;
+  }else{
+    outFrame.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+  }
+  outFrame.len = uint8_t (((cs & MB_CS_EDL) != 0) ? CANFD_LENGTH_CODE [dlc] : ((dlc <= 8) ? dlc : 8)) ;
+  const uint32_t idField = mRAM [inWordOffset + 1] ;
+  outFrame.id = outFrame.ext ? (idField & 0x1FFFFFFF) : ((idField >> 18) & 0x7FF) ;
+  const uint32_t wordCount = mailboxDataWordCount () ;
+  for (uint32_t i=0 ; i<16 ; i++) {
+    outFrame.data32 [i] = (i < wordCount) ? __builtin_bswap32 (mRAM [inWordOffset + 2 + i]) : 0 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RECEPTION
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::setInterruptFlag (const uint32_t inMailboxIndex) {
+  if (inMailboxIndex < 32) {
+    mIFLAG1 |= 1U << inMailboxIndex ;
+  }else{
+    mIFLAG2 |= 1U << (inMailboxIndex - 32) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::loadRxFIFOOutput (void) {
+  writeFrameToMailbox (mRxFIFO [mRxFIFOReadIndex], 0, 0) ;
+  mRXFIR = mRxFIFOFilterIndex [mRxFIFOReadIndex] ;
+  mIFLAG1 |= IFLAG1_FIFO_FRAME_AVAILABLE ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// RxFIFO filter table, format A: the first matching element gives IDHIT
+
+bool ACAN_T4_SimulatedFlexCAN::receiveInRxFIFO (const CANFDMessage & inFrame) {
+  const uint32_t RFFN = (mCTRL2 >> 24) & 0x0F ;
+  const uint32_t filterElementCount = 8 * (RFFN + 1) ;
+  uint32_t individualMaskCount = 0 ;
+  if ((mMCR & MCR_IRMQ) != 0) {
+    individualMaskCount = 8 + 2 * RFFN ;
+    if (individualMaskCount > 32) {
+      individualMaskCount = 32 ;
+    }
+  }
+  const uint32_t frameWord =
+    ((inFrame.type == CANFDMessage::CAN_REMOTE) ? (1U << 31) : 0) |
+    (inFrame.ext ? ((1U << 30) | ((inFrame.id & 0x1FFFFFFF) << 1)) : ((inFrame.id & 0x7FF) << 19))
+  ;
+  bool matched = false ;
+  uint32_t filterIndex = 0 ;
+  for (uint32_t i=0 ; (i<filterElementCount) && !matched ; i++) {
+    const uint32_t element = mRAM [RX_FIFO_FILTER_TABLE_WORD_OFFSET + i] ;
+    const uint32_t mask = (i < individualMaskCount) ? mRXIMR [i] : mRXFGMASK ;
+    matched = ((frameWord ^ element) & mask) == 0 ;
+    filterIndex = i ;
+  }
+  bool stored = false ;
+  if (matched) {
+    if (mRxFIFOCount == RX_FIFO_DEPTH) {
+      mIFLAG1 |= IFLAG1_FIFO_OVERFLOW ;
+    }else{
+      const uint32_t writeIndex = (mRxFIFOReadIndex + mRxFIFOCount) % RX_FIFO_DEPTH ;
+      mRxFIFO [writeIndex] = inFrame ;
+      mRxFIFOFilterIndex [writeIndex] = filterIndex ;
+      mRxFIFOCount += 1 ;
+      if (mRxFIFOCount == 1) {
+        loadRxFIFOOutput () ;
+      }else if (mRxFIFOCount == 5) {
+        mIFLAG1 |= IFLAG1_FIFO_WARNING ;
+      }
+      stored = true ;
+    }
+  }
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The first empty mailbox whose filter matches receives the frame
+
+bool ACAN_T4_SimulatedFlexCAN::receiveInMailbox (const CANFDMessage & inFrame,
+                                                 const uint32_t inFirstMailboxIndex) {
+  const uint32_t frameWord =
+    ((inFrame.type == CANFDMessage::CAN_REMOTE) ? (1U << 31) : 0) |
+    (inFrame.ext ? ((1U << 30) | (inFrame.id & 0x1FFFFFFF)) : ((inFrame.id & 0x7FF) << 18))
+  ;
+  bool stored = false ;
+  for (uint32_t i=inFirstMailboxIndex ; (i<=lastMailboxIndex ()) && !stored ; i++) {
+    const uint32_t wordOffset = mailboxWordOffset (i) ;
+    const uint32_t cs = mRAM [wordOffset] ;
+    if (((cs >> 24) & 0x0F) == MB_CODE_RX_EMPTY) {
+      const uint32_t filterWord =
+        (((cs & MB_CS_RTR) != 0) ? (1U << 31) : 0) |
+        (((cs & MB_CS_IDE) != 0) ? (1U << 30) : 0) |
+        (mRAM [wordOffset + 1] & 0x1FFFFFFF)
+      ;
+      const uint32_t mask = ((mMCR & MCR_IRMQ) != 0) ? mRXIMR [i] : 0xFFFFFFFF ;
+      if (((frameWord ^ filterWord) & mask) == 0) {
+        writeFrameToMailbox (inFrame, wordOffset, MB_CODE_RX_FULL) ;
+        setInterruptFlag (i) ;
+        stored = true ;
+      }
+    }
+  }
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::receiveFrame (const CANFDMessage & inFrame) {
+  bool stored = false ;
+  if (isRunning () && (isCANFDEnabled () || !isCANFDFrame (inFrame))) {
+    if ((mMCR & MCR_RFEN) != 0) { // Matching starts from RxFIFO and continues on mailboxes
+      stored = receiveInRxFIFO (inFrame) || receiveInMailbox (inFrame, firstTxMailboxIndex ()) ;
+    }else{
+      stored = receiveInMailbox (inFrame, 0) ;
+    }
+  }
+  if (stored) {
+    mReceivedFrameCount += 1 ;
+  }else{
+    mLostFrameCount += 1 ;
+  }
+  deliverPendingInterrupts () ;
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    TRANSMISSION
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::arbitrationKey (const CANFDMessage & inFrame) {
+  const uint32_t rtr = (inFrame.type == CANFDMessage::CAN_REMOTE) ? 1 : 0 ;
+  uint32_t key ;
+  if (inFrame.ext) { // Base identifier, SRR (recessive), IDE (recessive), identifier extension, RTR
+    key = (((inFrame.id >> 18) & 0x7FF) << 21) | (1U << 20) | (1U << 19) | ((inFrame.id & 0x3FFFF) << 1) | rtr ;
+  }else{ // Identifier, RTR, IDE (dominant)
+    key = ((inFrame.id & 0x7FF) << 21) | (rtr << 20) ;
+  }
+  return key ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::findTxMailbox (uint32_t & outMailboxIndex) const {
+  bool found = false ;
+  if (isRunning () && !isListenOnlyMode () && !isBusOff ()) {
+    uint32_t bestKey = 0 ;
+    for (uint32_t i=firstTxMailboxIndex () ; i<=lastMailboxIndex () ; i++) {
+      const uint32_t wordOffset = mailboxWordOffset (i) ;
+      if (((mRAM [wordOffset] >> 24) & 0x0F) == MB_CODE_TX_DATA) {
+        CANFDMessage frame ;
+        readFrameFromMailbox (wordOffset, frame) ;
+        const uint32_t key = arbitrationKey (frame) ;
+        if (!found || (key < bestKey)) {
+          found = true ;
+          bestKey = key ;
+          outMailboxIndex = i ;
+        }
+      }
+    }
+  }
+  return found ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::peekFrameToSend (CANFDMessage & outFrame) {
+  mHasPeekedMailbox = findTxMailbox (mPeekedMailboxIndex) ;
+  if (mHasPeekedMailbox) {
+    readFrameFromMailbox (mailboxWordOffset (mPeekedMailboxIndex), mPeekedFrame) ;
+    outFrame = mPeekedFrame ;
+  }
+  return mHasPeekedMailbox ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::completeTransmission (void) {
+  if (mHasPeekedMailbox) {
+    mHasPeekedMailbox = false ;
+    const uint32_t wordOffset = mailboxWordOffset (mPeekedMailboxIndex) ;
+    const uint32_t cs = mRAM [wordOffset] ;
+    if (((cs >> 24) & 0x0F) == MB_CODE_TX_DATA) { // Not aborted by driver meanwhile
+    //--- After sending a remote frame, the mailbox becomes an Rx mailbox
+      const uint32_t code = ((cs & MB_CS_RTR) != 0) ? MB_CODE_RX_EMPTY : MB_CODE_TX_INACTIVE ;
+      mRAM [wordOffset] = (cs & 0xF0FF0000) | (code << 24) | (micros () & 0xFFFF) ;
+      setInterruptFlag (mPeekedMailboxIndex) ;
+      mTransmittedFrameCount += 1 ;
+      if (isSelfReceptionEnabled ()) {
+        const bool stored = ((mMCR & MCR_RFEN) != 0)
+          ? (receiveInRxFIFO (mPeekedFrame) || receiveInMailbox (mPeekedFrame, firstTxMailboxIndex ()))
+          : receiveInMailbox (mPeekedFrame, 0)
+        ;
+        if (stored) {
+          mReceivedFrameCount += 1 ;
+        }
+      }
+      deliverPendingInterrupts () ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::takeTransmittedFrame (CANFDMessage & outFrame) {
+  const bool ok = peekFrameToSend (outFrame) ;
+  if (ok) {
+    completeTransmission () ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::transmitPendingFrames (void) {
+  uint32_t count = 0 ;
+  CANFDMessage frame ;
+  while (takeTransmittedFrame (frame)) {
+    count += 1 ;
+  }
+  return count ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    ERROR COUNTERS
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::setErrorCounters (const uint32_t inTransmitErrorCounter,
+                                                 const uint32_t inReceiveErrorCounter) {
+  mTransmitErrorCounter = inTransmitErrorCounter ;
+  mReceiveErrorCounter = inReceiveErrorCounter ;
+}
+
+bool ACAN_T4_SimulatedFlexCAN::isErrorPassive (void) const {
+  return (mTransmitErrorCounter > 127) || (mReceiveErrorCounter > 127) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::isBusOff (void) const {
+  return mTransmitErrorCounter > 255 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    BIT RATES
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t canClockFrequency (void) {
+  const uint32_t podf = (CCM_CSCMR2 >> 2) & 0x3F ;
+  uint32_t frequency ;
+  switch ((CCM_CSCMR2 >> 8) & 3) {
+  case 0 : frequency = 60 * 1000 * 1000 ; break ; // pll3_sw_clk / 8
+  case 1 : frequency = 24 * 1000 * 1000 ; break ; // Oscillator
+  default : frequency = 80 * 1000 * 1000 ; break ; // pll3_sw_clk / 6
+  }
+  return frequency / (podf + 1) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::nominalBitRate (void) const {
+  uint32_t prescaler ;
+  uint32_t timeQuantaPerBit ;
+  if ((mCBT & (1U << 31)) != 0) { // CBT enabled (CANFD driver)
+    prescaler = ((mCBT >> 21) & 0x3FF) + 1 ;
+    timeQuantaPerBit = 1 + (((mCBT >> 10) & 0x3F) + 1) + (((mCBT >> 5) & 0x1F) + 1) + ((mCBT & 0x1F) + 1) ;
+  }else{ // CTRL1 (CAN 2.0B driver)
+    prescaler = ((mCTRL1 >> 24) & 0xFF) + 1 ;
+    timeQuantaPerBit = 1 + ((mCTRL1 & 7) + 1) + (((mCTRL1 >> 19) & 7) + 1) + (((mCTRL1 >> 16) & 7) + 1) ;
+  }
+  return canClockFrequency () / (prescaler * timeQuantaPerBit) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_SimulatedFlexCAN::dataBitRate (void) const {
+  uint32_t result = 0 ;
+  if (isCANFDEnabled ()) {
+    const uint32_t prescaler = ((mFDCBT >> 20) & 0x3FF) + 1 ;
+  //--- FPROPSEG field is the propagation segment itself (not minus 1)
+    const uint32_t timeQuantaPerBit =
+      1 + ((mFDCBT >> 10) & 0x1F) + (((mFDCBT >> 5) & 7) + 1) + ((mFDCBT & 7) + 1) ;
+    result = canClockFrequency () / (prescaler * timeQuantaPerBit) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    INTERRUPTS
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_SimulatedFlexCAN::interruptPending (void) const {
+  return ((mMCR & MCR_MDIS) == 0) && (((mIFLAG1 & mIMASK1) | (mIFLAG2 & mIMASK2)) != 0) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Interrupt service routines are never preempted. FlexCAN interrupts are delivered first; when no
+// FlexCAN interrupt is pending, the pending software interrupt of highest priority (smallest
+// NVIC priority value) is delivered.
+
+static bool gInInterruptServiceRoutine = false ;
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_SimulatedFlexCAN::deliverPendingInterrupts (void) {
+  if (!gInInterruptServiceRoutine && acanT4HostInterruptsEnabled ()) {
+    gInInterruptServiceRoutine = true ;
+    ACAN_T4_SimulatedFlexCAN * modules [3] = {& flexcan1, & flexcan2, & flexcan3} ;
+    uint32_t guard = 100000 ; // Stops if an interrupt service routine does not clear its flags
+    bool delivered = true ;
+    while (delivered && (guard > 0)) {
+      delivered = false ;
+      for (uint32_t i=0 ; i<3 ; i++) {
+        ACAN_T4_SimulatedFlexCAN * m = modules [i] ;
+        void (* isr) (void) = _VectorsRam [16 + m->mIRQ] ;
+        if (m->interruptPending () && acanT4HostNVICEnabled [m->mIRQ] && (isr != nullptr)) {
+          m->mInterruptCount += 1 ;
+          isr () ;
+          delivered = true ;
+          guard -= 1 ;
+        }
+      }
+      if (!delivered) {
+        uint32_t irq = NVIC_NUM_INTERRUPTS ;
+        for (uint32_t i=0 ; i<NVIC_NUM_INTERRUPTS ; i++) {
+          if (acanT4HostNVICPending [i] && acanT4HostNVICEnabled [i] && (_VectorsRam [16 + i] != nullptr)
+           && ((irq == NVIC_NUM_INTERRUPTS) || (acanT4HostNVICPriority [i] < acanT4HostNVICPriority [irq]))) {
+            irq = i ;
+          }
+        }
+        if (irq < NVIC_NUM_INTERRUPTS) {
+          acanT4HostNVICPending [irq] = false ;
+          _VectorsRam [16 + irq] () ;
+          delivered = true ;
+          guard -= 1 ;
+        }
+      }
+    }
+    gInInterruptServiceRoutine = false ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,219 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: simulated FlexCAN modules
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// When ACAN_T4_HOST_SIMULATION is defined, the FLEXCAN_xxx register macros of ACAN_T4.cpp and
+// ACAN_T4FD.cpp are defined by this header: every register access is redirected to one of the
+// three simulated FlexCAN modules, selected by the base address of the driver instance.
+//
+// What is modeled:
+//   - MCR freeze / halt / soft reset / low power handshakes;
+//   - CAN 2.0B: RxFIFO (6 frames) with format A filter table, individual masks (RXIMR) and
+//     global mask (RXFGMASK), IDHIT (RXFIR), FIFO warning and overflow flags;
+//   - CANFD: mailbox RAM layout for every payload size, Rx mailbox filtering;
+//   - Tx mailboxes (data and remote frames), internal arbitration (lowest identifier first),
+//     self reception, loop back and listen only modes;
+//   - IFLAG (write 1 to clear) / IMASK, and interrupt delivery through _VectorsRam when the
+//     NVIC interrupt and the global interrupts are enabled;
+//   - ECR / ESR1 error counters and fault confinement state;
+//   - nominal and data bit rates, from CAN clock root and bit timing registers.
+// Configuration register writes outside freeze mode are counted.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_SimulatedFlexCAN {
+
+//--- Constructor
+  public: ACAN_T4_SimulatedFlexCAN (const uint32_t inBaseAddress, const uint32_t inIRQ) ;
+
+//--- The three modules
+  public: static ACAN_T4_SimulatedFlexCAN flexcan1 ;
+  public: static ACAN_T4_SimulatedFlexCAN flexcan2 ;
+  public: static ACAN_T4_SimulatedFlexCAN flexcan3 ;
+  public: static ACAN_T4_SimulatedFlexCAN & module (const uint32_t inBaseAddress) ;
+
+//--- Register access, used by FLEXCAN_xxx macros (inOffset is the offset from base address)
+  public: uint32_t readRegister (const uint32_t inOffset) ;
+  public: void writeRegister (const uint32_t inOffset, const uint32_t inValue) ;
+  public: inline volatile uint32_t * mailboxRAM (void) { return mRAM ; }
+
+//--- Module state
+  public: bool isFrozen (void) const ;
+  public: bool isRunning (void) const ; // Not frozen, not disabled, not in soft reset
+  public: bool isCANFDEnabled (void) const ;
+  public: bool isLoopBackMode (void) const ;
+  public: bool isListenOnlyMode (void) const ;
+  public: bool isSelfReceptionEnabled (void) const ;
+  public: inline uint32_t baseAddress (void) const { return mBaseAddress ; }
+
+//--- Bus side: reception of a frame sent by an other node. Returns false if the frame is not
+//    stored (module not running, no matching filter, RxFIFO or Rx mailboxes full).
+  public: bool receiveFrame (const CANFDMessage & inFrame) ;
+
+//--- Bus side: transmission. peekFrameToSend returns the pending frame that wins internal
+//    arbitration; completeTransmission marks it as sent (Tx flag, self reception).
+  public: bool peekFrameToSend (CANFDMessage & outFrame) ;
+  public: void completeTransmission (void) ;
+//--- Takes and completes the highest priority pending frame (returns false if none)
+  public: bool takeTransmittedFrame (CANFDMessage & outFrame) ;
+//--- Completes every pending frame (frames are considered as acknowledged); returns the count
+  public: uint32_t transmitPendingFrames (void) ;
+
+//--- Error counters (ECR) and fault confinement state (ESR1)
+  public: void setErrorCounters (const uint32_t inTransmitErrorCounter,
+                                 const uint32_t inReceiveErrorCounter) ;
+  public: inline uint32_t transmitErrorCounter (void) const { return mTransmitErrorCounter ; }
+  public: inline uint32_t receiveErrorCounter (void) const { return mReceiveErrorCounter ; }
+  public: bool isErrorPassive (void) const ;
+  public: bool isBusOff (void) const ; // A bus off module does not transmit
+
+//--- Bit rates set by the configured bit timing (CCM_CSCMR2, CTRL1 or CBT, FDCBT), in bit/s.
+//    dataBitRate returns 0 if CANFD is not enabled.
+  public: uint32_t nominalBitRate (void) const ;
+  public: uint32_t dataBitRate (void) const ;
+
+//--- Interrupts
+  public: bool interruptPending (void) const ;
+  public: static void deliverPendingInterrupts (void) ;
+
+//--- Statistics
+  public: inline uint32_t lostFrameCount (void) const { return mLostFrameCount ; }
+  public: inline uint32_t receivedFrameCount (void) const { return mReceivedFrameCount ; }
+  public: inline uint32_t transmittedFrameCount (void) const { return mTransmittedFrameCount ; }
+  public: inline uint32_t interruptCount (void) const { return mInterruptCount ; }
+  public: inline uint32_t writeOutsideFreezeModeCount (void) const { return mWriteOutsideFreezeModeCount ; }
+
+//--- Frame arbitration field, as a 32-bit value: the lowest value wins arbitration
+  public: static uint32_t arbitrationKey (const CANFDMessage & inFrame) ;
+
+//--- Private methods
+  private: void softReset (void) ;
+  private: void writeMCR (const uint32_t inValue) ;
+  private: uint32_t lastMailboxIndex (void) const ;
+  private: uint32_t firstTxMailboxIndex (void) const ;
+  private: uint32_t mailboxWordOffset (const uint32_t inMailboxIndex) const ;
+  private: uint32_t mailboxDataWordCount (void) const ;
+  private: void writeFrameToMailbox (const CANFDMessage & inFrame,
+                                     const uint32_t inWordOffset,
+                                     const uint32_t inCode) ;
+  private: void readFrameFromMailbox (const uint32_t inWordOffset, CANFDMessage & outFrame) const ;
+  private: bool receiveInRxFIFO (const CANFDMessage & inFrame) ;
+  private: bool receiveInMailbox (const CANFDMessage & inFrame, const uint32_t inFirstMailboxIndex) ;
+  private: void loadRxFIFOOutput (void) ;
+  private: void setInterruptFlag (const uint32_t inMailboxIndex) ;
+  private: bool findTxMailbox (uint32_t & outMailboxIndex) const ;
+
+//--- Registers
+  private: const uint32_t mBaseAddress ;
+  private: const uint32_t mIRQ ;
+  private: uint32_t mMCR ;
+  private: uint32_t mCTRL1 = 0 ;
+  private: uint32_t mIMASK1 = 0 ;
+  private: uint32_t mIMASK2 = 0 ;
+  private: uint32_t mIFLAG1 = 0 ;
+  private: uint32_t mIFLAG2 = 0 ;
+  private: uint32_t mCTRL2 = 0 ;
+  private: uint32_t mRXFGMASK = 0 ;
+  private: uint32_t mRXFIR = 0 ;
+  private: uint32_t mCBT = 0 ;
+  private: uint32_t mFDCTRL = 0 ;
+  private: uint32_t mFDCBT = 0 ;
+  private: volatile uint32_t mRAM [256] ; // Mailbox RAM, 0x080 ... 0x47F
+  private: uint32_t mRXIMR [64] ; // 0x880 ... 0x97F
+
+//--- RxFIFO (CAN 2.0B mode)
+  private: static const uint32_t RX_FIFO_DEPTH = 6 ;
+  private: CANFDMessage mRxFIFO [RX_FIFO_DEPTH] ;
+  private: uint32_t mRxFIFOFilterIndex [RX_FIFO_DEPTH] ;
+  private: uint32_t mRxFIFOReadIndex = 0 ;
+  private: uint32_t mRxFIFOCount = 0 ;
+
+//--- Transmission in progress (set by peekFrameToSend)
+  private: bool mHasPeekedMailbox = false ;
+  private: uint32_t mPeekedMailboxIndex = 0 ;
+  private: CANFDMessage mPeekedFrame ;
+
+//--- Error state
+  private: uint32_t mTransmitErrorCounter = 0 ;
+  private: uint32_t mReceiveErrorCounter = 0 ;
+
+//--- Statistics
+  private: uint32_t mLostFrameCount = 0 ;
+  private: uint32_t mReceivedFrameCount = 0 ;
+  private: uint32_t mTransmittedFrameCount = 0 ;
+  private: uint32_t mInterruptCount = 0 ;
+  private: uint32_t mWriteOutsideFreezeModeCount = 0 ;
+
+//--- No copy
+  private : ACAN_T4_SimulatedFlexCAN (const ACAN_T4_SimulatedFlexCAN &) = delete ;
+  private : ACAN_T4_SimulatedFlexCAN & operator = (const ACAN_T4_SimulatedFlexCAN &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//   REGISTER PROXY
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_SimulatedRegister {
+  public: inline ACAN_T4_SimulatedRegister (const uint32_t inBaseAddress, const uint32_t inOffset) :
+  mModule (ACAN_T4_SimulatedFlexCAN::module (inBaseAddress)),
+  mOffset (inOffset) {
+  }
+
+  public: inline operator uint32_t (void) const { return mModule.readRegister (mOffset) ; }
+
+  public: inline ACAN_T4_SimulatedRegister & operator = (const uint32_t inValue) {
+    mModule.writeRegister (mOffset, inValue) ;
+    return *this ;
+  }
+
+  public: inline ACAN_T4_SimulatedRegister & operator |= (const uint32_t inValue) {
+    mModule.writeRegister (mOffset, mModule.readRegister (mOffset) | inValue) ;
+    return *this ;
+  }
+
+  public: inline ACAN_T4_SimulatedRegister & operator &= (const uint32_t inValue) {
+    mModule.writeRegister (mOffset, mModule.readRegister (mOffset) & inValue) ;
+    return *this ;
+  }
+
+  private: ACAN_T4_SimulatedFlexCAN & mModule ;
+  private: const uint32_t mOffset ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//   FLEXCAN REGISTERS
+//--------------------------------------------------------------------------------------------------
+
+#define FLEXCAN_MCR(b)          ACAN_T4_SimulatedRegister ((b), 0x00)
+#define FLEXCAN_CTRL1(b)        ACAN_T4_SimulatedRegister ((b), 0x04)
+#define FLEXCAN_TIMER(b)        ACAN_T4_SimulatedRegister ((b), 0x08)
+#define FLEXCAN_ECR(b)          ACAN_T4_SimulatedRegister ((b), 0x1C)
+#define FLEXCAN_ESR1(b)         ACAN_T4_SimulatedRegister ((b), 0x20)
+#define FLEXCAN_IMASK2(b)       ACAN_T4_SimulatedRegister ((b), 0x24)
+#define FLEXCAN_IMASK1(b)       ACAN_T4_SimulatedRegister ((b), 0x28)
+#define FLEXCAN_IFLAG2(b)       ACAN_T4_SimulatedRegister ((b), 0x2C)
+#define FLEXCAN_IFLAG1(b)       ACAN_T4_SimulatedRegister ((b), 0x30)
+#define FLEXCAN_CTRL2(b)        ACAN_T4_SimulatedRegister ((b), 0x34)
+#define FLEXCAN_RXFGMASK(b)     ACAN_T4_SimulatedRegister ((b), 0x48)
+#define FLEXCAN_RXFIR(b)        ACAN_T4_SimulatedRegister ((b), 0x4C)
+#define FLEXCAN_CBT(b)          ACAN_T4_SimulatedRegister ((b), 0x50)
+#define FLEXCAN_FDCTRL(b)       ACAN_T4_SimulatedRegister ((b), 0xC00)
+#define FLEXCAN_FDCBT(b)        ACAN_T4_SimulatedRegister ((b), 0xC04)
+#define FLEXCAN_MBn_CS(b, n)    ACAN_T4_SimulatedRegister ((b), 0x80+(n)*16)
+#define FLEXCAN_MBn_ID(b, n)    ACAN_T4_SimulatedRegister ((b), 0x84+(n)*16)
+#define FLEXCAN_MBn_WORD0(b, n) ACAN_T4_SimulatedRegister ((b), 0x88+(n)*16)
+#define FLEXCAN_MBn_WORD1(b, n) ACAN_T4_SimulatedRegister ((b), 0x8C+(n)*16)
+#define FLEXCAN_IDAF(b, n)      ACAN_T4_SimulatedRegister ((b), 0xE0+(n)*4)
+#define FLEXCAN_MB_MASK(b, n)   ACAN_T4_SimulatedRegister ((b), 0x880+(n)*4)
+#define FLEXCAN_MB_RAM(b)       (ACAN_T4_SimulatedFlexCAN::module (b).mailboxRAM ())
+
+//--------------------------------------------------------------------------------------------------
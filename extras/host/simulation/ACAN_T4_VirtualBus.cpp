@@ -0,0 +1,444 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: virtual CAN bus
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_VirtualBus.h>
+
+//--------------------------------------------------------------------------------------------------
+//   FRAME BITS
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t CANFD_LENGTH_CODE [16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
+
+//--- CRC delimiter, ACK slot, ACK delimiter, end of frame
+static const uint32_t FRAME_TRAILER_BIT_COUNT = 10 ;
+static const uint32_t END_OF_FRAME_BIT_COUNT = 7 ;
+static const uint32_t INTERMISSION_BIT_COUNT = 3 ;
+//--- Error flag (6 dominant bits), error delimiter (8 recessive bits)
+static const uint32_t ERROR_FRAME_BIT_COUNT = 14 ;
+static const uint32_t SUSPEND_TRANSMISSION_BIT_COUNT = 8 ;
+
+//--- Largest frame: extended CANFD, 64 data bytes, CRC
+static const uint32_t MAX_FRAME_BIT_COUNT = 640 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static bool isCANFDFrame (const CANFDMessage & inFrame) {
+  return (inFrame.type == CANFDMessage::CANFD_NO_BIT_RATE_SWITCH)
+      || (inFrame.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void appendBits (uint8_t ioBits [],
+                        uint32_t & ioBitCount,
+                        const uint32_t inValue,
+                        const uint32_t inWidth) {
+  for (uint32_t i=inWidth ; i>0 ; i--) { // MSB first
+    ioBits [ioBitCount] = (inValue >> (i - 1)) & 1 ;
+    ioBitCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t crc15 (const uint8_t inBits [], const uint32_t inBitCount) {
+  uint32_t crc = 0 ;
+  for (uint32_t i=0 ; i<inBitCount ; i++) {
+    const uint32_t crcNext = inBits [i] ^ ((crc >> 14) & 1) ;
+    crc = (crc << 1) & 0x7FFF ;
+    if (crcNext != 0) {
+      crc ^= 0x4599 ;
+    }
+  }
+  return crc ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bit count after dynamic bit stuffing (a complement bit after five identical bits); also returns
+// the stuffed length of the first inPrefixLength bits
+
+static uint32_t stuffedBitCount (const uint8_t inBits [],
+                                 const uint32_t inBitCount,
+                                 const uint32_t inPrefixLength,
+                                 uint32_t & outStuffedPrefixLength) {
+  uint32_t count = 0 ;
+  uint32_t runLength = 0 ;
+  uint8_t previousBit = 2 ;
+  outStuffedPrefixLength = 0 ;
+  for (uint32_t i=0 ; i<inBitCount ; i++) {
+    if (i == inPrefixLength) {
+      outStuffedPrefixLength = count ;
+    }
+    count += 1 ;
+    if (inBits [i] == previousBit) {
+      runLength += 1 ;
+    }else{
+      previousBit = inBits [i] ;
+      runLength = 1 ;
+    }
+    if (runLength == 5) { // Stuff bit starts a new run
+      count += 1 ;
+      previousBit = 1 - previousBit ;
+      runLength = 1 ;
+    }
+  }
+  if (inPrefixLength >= inBitCount) {
+    outStuffedPrefixLength = count ;
+  }
+  return count ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_VirtualBus::frameBitCount (const CANFDMessage & inFrame,
+                                        uint32_t & outNominalBitCount,
+                                        uint32_t & outDataBitCount) {
+  const bool canfd = isCANFDFrame (inFrame) ;
+  const bool remote = inFrame.type == CANFDMessage::CAN_REMOTE ;
+  uint32_t lengthCode = 0 ;
+  if (canfd) {
+    while ((lengthCode < 15) && (CANFD_LENGTH_CODE [lengthCode] < inFrame.len)) {
+      lengthCode += 1 ;
+    }
+  }else{
+    lengthCode = (inFrame.len <= 8) ? inFrame.len : 8 ;
+  }
+  const uint32_t dataLength = remote ? 0 : CANFD_LENGTH_CODE [lengthCode] ;
+//--- Bits from SOF to end of data field
+  uint8_t bits [MAX_FRAME_BIT_COUNT] ;
+  uint32_t bitCount = 0 ;
+  appendBits (bits, bitCount, 0, 1) ; // SOF
+  if (inFrame.ext) {
+    appendBits (bits, bitCount, inFrame.id >> 18, 11) ;
+    appendBits (bits, bitCount, 1, 1) ; // SRR
+    appendBits (bits, bitCount, 1, 1) ; // IDE
+    appendBits (bits, bitCount, inFrame.id & 0x3FFFF, 18) ;
+  }else{
+    appendBits (bits, bitCount, inFrame.id & 0x7FF, 11) ;
+  }
+  uint32_t arbitrationPhaseLength = 0 ;
+  if (canfd) {
+    appendBits (bits, bitCount, 0, 1) ; // RRS
+    if (!inFrame.ext) {
+      appendBits (bits, bitCount, 0, 1) ; // IDE
+    }
+    appendBits (bits, bitCount, 1, 1) ; // FDF
+    appendBits (bits, bitCount, 0, 1) ; // res
+    appendBits (bits, bitCount, (inFrame.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) ? 1 : 0, 1) ; // BRS
+    arbitrationPhaseLength = bitCount ;
+    appendBits (bits, bitCount, 0, 1) ; // ESI
+  }else{
+    appendBits (bits, bitCount, remote ? 1 : 0, 1) ; // RTR
+    appendBits (bits, bitCount, 0, 1) ; // IDE (standard), r1 (extended)
+    appendBits (bits, bitCount, 0, 1) ; // r0
+  }
+  appendBits (bits, bitCount, lengthCode, 4) ;
+  for (uint32_t i=0 ; i<dataLength ; i++) {
+    appendBits (bits, bitCount, inFrame.data [i], 8) ;
+  }
+//--- CRC field
+  if (canfd) { // Stuff count and CRC with fixed stuff bits
+    const uint32_t crcLength = (dataLength <= 16) ? 17 : 21 ;
+    const uint32_t crcFieldLength = 4 + crcLength + (4 + crcLength + 3) / 4 ;
+    uint32_t stuffedArbitrationLength ;
+    const uint32_t stuffedLength = stuffedBitCount (bits, bitCount, arbitrationPhaseLength, stuffedArbitrationLength) ;
+    if (inFrame.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) {
+      outNominalBitCount = stuffedArbitrationLength + FRAME_TRAILER_BIT_COUNT ;
+      outDataBitCount = stuffedLength - stuffedArbitrationLength + crcFieldLength ;
+    }else{
+      outNominalBitCount = stuffedLength + crcFieldLength + FRAME_TRAILER_BIT_COUNT ;
+      outDataBitCount = 0 ;
+    }
+  }else{ // CRC 15 is stuffed
+    const uint32_t crc = crc15 (bits, bitCount) ;
+    appendBits (bits, bitCount, crc, 15) ;
+    uint32_t unused ;
+    outNominalBitCount = stuffedBitCount (bits, bitCount, bitCount, unused) + FRAME_TRAILER_BIT_COUNT ;
+    outDataBitCount = 0 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    CONSTRUCTOR
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_VirtualBus::ACAN_T4_VirtualBus (const uint32_t inNominalBitRate,
+                                        const uint32_t inDataBitRate) :
+mNominalBitRate (inNominalBitRate),
+mDataBitRate (inDataBitRate),
+mBusTime (acanT4HostTime () * 1000),
+mStartTime (acanT4HostTime () * 1000) {
+}
+
+//--------------------------------------------------------------------------------------------------
+//    NODES
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_VirtualBus::attach (ACAN_T4_SimulatedFlexCAN & inModule) {
+  uint32_t result = ACAN_T4_VIRTUAL_BUS_EXTERNAL_NODE ;
+  if (mNodeCount < MAX_NODE_COUNT) {
+    result = mNodeCount ;
+    mNodes [mNodeCount] = & inModule ;
+    mNodeCount += 1 ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_VirtualBus::sendFromExternalNode (const CANFDMessage & inFrame) {
+  const bool ok = (mExternalQueueCount < EXTERNAL_QUEUE_SIZE)
+    && ((inFrame.type != CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) || (mDataBitRate > 0)) ;
+  if (ok) {
+    mExternalQueue [(mExternalQueueReadIndex + mExternalQueueCount) % EXTERNAL_QUEUE_SIZE] = inFrame ;
+    mExternalQueueCount += 1 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_VirtualBus::onBus (const uint32_t inNodeIndex) const {
+  const ACAN_T4_SimulatedFlexCAN & module = * mNodes [inNodeIndex] ;
+  return module.isRunning () && !module.isLoopBackMode () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bit rates match if they are within 0.5 %
+
+static bool sameBitRate (const uint32_t inNodeBitRate, const uint32_t inBusBitRate) {
+  const uint32_t difference = (inNodeBitRate > inBusBitRate)
+    ? (inNodeBitRate - inBusBitRate)
+    : (inBusBitRate - inNodeBitRate)
+  ;
+  return (uint64_t (difference) * 200) <= inBusBitRate ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_VirtualBus::compatible (const uint32_t inNodeIndex, const CANFDMessage & inFrame) const {
+  const ACAN_T4_SimulatedFlexCAN & module = * mNodes [inNodeIndex] ;
+  bool ok = sameBitRate (module.nominalBitRate (), mNominalBitRate) ;
+  if (isCANFDFrame (inFrame)) {
+    ok = ok && module.isCANFDEnabled () ;
+  }
+  if (inFrame.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) {
+    ok = ok && (mDataBitRate > 0) && sameBitRate (module.dataBitRate (), mDataBitRate) ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    TIME
+//--------------------------------------------------------------------------------------------------
+
+uint64_t ACAN_T4_VirtualBus::bitDuration (const uint32_t inNominalBitCount,
+                                          const uint32_t inDataBitCount) const {
+  uint64_t duration = (uint64_t (inNominalBitCount) * 1000000000ULL) / mNominalBitRate ;
+  if (inDataBitCount > 0) {
+    duration += (uint64_t (inDataBitCount) * 1000000000ULL) / mDataBitRate ;
+  }
+  return duration ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t ACAN_T4_VirtualBus::frameDuration (const CANFDMessage & inFrame) const {
+  uint32_t nominalBitCount ;
+  uint32_t dataBitCount ;
+  frameBitCount (inFrame, nominalBitCount, dataBitCount) ;
+  return bitDuration (nominalBitCount, dataBitCount) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_VirtualBus::synchronizeWithHostTime (void) { // Host time may have been advanced
+  const uint64_t hostTime = acanT4HostTime () * 1000 ;
+  if (mBusTime < hostTime) {
+    mBusTime = hostTime ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_VirtualBus::advance (const uint64_t inDuration) {
+  mBusTime += inDuration ;
+  acanT4HostSetTime (mBusTime / 1000) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_VirtualBus::busLoadPerMille (void) const {
+  const uint64_t elapsed = mBusTime - mStartTime ;
+  return (elapsed == 0) ? 0 : uint32_t ((mBusyTime * 1000) / elapsed) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    ERROR COUNTERS
+//--------------------------------------------------------------------------------------------------
+
+static void incrementTransmitErrorCounter (ACAN_T4_SimulatedFlexCAN & ioModule) {
+  const uint32_t tec = ioModule.transmitErrorCounter () + 8 ;
+  ioModule.setErrorCounters ((tec > 256) ? 256 : tec, ioModule.receiveErrorCounter ()) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void decrementTransmitErrorCounter (ACAN_T4_SimulatedFlexCAN & ioModule) {
+  const uint32_t tec = ioModule.transmitErrorCounter () ;
+  ioModule.setErrorCounters ((tec > 0) ? (tec - 1) : 0, ioModule.receiveErrorCounter ()) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void incrementReceiveErrorCounter (ACAN_T4_SimulatedFlexCAN & ioModule) {
+  const uint32_t rec = ioModule.receiveErrorCounter () + 1 ;
+  ioModule.setErrorCounters (ioModule.transmitErrorCounter (), (rec > 255) ? 255 : rec) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void decrementReceiveErrorCounter (ACAN_T4_SimulatedFlexCAN & ioModule) {
+  uint32_t rec = ioModule.receiveErrorCounter () ;
+  if (rec > 127) { // Back to error active
+    rec = 127 ;
+  }else if (rec > 0) {
+    rec -= 1 ;
+  }
+  ioModule.setErrorCounters (ioModule.transmitErrorCounter (), rec) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SIMULATION
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_VirtualBus::step (void) {
+  synchronizeWithHostTime () ;
+//--- Arbitration
+  bool found = false ;
+  uint32_t transmitter = 0 ;
+  uint32_t bestKey = 0 ;
+  uint32_t pendingCount = 0 ;
+  CANFDMessage frame ;
+  for (uint32_t i=0 ; i<mNodeCount ; i++) {
+    CANFDMessage candidate ;
+    if (onBus (i) && mNodes [i]->peekFrameToSend (candidate)) {
+      pendingCount += 1 ;
+      const uint32_t key = ACAN_T4_SimulatedFlexCAN::arbitrationKey (candidate) ;
+      if (!found || (key < bestKey)) {
+        found = true ;
+        bestKey = key ;
+        transmitter = i ;
+        frame = candidate ;
+      }
+    }
+  }
+  if (mExternalQueueCount > 0) {
+    pendingCount += 1 ;
+    const CANFDMessage & candidate = mExternalQueue [mExternalQueueReadIndex] ;
+    const uint32_t key = ACAN_T4_SimulatedFlexCAN::arbitrationKey (candidate) ;
+    if (!found || (key < bestKey)) {
+      found = true ;
+      transmitter = ACAN_T4_VIRTUAL_BUS_EXTERNAL_NODE ;
+      frame = candidate ;
+    }
+  }
+//--- Transmission
+  if (found) {
+    mArbitrationLossCount += pendingCount - 1 ;
+    const uint64_t startDate = mBusTime ;
+    const bool externalTransmitter = transmitter == ACAN_T4_VIRTUAL_BUS_EXTERNAL_NODE ;
+    ACAN_T4_SimulatedFlexCAN * transmitterModule = externalTransmitter ? nullptr : mNodes [transmitter] ;
+    const bool errorPassiveTransmitter = !externalTransmitter && transmitterModule->isErrorPassive () ;
+    uint32_t nominalBitCount ;
+    uint32_t dataBitCount ;
+    frameBitCount (frame, nominalBitCount, dataBitCount) ;
+  //--- Error ? Acknowledged ?
+    bool error = false ;
+    if (mInjectedErrorCount > 0) {
+      mInjectedErrorCount -= 1 ;
+      error = true ;
+    }
+    if (!error && (mErrorCallBack != nullptr)) {
+      error = mErrorCallBack (frame, transmitter) ;
+    }
+    if (!externalTransmitter && !compatible (transmitter, frame)) {
+      error = true ;
+    }
+    bool acknowledged = !externalTransmitter && mExternalNodeAcknowledges ;
+    for (uint32_t i=0 ; i<mNodeCount ; i++) {
+      if ((i != transmitter) && onBus (i)) {
+        if (!compatible (i, frame)) {
+          error = true ;
+        }else if (!mNodes [i]->isListenOnlyMode ()) {
+          acknowledged = true ;
+        }
+      }
+    }
+  //---
+    if (error || !acknowledged) { // Error frame after ACK delimiter, the frame remains pending
+      advance (bitDuration (nominalBitCount - END_OF_FRAME_BIT_COUNT + ERROR_FRAME_BIT_COUNT + INTERMISSION_BIT_COUNT, dataBitCount)) ;
+      if (error) {
+        mErrorFrameCount += 1 ;
+        if (!externalTransmitter) {
+          incrementTransmitErrorCounter (*transmitterModule) ;
+        }
+        for (uint32_t i=0 ; i<mNodeCount ; i++) {
+          if ((i != transmitter) && onBus (i) && !mNodes [i]->isListenOnlyMode ()) {
+            incrementReceiveErrorCounter (*mNodes [i]) ;
+          }
+        }
+      }else{
+        mAckErrorCount += 1 ;
+        if (!externalTransmitter && !errorPassiveTransmitter) {
+          incrementTransmitErrorCounter (*transmitterModule) ;
+        }
+      }
+    }else{
+      advance (bitDuration (nominalBitCount, dataBitCount)) ;
+      for (uint32_t i=0 ; i<mNodeCount ; i++) {
+        if ((i != transmitter) && onBus (i)) {
+          mNodes [i]->receiveFrame (frame) ;
+          decrementReceiveErrorCounter (*mNodes [i]) ;
+        }
+      }
+      if (externalTransmitter) {
+        mExternalQueueReadIndex = (mExternalQueueReadIndex + 1) % EXTERNAL_QUEUE_SIZE ;
+        mExternalQueueCount -= 1 ;
+      }else{
+        transmitterModule->completeTransmission () ;
+        decrementTransmitErrorCounter (*transmitterModule) ;
+      }
+      mFrameCount += 1 ;
+      if (mFrameCallBack != nullptr) {
+        mFrameCallBack (frame, transmitter, startDate, mBusTime) ;
+      }
+      advance (bitDuration (INTERMISSION_BIT_COUNT, 0)) ;
+    }
+    if (errorPassiveTransmitter) {
+      advance (bitDuration (SUSPEND_TRANSMISSION_BIT_COUNT, 0)) ;
+    }
+    mBusyTime += mBusTime - startDate ;
+  }
+  return found ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_VirtualBus::run (const uint64_t inDuration) {
+  synchronizeWithHostTime () ;
+  const uint64_t endDate = mBusTime + inDuration * 1000 ;
+  const uint32_t initialFrameCount = mFrameCount ;
+  while ((mBusTime < endDate) && step ()) {
+  }
+  if (mBusTime < endDate) { // Bus is idle
+    advance (endDate - mBusTime) ;
+  }
+  return mFrameCount - initialFrameCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: virtual CAN bus
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Connects simulated FlexCAN modules (and an external node standing for the rest of the network)
+// on a single virtual bus, and advances the virtual clock (acanT4HostTime) frame by frame.
+//
+//   - Arbitration: among every pending frame (the winning Tx mailbox of each module, the head of
+//     the external node queue), the lowest arbitration field wins; on equality, the first
+//     attached node wins.
+//   - Frame duration: computed bit by bit (dynamic stuff bits, CRC 15 of CAN 2.0B frames,
+//     CANFD stuff count and fixed stuff bits, CRC 17 / CRC 21), data phase of BRS frames at the
+//     data bit rate, CRC delimiter, ACK, EOF and intermission. Bit rate switching is rounded to
+//     bit boundaries (BRS bit at nominal rate, CRC delimiter at nominal rate).
+//   - ACK: a frame is acknowledged if an other node (not in listen only mode) can receive it.
+//     An unacknowledged frame gives an ACK error, the frame is retransmitted.
+//   - Errors: a node whose bit timing does not match the bus bit rates, a CAN 2.0B node that
+//     receives a CANFD frame, or an injected error, destroys the frame with an error frame. Error
+//     counters follow fault confinement rules (transmitter +8, receivers +1, successful frame -1,
+//     error passive transmitter not incremented on ACK error, suspend transmission); a bus off
+//     module stops transmitting until its counters are reset by setErrorCounters.
+//     Errors are signaled after the ACK delimiter.
+//
+// Modules in loop back mode are not connected to the bus.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_SimulatedFlexCAN.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t ACAN_T4_VIRTUAL_BUS_EXTERNAL_NODE = 255 ;
+
+//--------------------------------------------------------------------------------------------------
+// Called for every frame that completes successfully; dates are in ns
+
+typedef void (* ACAN_T4_VirtualBusFrameCallBack) (const CANFDMessage & inFrame,
+                                                  const uint32_t inTransmitterIndex,
+                                                  const uint64_t inStartDate,
+                                                  const uint64_t inEndDate) ;
+
+//--------------------------------------------------------------------------------------------------
+// Called before every frame transmission; returns true for destroying the frame with an error
+
+typedef bool (* ACAN_T4_VirtualBusErrorCallBack) (const CANFDMessage & inFrame,
+                                                  const uint32_t inTransmitterIndex) ;
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_VirtualBus {
+
+//--- Constructor: bus bit rates (inDataBitRate == 0 for a CAN 2.0B bus)
+  public: ACAN_T4_VirtualBus (const uint32_t inNominalBitRate, const uint32_t inDataBitRate = 0) ;
+
+//--- Nodes: returns the node index, or ACAN_T4_VIRTUAL_BUS_EXTERNAL_NODE if no more room
+  public: static const uint32_t MAX_NODE_COUNT = 8 ;
+  public: uint32_t attach (ACAN_T4_SimulatedFlexCAN & inModule) ;
+
+//--- External node: sends frames of the rest of the network, and acknowledges frames
+  public: bool sendFromExternalNode (const CANFDMessage & inFrame) ; // false if queue full
+  public: inline uint32_t externalNodeQueueCount (void) const { return mExternalQueueCount ; }
+  public: bool mExternalNodeAcknowledges = true ;
+
+//--- Callbacks
+  public: ACAN_T4_VirtualBusFrameCallBack mFrameCallBack = nullptr ;
+  public: ACAN_T4_VirtualBusErrorCallBack mErrorCallBack = nullptr ;
+
+//--- Destroys the next inCount frames
+  public: inline void injectErrors (const uint32_t inCount) { mInjectedErrorCount += inCount ; }
+
+//--- Simulation: step transmits one frame (returns false if no frame is pending, the clock is
+//    not advanced); run transmits frames during inDuration µs (the bus is idle when no frame is
+//    pending), returns the number of completed frames.
+  public: bool step (void) ;
+  public: uint32_t run (const uint64_t inDuration) ;
+  public: inline uint64_t busTime (void) const { return mBusTime ; } // In ns
+
+//--- Frame duration (without intermission), in ns
+  public: uint64_t frameDuration (const CANFDMessage & inFrame) const ;
+//--- Bit count of a frame (without intermission), in arbitration and data phases
+  public: static void frameBitCount (const CANFDMessage & inFrame,
+                                     uint32_t & outNominalBitCount,
+                                     uint32_t & outDataBitCount) ;
+
+//--- Statistics
+  public: inline uint32_t frameCount (void) const { return mFrameCount ; }
+  public: inline uint32_t errorFrameCount (void) const { return mErrorFrameCount ; }
+  public: inline uint32_t ackErrorCount (void) const { return mAckErrorCount ; }
+  public: inline uint32_t arbitrationLossCount (void) const { return mArbitrationLossCount ; }
+  public: inline uint64_t busyTime (void) const { return mBusyTime ; } // In ns
+  public: uint32_t busLoadPerMille (void) const ;
+
+//--- Private methods
+  private: bool onBus (const uint32_t inNodeIndex) const ;
+  private: bool compatible (const uint32_t inNodeIndex, const CANFDMessage & inFrame) const ;
+  private: void advance (const uint64_t inDuration) ;
+  private: void synchronizeWithHostTime (void) ;
+  private: uint64_t bitDuration (const uint32_t inNominalBitCount, const uint32_t inDataBitCount) const ;
+
+//--- Properties
+  private: const uint32_t mNominalBitRate ;
+  private: const uint32_t mDataBitRate ;
+  private: ACAN_T4_SimulatedFlexCAN * mNodes [MAX_NODE_COUNT] ;
+  private: uint32_t mNodeCount = 0 ;
+  private: static const uint32_t EXTERNAL_QUEUE_SIZE = 64 ;
+  private: CANFDMessage mExternalQueue [EXTERNAL_QUEUE_SIZE] ;
+  private: uint32_t mExternalQueueReadIndex = 0 ;
+  private: uint32_t mExternalQueueCount = 0 ;
+  private: uint32_t mInjectedErrorCount = 0 ;
+  private: uint64_t mBusTime = 0 ;
+  private: uint64_t mStartTime = 0 ;
+  private: uint64_t mBusyTime = 0 ;
+  private: uint32_t mFrameCount = 0 ;
+  private: uint32_t mErrorFrameCount = 0 ;
+  private: uint32_t mAckErrorCount = 0 ;
+  private: uint32_t mArbitrationLossCount = 0 ;
+
+//--- No copy
+  private : ACAN_T4_VirtualBus (const ACAN_T4_VirtualBus &) = delete ;
+  private : ACAN_T4_VirtualBus & operator = (const ACAN_T4_VirtualBus &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------------------------------
+// Host build of the ACAN_T4 driver: minimal Arduino / Teensy 4.x environment
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Only what the driver uses is defined here. Clock, pin and NVIC registers are plain variables;
+// FlexCAN registers are provided by ACAN_T4_SimulatedFlexCAN.h.
+// Global interrupt masking is emulated: pending FlexCAN interrupts, and pending software
+// interrupts (NVIC_SET_PENDING), are delivered when interrupts are enabled again (see
+// ACAN_T4_SimulatedFlexCAN).
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ACAN_T4_HOST_SIMULATION
+  #error "This header is only used by the host build (define ACAN_T4_HOST_SIMULATION)"
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+//   TIME (virtual clock, advanced by the simulation)
+//--------------------------------------------------------------------------------------------------
+
+uint32_t micros (void) ;
+uint32_t millis (void) ;
+
+uint64_t acanT4HostTime (void) ; // In µs
+void acanT4HostSetTime (const uint64_t inMicroseconds) ;
+void acanT4HostAdvanceTime (const uint64_t inMicroseconds) ;
+
+//--------------------------------------------------------------------------------------------------
+//   INTERRUPTS
+//--------------------------------------------------------------------------------------------------
+
+void acanT4HostDisableInterrupts (void) ;
+void acanT4HostEnableInterrupts (void) ;
+bool acanT4HostInterruptsEnabled (void) ;
+
+#define noInterrupts() acanT4HostDisableInterrupts ()
+#define interrupts() acanT4HostEnableInterrupts ()
+
+//--------------------------------------------------------------------------------------------------
+//   INTERVAL TIMER (PIT): a running timer calls its function when acanT4HostAdvanceTime reaches its
+//   next date, with the virtual clock set to this date
+//--------------------------------------------------------------------------------------------------
+
+class IntervalTimer {
+  public: IntervalTimer (void) ;
+  public: ~IntervalTimer (void) ;
+  public: bool begin (void (* inFunction) (void), const uint32_t inMicroseconds) ;
+  public: void end (void) ;
+  public: void priority (const uint8_t inPriority) ;
+
+  public: static bool fireNextTimer (const uint64_t inLimitDate) ; // Returns false if none is due
+
+  private: void (* mFunction) (void) ;
+  private: uint32_t mPeriod ;
+  private: uint64_t mNextDate ;
+  private: bool mRunning ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//   MEMORY PLACEMENT (OCRAM and external PSRAM sections on Teensy 4.x, plain memory on host)
+//--------------------------------------------------------------------------------------------------
+
+#define DMAMEM
+#define EXTMEM
+
+//--------------------------------------------------------------------------------------------------
+//   NVIC
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t NVIC_NUM_INTERRUPTS = 160 ;
+
+enum IRQ_NUMBER_t {
+  IRQ_CAN1 = 36,
+  IRQ_CAN2 = 37,
+  IRQ_CAN3 = 154
+} ;
+
+extern void (* _VectorsRam [NVIC_NUM_INTERRUPTS + 16]) (void) ;
+
+extern bool acanT4HostNVICEnabled [NVIC_NUM_INTERRUPTS] ;
+
+extern bool acanT4HostNVICPending [NVIC_NUM_INTERRUPTS] ;
+
+extern uint8_t acanT4HostNVICPriority [NVIC_NUM_INTERRUPTS] ;
+
+#define NVIC_ENABLE_IRQ(n) (acanT4HostNVICEnabled [(n)] = true)
+#define NVIC_DISABLE_IRQ(n) (acanT4HostNVICEnabled [(n)] = false)
+#define NVIC_SET_PENDING(n) (acanT4HostNVICPending [(n)] = true)
+#define NVIC_SET_PRIORITY(n, p) (acanT4HostNVICPriority [(n)] = uint8_t (p))
+
+//--------------------------------------------------------------------------------------------------
+//   CLOCK CONTROL MODULE
+//--------------------------------------------------------------------------------------------------
+
+extern volatile uint32_t CCM_CSCMR2 ;
+extern volatile uint32_t CCM_CCGR0 ;
+extern volatile uint32_t CCM_CCGR7 ;
+
+#define CCM_CSCMR2_CAN_CLK_PODF(n) ((uint32_t) (((n) & 0x3F) << 2))
+#define CCM_CSCMR2_CAN_CLK_SEL(n)  ((uint32_t) (((n) & 0x03) << 8))
+
+//--------------------------------------------------------------------------------------------------
+//   IOMUXC (pin configuration registers are only written by the driver)
+//--------------------------------------------------------------------------------------------------
+
+#define IOMUXC_PAD_HYS    ((uint32_t) (1 << 16))
+#define IOMUXC_PAD_ODE    ((uint32_t) (1 << 11))
+#define IOMUXC_PAD_DSE(n) ((uint32_t) (((n) & 0x07) << 3))
+
+extern volatile uint32_t acanT4HostPinRegisters [32] ;
+
+#define IOMUXC_FLEXCAN1_RX_SELECT_INPUT         (acanT4HostPinRegisters [0])
+#define IOMUXC_FLEXCAN2_RX_SELECT_INPUT         (acanT4HostPinRegisters [1])
+#define IOMUXC_CANFD_IPP_IND_CANRX_SELECT_INPUT (acanT4HostPinRegisters [2])
+#define CORE_PIN0_CONFIG                        (acanT4HostPinRegisters [3])
+#define CORE_PIN0_PADCONFIG                     (acanT4HostPinRegisters [4])
+#define CORE_PIN1_CONFIG                        (acanT4HostPinRegisters [5])
+#define CORE_PIN1_PADCONFIG                     (acanT4HostPinRegisters [6])
+#define CORE_PIN11_CONFIG                       (acanT4HostPinRegisters [7])
+#define CORE_PIN11_PADCONFIG                    (acanT4HostPinRegisters [8])
+#define CORE_PIN13_CONFIG                       (acanT4HostPinRegisters [9])
+#define CORE_PIN13_PADCONFIG                    (acanT4HostPinRegisters [10])
+#define CORE_PIN22_CONFIG                       (acanT4HostPinRegisters [11])
+#define CORE_PIN22_PADCONFIG                    (acanT4HostPinRegisters [12])
+#define CORE_PIN23_CONFIG                       (acanT4HostPinRegisters [13])
+#define CORE_PIN23_PADCONFIG                    (acanT4HostPinRegisters [14])
+#define CORE_PIN30_CONFIG                       (acanT4HostPinRegisters [15])
+#define CORE_PIN30_PADCONFIG                    (acanT4HostPinRegisters [16])
+#define CORE_PIN31_CONFIG                       (acanT4HostPinRegisters [17])
+#define CORE_PIN31_PADCONFIG                    (acanT4HostPinRegisters [18])
+
+//--------------------------------------------------------------------------------------------------
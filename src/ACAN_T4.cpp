@@ -25,6 +25,10 @@
 //   FLEXCAN REGISTERS
 //----------------------------------------------------------------------------------------
 
+#ifdef ACAN_T4_HOST_SIMULATION
+  #include <ACAN_T4_SimulatedFlexCAN.h> // Host build: registers of a simulated FlexCAN
+#else
+
 #define FLEXCAN_MCR(b)                   (*((volatile uint32_t *) ((b)+0x00)))
 #define FLEXCAN_CTRL1(b)                 (*((volatile uint32_t *) ((b)+0x04)))
 #define FLEXCAN_ECR(b)                   (*((volatile uint32_t *) ((b)+0x1C)))
@@ -43,6 +47,8 @@
 #define FLEXCAN_IDAF(b, n)               (*((volatile uint32_t *) ((b)+0xE0+(n)*4)))
 #define FLEXCAN_MB_MASK(b, n)            (*((volatile uint32_t *) ((b)+0x880+(n)*4)))
 
+#endif
+
 //--- Definitions FLEXCAN_MB_CS
 static const uint32_t FLEXCAN_MB_CS_RTR       = 0x00100000 ;
 static const uint32_t FLEXCAN_MB_CS_IDE       = 0x00200000 ;
@@ -162,10 +168,12 @@ static uint32_t computeAcceptanceFilter (const tFrameKind inKind,
 
 ACANPrimaryFilter::ACANPrimaryFilter (const tFrameKind inKind,
                                       const tFrameFormat inFormat,
-                                      const ACANCallBackRoutine inCallBackRoutine) :
+                                      const ACANCallBackRoutine inCallBackRoutine,
+                                      const bool inCallBackInISR) :
 mPrimaryFilterMask (computeFilterMask (inFormat, 0)),
 mPrimaryAcceptanceFilter (computeAcceptanceFilter (inKind, inFormat, defaultMask (inFormat), 0)),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
@@ -173,10 +181,12 @@ mCallBackRoutine (inCallBackRoutine) {
 ACANPrimaryFilter::ACANPrimaryFilter (const tFrameKind inKind,
                                       const tFrameFormat inFormat,
                                       const uint32_t inIdentifier,
-                                      const ACANCallBackRoutine inCallBackRoutine) :
+                                      const ACANCallBackRoutine inCallBackRoutine,
+                                      const bool inCallBackInISR) :
 mPrimaryFilterMask (computeFilterMask (inFormat, (inFormat == kExtended) ? 0x1FFFFFFF : 0x7FF)),
 mPrimaryAcceptanceFilter (computeAcceptanceFilter (inKind, inFormat, defaultMask (inFormat), inIdentifier)),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
@@ -185,10 +195,12 @@ ACANPrimaryFilter::ACANPrimaryFilter (const tFrameKind inKind,
                                       const tFrameFormat inFormat,
                                       const uint32_t inMask,
                                       const uint32_t inAcceptance,
-                                      const ACANCallBackRoutine inCallBackRoutine) :
+                                      const ACANCallBackRoutine inCallBackRoutine,
+                                      const bool inCallBackInISR) :
 mPrimaryFilterMask (computeFilterMask (inFormat, inMask)),
 mPrimaryAcceptanceFilter (computeAcceptanceFilter (inKind, inFormat, inMask, inAcceptance)),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
@@ -196,9 +208,11 @@ mCallBackRoutine (inCallBackRoutine) {
 ACANSecondaryFilter::ACANSecondaryFilter (const tFrameKind inKind,
                                           const tFrameFormat inFormat,
                                           const uint32_t inIdentifier,
-                                          const ACANCallBackRoutine inCallBackRoutine) :
+                                          const ACANCallBackRoutine inCallBackRoutine,
+                                          const bool inCallBackInISR) :
 mSecondaryAcceptanceFilter (computeAcceptanceFilter (inKind, inFormat, defaultMask (inFormat), inIdentifier)),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
@@ -283,30 +297,86 @@ void ACAN_T4::end (void) {
   case ACAN_T4_Module::CAN2 : NVIC_DISABLE_IRQ (IRQ_CAN2) ; break ;
   case ACAN_T4_Module::CAN3 : NVIC_DISABLE_IRQ (IRQ_CAN3) ; break ;
   }
+  endDeferredReceiveProcessing () ;
+  mPolledMode = false ;
 //--- Enter freeze mode
   FLEXCAN_MCR (mFlexcanBaseAddress) |= (FLEXCAN_MCR_HALT);
   while (!(FLEXCAN_MCR (mFlexcanBaseAddress) & FLEXCAN_MCR_FRZ_ACK)) ;
-//--- Free receive buffer
-  delete [] mReceiveBuffer ; mReceiveBuffer = nullptr ;
-  delete [] mReceiveBufferFD ; mReceiveBufferFD = nullptr ;
+//--- Free receive buffer (if allocated by begin / beginFD)
+  if (mOwnsReceiveBuffer) {
+    delete [] mReceiveBuffer ;
+    delete [] mReceiveBufferFD ;
+  }
+  mReceiveBuffer = nullptr ;
+  mReceiveBufferFD = nullptr ;
+  mOwnsReceiveBuffer = false ;
   mReceiveBufferSize = 0 ;
   mReceiveBufferReadIndex = 0 ;
   mReceiveBufferCount = 0 ;
   mReceiveBufferPeakCount = 0 ;
+  mReceiveBufferOverflowCount = 0 ;
   mGlobalStatus = 0 ;
-//--- Free transmit buffer
-  delete [] mTransmitBuffer ; mTransmitBuffer = nullptr ;
-  delete [] mReceiveBufferFD ; mReceiveBufferFD = nullptr ;
+//--- Free transmit buffer (if allocated by begin / beginFD)
+  if (mOwnsTransmitBuffer) {
+    delete [] mTransmitBuffer ;
+    delete [] mTransmitBufferFD ;
+  }
+  mTransmitBuffer = nullptr ;
+  mTransmitBufferFD = nullptr ;
+  mOwnsTransmitBuffer = false ;
   mTransmitBufferSize = 0 ;
   mTransmitBufferReadIndex = 0 ;
   mTransmitBufferCount = 0 ;
   mTransmitBufferPeakCount = 0 ;
-//--- Free callback function array
-  delete [] mCallBackFunctionArray ; mCallBackFunctionArray = nullptr ;
-  delete [] mCallBackFunctionArrayFD ; mCallBackFunctionArrayFD = nullptr ;
+//--- Free transmit deadlines (if allocated by begin / beginFD)
+  if (mOwnsTransmitDeadlines) {
+    delete [] mTransmitDeadlines ;
+  }
+  mTransmitDeadlines = nullptr ;
+  mOwnsTransmitDeadlines = false ;
+  mTransmitFrameLifetime = 0 ;
+  mExpiredTransmitFrameCallBack = nullptr ;
+  mExpiredTransmitFrameCallBackFD = nullptr ;
+//--- Stop routing
+  mRoutes = nullptr ;
+  mRouteCount = 0 ;
+//--- Remove latest value slots
+  mLatestValueSlots = nullptr ;
+  mLatestValueSlotCount = 0 ;
+//--- Remove change filters
+  mChangeFilters = nullptr ;
+  mChangeFilterCount = 0 ;
+//--- Remove receive queues
+  mReceiveQueues = nullptr ;
+  mReceiveQueueCount = 0 ;
+//--- Remove periodic frames
+  mPeriodicFrames = nullptr ;
+  mPeriodicFrameCount = 0 ;
+//--- Remove rate limits
+  mRateLimits = nullptr ;
+  mRateLimitCount = 0 ;
+//--- Detach time triggered schedule
+  mTimeTriggeredSchedule = nullptr ;
+  mTimeTriggeredMailboxCount = 0 ;
+  mTransmitMailboxHoldCount = 0 ;
+//--- Free callback function arrays and CANFD array (if allocated by begin / beginFD)
+  if (mOwnsCallBackTables) {
+    delete [] mCallBackFunctionArray ;
+    delete [] mCallBackFunctionArrayFD ;
+    delete [] mISRCallBackFunctionArray ;
+    delete [] mISRCallBackFunctionArrayFD ;
+  }
+  if (mOwnsAcceptanceFilterTable) {
+    delete [] mCANFDAcceptanceFilterArray ;
+  }
+  mCallBackFunctionArray = nullptr ;
+  mCallBackFunctionArrayFD = nullptr ;
   mCallBackFunctionArraySize = 0 ;
-//--- Free CANFD array
-  delete [] mCANFDAcceptanceFilterArray ; mCANFDAcceptanceFilterArray = nullptr ;
+  mISRCallBackFunctionArray = nullptr ;
+  mISRCallBackFunctionArrayFD = nullptr ;
+  mCANFDAcceptanceFilterArray = nullptr ;
+  mOwnsCallBackTables = false ;
+  mOwnsAcceptanceFilterTable = false ;
 }
 
 //----------------------------------------------------------------------------------------
@@ -324,19 +394,34 @@ uint32_t ACAN_T4::begin (const ACAN_T4_Settings & inSettings,
     errorCode |= kCANBitConfiguration ;
   }
   if (0 == errorCode) {
-  //---------- Allocate receive buffer
+  //---------- Allocate receive buffer, unless provided by settings
     mReceiveBufferSize = inSettings.mReceiveBufferSize ;
-    mReceiveBuffer = new CANMessage [inSettings.mReceiveBufferSize] ;
-  //---------- Allocate transmit buffer
+    mReceiveOverflowPolicy = inSettings.mReceiveOverflowPolicy ;
+    mOwnsReceiveBuffer = inSettings.mReceiveBufferStorage == nullptr ;
+    mReceiveBuffer = mOwnsReceiveBuffer
+      ? new CANMessage [inSettings.mReceiveBufferSize]
+      : inSettings.mReceiveBufferStorage ;
+  //---------- Allocate transmit buffer, unless provided by settings
     mTransmitBufferSize = inSettings.mTransmitBufferSize ;
-    mTransmitBuffer = new CANMessage [inSettings.mTransmitBufferSize] ;
+    mOwnsTransmitBuffer = inSettings.mTransmitBufferStorage == nullptr ;
+    mTransmitBuffer = mOwnsTransmitBuffer
+      ? new CANMessage [inSettings.mTransmitBufferSize]
+      : inSettings.mTransmitBufferStorage ;
+  //---------- Transmit frame expiry
+    setupTransmitFrameExpiry (inSettings.mTransmitFrameExpiry, inSettings.mTransmitDeadlineStorage) ;
+    mTransmitFrameLifetime = inSettings.mTransmitFrameLifetime ;
+    mExpiredTransmitFrameCallBack = inSettings.mExpiredTransmitFrameCallBack ;
   //---------- Filter count
     const uint32_t primaryFilterCount = std::min (inPrimaryFilterCount, MAX_PRIMARY_FILTER_COUNT) ;
     const uint32_t secondaryFilterCount = std::min (inSecondaryFilterCount, MAX_SECONDARY_FILTER_COUNT) ;
-  //---------- Allocate call back function array
+  //---------- Allocate call back function array, unless provided by settings
     mCallBackFunctionArraySize = primaryFilterCount + secondaryFilterCount ;
+    mOwnsCallBackTables = inSettings.mCallBackStorage == nullptr ;
+    mOwnsAcceptanceFilterTable = false ; // No acceptance filter array in CAN 2.0B mode
     if (mCallBackFunctionArraySize > 0) {
-      mCallBackFunctionArray = new ACANCallBackRoutine [mCallBackFunctionArraySize] ;
+      mCallBackFunctionArray = mOwnsCallBackTables
+        ? new ACANCallBackRoutine [mCallBackFunctionArraySize]
+        : inSettings.mCallBackStorage ;
       for (uint32_t i=0 ; i<primaryFilterCount ; i++) {
         mCallBackFunctionArray [i] = inPrimaryFilters [i].mCallBackRoutine ;
       }
@@ -344,6 +429,29 @@ uint32_t ACAN_T4::begin (const ACAN_T4_Settings & inSettings,
         mCallBackFunctionArray [i + primaryFilterCount] = inSecondaryFilters [i].mCallBackRoutine ;
       }
     }
+  //---------- Allocate interrupt call back function array, only if required
+    bool hasISRCallBack = false ;
+    for (uint32_t i=0 ; i<primaryFilterCount ; i++) {
+      hasISRCallBack |= inPrimaryFilters [i].mCallBackInISR && (inPrimaryFilters [i].mCallBackRoutine != nullptr) ;
+    }
+    for (uint32_t i=0 ; i<secondaryFilterCount ; i++) {
+      hasISRCallBack |= inSecondaryFilters [i].mCallBackInISR && (inSecondaryFilters [i].mCallBackRoutine != nullptr) ;
+    }
+    if (hasISRCallBack) {
+      mISRCallBackFunctionArray = mOwnsCallBackTables
+        ? new ACANCallBackRoutine [mCallBackFunctionArraySize]
+        : (inSettings.mCallBackStorage + mCallBackFunctionArraySize) ;
+      for (uint32_t i=0 ; i<primaryFilterCount ; i++) {
+        mISRCallBackFunctionArray [i] = inPrimaryFilters [i].mCallBackInISR
+          ? inPrimaryFilters [i].mCallBackRoutine
+          : nullptr ;
+      }
+      for (uint32_t i=0 ; i<secondaryFilterCount ; i++) {
+        mISRCallBackFunctionArray [i + primaryFilterCount] = inSecondaryFilters [i].mCallBackInISR
+          ? inSecondaryFilters [i].mCallBackRoutine
+          : nullptr ;
+      }
+    }
   //---------- Select clock source (see i.MX RT1060 Processor Reference Manual, Rev. 2, 12/2019, page 1059)
     uint32_t cscmr2 = CCM_CSCMR2 & 0xFFFFFC03 ;
     cscmr2 |= CCM_CSCMR2_CAN_CLK_PODF (getCANRootClockDivisor () - 1) ;
@@ -363,15 +471,15 @@ uint32_t ACAN_T4::begin (const ACAN_T4_Settings & inSettings,
     switch (mModule) {
     case ACAN_T4_Module::CAN1 :
       CCM_CCGR0 |= 0x3C000 ;
-      _VectorsRam [16 + IRQ_CAN1] = flexcan_isr_can1 ;
+      _VectorsRam [16 + IRQ_CAN1] = isrCAN20B <ACAN_T4_Module::CAN1> ;
       break ;
     case ACAN_T4_Module::CAN2 :
       CCM_CCGR0 |= 0x3C0000 ;
-      _VectorsRam [16 + IRQ_CAN2] = flexcan_isr_can2 ;
+      _VectorsRam [16 + IRQ_CAN2] = isrCAN20B <ACAN_T4_Module::CAN2> ;
       break ;
     case ACAN_T4_Module::CAN3 :
       CCM_CCGR7 |= 0x3C0 ;
-      _VectorsRam [16 + IRQ_CAN3] = flexcan_isr_can3 ;
+      _VectorsRam [16 + IRQ_CAN3] = isrCAN20B <ACAN_T4_Module::CAN3> ;
      break ;
     }
   //---------- Enable CAN
@@ -544,17 +652,27 @@ uint32_t ACAN_T4::begin (const ACAN_T4_Settings & inSettings,
     while (FLEXCAN_MCR (mFlexcanBaseAddress) & FLEXCAN_MCR_FRZ_ACK) {}
   //----------  Wait until ready
     while (FLEXCAN_MCR (mFlexcanBaseAddress) & FLEXCAN_MCR_NOT_RDY) {}
-  //---------- Enable NVIC interrupts
-    switch (mModule) {
-    case ACAN_T4_Module::CAN1 :
-      NVIC_ENABLE_IRQ (IRQ_CAN1) ;
-      break ;
-    case ACAN_T4_Module::CAN2 :
-      NVIC_ENABLE_IRQ (IRQ_CAN2) ;
-      break ;
-    case ACAN_T4_Module::CAN3 :
-      NVIC_ENABLE_IRQ (IRQ_CAN3) ;
-      break ;
+  //---------- Interrupt priorities, deferred receive processing
+    mPolledMode = inSettings.mPolledMode ;
+    setupInterrupts (inSettings.mInterruptPriority,
+                     inSettings.mDeferredReceiveProcessing && !inSettings.mPolledMode,
+                     inSettings.mDeferredInterruptPriority,
+                     inSettings.mStagingBufferSize,
+                     inSettings.mStagingBufferStorage,
+                     nullptr) ;
+  //---------- Enable NVIC interrupts (polled mode: interrupts are left disabled)
+    if (!mPolledMode) {
+      switch (mModule) {
+      case ACAN_T4_Module::CAN1 :
+        NVIC_ENABLE_IRQ (IRQ_CAN1) ;
+        break ;
+      case ACAN_T4_Module::CAN2 :
+        NVIC_ENABLE_IRQ (IRQ_CAN2) ;
+        break ;
+      case ACAN_T4_Module::CAN3 :
+        NVIC_ENABLE_IRQ (IRQ_CAN3) ;
+        break ;
+      }
     }
   //---------- Enable CAN interrupts
     FLEXCAN_IMASK1 (mFlexcanBaseAddress) =
@@ -572,6 +690,13 @@ uint32_t ACAN_T4::begin (const ACAN_T4_Settings & inSettings,
 
 //----------------------------------------------------------------------------------------
 //   RECEPTION
+//----------------------------------------------------------------------------------------
+// Driver rings store CANMessage as is: it is already a packed 16-byte record (identifier, ext, rtr,
+// idx, len, 8-byte payload), so a specific internal format would not save RAM, and would require
+// conversions.
+
+static_assert (sizeof (CANMessage) == 16, "CANMessage should be a 16-byte record") ;
+
 //----------------------------------------------------------------------------------------
 
 bool ACAN_T4::receive (CANMessage & outMessage) {
@@ -582,7 +707,7 @@ bool ACAN_T4::receive (CANMessage & outMessage) {
       mReceiveBufferReadIndex = (mReceiveBufferReadIndex + 1) % mReceiveBufferSize ;
       mReceiveBufferCount -= 1 ;
     }
-  interrupts ()
+  interrupts () ;
   return hasMessage ;
 }
 
@@ -606,6 +731,12 @@ bool ACAN_T4::dispatchReceivedMessage (const tFilterMatchCallBack inFilterMatchC
   return hasReceived ;
 }
 
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::setTraceRecorder (ACAN_T4_TraceRecorder * inRecorder) {
+  mTraceRecorder = inRecorder ;
+}
+
 //----------------------------------------------------------------------------------------
 //   EMISSION
 //----------------------------------------------------------------------------------------
@@ -621,7 +752,11 @@ uint32_t ACAN_T4::tryToSendReturnStatus (const CANMessage & inMessage) {
   if (mCANFD) {
     sendStatus = kFlexCANinCANFDMode ;
   }else if ((mGlobalStatus & kGlobalStatusInitError) == 0) {
-    if (inMessage.rtr) { // Remote
+    if (mRateLimitCount > 0) {
+      noInterrupts () ;
+        sendStatus = rateLimitedSend (inMessage, mTransmitFrameLifetime) ;
+      interrupts () ;
+    }else if (inMessage.rtr) { // Remote
       sendStatus = tryToSendRemoteFrame (inMessage) ;
     }else{ // Data
       sendStatus = tryToSendDataFrame (inMessage) ;
@@ -632,9 +767,69 @@ uint32_t ACAN_T4::tryToSendReturnStatus (const CANMessage & inMessage) {
 
 //----------------------------------------------------------------------------------------
 
+uint32_t ACAN_T4::tryToSendBatch (const CANMessage inMessages [], const uint32_t inCount) {
+  uint32_t acceptedCount = 0 ;
+  if (!mCANFD && ((mGlobalStatus & kGlobalStatusInitError) == 0)) {
+    noInterrupts () ;
+      bool accepted = true ;
+      while (accepted && (acceptedCount < inCount)) {
+        const CANMessage & message = inMessages [acceptedCount] ;
+        if (mRateLimitCount > 0) {
+          accepted = rateLimitedSend (message, mTransmitFrameLifetime) == 0 ;
+        }else{
+          accepted = (message.rtr
+            ? enqueueRemoteFrame (message)
+            : enqueueDataFrame (message, mTransmitFrameLifetime)) == 0 ;
+        }
+        if (accepted) {
+          acceptedCount += 1 ;
+        }
+      }
+    interrupts () ;
+  }
+  return acceptedCount ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool ACAN_T4::tryToSendWithLifetime (const CANMessage & inMessage, const uint32_t inLifetime) {
+  uint32_t sendStatus = 0 ;
+  if (mCANFD) {
+    sendStatus = kFlexCANinCANFDMode ;
+  }else if ((mGlobalStatus & kGlobalStatusInitError) == 0) {
+    if (mRateLimitCount > 0) {
+      noInterrupts () ;
+        sendStatus = rateLimitedSend (inMessage, inLifetime) ;
+      interrupts () ;
+    }else if (inMessage.rtr) {
+      sendStatus = tryToSendRemoteFrame (inMessage) ;
+    }else{
+      noInterrupts () ;
+        sendStatus = enqueueDataFrame (inMessage, inLifetime) ;
+      interrupts () ;
+    }
+  }
+  return sendStatus == 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+
 uint32_t ACAN_T4::tryToSendRemoteFrame (const CANMessage & inMessage) {
+  noInterrupts () ;
+    const uint32_t sendStatus = enqueueRemoteFrame (inMessage) ;
+  interrupts () ;
+  return sendStatus ;
+}
+
+//----------------------------------------------------------------------------------------
+
+// Interrupts should be disabled: a remote frame may be sent from an interrupt service routine
+// (route, periodic frame, interrupt call back), that could claim the same mailbox.
+
+uint32_t ACAN_T4::enqueueRemoteFrame (const CANMessage & inMessage) {
   bool sent = false ;
-  for (uint32_t index = FIRST_MB_AVAILABLE_FOR_SENDING ; (index < TX_MAILBOX_INDEX) && !sent ; index++) {
+  const uint32_t lastIndex = TX_MAILBOX_INDEX - mTimeTriggeredMailboxCount ; // Excluded
+  for (uint32_t index = FIRST_MB_AVAILABLE_FOR_SENDING ; (index < lastIndex) && !sent ; index++) {
     const uint32_t status = FLEXCAN_get_code (FLEXCAN_MBn_CS (mFlexcanBaseAddress, index)) ;
     switch (status) {
     case FLEXCAN_MB_CODE_TX_INACTIVE : // MB has never sent remote frame
@@ -653,39 +848,114 @@ uint32_t ACAN_T4::tryToSendRemoteFrame (const CANMessage & inMessage) {
 
 //----------------------------------------------------------------------------------------
 
+uint32_t ACAN_T4::timeTriggeredMailboxCapacity (void) const {
+  return mCANFD
+    ? timeTriggeredMailboxCapacityFD ()
+    : (TX_MAILBOX_INDEX - FIRST_MB_AVAILABLE_FOR_SENDING) ;
+}
+
+//----------------------------------------------------------------------------------------
+
 uint32_t ACAN_T4::tryToSendDataFrame (const CANMessage & inMessage) {
-  bool sent = false ;
   noInterrupts () ;
-  //--- Find an available mailbox
-    if (mTransmitBufferCount == 0) {
-      const uint32_t code = FLEXCAN_get_code (FLEXCAN_MBn_CS (mFlexcanBaseAddress, TX_MAILBOX_INDEX)) ;
-      if (code == FLEXCAN_MB_CODE_TX_INACTIVE) {
-        writeTxRegisters (inMessage, TX_MAILBOX_INDEX) ;
-        sent = true ;
+    const uint32_t sendStatus = enqueueDataFrame (inMessage, mTransmitFrameLifetime) ;
+  interrupts () ;
+  return sendStatus ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::enqueueDataFrame (const CANMessage & inMessage, const uint32_t inLifetime) {
+  bool sent = false ;
+//--- Find an available mailbox (not while a time triggered window is pending)
+  if ((mTransmitBufferCount == 0) && (mTransmitMailboxHoldCount == 0)) {
+    const uint32_t code = FLEXCAN_get_code (FLEXCAN_MBn_CS (mFlexcanBaseAddress, TX_MAILBOX_INDEX)) ;
+    if (code == FLEXCAN_MB_CODE_TX_INACTIVE) {
+      writeTxRegisters (inMessage, TX_MAILBOX_INDEX) ;
+      sent = true ;
+    }
+  }
+//--- If no mailboxes available, try to buffer it
+  if (!sent) {
+    sent = mTransmitBufferCount < mTransmitBufferSize ;
+    if (sent) {
+      uint32_t transmitBufferWriteIndex = mTransmitBufferReadIndex + mTransmitBufferCount ;
+      if (transmitBufferWriteIndex >= mTransmitBufferSize) {
+        transmitBufferWriteIndex -= mTransmitBufferSize ;
+      }
+      mTransmitBuffer [transmitBufferWriteIndex] = inMessage ;
+      storeTransmitDeadline (transmitBufferWriteIndex, inLifetime) ;
+      mTransmitBufferCount += 1 ;
+    //--- Update max count
+      if (mTransmitBufferPeakCount < mTransmitBufferCount) {
+        mTransmitBufferPeakCount = mTransmitBufferCount ;
       }
+    }else{
+      mTransmitBufferPeakCount = mTransmitBufferSize + 1 ;
     }
-  //--- If no mailboxes available, try to buffer it
-    if (!sent) {
-      sent = mTransmitBufferCount < mTransmitBufferSize ;
-      if (sent) {
-        uint32_t transmitBufferWriteIndex = mTransmitBufferReadIndex + mTransmitBufferCount ;
-        if (transmitBufferWriteIndex >= mTransmitBufferSize) {
-          transmitBufferWriteIndex -= mTransmitBufferSize ;
-        }
-        mTransmitBuffer [transmitBufferWriteIndex] = inMessage ;
-        mTransmitBufferCount += 1 ;
-      //--- Update max count
-        if (mTransmitBufferPeakCount < mTransmitBufferCount) {
-          mTransmitBufferPeakCount = mTransmitBufferCount ;
+  }
+  return sent ? 0 : kTransmitBufferOverflow ;
+}
+
+//----------------------------------------------------------------------------------------
+//   TRANSMIT FRAME EXPIRY
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::setupTransmitFrameExpiry (const bool inEnabled, uint32_t * inDeadlineStorage) {
+  mOwnsTransmitDeadlines = inEnabled && (inDeadlineStorage == nullptr) ;
+  if (!inEnabled) {
+    mTransmitDeadlines = nullptr ;
+  }else if (mOwnsTransmitDeadlines) {
+    mTransmitDeadlines = new uint32_t [mTransmitBufferSize] ;
+  }else{
+    mTransmitDeadlines = inDeadlineStorage ;
+  }
+  mExpiredTransmitFrameCount = 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::storeTransmitDeadline (const uint32_t inIndex, const uint32_t inLifetime) {
+  if (mTransmitDeadlines != nullptr) {
+    uint32_t deadline = 0 ; // No expiry
+    if (inLifetime > 0) {
+      deadline = millis () + inLifetime ;
+      if (deadline == 0) { // 0 means no expiry, expire 1 ms later
+        deadline = 1 ;
+      }
+    }
+    mTransmitDeadlines [inIndex] = deadline ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+// Called (interrupts disabled) when the transmit mailbox is about to be refilled: expired frames at
+// the head of the transmit buffer are dropped. A non expired frame stops the scan, so frames are
+// always sent in order; a frame queued behind it expires when it reaches the head.
+
+void ACAN_T4::dropExpiredTransmitFrames (void) {
+  const uint32_t now = millis () ;
+  bool expired = true ;
+  while (expired && (mTransmitBufferCount > 0)) {
+    const uint32_t deadline = mTransmitDeadlines [mTransmitBufferReadIndex] ;
+    expired = (deadline != 0) && (int32_t (now - deadline) >= 0) ;
+    if (expired) {
+      mExpiredTransmitFrameCount += 1 ;
+      if (mCANFD) {
+        if (mExpiredTransmitFrameCallBackFD != nullptr) {
+          mExpiredTransmitFrameCallBackFD (mTransmitBufferFD [mTransmitBufferReadIndex]) ;
         }
-      }else{
-        mTransmitBufferPeakCount = mTransmitBufferSize + 1 ;
+      }else if (mExpiredTransmitFrameCallBack != nullptr) {
+        mExpiredTransmitFrameCallBack (mTransmitBuffer [mTransmitBufferReadIndex]) ;
       }
+      mTransmitBufferReadIndex = (mTransmitBufferReadIndex + 1) % mTransmitBufferSize ;
+      mTransmitBufferCount -= 1 ;
     }
-  interrupts () ;
-  return sent ? 0 : kTransmitBufferOverflow ;
+  }
 }
-      //----------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------
 
 void ACAN_T4::writeTxRegisters (const CANMessage & inMessage, const uint32_t inMBIndex) {
 //--- Make Tx box inactive
@@ -714,28 +984,29 @@ void ACAN_T4::writeTxRegisters (const CANMessage & inMessage, const uint32_t inM
 //   MESSAGE INTERRUPT SERVICE ROUTINES
 //----------------------------------------------------------------------------------------
 
-void ACAN_T4::readRxRegisters (CANMessage & outMessage) {
+template <ACAN_T4_Module MODULE> void ACAN_T4::readRxRegisters (CANMessage & outMessage) {
+  constexpr uint32_t base = flexcanBaseAddress (MODULE) ;
 //--- Get identifier, ext, rtr and len
-  const uint32_t dlc = FLEXCAN_MBn_CS (mFlexcanBaseAddress, 0) ;
+  const uint32_t dlc = FLEXCAN_MBn_CS (base, 0) ;
   outMessage.len = FLEXCAN_get_length (dlc) ;
   if (outMessage.len > 8) {
     outMessage.len = 8 ;
   }
   outMessage.ext = (dlc & FLEXCAN_MB_CS_IDE) != 0 ;
   outMessage.rtr = (dlc & FLEXCAN_MB_CS_RTR) != 0 ;
-  outMessage.id  = FLEXCAN_MBn_ID (mFlexcanBaseAddress, 0) & FLEXCAN_MB_ID_EXT_MASK ;
+  outMessage.id  = FLEXCAN_MBn_ID (base, 0) & FLEXCAN_MB_ID_EXT_MASK ;
   if (!outMessage.ext) {
     outMessage.id >>= FLEXCAN_MB_ID_STD_BIT_NO ;
   }
 //-- Get data (registers are big endian, values should be swapped)
-  outMessage.data32 [0] = __builtin_bswap32 (FLEXCAN_MBn_WORD0 (mFlexcanBaseAddress, 0)) ;
-  outMessage.data32 [1] = __builtin_bswap32 (FLEXCAN_MBn_WORD1 (mFlexcanBaseAddress, 0)) ;
-//--- Zero unused data entries
-  for (uint32_t i = outMessage.len ; i < 8 ; i++) {
-    outMessage.data [i] = 0 ;
+  outMessage.data32 [0] = __builtin_bswap32 (FLEXCAN_MBn_WORD0 (base, 0)) ;
+  outMessage.data32 [1] = __builtin_bswap32 (FLEXCAN_MBn_WORD1 (base, 0)) ;
+//--- Zero unused data bytes (data64 is little endian)
+  if (outMessage.len < 8) {
+    outMessage.data64 &= (uint64_t (1) << (8 * outMessage.len)) - 1 ;
   }
 //--- Get filter index
-  outMessage.idx = uint8_t (FLEXCAN_RXFIR (mFlexcanBaseAddress)) ;
+  outMessage.idx = uint8_t (FLEXCAN_RXFIR (base)) ;
   if (outMessage.idx >= MAX_PRIMARY_FILTER_COUNT) {
     outMessage.idx -= MAX_PRIMARY_FILTER_COUNT - mActualPrimaryFilterCount ;
   }
@@ -743,62 +1014,209 @@ void ACAN_T4::readRxRegisters (CANMessage & outMessage) {
 
 //----------------------------------------------------------------------------------------
 
-void ACAN_T4::message_isr_receive (void) {
+// Frames are read from the FlexCAN registers directly into their destination entry when possible
+// (staging buffer, or receive buffer if directReceive), so the ISR does not copy them. The
+// reference message of a time triggered schedule is detected here, so its date does not depend on
+// deferred processing.
+
+template <ACAN_T4_Module MODULE> void ACAN_T4::message_isr_receive (void) {
   CANMessage message ;
-  readRxRegisters (message) ;
+  CANMessage * stagingEntry = (mStagingBuffer != nullptr) ? stagingBufferFreeEntry () : nullptr ;
+  const bool direct = (mStagingBuffer == nullptr) && (mISRCallBackFunctionArray == nullptr) && directReceive () ;
+  CANMessage & destination = (stagingEntry != nullptr)
+    ? *stagingEntry
+    : (direct ? mReceiveBuffer [receiveBufferFreeIndex ()] : message) ;
+  readRxRegisters <MODULE> (destination) ;
+  if ((mTimeTriggeredSchedule != nullptr) && !destination.rtr) {
+    timeTriggeredReceive (destination.id, destination.ext, destination.data [0]) ;
+  }
+  if (mStagingBuffer != nullptr) {
+    commitStagedFrame (stagingEntry != nullptr) ;
+  }else if (direct) {
+    commitReceiveBufferEntry () ;
+  }else{
+    processReceivedFrame (message) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::processReceivedFrame (const CANMessage & inMessage) {
+//--- Interrupt call back: the frame is handled here, neither routed nor stored
+  const ACANCallBackRoutine isrCallBack =
+    ((mISRCallBackFunctionArray != nullptr) && (inMessage.idx < mCallBackFunctionArraySize))
+      ? mISRCallBackFunctionArray [inMessage.idx]
+      : nullptr ;
+  if (nullptr != isrCallBack) {
+    isrCallBack (inMessage) ;
+  }
+  if (nullptr != mTraceRecorder) {
+    mTraceRecorder->record (inMessage, uint8_t (mModule), micros ()) ;
+  }
+  const bool store = (nullptr == isrCallBack)
+    && ((mRouteCount == 0) || routeFrame (inMessage))
+    && ((mLatestValueSlotCount == 0) || !storeLatestValue (inMessage)) ;
+  ACAN_T4_ChangeFilter * changeFilter = (store && (mChangeFilterCount > 0))
+    ? findChangeFilter (inMessage.id, inMessage.ext, inMessage.rtr)
+    : nullptr ;
+  const uint32_t date = (changeFilter == nullptr) ? 0 : millis () ;
+  if (!store) {
+  //--- Frame handled by an interrupt call back, routed frame, or frame stored in a latest value slot
+  }else if ((changeFilter != nullptr) && !changeFilter->changed (inMessage, date)) {
+  //--- Unchanged payload, suppressed
+  }else{
+    ACAN_T4_ReceiveQueue * queue = (inMessage.idx < mReceiveQueueCount) ? mReceiveQueues [inMessage.idx] : nullptr ;
+    const bool stored = (queue == nullptr) ? appendToReceiveBuffer (inMessage) : queue->append (inMessage) ;
+    if (stored && (changeFilter != nullptr)) {
+      changeFilter->stored (inMessage, date) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::commitReceiveBufferEntry (void) { // Receive buffer is not full
+  mReceiveBufferCount += 1 ;
+  if (mReceiveBufferCount > mReceiveBufferPeakCount) {
+    mReceiveBufferPeakCount = mReceiveBufferCount ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+bool ACAN_T4::appendToReceiveBuffer (const CANMessage & inMessage) {
   if (mReceiveBufferCount == mReceiveBufferSize) { // Overflow! Receive buffer is full
     mReceiveBufferPeakCount = mReceiveBufferSize + 1 ; // Mark overflow
+    mReceiveBufferOverflowCount += 1 ;
     mGlobalStatus |= kGlobalStatusReceiveBufferOverflow ;
-  }else{
-    uint32_t receiveBufferWriteIndex = mReceiveBufferReadIndex + mReceiveBufferCount ;
-    if (receiveBufferWriteIndex >= mReceiveBufferSize) {
-      receiveBufferWriteIndex -= mReceiveBufferSize ;
-    }
-    mReceiveBuffer [receiveBufferWriteIndex] = message ;
-    mReceiveBufferCount += 1 ;
-    if (mReceiveBufferCount > mReceiveBufferPeakCount) {
-      mReceiveBufferPeakCount = mReceiveBufferCount ;
-    }
   }
+  const bool stored = acanT4AppendToReceiveRing (mReceiveBuffer, mReceiveBufferSize, mReceiveBufferReadIndex,
+                                                 mReceiveBufferCount, mReceiveOverflowPolicy, inMessage) ;
+  if (mReceiveBufferCount > mReceiveBufferPeakCount) {
+    mReceiveBufferPeakCount = mReceiveBufferCount ;
+  }
+  return stored ;
 }
 
 //----------------------------------------------------------------------------------------
 
 void ACAN_T4::message_isr (void) {
-  if (mCANFD) {
-    message_isr_FD () ;
-  }else{
-    const uint32_t status1 = FLEXCAN_IFLAG1 (mFlexcanBaseAddress) ;
-  //--- A trame has been received in RxFIFO ?
-    if ((status1 & (1 << 5)) != 0) {
-      message_isr_receive () ;
-    }
-  //--- RxFIFO warning ? It occurs when the number of messages goes from 4 to 5
-    if ((status1 & (1 << 6)) != 0) {
-      mGlobalStatus |= kGlobalStatusRxFIFOWarning ;
-    }
-  //--- RxFIFO Overflow ?
-    if ((status1 & (1 << 7)) != 0) {
-      mGlobalStatus |= kGlobalStatusRxFIFOOverflow ;
+  switch (mModule) {
+  case ACAN_T4_Module::CAN1 :
+    isrCAN20B <ACAN_T4_Module::CAN1> () ;
+    break ;
+  case ACAN_T4_Module::CAN2 :
+    isrCAN20B <ACAN_T4_Module::CAN2> () ;
+    break ;
+  case ACAN_T4_Module::CAN3 :
+    if (mCANFD) {
+      isrFD <ACAN_T4_Module::CAN3> () ;
+    }else{
+      isrCAN20B <ACAN_T4_Module::CAN3> () ;
     }
-  //--- Writing its value back to itself clears all flags
-    FLEXCAN_IFLAG1 (mFlexcanBaseAddress) = status1 ;
-  //--- Handle Tx mailbox
-    const uint32_t status2 = FLEXCAN_IFLAG2 (mFlexcanBaseAddress) ;
-    if ((status2 & (1 << (TX_MAILBOX_INDEX - 32))) != 0) {
-      if (mTransmitBufferCount == 0) {
-        FLEXCAN_MBn_CS (mFlexcanBaseAddress, TX_MAILBOX_INDEX) = FLEXCAN_MB_CS_CODE (FLEXCAN_MB_CODE_TX_INACTIVE) ; // Inactive MB
-      }else{ // There is a frame in the queue to send
-        const uint32_t code = FLEXCAN_get_code (FLEXCAN_MBn_CS (mFlexcanBaseAddress, TX_MAILBOX_INDEX));
-        if (code == FLEXCAN_MB_CODE_TX_INACTIVE) {
+    break ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+template <ACAN_T4_Module MODULE> void ACAN_T4::isrCAN20B (void) {
+  uint32_t transmitCount ;
+  driver <MODULE> ().template message_isr_CAN20B <MODULE> (transmitCount) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+template <ACAN_T4_Module MODULE> uint32_t ACAN_T4::message_isr_CAN20B (uint32_t & outTransmitCount) {
+  constexpr uint32_t base = flexcanBaseAddress (MODULE) ;
+  uint32_t receiveCount = 0 ;
+  outTransmitCount = 0 ;
+  const uint32_t status1 = FLEXCAN_IFLAG1 (base) ;
+//--- A trame has been received in RxFIFO ?
+  if ((status1 & (1 << 5)) != 0) {
+    message_isr_receive <MODULE> () ;
+    receiveCount = 1 ;
+  }
+//--- RxFIFO warning ? It occurs when the number of messages goes from 4 to 5
+  if ((status1 & (1 << 6)) != 0) {
+    mGlobalStatus |= kGlobalStatusRxFIFOWarning ;
+  }
+//--- RxFIFO Overflow ?
+  if ((status1 & (1 << 7)) != 0) {
+    mGlobalStatus |= kGlobalStatusRxFIFOOverflow ;
+  }
+//--- Writing its value back to itself clears all flags
+  FLEXCAN_IFLAG1 (base) = status1 ;
+//--- Handle Tx mailbox
+  const uint32_t status2 = FLEXCAN_IFLAG2 (base) ;
+  if ((status2 & (1 << (TX_MAILBOX_INDEX - 32))) != 0) {
+  //--- Critical section: the transmit buffer and the Tx mailbox are also handled by tryToSend, that
+  //    may be called from a higher priority interrupt (route from an other controller, scheduler)
+    noInterrupts () ;
+      const uint32_t code = FLEXCAN_get_code (FLEXCAN_MBn_CS (base, TX_MAILBOX_INDEX));
+      if (code == FLEXCAN_MB_CODE_TX_ONCE) {
+      //--- A frame has been written since the interrupt was raised (call back, route): it is being sent
+      }else{
+        if (mTransmitDeadlines != nullptr) {
+          dropExpiredTransmitFrames () ;
+        }
+        if ((mTransmitBufferCount == 0) || (mTransmitMailboxHoldCount > 0)) { // Held: see releaseTransmitMailbox
+          FLEXCAN_MBn_CS (base, TX_MAILBOX_INDEX) = FLEXCAN_MB_CS_CODE (FLEXCAN_MB_CODE_TX_INACTIVE) ; // Inactive MB
+        }else if (code == FLEXCAN_MB_CODE_TX_INACTIVE) { // There is a frame in the queue to send
           writeTxRegisters (mTransmitBuffer [mTransmitBufferReadIndex], TX_MAILBOX_INDEX);
           mTransmitBufferReadIndex = (mTransmitBufferReadIndex + 1) % mTransmitBufferSize ;
           mTransmitBufferCount -= 1 ;
+          outTransmitCount = 1 ;
         }
       }
-      FLEXCAN_IFLAG2 (mFlexcanBaseAddress) = status2 ;
+      FLEXCAN_IFLAG2 (base) = status2 ;
+    interrupts () ;
+  }
+  return receiveCount ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Polled mode
+//----------------------------------------------------------------------------------------
+
+static const uint32_t RX_FIFO_DEPTH = 6 ;
+
+//----------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::poll (uint32_t & outTransmitCount) {
+  uint32_t receiveCount = 0 ;
+  outTransmitCount = 0 ;
+  if (!mPolledMode) {
+  //--- Controller is handled by its interrupt service routine
+  }else if (mCANFD) { // Every Rx mailbox is handled once
+    receiveCount = message_isr_FD <ACAN_T4_Module::CAN3> (outTransmitCount) ;
+  }else{ // At most RX_FIFO_DEPTH frames are read from RxFIFO
+    bool received = true ;
+    for (uint32_t i=0 ; (i<RX_FIFO_DEPTH) && received ; i++) {
+      uint32_t transmitCount = 0 ;
+      switch (mModule) {
+      case ACAN_T4_Module::CAN1 :
+        received = message_isr_CAN20B <ACAN_T4_Module::CAN1> (transmitCount) > 0 ;
+        break ;
+      case ACAN_T4_Module::CAN2 :
+        received = message_isr_CAN20B <ACAN_T4_Module::CAN2> (transmitCount) > 0 ;
+        break ;
+      case ACAN_T4_Module::CAN3 :
+        received = message_isr_CAN20B <ACAN_T4_Module::CAN3> (transmitCount) > 0 ;
+        break ;
+      }
+      receiveCount += received ? 1 : 0 ;
+      outTransmitCount += transmitCount ;
     }
   }
+  return receiveCount ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::poll (void) {
+  uint32_t transmitCount ;
+  return poll (transmitCount) ;
 }
 
 //----------------------------------------------------------------------------------------
@@ -836,19 +1254,11 @@ void ACAN_T4::resetGlobalStatus (const uint32_t inReset) {
 }
 
 //----------------------------------------------------------------------------------------
-//    FlexCAN Register access
-//----------------------------------------------------------------------------------------
-
-static const uint32_t FLEXCAN1_BASE = 0x401D0000 ;
-static const uint32_t FLEXCAN2_BASE = 0x401D4000 ;
-static const uint32_t FLEXCAN3_BASE = 0x401D8000 ;
-
-//----------------------------------------------------------------------------------------
-//   Driver as global variable
+//   Driver as global variable (FlexCAN base addresses are defined by flexcanBaseAddress)
 //----------------------------------------------------------------------------------------
 
-ACAN_T4 ACAN_T4::can1 (FLEXCAN1_BASE, ACAN_T4_Module::CAN1) ;
-ACAN_T4 ACAN_T4::can2 (FLEXCAN2_BASE, ACAN_T4_Module::CAN2) ;
-ACAN_T4 ACAN_T4::can3 (FLEXCAN3_BASE, ACAN_T4_Module::CAN3) ;
+ACAN_T4 ACAN_T4::can1 (flexcanBaseAddress (ACAN_T4_Module::CAN1), ACAN_T4_Module::CAN1) ;
+ACAN_T4 ACAN_T4::can2 (flexcanBaseAddress (ACAN_T4_Module::CAN2), ACAN_T4_Module::CAN2) ;
+ACAN_T4 ACAN_T4::can3 (flexcanBaseAddress (ACAN_T4_Module::CAN3), ACAN_T4_Module::CAN3) ;
 
 //----------------------------------------------------------------------------------------
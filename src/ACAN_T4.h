@@ -9,7 +9,7 @@
 
 //--------------------------------------------------------------------------------------------------
 
-#ifndef __IMXRT1062__
+#if !defined (__IMXRT1062__) && !defined (ACAN_T4_HOST_SIMULATION)
   #error "This sketch should be compiled for Teensy 4.0"
 #endif
 
@@ -18,38 +18,58 @@
 #include <ACAN_T4_Settings.h>
 #include <ACAN_T4FD_Settings.h>
 #include <ACAN_T4_CANFDMessage.h>
+#include <ACAN_T4_TraceRecorder.h>
+#include <ACAN_T4_LatestValue.h>
+#include <ACAN_T4_ChangeFilter.h>
+#include <ACAN_T4_ReceiveQueue.h>
+#include <ACAN_T4_PeriodicFrame.h>
+#include <ACAN_T4_TimeTriggered.h>
+#include <ACAN_T4_RateLimit.h>
 
 //--------------------------------------------------------------------------------------------------
 
 typedef enum {kActive, kPassive, kBusOff} tControllerState ;
 
+//--------------------------------------------------------------------------------------------------
+//  Filter call back routine: by default, it is called by dispatchReceivedMessage(FD) for every
+//  frame accepted by the filter. If mCallBackInISR is true, it is called by the receive interrupt
+//  service routine instead (by the software interrupt if deferred receive processing is enabled,
+//  see ACAN_T4_Settings), as soon as the frame is read from the controller; the frame is then
+//  recorded by the trace recorder, but it is neither routed nor stored. The call back routine runs
+//  in interrupt context: it should be short, it can call tryToSend(FD) for sending a response.
 //--------------------------------------------------------------------------------------------------
 
 class ACANPrimaryFilter {
   public: uint32_t mPrimaryFilterMask ;
   public: uint32_t mPrimaryAcceptanceFilter ;
   public: ACANCallBackRoutine mCallBackRoutine ;
+  public: bool mCallBackInISR ;
 
-  public: inline ACANPrimaryFilter (const ACANCallBackRoutine inCallBackRoutine) :  // Accept any frame
+  public: inline ACANPrimaryFilter (const ACANCallBackRoutine inCallBackRoutine, // Accept any frame
+                                    const bool inCallBackInISR = false) :
   mPrimaryFilterMask (0),
   mPrimaryAcceptanceFilter (0),
-  mCallBackRoutine (inCallBackRoutine) {
+  mCallBackRoutine (inCallBackRoutine),
+  mCallBackInISR (inCallBackInISR) {
   }
 
   public: ACANPrimaryFilter (const tFrameKind inKind,
                              const tFrameFormat inFormat, // Accept any identifier
-                             const ACANCallBackRoutine inCallBackRoutine = nullptr) ;
+                             const ACANCallBackRoutine inCallBackRoutine = nullptr,
+                             const bool inCallBackInISR = false) ;
 
   public: ACANPrimaryFilter (const tFrameKind inKind,
                              const tFrameFormat inFormat,
                              const uint32_t inIdentifier,
-                             const ACANCallBackRoutine inCallBackRoutine = nullptr) ;
+                             const ACANCallBackRoutine inCallBackRoutine = nullptr,
+                             const bool inCallBackInISR = false) ;
 
   public: ACANPrimaryFilter (const tFrameKind inKind,
                              const tFrameFormat inFormat,
                              const uint32_t inMask,
                              const uint32_t inAcceptance,
-                             const ACANCallBackRoutine inCallBackRoutine = nullptr) ;
+                             const ACANCallBackRoutine inCallBackRoutine = nullptr,
+                             const bool inCallBackInISR = false) ;
 } ;
 
 //--------------------------------------------------------------------------------------------------
@@ -57,11 +77,13 @@ class ACANPrimaryFilter {
 class ACANSecondaryFilter {
   public: uint32_t mSecondaryAcceptanceFilter ;
   public: ACANCallBackRoutine mCallBackRoutine ;
+  public: bool mCallBackInISR ;
 
   public: ACANSecondaryFilter (const tFrameKind inKind,
                                const tFrameFormat inFormat,
                                const uint32_t inIdentifier,
-                               const ACANCallBackRoutine inCallBackRoutine = nullptr) ;
+                               const ACANCallBackRoutine inCallBackRoutine = nullptr,
+                               const bool inCallBackInISR = false) ;
 } ;
 
 //--------------------------------------------------------------------------------------------------
@@ -70,23 +92,78 @@ class ACANFDFilter {
   public: uint32_t mFilterMask ;
   public: uint32_t mAcceptanceMask ;
   public: ACANFDCallBackRoutine mCallBackRoutine ;
+  public: bool mCallBackInISR ;
 
-  public: ACANFDFilter (const ACANFDCallBackRoutine inCallBackRoutine = nullptr) ; // Receive any frame
+  public: ACANFDFilter (const ACANFDCallBackRoutine inCallBackRoutine = nullptr, // Receive any frame
+                        const bool inCallBackInISR = false) ;
 
   public: ACANFDFilter (const tFrameKind inKind,
                         const tFrameFormat inFormat, // Accept any identifier
-                        const ACANFDCallBackRoutine inCallBackRoutine = nullptr) ;
+                        const ACANFDCallBackRoutine inCallBackRoutine = nullptr,
+                        const bool inCallBackInISR = false) ;
 
   public: ACANFDFilter (const tFrameKind inKind,
                         const tFrameFormat inFormat,
                         const uint32_t inIdentifier,
-                        const ACANFDCallBackRoutine inCallBackRoutine = nullptr) ;
+                        const ACANFDCallBackRoutine inCallBackRoutine = nullptr,
+                        const bool inCallBackInISR = false) ;
 
   public: ACANFDFilter (const tFrameKind inKind,
                         const tFrameFormat inFormat,
                         const uint32_t inMask,
                         const uint32_t inAcceptance,
-                        const ACANFDCallBackRoutine inCallBackRoutine = nullptr) ;
+                        const ACANFDCallBackRoutine inCallBackRoutine = nullptr,
+                        const bool inCallBackInISR = false) ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//  Route: a received frame (accepted by the receive filters) whose identifier matches the route is
+//  sent by the destination controller, directly from the receive interrupt service routine. Every
+//  matching route forwards the frame. A routed frame is not stored in the receive buffer, unless
+//  mStoreInReceiveBuffer is set for one of its matching routes.
+//  Forwarding calls the destination driver from the source interrupt service routine: CAN1, CAN2
+//  and CAN3 interrupts may have different priorities, so both the destination enqueue and the
+//  destination transmit interrupt (Tx mailbox refill, expired frame removal) run with interrupts
+//  disabled.
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4 ;
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_Route {
+  public: uint32_t mMask ;
+  public: uint32_t mAcceptance ;
+  public: tFrameFormat mFormat ;
+  public: ACAN_T4 * mDestination ;
+//--- Identifier rewrite: bits set in mRewriteMask are replaced by bits of mRewriteValue
+  public: uint32_t mRewriteMask = 0 ; // 0: no rewrite
+  public: uint32_t mRewriteValue = 0 ;
+  public: bool mStoreInReceiveBuffer = false ;
+//--- Counters, updated by the receive interrupt service routine
+  public: volatile uint32_t mForwardedCount = 0 ;
+  public: volatile uint32_t mDroppedCount = 0 ; // Destination transmit buffer full, or frame not sendable
+
+  public: ACAN_T4_Route (const tFrameFormat inFormat, // Route any identifier
+                         ACAN_T4 & inDestination) ;
+
+  public: ACAN_T4_Route (const tFrameFormat inFormat,
+                         const uint32_t inIdentifier,
+                         ACAN_T4 & inDestination) ;
+
+  public: ACAN_T4_Route (const tFrameFormat inFormat,
+                         const uint32_t inMask,
+                         const uint32_t inAcceptance,
+                         ACAN_T4 & inDestination) ;
+
+  public: inline bool matches (const uint32_t inIdentifier, const bool inExtended) const {
+    return ((mFormat == kExtended) == inExtended) && ((inIdentifier & mMask) == mAcceptance) ;
+  }
+
+  public: inline uint32_t rewrittenIdentifier (const uint32_t inIdentifier, const bool inExtended) const {
+    const uint32_t identifier = (inIdentifier & ~ mRewriteMask) | (mRewriteValue & mRewriteMask) ;
+    return identifier & (inExtended ? 0x1FFFFFFF : 0x7FF) ;
+  }
 } ;
 
 //--------------------------------------------------------------------------------------------------
@@ -136,6 +213,18 @@ class ACAN_T4 {
   public: inline uint32_t transmitBufferCount (void) const { return mTransmitBufferCount ; }
   public: inline uint32_t transmitBufferPeakCount (void) const { return mTransmitBufferPeakCount ; }
 
+//--- Transmitting a burst of messages within a single critical section: messages are accepted in
+//    order, until one cannot be sent or buffered. Returns the number of accepted messages.
+  public: uint32_t tryToSendBatch (const CANMessage inMessages [], const uint32_t inCount) ;
+  public: uint32_t tryToSendBatchFD (const CANFDMessage inMessages [], const uint32_t inCount) ;
+
+//--- Transmitting a data frame that expires inLifetime ms after it has been stored in the transmit
+//    buffer (0: no expiry); requires mTransmitFrameExpiry in settings, otherwise it is sent as
+//    tryToSend(FD). A remote frame does not expire.
+  public: bool tryToSendWithLifetime (const CANMessage & inMessage, const uint32_t inLifetime) ;
+  public: bool tryToSendWithLifetimeFD (const CANFDMessage & inMessage, const uint32_t inLifetime) ;
+  public: inline uint32_t expiredTransmitFrameCount (void) const { return mExpiredTransmitFrameCount ; }
+
 //--- Transmitting messages and return status (returns 0 if ok)
   public: uint32_t tryToSendReturnStatus (const CANMessage & inMessage) ;
   public: uint32_t tryToSendReturnStatusFD (const CANFDMessage & inMessage) ;
@@ -145,6 +234,7 @@ class ACAN_T4 {
   public: static const uint32_t kMessageLengthExceedsPayload = 1 << 3 ;
   public: static const uint32_t kFlexCANinCAN20BMode = 1 << 4 ;
   public: static const uint32_t kFlexCANinCANFDMode = 1 << 5 ;
+  public: static const uint32_t kRateLimitExceeded = 1 << 6 ;
 
 //--- Receiving messages
   public: inline bool available (void)   const { return (!mCANFD) && (mReceiveBufferCount > 0) ; }
@@ -157,6 +247,98 @@ class ACAN_T4 {
   public: inline uint32_t receiveBufferSize (void) const { return mReceiveBufferSize ; }
   public: inline uint32_t receiveBufferCount (void) const { return mReceiveBufferCount ; }
   public: inline uint32_t receiveBufferPeakCount (void) const { return mReceiveBufferPeakCount ; }
+  public: inline uint32_t receiveBufferOverflowCount (void) const { return mReceiveBufferOverflowCount ; } // Lost frames
+
+//--- Trace recording: every received frame is appended to inRecorder by the interrupt service
+//    routine, before being stored in driver receive buffer (nullptr stops recording). A recorder
+//    can be shared by CAN1, CAN2 and CAN3, appending is a critical section.
+  public: void setTraceRecorder (ACAN_T4_TraceRecorder * inRecorder) ;
+  private: ACAN_T4_TraceRecorder * volatile mTraceRecorder = nullptr ;
+
+//--- Routing: frames matching inRoutes are forwarded by the receive interrupt service routine (see
+//    ACAN_T4_Route). inRoutes array is not copied, it should remain valid while routing is active;
+//    nullptr stops routing. end clears the routes.
+  public: void setRoutes (ACAN_T4_Route inRoutes [], const uint32_t inRouteCount) ;
+  private: ACAN_T4_Route * volatile mRoutes = nullptr ;
+  private: volatile uint32_t mRouteCount = 0 ;
+
+//--- Latest value slots: a received data frame whose identifier matches a slot overwrites the slot
+//    instead of being stored in the receive buffer (see ACAN_T4_LatestValueSlot). inSlots array is
+//    not copied, it should remain valid while slots are installed; nullptr removes the slots. end
+//    removes the slots.
+  public: void setLatestValueSlots (ACAN_T4_LatestValueSlot inSlots [], const uint32_t inSlotCount) ;
+  private: ACAN_T4_LatestValueSlot * volatile mLatestValueSlots = nullptr ;
+  private: volatile uint32_t mLatestValueSlotCount = 0 ;
+
+//--- Change filters: a received data frame whose identifier matches a change filter is stored in
+//    the receive buffer only if its payload has changed, or if its heartbeat interval has elapsed
+//    (see ACAN_T4_ChangeFilter). inFilters array is not copied, it should remain valid while
+//    change filters are installed; nullptr removes the change filters. end removes the filters.
+  public: void setChangeFilters (ACAN_T4_ChangeFilter inFilters [], const uint32_t inFilterCount) ;
+  private: ACAN_T4_ChangeFilter * volatile mChangeFilters = nullptr ;
+  private: volatile uint32_t mChangeFilterCount = 0 ;
+
+//--- Receive queues: a frame accepted by filter #i is stored in inQueues [i] instead of the
+//    receive buffer, if i < inQueueCount and inQueues [i] is not nullptr (see
+//    ACAN_T4_ReceiveQueue). inQueues array is not copied, it should remain valid while queues are
+//    installed; nullptr removes the queues. end removes the queues.
+  public: void setReceiveQueues (ACAN_T4_ReceiveQueue * inQueues [], const uint32_t inQueueCount) ;
+  private: ACAN_T4_ReceiveQueue * * volatile mReceiveQueues = nullptr ;
+  private: volatile uint32_t mReceiveQueueCount = 0 ;
+
+//--- Periodic frames: inFrames are sent by the periodic scheduler timer interrupt (see
+//    ACAN_T4_PeriodicFrame.h and ACAN_T4_PeriodicScheduler::begin), their phase starts now.
+//    inFrames array is not copied, it should remain valid while frames are installed; nullptr
+//    removes the frames. end removes the frames.
+  public: void setPeriodicFrames (ACAN_T4_PeriodicFrame inFrames [], const uint32_t inFrameCount) ;
+  public: void sendDuePeriodicFrames (const uint32_t inTick, const uint32_t inTickDate) ; // Called by the scheduler
+  private: ACAN_T4_PeriodicFrame * volatile mPeriodicFrames = nullptr ;
+  private: volatile uint32_t mPeriodicFrameCount = 0 ;
+
+//--- Transmit rate limits (see ACAN_T4_RateLimit.h): frames sent by tryToSend(FD),
+//    tryToSendBatch(FD) and tryToSendWithLifetime(FD) are checked against the first matching limit
+//    (routed frames are not). inLimits array is not copied, it should remain valid while limits
+//    are installed; nullptr removes the limits. end removes the limits.
+  public: void setRateLimits (ACAN_T4_RateLimit inLimits [], const uint32_t inLimitCount) ;
+  public: void releaseDeferredFrames (void) ; // Called by the periodic scheduler
+  private: ACAN_T4_RateLimit * volatile mRateLimits = nullptr ;
+  private: volatile uint32_t mRateLimitCount = 0 ;
+  private: ACAN_T4_RateLimit * findRateLimit (const uint32_t inIdentifier, const bool inExtended) const ;
+  private: uint32_t rateLimitedSend (const CANMessage & inMessage, const uint32_t inLifetime) ; // Interrupts should be disabled
+  private: uint32_t rateLimitedSendFD (const CANFDMessage & inMessage, const uint32_t inLifetime) ; // Interrupts should be disabled
+
+//--- Time triggered schedule (see ACAN_T4_TimeTriggered.h): the schedule reserves the top
+//    mTimeTriggeredMailboxCount mailboxes used for sending remote frames, slot 0 being the highest
+//    one. The receive interrupt passes the reference message reception date to the schedule. end
+//    detaches the schedule. While a window frame is pending, the data frame Tx mailbox is held: it
+//    is not refilled from the transmit buffer (mTransmitMailboxHoldCount is the number of pending
+//    windows).
+  public: inline ACAN_T4_TimeTriggeredSchedule * timeTriggeredSchedule (void) const { return mTimeTriggeredSchedule ; }
+  private: ACAN_T4_TimeTriggeredSchedule * volatile mTimeTriggeredSchedule = nullptr ;
+  private: volatile uint32_t mTimeTriggeredMailboxCount = 0 ;
+  private: volatile uint32_t mTransmitMailboxHoldCount = 0 ;
+  private: uint32_t timeTriggeredMailboxCapacity (void) const ;
+  private: uint32_t timeTriggeredMailboxCapacityFD (void) const ;
+  private: volatile uint32_t * timeTriggeredMailboxAddress (const uint32_t inSlot) const ;
+  private: void writeTimeTriggeredMailbox (const uint32_t inSlot, const CANFDMessage & inMessage) ;
+  private: bool timeTriggeredMailboxPending (const uint32_t inSlot) const ;
+  private: void abortTimeTriggeredMailbox (const uint32_t inSlot) ;
+  private: void holdTransmitMailbox (void) ; // Interrupts should be disabled
+  private: void releaseTransmitMailbox (void) ; // Interrupts should be disabled
+  private: void timeTriggeredReceive (const uint32_t inIdentifier, const bool inExtended, const uint8_t inFirstByte) ;
+  friend class ACAN_T4_TimeTriggeredSchedule ;
+
+//--- Deferred receive processing (see ACAN_T4_Settings::mDeferredReceiveProcessing): received frames
+//    are moved by the CAN interrupt to the staging buffer, and processed by the software interrupt.
+//    Staging buffer has mStagingBufferSize + 1 entries, it is empty when both indexes are equal.
+  public: inline bool deferredReceiveProcessing (void) const { return mStagingBufferSize > 0 ; }
+  public: inline uint32_t stagingBufferOverflowCount (void) const { return mStagingBufferOverflowCount ; } // Lost frames
+  private: CANMessage * mStagingBuffer = nullptr ;
+  private: CANFDMessage * mStagingBufferFD = nullptr ;
+  private: uint32_t mStagingBufferSize = 0 ;
+  private: volatile uint32_t mStagingBufferReadIndex = 0 ; // Only written by the software interrupt
+  private: volatile uint32_t mStagingBufferWriteIndex = 0 ; // Only written by the CAN interrupt
+  private: volatile uint32_t mStagingBufferOverflowCount = 0 ;
 
 //--- FlexCAN controller state
   public: tControllerState controllerState (void) const ;
@@ -168,15 +350,29 @@ class ACAN_T4 {
   private: ACANFDCallBackRoutine * mCallBackFunctionArrayFD = nullptr ; // null, or size is mRxCANFDMBCount
   private: uint32_t mCallBackFunctionArraySize = 0 ;
 
+//--- Interrupt call back function array (null if no filter has mCallBackInISR set, otherwise same
+//    size as call back function array, entries are null for filters without mCallBackInISR)
+  private: ACANCallBackRoutine * mISRCallBackFunctionArray = nullptr ;
+  private: ACANFDCallBackRoutine * mISRCallBackFunctionArrayFD = nullptr ;
+
 //--- Base address
   private: const uint32_t mFlexcanBaseAddress ;
   private: const ACAN_T4_Module mModule ; // Initialized in constructor
+  private: static constexpr uint32_t flexcanBaseAddress (const ACAN_T4_Module inModule) {
+    return (inModule == ACAN_T4_Module::CAN1) ? 0x401D0000
+         : (inModule == ACAN_T4_Module::CAN2) ? 0x401D4000
+         : 0x401D8000 ;
+  }
+  private: template <ACAN_T4_Module MODULE> static inline ACAN_T4 & driver (void) {
+    return (MODULE == ACAN_T4_Module::CAN1) ? can1 : (MODULE == ACAN_T4_Module::CAN2) ? can2 : can3 ;
+  }
 
 //--- CANFD properties
   private : bool mCANFD = false ;
   private : ACAN_T4FD_Settings::Payload mPayload = ACAN_T4FD_Settings::PAYLOAD_64_BYTES ;
   private : uint8_t mRxCANFDMBCount = 12 ;
   public : uint32_t RxCANFDMBCount (void) const { return mRxCANFDMBCount ; }
+  public : bool isCANFDMode (void) const { return mCANFD ; }
 
 //--- Filters
   private : uint8_t mActualPrimaryFilterCount = 0 ;
@@ -190,6 +386,8 @@ class ACAN_T4 {
   private: volatile uint32_t mReceiveBufferReadIndex = 0 ;
   private: volatile uint32_t mReceiveBufferCount = 0 ;
   private: volatile uint32_t mReceiveBufferPeakCount = 0 ; // == mReceiveBufferSize + 1 if overflow did occur
+  private: volatile uint32_t mReceiveBufferOverflowCount = 0 ;
+  private: ACAN_T4_ReceiveOverflowPolicy mReceiveOverflowPolicy = ACAN_T4_ReceiveOverflowPolicy::DROP_NEWEST ;
 
 //--- Driver transmit buffer
   private: CANMessage * mTransmitBuffer = nullptr ;
@@ -199,6 +397,22 @@ class ACAN_T4 {
   private: volatile uint32_t mTransmitBufferCount = 0 ;
   private: volatile uint32_t mTransmitBufferPeakCount = 0 ; // == mTransmitBufferSize + 1 if tentative overflow did occur
 
+//--- Transmit frame expiry: mTransmitDeadlines [i] is the millis deadline of transmit buffer entry
+//    i, 0 if it does not expire; nullptr if expiry is not enabled
+  private: uint32_t * mTransmitDeadlines = nullptr ;
+  private: uint32_t mTransmitFrameLifetime = 0 ;
+  private: ACANCallBackRoutine mExpiredTransmitFrameCallBack = nullptr ;
+  private: ACANFDCallBackRoutine mExpiredTransmitFrameCallBackFD = nullptr ;
+  private: volatile uint32_t mExpiredTransmitFrameCount = 0 ;
+
+//--- Storage allocated by begin / beginFD, freed by end (storage provided by the settings is not)
+  private: bool mOwnsReceiveBuffer = false ;
+  private: bool mOwnsTransmitBuffer = false ;
+  private: bool mOwnsTransmitDeadlines = false ;
+  private: bool mOwnsStagingBuffer = false ;
+  private: bool mOwnsCallBackTables = false ; // Call back function arrays (2.0B and CANFD)
+  private: bool mOwnsAcceptanceFilterTable = false ; // CANFD acceptance filter array
+
 //--- Global status
   private : volatile uint32_t mGlobalStatus = 0 ; // Returns 0 if all is ok
   public : uint32_t globalStatus (void) const { return mGlobalStatus ; }
@@ -208,10 +422,30 @@ class ACAN_T4 {
   public: static const uint32_t kGlobalStatusRxFIFOWarning = 1 <<  1 ; // Occurs when the number of messages goes from 4 to 5
   public: static const uint32_t kGlobalStatusRxFIFOOverflow = 1 <<  2 ; // Occurs when RxFIFO overflows
   public: static const uint32_t kGlobalStatusReceiveBufferOverflow = 1 <<  3 ; // Occurs when driver receive buffer overflows
+  public: static const uint32_t kGlobalStatusStagingBufferOverflow = 1 <<  4 ; // Occurs when deferred receive processing staging buffer overflows
 
-//--- Message interrupt service routine
+//--- Message interrupt service routine (tests the mode and the module, see isrCAN20B and isrFD)
   public: void message_isr (void) ;
 
+//--- Message interrupt service routines, specialized at compile time for a module: the driver
+//    instance and the FlexCAN register addresses are constants. begin installs isrCAN20B, beginFD
+//    installs isrFD: the mode is not tested on every interrupt.
+  public: template <ACAN_T4_Module MODULE> static void isrCAN20B (void) ;
+  public: template <ACAN_T4_Module MODULE> static void isrFD (void) ;
+
+//--- Deferred receive processing software interrupt service routine
+  public: void message_deferred_isr (void) ;
+
+//--- Polled mode (see ACAN_T4_Settings::mPolledMode): the CAN interrupt is disabled, poll does
+//    what the interrupt service routine does: it handles received frames (at most 6 for a CAN 2.0B
+//    controller, at most one per Rx mailbox for a CANFD controller), and moves a frame from the
+//    transmit buffer to the Tx mailbox. Returns the number of received frames, outTransmitCount is
+//    the number of frames moved to the Tx mailbox (0 or 1). Does nothing if not in polled mode.
+  public: uint32_t poll (uint32_t & outTransmitCount) ;
+  public: uint32_t poll (void) ;
+  public: inline bool polledMode (void) const { return mPolledMode ; }
+  private: bool mPolledMode = false ;
+
 //--- Driver instance
   public: static ACAN_T4 can1 ;
   public: static ACAN_T4 can2 ;
@@ -219,16 +453,67 @@ class ACAN_T4 {
 
 //--- Private methods
   private : uint32_t tryToSendRemoteFrame (const CANMessage & inMessage) ;
+  private : uint32_t enqueueRemoteFrame (const CANMessage & inMessage) ; // Interrupts should be disabled
   private : uint32_t tryToSendDataFrame (const CANMessage & inMessage) ;
+  private : uint32_t enqueueDataFrame (const CANMessage & inMessage, const uint32_t inLifetime) ; // Interrupts should be disabled
   private : void writeTxRegisters (const CANMessage & inMessage, const uint32_t inMBIndex) ;
   private : uint32_t tryToSendDataFrameFD (const CANFDMessage & inMessage) ;
+  private : uint32_t enqueueDataFrameFD (const CANFDMessage & inMessage, const uint32_t inLifetime) ; // Interrupts should be disabled
+  private : void setupTransmitFrameExpiry (const bool inEnabled, uint32_t * inDeadlineStorage) ;
+  private : void storeTransmitDeadline (const uint32_t inIndex, const uint32_t inLifetime) ;
+  private : void dropExpiredTransmitFrames (void) ; // Interrupts should be disabled
   private : uint32_t tryToSendRemoteFrameFD (const CANFDMessage & inMessage) ;
+  private : uint32_t enqueueRemoteFrameFD (const CANFDMessage & inMessage) ; // Interrupts should be disabled
+  private : uint32_t checkFrameFD (const CANFDMessage & inMessage) const ;
   private : void writeTxRegistersFD (const CANFDMessage & inMessage, volatile uint32_t * inMBAddress) ;
-  private : void message_isr_receive (void) ;
-  private : void message_isr_receiveFD (const uint32_t inReceiveMailboxIndex) ;
-  private : void message_isr_FD (void) ;
-  private: void readRxRegisters (CANMessage & outMessage) ;
-  private : void readRxRegistersFD (CANFDMessage & outMessage, const uint32_t inReceiveMailboxIndex) ;
+  private : template <ACAN_T4_Module MODULE> void message_isr_receive (void) ;
+  private : template <ACAN_T4_Module MODULE> void message_isr_receiveFD (const uint32_t inReceiveMailboxIndex) ;
+  private : template <ACAN_T4_Module MODULE> uint32_t message_isr_FD (uint32_t & outTransmitCount) ; // Returns received frame count
+  private : template <ACAN_T4_Module MODULE> uint32_t message_isr_CAN20B (uint32_t & outTransmitCount) ; // Returns received frame count
+  private : void processReceivedFrame (const CANMessage & inMessage) ;
+  private : void processReceivedFrameFD (const CANFDMessage & inMessage) ;
+  private : void setupInterrupts (const uint8_t inInterruptPriority,
+                                  const bool inDeferredReceiveProcessing,
+                                  const uint8_t inDeferredInterruptPriority,
+                                  const uint16_t inStagingBufferSize,
+                                  CANMessage * inStagingBufferStorage,
+                                  CANFDMessage * inStagingBufferStorageFD) ;
+  private : void endDeferredReceiveProcessing (void) ;
+  private : CANMessage * stagingBufferFreeEntry (void) ; // nullptr if staging buffer is full
+  private : CANFDMessage * stagingBufferFreeEntryFD (void) ; // nullptr if staging buffer is full
+  private : void commitStagedFrame (const bool inStored) ;
+  private: template <ACAN_T4_Module MODULE> void readRxRegisters (CANMessage & outMessage) ;
+  private : template <ACAN_T4_Module MODULE> void readRxRegistersFD (CANFDMessage & outMessage, const uint32_t inReceiveMailboxIndex) ;
+  private : bool routeFrame (const CANMessage & inMessage) ; // Returns true if frame should be stored
+  private : bool routeFrameFD (const CANFDMessage & inMessage) ; // Returns true if frame should be stored
+  private : uint32_t forwardFrame (const CANMessage & inMessage) ;
+  private : bool storeLatestValue (const CANMessage & inMessage) ; // Returns true if frame is stored in a slot
+  private : bool storeLatestValueFD (const CANFDMessage & inMessage) ; // Returns true if frame is stored in a slot
+  private : bool appendToReceiveBuffer (const CANMessage & inMessage) ; // Returns true if frame is stored
+  private : bool appendToReceiveBufferFD (const CANFDMessage & inMessage) ; // Returns true if frame is stored
+  private : void commitReceiveBufferEntry (void) ;
+
+//--- Direct receive: if no receive processing feature (trace, routes, latest value slots, change
+//    filters, receive queues) is active and the receive buffer is not full, the receive interrupt
+//    reads a frame from the FlexCAN registers directly into the free receive buffer entry; the
+//    caller also checks there is no interrupt call back
+  private: inline bool directReceive (void) const {
+    return (mReceiveBufferCount < mReceiveBufferSize)
+      && (mTraceRecorder == nullptr)
+      && (mRouteCount == 0)
+      && (mLatestValueSlotCount == 0)
+      && (mChangeFilterCount == 0)
+      && (mReceiveQueueCount == 0) ;
+  }
+
+  private: inline uint32_t receiveBufferFreeIndex (void) const {
+    const uint32_t index = mReceiveBufferReadIndex + mReceiveBufferCount ;
+    return (index >= mReceiveBufferSize) ? (index - mReceiveBufferSize) : index ;
+  }
+  private : ACAN_T4_ChangeFilter * findChangeFilter (const uint32_t inIdentifier,
+                                                     const bool inExtended,
+                                                     const bool inRemote) const ;
+  private : uint32_t forwardFrameFD (const CANFDMessage & inMessage) ;
 
 //--- No copy
   private : ACAN_T4 (const ACAN_T4 &) = delete ;
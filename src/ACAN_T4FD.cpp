@@ -19,6 +19,10 @@
 //   FLEXCAN REGISTERS
 //----------------------------------------------------------------------------------------
 
+#ifdef ACAN_T4_HOST_SIMULATION
+  #include <ACAN_T4_SimulatedFlexCAN.h> // Host build: registers of a simulated FlexCAN
+#else
+
 #define FLEXCAN_MCR(b)      (*((volatile uint32_t *) ((b)+0x00)))
 #define FLEXCAN_CTRL1(b)    (*((volatile uint32_t *) ((b)+0x04)))
 #define FLEXCAN_TIMER(b)    (*((volatile uint32_t *) ((b)+0x08)))
@@ -37,6 +41,9 @@
 
 // #define FLEXCAN_IDAF(b, n)    (*((volatile uint32_t *) ((b)+0xE0+(n)*4)))
 #define FLEXCAN_MB_MASK(b, n) (*((volatile uint32_t *) ((b)+0x880+(n)*4)))
+#define FLEXCAN_MB_RAM(b)     ((volatile uint32_t *) ((b)+0x80))
+
+#endif
 
 //--- Definitions FLEXCAN_MB_CS
 static const uint32_t FLEXCAN_MB_CS_RTR       = 1 << 20 ;
@@ -155,31 +162,31 @@ static uint32_t dataWordsForPayload (const ACAN_T4FD_Settings::Payload inPayload
 static volatile uint32_t * mailboxAddress (const uint32_t inFlexcanBaseAddress,
                                            const ACAN_T4FD_Settings::Payload inPayload,
                                            const uint32_t inMailboxIndex) {
-  uint32_t address = inFlexcanBaseAddress + 0x0080 ; // Base address
+  uint32_t offset = 0 ; // In bytes, from mailbox RAM start
   switch (inPayload) {
   case ACAN_T4FD_Settings::PAYLOAD_8_BYTES : // 64 MB, table 45-29 page 2711
-    address += 16 * inMailboxIndex ;
+    offset += 16 * inMailboxIndex ;
     break ;
   case ACAN_T4FD_Settings::PAYLOAD_16_BYTES : // 42 MB, table 45-30 page 2713
-    address += 24 * inMailboxIndex ;
+    offset += 24 * inMailboxIndex ;
     if (inMailboxIndex >= 21) {
-      address += 8 ;
+      offset += 8 ;
     }
     break ;
   case ACAN_T4FD_Settings::PAYLOAD_32_BYTES : // 24 MB, table 45-31 page 2714
-    address += 40 * inMailboxIndex ;
+    offset += 40 * inMailboxIndex ;
     if (inMailboxIndex >= 12) {
-      address += 32 ;
+      offset += 32 ;
     }
     break ;
   case ACAN_T4FD_Settings::PAYLOAD_64_BYTES :  // 14 MB, table 45-32 page 2715
-    address += 72 * inMailboxIndex ;
+    offset += 72 * inMailboxIndex ;
     if (inMailboxIndex >= 7) {
-      address += 8 ;
+      offset += 8 ;
     }
     break ;
   }
-  return (volatile uint32_t *) address ;
+  return FLEXCAN_MB_RAM (inFlexcanBaseAddress) + offset / 4 ;
 }
 
 //----------------------------------------------------------------------------------------
@@ -209,12 +216,23 @@ uint32_t ACAN_T4::beginFD (const ACAN_T4FD_Settings & inSettings,
   if (0 == errorCode) {
     mCANFD = true ;
     mPayload = inSettings.mPayload ;
-  //---------- Allocate receive buffer
+  //---------- Allocate receive buffer, unless provided by settings
     mReceiveBufferSize = inSettings.mReceiveBufferSize ;
-    mReceiveBufferFD = new CANFDMessage [inSettings.mReceiveBufferSize] ;
-  //---------- Allocate transmit buffer
+    mReceiveOverflowPolicy = inSettings.mReceiveOverflowPolicy ;
+    mOwnsReceiveBuffer = inSettings.mReceiveBufferStorage == nullptr ;
+    mReceiveBufferFD = mOwnsReceiveBuffer
+      ? new CANFDMessage [inSettings.mReceiveBufferSize]
+      : inSettings.mReceiveBufferStorage ;
+  //---------- Allocate transmit buffer, unless provided by settings
     mTransmitBufferSize = inSettings.mTransmitBufferSize ;
-    mTransmitBufferFD = new CANFDMessage [inSettings.mTransmitBufferSize] ;
+    mOwnsTransmitBuffer = inSettings.mTransmitBufferStorage == nullptr ;
+    mTransmitBufferFD = mOwnsTransmitBuffer
+      ? new CANFDMessage [inSettings.mTransmitBufferSize]
+      : inSettings.mTransmitBufferStorage ;
+  //---------- Transmit frame expiry
+    setupTransmitFrameExpiry (inSettings.mTransmitFrameExpiry, inSettings.mTransmitDeadlineStorage) ;
+    mTransmitFrameLifetime = inSettings.mTransmitFrameLifetime ;
+    mExpiredTransmitFrameCallBackFD = inSettings.mExpiredTransmitFrameCallBack ;
   //---------- Select clock source (see i.MX RT1060 Processor Reference Manual, Rev. 2, 12/2019, page 1059)
     uint32_t cscmr2 = CCM_CSCMR2 & 0xFFFFFC03 ;
     cscmr2 |= CCM_CSCMR2_CAN_CLK_PODF (getCANRootClockDivisor () - 1) ;
@@ -232,7 +250,7 @@ uint32_t ACAN_T4::beginFD (const ACAN_T4FD_Settings & inSettings,
     CCM_CSCMR2 = cscmr2 ;
   //---------- Vectors
     CCM_CCGR7 |= 0x3C0 ;
-    _VectorsRam [16 + IRQ_CAN3] = flexcan_isr_can3 ;
+    _VectorsRam [16 + IRQ_CAN3] = isrFD <ACAN_T4_Module::CAN3> ;
   //---------- Enable CANFD
     const uint32_t lastMailboxIndex = MBCount (inSettings.mPayload) - 1 ;
     FLEXCAN_MCR (mFlexcanBaseAddress) =
@@ -298,9 +316,15 @@ uint32_t ACAN_T4::beginFD (const ACAN_T4FD_Settings & inSettings,
       (inSettings.mISOCRCEnabled ? (1 << 12) : 0)   // ISO CANFD Enable
     ;
   //---------- Filters
+    mOwnsCallBackTables = inSettings.mCallBackStorage == nullptr ;
+    mOwnsAcceptanceFilterTable = inSettings.mAcceptanceFilterStorage == nullptr ;
     if (inFilterCount > 0) {
-      mCallBackFunctionArrayFD = new ACANFDCallBackRoutine [inSettings.mRxCANFDMBCount] ;
-      mCANFDAcceptanceFilterArray = new uint32_t [inSettings.mRxCANFDMBCount] ;
+      mCallBackFunctionArrayFD = mOwnsCallBackTables
+        ? new ACANFDCallBackRoutine [inSettings.mRxCANFDMBCount]
+        : inSettings.mCallBackStorage ;
+      mCANFDAcceptanceFilterArray = mOwnsAcceptanceFilterTable
+        ? new uint32_t [inSettings.mRxCANFDMBCount]
+        : inSettings.mAcceptanceFilterStorage ;
       for (uint32_t i=0 ; i < inFilterCount ; i++) {
         mCallBackFunctionArrayFD [i] = inFilters [i].mCallBackRoutine ;
         FLEXCAN_MB_MASK (mFlexcanBaseAddress, i+1) = inFilters [i].mFilterMask ;
@@ -317,6 +341,20 @@ uint32_t ACAN_T4::beginFD (const ACAN_T4FD_Settings & inSettings,
         FLEXCAN_MB_MASK (mFlexcanBaseAddress, i+1) = inFilters [inFilterCount - 1].mFilterMask ;
         mCANFDAcceptanceFilterArray [i] = inFilters [inFilterCount - 1].mAcceptanceMask ;
       }
+    //--- Interrupt call backs, only if required
+      bool hasISRCallBack = false ;
+      for (uint32_t i=0 ; i < inFilterCount ; i++) {
+        hasISRCallBack |= inFilters [i].mCallBackInISR && (inFilters [i].mCallBackRoutine != nullptr) ;
+      }
+      if (hasISRCallBack) {
+        mISRCallBackFunctionArrayFD = mOwnsCallBackTables
+          ? new ACANFDCallBackRoutine [inSettings.mRxCANFDMBCount]
+          : (inSettings.mCallBackStorage + inSettings.mRxCANFDMBCount) ;
+        for (uint32_t i=0 ; i < inSettings.mRxCANFDMBCount ; i++) {
+          const ACANFDFilter & filter = inFilters [(i < inFilterCount) ? i : (inFilterCount - 1)] ;
+          mISRCallBackFunctionArrayFD [i] = filter.mCallBackInISR ? filter.mCallBackRoutine : nullptr ;
+        }
+      }
     }else{
       for (uint32_t i = 1 ; i <= inSettings.mRxCANFDMBCount ; i++) {
         FLEXCAN_MB_MASK (mFlexcanBaseAddress, i) = 0 ; // Accept any
@@ -366,8 +404,18 @@ uint32_t ACAN_T4::beginFD (const ACAN_T4FD_Settings & inSettings,
     while (FLEXCAN_MCR (mFlexcanBaseAddress) & FLEXCAN_MCR_FRZ_ACK) {}
   //----------  Wait until ready
     while (FLEXCAN_MCR (mFlexcanBaseAddress) & FLEXCAN_MCR_NOT_RDY) {}
-  //---------- Enable NVIC interrupts
-    NVIC_ENABLE_IRQ (IRQ_CAN3) ;
+  //---------- Interrupt priorities, deferred receive processing
+    mPolledMode = inSettings.mPolledMode ;
+    setupInterrupts (inSettings.mInterruptPriority,
+                     inSettings.mDeferredReceiveProcessing && !inSettings.mPolledMode,
+                     inSettings.mDeferredInterruptPriority,
+                     inSettings.mStagingBufferSize,
+                     nullptr,
+                     inSettings.mStagingBufferStorage) ;
+  //---------- Enable NVIC interrupts (polled mode: interrupts are left disabled)
+    if (!mPolledMode) {
+      NVIC_ENABLE_IRQ (IRQ_CAN3) ;
+    }
   //---------- Enable CAN interrupts
     const uint32_t txMBindex = MBCount (mPayload) - 1 ;
     const uint64_t interruptEnableBits =
@@ -395,7 +443,7 @@ bool ACAN_T4::receiveFD (CANFDMessage & outMessage) {
       mReceiveBufferReadIndex = (mReceiveBufferReadIndex + 1) % mReceiveBufferSize ;
       mReceiveBufferCount -= 1 ;
     }
-  interrupts ()
+  interrupts () ;
   return hasMessage ;
 }
 
@@ -434,7 +482,11 @@ uint32_t ACAN_T4::tryToSendReturnStatusFD (const CANFDMessage & inMessage) {
   if (!mCANFD) {
     sendStatus = kFlexCANinCAN20BMode ;
   }else if ((mGlobalStatus & kGlobalStatusInitError) == 0) {
-    if (inMessage.type == CANFDMessage::CAN_REMOTE) {
+    if (mRateLimitCount > 0) {
+      noInterrupts () ;
+        sendStatus = rateLimitedSendFD (inMessage, mTransmitFrameLifetime) ;
+      interrupts () ;
+    }else if (inMessage.type == CANFDMessage::CAN_REMOTE) {
       sendStatus = tryToSendRemoteFrameFD (inMessage) ;
     }else{
       sendStatus = tryToSendDataFrameFD (inMessage) ;
@@ -445,13 +497,106 @@ uint32_t ACAN_T4::tryToSendReturnStatusFD (const CANFDMessage & inMessage) {
 
 //----------------------------------------------------------------------------------------
 
-uint32_t ACAN_T4::tryToSendRemoteFrameFD (const CANFDMessage & inMessage) {
+uint32_t ACAN_T4::tryToSendBatchFD (const CANFDMessage inMessages [], const uint32_t inCount) {
+  uint32_t acceptedCount = 0 ;
+  if (mCANFD && ((mGlobalStatus & kGlobalStatusInitError) == 0)) {
+    noInterrupts () ;
+      bool accepted = true ;
+      while (accepted && (acceptedCount < inCount)) {
+        const CANFDMessage & message = inMessages [acceptedCount] ;
+        if (mRateLimitCount > 0) {
+          accepted = rateLimitedSendFD (message, mTransmitFrameLifetime) == 0 ;
+        }else{
+          accepted = ((message.type == CANFDMessage::CAN_REMOTE)
+            ? enqueueRemoteFrameFD (message)
+            : enqueueDataFrameFD (message, mTransmitFrameLifetime)) == 0 ;
+        }
+        if (accepted) {
+          acceptedCount += 1 ;
+        }
+      }
+    interrupts () ;
+  }
+  return acceptedCount ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool ACAN_T4::tryToSendWithLifetimeFD (const CANFDMessage & inMessage, const uint32_t inLifetime) {
   uint32_t sendStatus = 0 ;
-  if (mRxCANFDMBCount >= (MBCount (mPayload) - 2)) {
-    sendStatus = kNoReservedMBForSendingRemoteFrame ;
+  if (!mCANFD) {
+    sendStatus = kFlexCANinCAN20BMode ;
+  }else if ((mGlobalStatus & kGlobalStatusInitError) == 0) {
+    if (mRateLimitCount > 0) {
+      noInterrupts () ;
+        sendStatus = rateLimitedSendFD (inMessage, inLifetime) ;
+      interrupts () ;
+    }else if (inMessage.type == CANFDMessage::CAN_REMOTE) {
+      sendStatus = tryToSendRemoteFrameFD (inMessage) ;
+    }else{
+      noInterrupts () ;
+        sendStatus = enqueueDataFrameFD (inMessage, inLifetime) ;
+      interrupts () ;
+    }
+  }
+  return sendStatus == 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+// Checks that do not depend on the transmit state: if a frame fails them, sending it later
+// fails again (kMessageLengthExceedsPayload, kNoReservedMBForSendingRemoteFrame).
+
+uint32_t ACAN_T4::checkFrameFD (const CANFDMessage & inMessage) const {
+  uint32_t sendStatus = 0 ;
+  if (inMessage.type == CANFDMessage::CAN_REMOTE) {
+    const uint32_t lastTxMBIndex = MBCount (mPayload) - 1 - mTimeTriggeredMailboxCount ; // Excluded
+    if ((mRxCANFDMBCount + 1U) >= lastTxMBIndex) {
+      sendStatus = kNoReservedMBForSendingRemoteFrame ;
+    }
   }else{
+    switch (mPayload) {
+    case ACAN_T4FD_Settings::PAYLOAD_8_BYTES : // 64 MB, table 44-40 page 2837
+      if (inMessage.len > 8) {
+        sendStatus = kMessageLengthExceedsPayload ;
+      }
+      break ;
+    case ACAN_T4FD_Settings::PAYLOAD_16_BYTES : // 42 MB, table 44-41 page 2839
+      if (inMessage.len > 16) {
+        sendStatus = kMessageLengthExceedsPayload ;
+      }
+      break ;
+    case ACAN_T4FD_Settings::PAYLOAD_32_BYTES : // 24 MB, table 44-42 page 2840
+      if (inMessage.len > 32) {
+        sendStatus = kMessageLengthExceedsPayload ;
+      }
+      break ;
+    case ACAN_T4FD_Settings::PAYLOAD_64_BYTES :  // 14 MB, table 44-43 page 2841
+      break ;
+    }
+  }
+  return sendStatus ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::tryToSendRemoteFrameFD (const CANFDMessage & inMessage) {
+  noInterrupts () ;
+    const uint32_t sendStatus = enqueueRemoteFrameFD (inMessage) ;
+  interrupts () ;
+  return sendStatus ;
+}
+
+//----------------------------------------------------------------------------------------
+
+// Interrupts should be disabled (see enqueueRemoteFrame)
+
+uint32_t ACAN_T4::enqueueRemoteFrameFD (const CANFDMessage & inMessage) {
+  uint32_t sendStatus = checkFrameFD (inMessage) ;
+  if (sendStatus == 0) {
+    const uint32_t lastTxMBIndex = MBCount (mPayload) - 1 - mTimeTriggeredMailboxCount ; // Excluded
     bool sent = false ;
-    for (uint32_t txMBIndex = mRxCANFDMBCount + 1 ; (txMBIndex < (MBCount (mPayload) - 1)) && !sent ; txMBIndex++) {
+    for (uint32_t txMBIndex = mRxCANFDMBCount + 1 ; (txMBIndex < lastTxMBIndex) && !sent ; txMBIndex++) {
       volatile uint32_t * TxMailBoxAddress = mailboxAddress (mFlexcanBaseAddress, mPayload, txMBIndex) ;
       const uint32_t status = (TxMailBoxAddress [0] >> 24) & 0x0F ;
       switch (status) {
@@ -476,63 +621,51 @@ uint32_t ACAN_T4::tryToSendRemoteFrameFD (const CANFDMessage & inMessage) {
 //----------------------------------------------------------------------------------------
 
 uint32_t ACAN_T4::tryToSendDataFrameFD (const CANFDMessage & inMessage) {
-  uint32_t sendStatus = 0 ;
-  switch (mPayload) {
-  case ACAN_T4FD_Settings::PAYLOAD_8_BYTES : // 64 MB, table 44-40 page 2837
-    if (inMessage.len > 8) {
-      sendStatus = kMessageLengthExceedsPayload ;
-    }
-    break ;
-  case ACAN_T4FD_Settings::PAYLOAD_16_BYTES : // 42 MB, table 44-41 page 2839
-    if (inMessage.len > 16) {
-      sendStatus = kMessageLengthExceedsPayload ;
-    }
-    break ;
-  case ACAN_T4FD_Settings::PAYLOAD_32_BYTES : // 24 MB, table 44-42 page 2840
-    if (inMessage.len > 32) {
-      sendStatus = kMessageLengthExceedsPayload ;
-    }
-    break ;
-  case ACAN_T4FD_Settings::PAYLOAD_64_BYTES :  // 14 MB, table 44-43 page 2841
-    break ;
-  }
   noInterrupts () ;
-    if (sendStatus == 0) {
-      bool sent = false ;
-      const uint32_t TxMailboxIndex = MBCount (mPayload) - 1 ;
-      if (mTransmitBufferCount == 0) {
-        volatile uint32_t * TxMailBoxAddress = mailboxAddress (mFlexcanBaseAddress, mPayload, TxMailboxIndex) ;
-        const uint32_t code = (TxMailBoxAddress [0] >> 24) & 0x0F ;
-        if (code == FLEXCAN_MB_CODE_TX_INACTIVE) {
-          writeTxRegistersFD (inMessage, TxMailBoxAddress) ;
-          sent = true ;
-        }
+    const uint32_t sendStatus = enqueueDataFrameFD (inMessage, mTransmitFrameLifetime) ;
+  interrupts () ;
+  return sendStatus ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::enqueueDataFrameFD (const CANFDMessage & inMessage, const uint32_t inLifetime) {
+  uint32_t sendStatus = checkFrameFD (inMessage) ;
+  if (sendStatus == 0) {
+    bool sent = false ;
+    const uint32_t TxMailboxIndex = MBCount (mPayload) - 1 ;
+    if ((mTransmitBufferCount == 0) && (mTransmitMailboxHoldCount == 0)) { // Not while a time triggered window is pending
+      volatile uint32_t * TxMailBoxAddress = mailboxAddress (mFlexcanBaseAddress, mPayload, TxMailboxIndex) ;
+      const uint32_t code = (TxMailBoxAddress [0] >> 24) & 0x0F ;
+      if (code == FLEXCAN_MB_CODE_TX_INACTIVE) {
+        writeTxRegistersFD (inMessage, TxMailBoxAddress) ;
+        sent = true ;
       }
-    //--- If no mailboxes available, try to buffer it
-      if (!sent) {
-        sent = mTransmitBufferCount < mTransmitBufferSize ;
-        if (sent) {
-          uint32_t transmitBufferWriteIndex = mTransmitBufferReadIndex + mTransmitBufferCount ;
-          if (transmitBufferWriteIndex >= mTransmitBufferSize) {
-            transmitBufferWriteIndex -= mTransmitBufferSize ;
-          }
-          mTransmitBufferFD [transmitBufferWriteIndex] = inMessage ;
-          mTransmitBufferCount += 1 ;
-        //--- Update max count
-          if (mTransmitBufferPeakCount < mTransmitBufferCount) {
-            mTransmitBufferPeakCount = mTransmitBufferCount ;
-          }
-        }else{
-          mTransmitBufferPeakCount = mTransmitBufferSize + 1 ;
+    }
+  //--- If no mailboxes available, try to buffer it
+    if (!sent) {
+      sent = mTransmitBufferCount < mTransmitBufferSize ;
+      if (sent) {
+        uint32_t transmitBufferWriteIndex = mTransmitBufferReadIndex + mTransmitBufferCount ;
+        if (transmitBufferWriteIndex >= mTransmitBufferSize) {
+          transmitBufferWriteIndex -= mTransmitBufferSize ;
         }
-      }
-    //---
-      if (!sent) {
-        sendStatus = kTransmitBufferOverflow ;
+        mTransmitBufferFD [transmitBufferWriteIndex] = inMessage ;
+        storeTransmitDeadline (transmitBufferWriteIndex, inLifetime) ;
+        mTransmitBufferCount += 1 ;
+      //--- Update max count
+        if (mTransmitBufferPeakCount < mTransmitBufferCount) {
+          mTransmitBufferPeakCount = mTransmitBufferCount ;
+        }
+      }else{
+        mTransmitBufferPeakCount = mTransmitBufferSize + 1 ;
       }
     }
-  interrupts () ;
-//---
+  //---
+    if (!sent) {
+      sendStatus = kTransmitBufferOverflow ;
+    }
+  }
   return sendStatus ;
 }
 
@@ -596,13 +729,99 @@ void ACAN_T4::writeTxRegistersFD (const CANFDMessage & inMessage,
   mailBox0Address [0] = FLEXCAN_MB_CS_CODE (FLEXCAN_MB_CODE_TX_INACTIVE) ;
 }
 
+//----------------------------------------------------------------------------------------
+//   TIME TRIGGERED MAILBOXES (see ACAN_T4_TimeTriggered.h)
+//----------------------------------------------------------------------------------------
+
+// Slot 0 is the highest mailbox below the data frame Tx mailbox (in CAN 2.0B mode, the mailbox
+// layout is the 8 byte payload one, mPayload is not used).
+
+uint32_t ACAN_T4::timeTriggeredMailboxCapacityFD (void) const {
+  const uint32_t firstRemoteMailbox = mRxCANFDMBCount + 1 ;
+  const uint32_t txMailbox = MBCount (mPayload) - 1 ;
+  return (firstRemoteMailbox < txMailbox) ? (txMailbox - firstRemoteMailbox) : 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+volatile uint32_t * ACAN_T4::timeTriggeredMailboxAddress (const uint32_t inSlot) const {
+  const ACAN_T4FD_Settings::Payload payload = mCANFD ? mPayload : ACAN_T4FD_Settings::PAYLOAD_8_BYTES ;
+  return mailboxAddress (mFlexcanBaseAddress, payload, MBCount (payload) - 2 - inSlot) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::writeTimeTriggeredMailbox (const uint32_t inSlot, const CANFDMessage & inMessage) {
+  if (mCANFD) {
+    volatile uint32_t * address = timeTriggeredMailboxAddress (inSlot) ;
+    address [0] = FLEXCAN_MB_CS_CODE (FLEXCAN_MB_CODE_TX_INACTIVE) ;
+    writeTxRegistersFD (inMessage, address) ;
+  }else{
+    CANMessage message ;
+    message.id = inMessage.id ;
+    message.ext = inMessage.ext ;
+    message.rtr = inMessage.type == CANFDMessage::CAN_REMOTE ;
+    message.len = (inMessage.len > 8) ? 8 : inMessage.len ;
+    message.data64 = inMessage.data64 [0] ;
+    writeTxRegisters (message, MBCount (ACAN_T4FD_Settings::PAYLOAD_8_BYTES) - 2 - inSlot) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+bool ACAN_T4::timeTriggeredMailboxPending (const uint32_t inSlot) const {
+  return FLEXCAN_get_code (timeTriggeredMailboxAddress (inSlot) [0]) == FLEXCAN_MB_CODE_TX_ONCE ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::abortTimeTriggeredMailbox (const uint32_t inSlot) {
+  timeTriggeredMailboxAddress (inSlot) [0] = FLEXCAN_MB_CS_CODE (FLEXCAN_MB_CODE_TX_INACTIVE) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::holdTransmitMailbox (void) {
+  mTransmitMailboxHoldCount += 1 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+// When the last pending window is closed, the data frame Tx mailbox is idle (its interrupt has not
+// refilled it): the next frame of the transmit buffer is written here.
+
+void ACAN_T4::releaseTransmitMailbox (void) {
+  if (mTransmitMailboxHoldCount > 0) {
+    mTransmitMailboxHoldCount -= 1 ;
+    if (mTransmitMailboxHoldCount == 0) {
+      const ACAN_T4FD_Settings::Payload payload = mCANFD ? mPayload : ACAN_T4FD_Settings::PAYLOAD_8_BYTES ;
+      const uint32_t TxMailboxIndex = MBCount (payload) - 1 ;
+      volatile uint32_t * TxMailBoxAddress = mailboxAddress (mFlexcanBaseAddress, payload, TxMailboxIndex) ;
+      if (FLEXCAN_get_code (TxMailBoxAddress [0]) == FLEXCAN_MB_CODE_TX_INACTIVE) {
+        if (mTransmitDeadlines != nullptr) {
+          dropExpiredTransmitFrames () ;
+        }
+        if (mTransmitBufferCount > 0) {
+          if (mCANFD) {
+            writeTxRegistersFD (mTransmitBufferFD [mTransmitBufferReadIndex], TxMailBoxAddress) ;
+          }else{
+            writeTxRegisters (mTransmitBuffer [mTransmitBufferReadIndex], TxMailboxIndex) ;
+          }
+          mTransmitBufferReadIndex = (mTransmitBufferReadIndex + 1) % mTransmitBufferSize ;
+          mTransmitBufferCount -= 1 ;
+        }
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------------------
 //   MESSAGE INTERRUPT SERVICE ROUTINES
 //----------------------------------------------------------------------------------------
 
-void ACAN_T4::readRxRegistersFD (CANFDMessage & outMessage,
-                                 const uint32_t inReceiveMailboxIndex) {
-  volatile uint32_t * RxMailBoxAddress = mailboxAddress (mFlexcanBaseAddress, mPayload, inReceiveMailboxIndex) ;
+template <ACAN_T4_Module MODULE> void ACAN_T4::readRxRegistersFD (CANFDMessage & outMessage,
+                                                                  const uint32_t inReceiveMailboxIndex) {
+  volatile uint32_t * RxMailBoxAddress = mailboxAddress (flexcanBaseAddress (MODULE), mPayload, inReceiveMailboxIndex) ;
 //--- Wait while MB is busy
   uint32_t controlField = RxMailBoxAddress [0] ;
   while ((controlField & (1 << 24)) != 0) {
@@ -649,57 +868,138 @@ void ACAN_T4::readRxRegistersFD (CANFDMessage & outMessage,
 
 //----------------------------------------------------------------------------------------
 
-void ACAN_T4::message_isr_receiveFD (const uint32_t inReceiveMailboxIndex) {
+template <ACAN_T4_Module MODULE> void ACAN_T4::message_isr_receiveFD (const uint32_t inReceiveMailboxIndex) {
   CANFDMessage message ;
-  readRxRegistersFD (message, inReceiveMailboxIndex) ;
+  CANFDMessage * stagingEntry = (mStagingBufferFD != nullptr) ? stagingBufferFreeEntryFD () : nullptr ;
+  const bool direct = (mStagingBufferFD == nullptr) && (mISRCallBackFunctionArrayFD == nullptr) && directReceive () ;
+  CANFDMessage & destination = (stagingEntry != nullptr)
+    ? *stagingEntry
+    : (direct ? mReceiveBufferFD [receiveBufferFreeIndex ()] : message) ;
+  readRxRegistersFD <MODULE> (destination, inReceiveMailboxIndex) ;
+  if ((mTimeTriggeredSchedule != nullptr) && (destination.type != CANFDMessage::CAN_REMOTE)) {
+    timeTriggeredReceive (destination.id, destination.ext, destination.data [0]) ;
+  }
+  if (mStagingBufferFD != nullptr) {
+    commitStagedFrame (stagingEntry != nullptr) ;
+  }else if (direct) {
+    commitReceiveBufferEntry () ;
+  }else{
+    processReceivedFrameFD (message) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void ACAN_T4::processReceivedFrameFD (const CANFDMessage & inMessage) {
+//--- Interrupt call back: the frame is handled here, neither routed nor stored
+  const ACANFDCallBackRoutine isrCallBack =
+    ((mISRCallBackFunctionArrayFD != nullptr) && (inMessage.idx < mRxCANFDMBCount))
+      ? mISRCallBackFunctionArrayFD [inMessage.idx]
+      : nullptr ;
+  if (nullptr != isrCallBack) {
+    isrCallBack (inMessage) ;
+  }
+  if (nullptr != mTraceRecorder) {
+    mTraceRecorder->recordFD (inMessage, uint8_t (mModule), micros ()) ;
+  }
+  const bool store = (nullptr == isrCallBack)
+    && ((mRouteCount == 0) || routeFrameFD (inMessage))
+    && ((mLatestValueSlotCount == 0) || !storeLatestValueFD (inMessage)) ;
+  ACAN_T4_ChangeFilter * changeFilter = (store && (mChangeFilterCount > 0))
+    ? findChangeFilter (inMessage.id, inMessage.ext, inMessage.type == CANFDMessage::CAN_REMOTE)
+    : nullptr ;
+  const uint32_t date = (changeFilter == nullptr) ? 0 : millis () ;
+  if (!store) {
+  //--- Frame handled by an interrupt call back, routed frame, or frame stored in a latest value slot
+  }else if ((changeFilter != nullptr) && !changeFilter->changedFD (inMessage, date)) {
+  //--- Unchanged payload, suppressed
+  }else{
+    ACAN_T4_ReceiveQueue * queue = (inMessage.idx < mReceiveQueueCount) ? mReceiveQueues [inMessage.idx] : nullptr ;
+    const bool stored = (queue == nullptr) ? appendToReceiveBufferFD (inMessage) : queue->appendFD (inMessage) ;
+    if (stored && (changeFilter != nullptr)) {
+      changeFilter->storedFD (inMessage, date) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+bool ACAN_T4::appendToReceiveBufferFD (const CANFDMessage & inMessage) {
   if (mReceiveBufferCount == mReceiveBufferSize) { // Overflow! Receive buffer is full
     mReceiveBufferPeakCount = mReceiveBufferSize + 1 ; // Mark overflow
+    mReceiveBufferOverflowCount += 1 ;
     mGlobalStatus |= kGlobalStatusReceiveBufferOverflow ;
-  }else{
-    uint32_t receiveBufferWriteIndex = mReceiveBufferReadIndex + mReceiveBufferCount ;
-    if (receiveBufferWriteIndex >= mReceiveBufferSize) {
-      receiveBufferWriteIndex -= mReceiveBufferSize ;
-    }
-    mReceiveBufferFD [receiveBufferWriteIndex] = message ;
-    mReceiveBufferCount += 1 ;
-    if (mReceiveBufferCount > mReceiveBufferPeakCount) {
-      mReceiveBufferPeakCount = mReceiveBufferCount ;
-    }
   }
+  const bool stored = acanT4AppendToReceiveRing (mReceiveBufferFD, mReceiveBufferSize, mReceiveBufferReadIndex,
+                                                 mReceiveBufferCount, mReceiveOverflowPolicy, inMessage) ;
+  if (mReceiveBufferCount > mReceiveBufferPeakCount) {
+    mReceiveBufferPeakCount = mReceiveBufferCount ;
+  }
+  return stored ;
 }
 
 //----------------------------------------------------------------------------------------
 
-void ACAN_T4::message_isr_FD (void) {
-  uint64_t status = FLEXCAN_IFLAG2 (mFlexcanBaseAddress) ;
+template <ACAN_T4_Module MODULE> void ACAN_T4::isrFD (void) {
+  uint32_t transmitCount ;
+  driver <MODULE> ().template message_isr_FD <MODULE> (transmitCount) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+template <ACAN_T4_Module MODULE> uint32_t ACAN_T4::message_isr_FD (uint32_t & outTransmitCount) {
+  constexpr uint32_t base = flexcanBaseAddress (MODULE) ;
+  uint32_t receiveCount = 0 ;
+  outTransmitCount = 0 ;
+  uint64_t status = FLEXCAN_IFLAG2 (base) ;
   status <<= 32 ;
-  status |= FLEXCAN_IFLAG1 (mFlexcanBaseAddress) ;
-//--- Frames have been received in Rx mailboxes ?
-  uint32_t receiveStatus = status & ((ONE << mRxCANFDMBCount) - ONE) ;
+  status |= FLEXCAN_IFLAG1 (base) ;
+//--- Frames have been received in Rx mailboxes ? (Rx mailboxes are #1 ... #mRxCANFDMBCount)
+  uint64_t receiveStatus = status & (((ONE << mRxCANFDMBCount) - ONE) << 1) ;
   while (receiveStatus != 0) {
-    const uint32_t receiveMailboxIndex = uint32_t (__builtin_ctz (receiveStatus)) ;
-    receiveStatus &= ~ (1 << receiveMailboxIndex) ;
-    message_isr_receiveFD (receiveMailboxIndex) ;
+    const uint32_t receiveMailboxIndex = uint32_t (__builtin_ctzll (receiveStatus)) ;
+    receiveStatus &= ~ (ONE << receiveMailboxIndex) ;
+    message_isr_receiveFD <MODULE> (receiveMailboxIndex) ;
+    receiveCount += 1 ;
   }
 //--- Tx Mailbox becomes free ?
   const uint32_t TxMailboxIndex = MBCount (mPayload) - 1 ;
   if ((status & (ONE << TxMailboxIndex)) != 0) {
-    volatile uint32_t * TxMailBoxAddress = mailboxAddress (mFlexcanBaseAddress, mPayload, TxMailboxIndex) ;
-    if (mTransmitBufferCount == 0) {
-      TxMailBoxAddress [0] = FLEXCAN_MB_CS_CODE (FLEXCAN_MB_CODE_TX_INACTIVE) ; // Inactive MB
-    }else{ // There is a frame in the queue to send
-      writeTxRegistersFD (mTransmitBufferFD [mTransmitBufferReadIndex], TxMailBoxAddress);
-      mTransmitBufferReadIndex = (mTransmitBufferReadIndex + 1) % mTransmitBufferSize ;
-      mTransmitBufferCount -= 1 ;
-    }
+    volatile uint32_t * TxMailBoxAddress = mailboxAddress (base, mPayload, TxMailboxIndex) ;
+  //--- Critical section: the transmit buffer and the Tx mailbox are also handled by tryToSendFD,
+  //    that may be called from a higher priority interrupt (route from an other controller, scheduler)
+    noInterrupts () ;
+      if (FLEXCAN_get_code (TxMailBoxAddress [0]) == FLEXCAN_MB_CODE_TX_ONCE) {
+      //--- A frame has been written since the interrupt was raised (call back, route): it is being sent
+      }else{
+        if (mTransmitDeadlines != nullptr) {
+          dropExpiredTransmitFrames () ;
+        }
+        if ((mTransmitBufferCount == 0) || (mTransmitMailboxHoldCount > 0)) { // Held: see releaseTransmitMailbox
+          TxMailBoxAddress [0] = FLEXCAN_MB_CS_CODE (FLEXCAN_MB_CODE_TX_INACTIVE) ; // Inactive MB
+        }else{ // There is a frame in the queue to send
+          writeTxRegistersFD (mTransmitBufferFD [mTransmitBufferReadIndex], TxMailBoxAddress);
+          mTransmitBufferReadIndex = (mTransmitBufferReadIndex + 1) % mTransmitBufferSize ;
+          mTransmitBufferCount -= 1 ;
+          outTransmitCount = 1 ;
+        }
+      }
+    interrupts () ;
   }
 //--- Writing its value back to itself clears all flags
-  FLEXCAN_IFLAG1 (mFlexcanBaseAddress) = uint32_t (status) ;
-  FLEXCAN_IFLAG2 (mFlexcanBaseAddress) = uint32_t (status >> 32) ;
+  FLEXCAN_IFLAG1 (base) = uint32_t (status) ;
+  FLEXCAN_IFLAG2 (base) = uint32_t (status >> 32) ;
 //--- Read the Free Running Timer (recommended, see page 2704)
-  const uint32_t unused __attribute__((unused)) = FLEXCAN_TIMER (mFlexcanBaseAddress) ;
+  const uint32_t unused __attribute__((unused)) = FLEXCAN_TIMER (base) ;
+  return receiveCount ;
 }
 
+//----------------------------------------------------------------------------------------
+// Only FlexCAN3 supports CANFD; instances used by ACAN_T4::message_isr and ACAN_T4::poll
+
+template void ACAN_T4::isrFD <ACAN_T4_Module::CAN3> (void) ;
+template uint32_t ACAN_T4::message_isr_FD <ACAN_T4_Module::CAN3> (uint32_t & outTransmitCount) ;
+
 //----------------------------------------------------------------------------------------
 //    CANFD Filter (format A)
 //----------------------------------------------------------------------------------------
@@ -735,20 +1035,24 @@ static uint32_t computeAcceptanceMask (const tFrameKind inKind,
 
 //----------------------------------------------------------------------------------------
 
-ACANFDFilter::ACANFDFilter (const ACANFDCallBackRoutine inCallBackRoutine) :
+ACANFDFilter::ACANFDFilter (const ACANFDCallBackRoutine inCallBackRoutine,
+                            const bool inCallBackInISR) :
 mFilterMask (0),
 mAcceptanceMask (0),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
 
 ACANFDFilter::ACANFDFilter (const tFrameKind inKind,
                             const tFrameFormat inFormat,
-                            const ACANFDCallBackRoutine inCallBackRoutine) :
+                            const ACANFDCallBackRoutine inCallBackRoutine,
+                            const bool inCallBackInISR) :
 mFilterMask (computeFilterMask (inFormat, 0)),
 mAcceptanceMask (computeAcceptanceMask (inKind, inFormat, 0)),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
@@ -756,10 +1060,12 @@ mCallBackRoutine (inCallBackRoutine) {
 ACANFDFilter::ACANFDFilter (const tFrameKind inKind,
                             const tFrameFormat inFormat,
                             const uint32_t inIdentifier,
-                            const ACANFDCallBackRoutine inCallBackRoutine) :
+                            const ACANFDCallBackRoutine inCallBackRoutine,
+                            const bool inCallBackInISR) :
 mFilterMask (computeFilterMask (inFormat, defaultMask (inFormat))),
 mAcceptanceMask (computeAcceptanceMask (inKind, inFormat, inIdentifier)),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
@@ -768,10 +1074,12 @@ ACANFDFilter::ACANFDFilter (const tFrameKind inKind,
                             const tFrameFormat inFormat,
                             const uint32_t inMask,
                             const uint32_t inAcceptance,
-                            const ACANFDCallBackRoutine inCallBackRoutine) :
+                            const ACANFDCallBackRoutine inCallBackRoutine,
+                            const bool inCallBackInISR) :
 mFilterMask (computeFilterMask (inFormat, inMask)),
 mAcceptanceMask (computeAcceptanceMask (inKind, inFormat, inAcceptance)),
-mCallBackRoutine (inCallBackRoutine) {
+mCallBackRoutine (inCallBackRoutine),
+mCallBackInISR (inCallBackInISR) {
 }
 
 //----------------------------------------------------------------------------------------
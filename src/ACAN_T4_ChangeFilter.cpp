@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: change filters
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+// Mask of the significant bytes of a data64 word, inRemaining bytes from its start (data64 is
+// little endian): bytes beyond the frame length are not compared.
+
+static inline uint64_t lengthMask (const uint32_t inRemaining) {
+  return (inRemaining >= 8) ? ~ uint64_t (0) : ((uint64_t (1) << (inRemaining * 8)) - 1) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    CHANGE FILTER
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_ChangeFilter::ACAN_T4_ChangeFilter (const tFrameFormat inFormat,
+                                            const uint32_t inIdentifier,
+                                            const uint32_t inHeartbeat,
+                                            const uint64_t inMask) :
+mIdentifier (inIdentifier & ((inFormat == kExtended) ? 0x1FFFFFFF : 0x7FF)),
+mFormat (inFormat),
+mHeartbeat (inHeartbeat),
+mMask (inMask),
+mLastData64 () {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ChangeFilter::changed (const CANMessage & inMessage, const uint32_t inDate) {
+  const bool isChanged = !mHasLast
+    || (inMessage.len != mLastLength)
+    || (((inMessage.data64 ^ mLastData64 [0]) & mMask & lengthMask (inMessage.len)) != 0)
+    || ((mHeartbeat > 0) && ((inDate - mLastDate) >= mHeartbeat))
+  ;
+  if (!isChanged) {
+    mSuppressedCount += 1 ;
+  }
+  return isChanged ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ChangeFilter::changedFD (const CANFDMessage & inMessage, const uint32_t inDate) {
+  bool isChanged = !mHasLast
+    || (inMessage.len != mLastLength)
+    || (((inMessage.data64 [0] ^ mLastData64 [0]) & mMask & lengthMask (inMessage.len)) != 0)
+    || ((mHeartbeat > 0) && ((inDate - mLastDate) >= mHeartbeat))
+  ;
+//--- Bytes 8 ... len-1 (bytes after len are not significant)
+  for (uint32_t i=8 ; (i<inMessage.len) && !isChanged ; i += 8) {
+    isChanged = ((inMessage.data64 [i / 8] ^ mLastData64 [i / 8]) & lengthMask (inMessage.len - i)) != 0 ;
+  }
+  if (!isChanged) {
+    mSuppressedCount += 1 ;
+  }
+  return isChanged ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ChangeFilter::stored (const CANMessage & inMessage, const uint32_t inDate) {
+  mLastData64 [0] = inMessage.data64 ;
+  mLastLength = inMessage.len ;
+  mLastDate = inDate ;
+  mHasLast = true ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ChangeFilter::storedFD (const CANFDMessage & inMessage, const uint32_t inDate) {
+  for (uint32_t i=0 ; i<inMessage.len ; i += 8) {
+    mLastData64 [i / 8] = inMessage.data64 [i / 8] ;
+  }
+  mLastLength = inMessage.len ;
+  mLastDate = inDate ;
+  mHasLast = true ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    CHANGE FILTER TABLE
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::setChangeFilters (ACAN_T4_ChangeFilter inFilters [], const uint32_t inFilterCount) {
+  noInterrupts () ;
+    mChangeFilters = inFilters ;
+    mChangeFilterCount = (inFilters == nullptr) ? 0 : inFilterCount ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    LOOKUP (called by the receive interrupt service routine)
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_ChangeFilter * ACAN_T4::findChangeFilter (const uint32_t inIdentifier,
+                                                  const bool inExtended,
+                                                  const bool inRemote) const {
+  ACAN_T4_ChangeFilter * result = nullptr ;
+  if (!inRemote) {
+    for (uint32_t i=0 ; (i<mChangeFilterCount) && (result == nullptr) ; i++) {
+      if (mChangeFilters [i].matches (inIdentifier, inExtended)) {
+        result = & mChangeFilters [i] ;
+      }
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
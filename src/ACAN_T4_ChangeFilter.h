@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Change filter: a received data frame whose identifier matches a change filter is stored in the
+// driver receive buffer only if its payload differs from the last stored one, or if the heartbeat
+// interval has elapsed since the last stored one (see ACAN_T4::setChangeFilters). Other frames are
+// suppressed by the receive interrupt service routine, and counted.
+// Payloads are compared on the frame length, and:
+//   - for bytes 0 ... 7, on the bits set in mMask;
+//   - for bytes 8 ... 63 (CANFD frames), on every bit.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_ChangeFilter {
+
+//--- Constructor
+  public: ACAN_T4_ChangeFilter (const tFrameFormat inFormat,
+                                const uint32_t inIdentifier,
+                                const uint32_t inHeartbeat = 0, // In ms, 0: no heartbeat
+                                const uint64_t inMask = ~ uint64_t (0)) ; // Applied on data64 (bytes 0 ... 7)
+
+//--- Settings
+  public: const uint32_t mIdentifier ;
+  public: const tFrameFormat mFormat ;
+  public: uint32_t mHeartbeat ;
+  public: uint64_t mMask ;
+
+//--- Number of suppressed frames
+  public: inline uint32_t suppressedCount (void) const { return mSuppressedCount ; }
+  public: inline void resetSuppressedCount (void) { mSuppressedCount = 0 ; }
+
+//--- Methods called by the receive interrupt service routine
+  public: inline bool matches (const uint32_t inIdentifier, const bool inExtended) const {
+    return (inIdentifier == mIdentifier) && ((mFormat == kExtended) == inExtended) ;
+  }
+  public: bool changed (const CANMessage & inMessage, const uint32_t inDate) ;
+  public: bool changedFD (const CANFDMessage & inMessage, const uint32_t inDate) ;
+  public: void stored (const CANMessage & inMessage, const uint32_t inDate) ;
+  public: void storedFD (const CANFDMessage & inMessage, const uint32_t inDate) ;
+
+//--- Properties
+  private: uint64_t mLastData64 [8] ;
+  private: uint32_t mLastDate = 0 ; // In ms
+  private: volatile uint32_t mSuppressedCount = 0 ;
+  private: uint8_t mLastLength = 0 ;
+  private: bool mHasLast = false ;
+
+//--- No copy
+  private : ACAN_T4_ChangeFilter (const ACAN_T4_ChangeFilter &) = delete ;
+  private : ACAN_T4_ChangeFilter & operator = (const ACAN_T4_ChangeFilter &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
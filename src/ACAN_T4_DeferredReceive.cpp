@@ -0,0 +1,182 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: interrupt priorities and deferred receive processing
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// With deferred receive processing, the work is split between two interrupts:
+//   - the CAN interrupt (top half) reads received frames from the FlexCAN module into the staging
+//     buffer, refills the transmit mailbox, updates the status flags, and pends the software
+//     interrupt;
+//   - the software interrupt (bottom half), of lower priority, processes the staged frames:
+//     interrupt call backs, trace recording, routing, latest value slots, change filters, receive
+//     queues and receive buffer.
+// The staging buffer is a single producer (CAN interrupt), single consumer (software interrupt)
+// ring: each index is written by one side only, so no critical section is required.
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+//   SOFTWARE INTERRUPTS
+//--------------------------------------------------------------------------------------------------
+// i.MX RT1062 interrupt vectors 62, 71 and 155 are reserved, they are not connected to any
+// peripheral: they are used as software interrupts (vector 70, IRQ_SOFTWARE, is used by the
+// Teensy Audio library).
+
+static const uint32_t SOFTWARE_IRQ_CAN1 = 62 ;
+
+static const uint32_t SOFTWARE_IRQ_CAN2 = 71 ;
+
+static const uint32_t SOFTWARE_IRQ_CAN3 = 155 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t softwareIRQ (const ACAN_T4_Module inModule) {
+  uint32_t irq = SOFTWARE_IRQ_CAN1 ;
+  switch (inModule) {
+  case ACAN_T4_Module::CAN1 : irq = SOFTWARE_IRQ_CAN1 ; break ;
+  case ACAN_T4_Module::CAN2 : irq = SOFTWARE_IRQ_CAN2 ; break ;
+  case ACAN_T4_Module::CAN3 : irq = SOFTWARE_IRQ_CAN3 ; break ;
+  }
+  return irq ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void flexcan_deferred_isr_can1 (void) {
+  ACAN_T4::can1.message_deferred_isr () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void flexcan_deferred_isr_can2 (void) {
+  ACAN_T4::can2.message_deferred_isr () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void flexcan_deferred_isr_can3 (void) {
+  ACAN_T4::can3.message_deferred_isr () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   SETUP (called by begin and beginFD, before enabling the CAN interrupt)
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::setupInterrupts (const uint8_t inInterruptPriority,
+                               const bool inDeferredReceiveProcessing,
+                               const uint8_t inDeferredInterruptPriority,
+                               const uint16_t inStagingBufferSize,
+                               CANMessage * inStagingBufferStorage,
+                               CANFDMessage * inStagingBufferStorageFD) {
+  endDeferredReceiveProcessing () ;
+//--- CAN interrupt priority
+  switch (mModule) {
+  case ACAN_T4_Module::CAN1 : NVIC_SET_PRIORITY (IRQ_CAN1, inInterruptPriority) ; break ;
+  case ACAN_T4_Module::CAN2 : NVIC_SET_PRIORITY (IRQ_CAN2, inInterruptPriority) ; break ;
+  case ACAN_T4_Module::CAN3 : NVIC_SET_PRIORITY (IRQ_CAN3, inInterruptPriority) ; break ;
+  }
+//--- Deferred receive processing
+  if (inDeferredReceiveProcessing && (inStagingBufferSize > 0)) {
+    mStagingBufferSize = inStagingBufferSize ;
+    if (mCANFD) {
+      mOwnsStagingBuffer = inStagingBufferStorageFD == nullptr ;
+      mStagingBufferFD = mOwnsStagingBuffer
+        ? new CANFDMessage [inStagingBufferSize + 1]
+        : inStagingBufferStorageFD ;
+    }else{
+      mOwnsStagingBuffer = inStagingBufferStorage == nullptr ;
+      mStagingBuffer = mOwnsStagingBuffer
+        ? new CANMessage [inStagingBufferSize + 1]
+        : inStagingBufferStorage ;
+    }
+    const uint32_t irq = softwareIRQ (mModule) ;
+    switch (mModule) {
+    case ACAN_T4_Module::CAN1 : _VectorsRam [16 + irq] = flexcan_deferred_isr_can1 ; break ;
+    case ACAN_T4_Module::CAN2 : _VectorsRam [16 + irq] = flexcan_deferred_isr_can2 ; break ;
+    case ACAN_T4_Module::CAN3 : _VectorsRam [16 + irq] = flexcan_deferred_isr_can3 ; break ;
+    }
+    NVIC_SET_PRIORITY (irq, inDeferredInterruptPriority) ;
+    NVIC_ENABLE_IRQ (irq) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//   END (the CAN interrupt is disabled)
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::endDeferredReceiveProcessing (void) {
+  if (mStagingBufferSize > 0) {
+    NVIC_DISABLE_IRQ (softwareIRQ (mModule)) ;
+  }
+  if (mOwnsStagingBuffer) {
+    delete [] mStagingBuffer ;
+    delete [] mStagingBufferFD ;
+  }
+  mStagingBuffer = nullptr ;
+  mStagingBufferFD = nullptr ;
+  mOwnsStagingBuffer = false ;
+  mStagingBufferSize = 0 ;
+  mStagingBufferReadIndex = 0 ;
+  mStagingBufferWriteIndex = 0 ;
+  mStagingBufferOverflowCount = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   TOP HALF (called by the CAN interrupt service routine)
+//--------------------------------------------------------------------------------------------------
+
+// The received frame is read from the FlexCAN registers directly into the free entry of the
+// staging buffer, then commitStagedFrame makes it available to the software interrupt.
+
+static inline uint32_t nextStagingIndex (const uint32_t inIndex, const uint32_t inStagingBufferSize) {
+  return (inIndex == inStagingBufferSize) ? 0 : (inIndex + 1) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+CANMessage * ACAN_T4::stagingBufferFreeEntry (void) {
+  const uint32_t writeIndex = mStagingBufferWriteIndex ;
+  const bool full = nextStagingIndex (writeIndex, mStagingBufferSize) == mStagingBufferReadIndex ;
+  return full ? nullptr : & mStagingBuffer [writeIndex] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+CANFDMessage * ACAN_T4::stagingBufferFreeEntryFD (void) {
+  const uint32_t writeIndex = mStagingBufferWriteIndex ;
+  const bool full = nextStagingIndex (writeIndex, mStagingBufferSize) == mStagingBufferReadIndex ;
+  return full ? nullptr : & mStagingBufferFD [writeIndex] ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::commitStagedFrame (const bool inStored) {
+  if (inStored) {
+    mStagingBufferWriteIndex = nextStagingIndex (mStagingBufferWriteIndex, mStagingBufferSize) ;
+  }else{ // Staging buffer is full, frame is lost
+    mStagingBufferOverflowCount += 1 ;
+    mGlobalStatus |= kGlobalStatusStagingBufferOverflow ;
+  }
+  NVIC_SET_PENDING (softwareIRQ (mModule)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   BOTTOM HALF (software interrupt service routine)
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::message_deferred_isr (void) {
+  uint32_t readIndex = mStagingBufferReadIndex ;
+  while (readIndex != mStagingBufferWriteIndex) {
+    if (mStagingBufferFD != nullptr) {
+      processReceivedFrameFD (mStagingBufferFD [readIndex]) ;
+    }else if (mStagingBuffer != nullptr) {
+      processReceivedFrame (mStagingBuffer [readIndex]) ;
+    }
+    readIndex = (readIndex == mStagingBufferSize) ? 0 : (readIndex + 1) ;
+    mStagingBufferReadIndex = readIndex ; // Frees the entry
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_FrameAggregator.h>
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+//    AGGREGATOR
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_FrameAggregator::ACAN_T4_FrameAggregator (const uint32_t inIdentifier,
+                                                  const bool inExtended) :
+mContainer () {
+  mContainer.id = inIdentifier & (inExtended ? 0x1FFFFFFF : 0x7FF) ;
+  mContainer.ext = inExtended ;
+  clear () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_FrameAggregator::clear (void) {
+  mContainer.len = 1 ; // Entry count
+  mContainer.data [0] = 0 ;
+  mEntryCount = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_FrameAggregator::append (const CANMessage & inMessage) {
+  const uint32_t length = (inMessage.len <= 8) ? inMessage.len : 8 ;
+  const uint32_t headerSize = inMessage.ext ? 5 : 2 ;
+  const bool ok = !inMessage.rtr && ((usedBytes () + headerSize + length) <= 64) ;
+  if (ok) {
+    uint8_t * entry = mContainer.data + mContainer.len ;
+    if (inMessage.ext) {
+      entry [0] = uint8_t (0x80 | (length << 3)) ;
+      entry [1] = uint8_t ((inMessage.id >> 24) & 0x1F) ;
+      entry [2] = uint8_t (inMessage.id >> 16) ;
+      entry [3] = uint8_t (inMessage.id >> 8) ;
+      entry [4] = uint8_t (inMessage.id) ;
+    }else{
+      const uint32_t header = (length << 11) | (inMessage.id & 0x7FF) ;
+      entry [0] = uint8_t (header >> 8) ;
+      entry [1] = uint8_t (header) ;
+    }
+    for (uint32_t i=0 ; i<length ; i++) {
+      entry [headerSize + i] = inMessage.data [i] ;
+    }
+    mContainer.len = uint8_t (mContainer.len + headerSize + length) ;
+    if (mEntryCount == 0) {
+      mFirstFrameDate = micros () ;
+    }
+    mEntryCount += 1 ;
+    mContainer.data [0] = uint8_t (mEntryCount) ;
+    mAggregatedFrameCount += 1 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_FrameAggregator::flushRequired (void) const {
+  return (mEntryCount > 0) && (
+    ((usedBytes () + ACAN_T4_CONTAINER_MAX_ENTRY_SIZE) > 64)
+  ||
+    (usedBytes () >= mFillLevel)
+  ||
+    ((micros () - mFirstFrameDate) >= mMaxDelay)
+  ) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_FrameAggregator::tryToFlush (ACAN_T4 & inDriver) {
+  bool sent = mEntryCount > 0 ;
+  if (sent) {
+    const uint8_t usedLength = mContainer.len ;
+    mContainer.type = mContainerType ;
+    mContainer.pad () ;
+    sent = inDriver.tryToSendFD (mContainer) ;
+    if (sent) {
+      mContainerCount += 1 ;
+      clear () ;
+    }else{ // Not sent, keep container
+      mContainer.len = usedLength ;
+    }
+  }
+  return sent ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_FrameAggregator::gateway (ACAN_T4 & inSource, ACAN_T4 & inDestination) {
+//--- Send pending container
+  bool ok = !flushRequired () || tryToFlush (inDestination) ;
+//--- Aggregate received frames: as container is not full, an entry of maximum size always fits
+  CANMessage message ;
+  while (ok && inSource.receive (message)) {
+    if (message.rtr) { // Remote frame, sent as an individual frame
+      if (!inDestination.tryToSendFD (CANFDMessage (message))) {
+        mDroppedFrameCount += 1 ;
+      }
+    }else{
+      append (message) ;
+      ok = !flushRequired () || tryToFlush (inDestination) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    UNPACKER
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_FrameUnpacker::ACAN_T4_FrameUnpacker (const CANFDMessage & inContainer) :
+mContainer (inContainer),
+mRemainingEntryCount ((inContainer.len > 0) ? inContainer.data [0] : 0),
+mMalformed (inContainer.len == 0) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_FrameUnpacker::next (CANMessage & outMessage) {
+  bool ok = (mRemainingEntryCount > 0) && !mMalformed ;
+  if (ok) {
+    const uint32_t containerLength = (mContainer.len <= 64) ? mContainer.len : 64 ;
+    const uint8_t * entry = mContainer.data + mReadOffset ;
+    const bool extended = (mReadOffset < containerLength) && ((entry [0] & 0x80) != 0) ;
+    const uint32_t headerSize = extended ? 5 : 2 ;
+    const uint32_t length = (mReadOffset < containerLength) ? ((entry [0] >> 3) & 0x0F) : 0 ;
+    ok = (mReadOffset < containerLength) && (length <= 8)
+      && ((mReadOffset + headerSize + length) <= containerLength) ;
+    if (ok) {
+      outMessage.ext = extended ;
+      outMessage.rtr = false ;
+      outMessage.idx = 0 ;
+      outMessage.len = uint8_t (length) ;
+      if (extended) {
+        outMessage.id =
+          (uint32_t (entry [1] & 0x1F) << 24) | (uint32_t (entry [2]) << 16) | (uint32_t (entry [3]) << 8) | entry [4]
+        ;
+      }else{
+        outMessage.id = ((uint32_t (entry [0]) << 8) | entry [1]) & 0x7FF ;
+      }
+      outMessage.data64 = 0 ;
+      for (uint32_t i=0 ; i<length ; i++) {
+        outMessage.data [i] = entry [headerSize + i] ;
+      }
+      mReadOffset += headerSize + length ;
+      mRemainingEntryCount -= 1 ;
+    }else{
+      mMalformed = true ;
+    }
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
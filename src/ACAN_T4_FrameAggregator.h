@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Frame aggregation: several CAN 2.0B data frames are packed into one CANFD frame (a container),
+// so that a CAN 2.0B bus bridged onto a CANFD backbone does not cost one CANFD frame per frame.
+// ACAN_T4_FrameAggregator packs frames, ACAN_T4_FrameUnpacker restores them on the far side.
+//
+// Container format (CANFD frame data, multi-byte fields are big endian):
+//   byte 0: entry count;
+//   then, for each entry:
+//     - standard frame: 2 bytes, bit 15 = 0, bits 14-11 = length (0 ... 8), bits 10-0 = identifier;
+//     - extended frame: 1 byte, bit 7 = 1, bits 6-3 = length (0 ... 8), bits 2-0 = 0, followed by
+//       4 bytes, bits 28-0 = identifier;
+//     - length data bytes.
+//   Container length is padded to a valid CANFD length with zero bytes.
+// Remote frames are not aggregated.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t ACAN_T4_CONTAINER_MAX_ENTRY_SIZE = 5 + 8 ; // Extended frame, 8 data bytes
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_FrameAggregator {
+
+//--- Constructor: inIdentifier and inExtended define the container identifier
+  public: ACAN_T4_FrameAggregator (const uint32_t inIdentifier,
+                                   const bool inExtended = false) ;
+
+//--- Settings
+//    A container is flushed when an other entry of maximum size would not fit, when it contains
+//    mFillLevel bytes or more, or when its first frame has been waiting for mMaxDelay µs
+  public: uint32_t mFillLevel = 64 ;
+  public: uint32_t mMaxDelay = 1000 ; // In µs
+  public: CANFDMessage::Type mContainerType = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+
+//--- Append a frame; returns false if inMessage is a remote frame, or if it does not fit
+//    (flush the container first)
+  public: bool append (const CANMessage & inMessage) ;
+
+//--- Flush
+  public: bool flushRequired (void) const ;
+  public: inline bool isEmpty (void) const { return mEntryCount == 0 ; }
+  public: inline uint32_t entryCount (void) const { return mEntryCount ; }
+
+//--- Send the container with inDriver (CANFD mode); returns false if the container is empty, or
+//    if inDriver cannot send it now (the container is kept)
+  public: bool tryToFlush (ACAN_T4 & inDriver) ;
+
+//--- Gateway (call from loop): moves frames received by inSource into containers, sends them with
+//    inDestination. Remote frames are sent as individual frames (the driver sends remote frames
+//    from dedicated mailboxes, so they can overtake containers); a remote frame that cannot be
+//    sent is dropped.
+  public: void gateway (ACAN_T4 & inSource, ACAN_T4 & inDestination) ;
+
+//--- Statistics
+  public: inline uint32_t aggregatedFrameCount (void) const { return mAggregatedFrameCount ; }
+  public: inline uint32_t containerCount (void) const { return mContainerCount ; }
+  public: inline uint32_t droppedFrameCount (void) const { return mDroppedFrameCount ; }
+
+//--- Private methods
+  private: void clear (void) ;
+  private: inline uint32_t usedBytes (void) const { return mContainer.len ; }
+
+//--- Properties
+  private: CANFDMessage mContainer ; // mContainer.len is the number of used bytes
+  private: uint32_t mEntryCount = 0 ;
+  private: uint32_t mFirstFrameDate = 0 ;
+  private: uint32_t mAggregatedFrameCount = 0 ;
+  private: uint32_t mContainerCount = 0 ;
+  private: uint32_t mDroppedFrameCount = 0 ;
+
+//--- No copy
+  private : ACAN_T4_FrameAggregator (const ACAN_T4_FrameAggregator &) = delete ;
+  private : ACAN_T4_FrameAggregator & operator = (const ACAN_T4_FrameAggregator &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_FrameUnpacker {
+
+//--- Constructor: inContainer should remain valid while unpacking
+  public: ACAN_T4_FrameUnpacker (const CANFDMessage & inContainer) ;
+
+//--- Get next frame; returns false when all entries have been read, or if the container is malformed
+  public: bool next (CANMessage & outMessage) ;
+
+//--- Returns true if the container is malformed (valid once next has returned false)
+  public: inline bool isMalformed (void) const { return mMalformed ; }
+
+//--- Properties
+  private: const CANFDMessage & mContainer ;
+  private: uint32_t mReadOffset = 1 ;
+  private: uint32_t mRemainingEntryCount ;
+  private: bool mMalformed = false ;
+
+//--- No copy
+  private : ACAN_T4_FrameUnpacker (const ACAN_T4_FrameUnpacker &) = delete ;
+  private : ACAN_T4_FrameUnpacker & operator = (const ACAN_T4_FrameUnpacker &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
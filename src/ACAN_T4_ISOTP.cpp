@@ -0,0 +1,477 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_ISOTP.h>
+
+//--------------------------------------------------------------------------------------------------
+//    PROTOCOL CONTROL INFORMATION (ISO 15765-2)
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t PCI_SINGLE_FRAME      = 0x00 ;
+static const uint8_t PCI_FIRST_FRAME       = 0x10 ;
+static const uint8_t PCI_CONSECUTIVE_FRAME = 0x20 ;
+static const uint8_t PCI_FLOW_CONTROL      = 0x30 ;
+
+static const uint8_t FLOW_STATUS_CONTINUE_TO_SEND = 0 ;
+static const uint8_t FLOW_STATUS_WAIT             = 1 ;
+static const uint8_t FLOW_STATUS_OVERFLOW         = 2 ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t separationTime (const uint8_t inSTmin) { // In µs
+  uint32_t result = 127 * 1000 ; // Reserved values: maximum separation time
+  if (inSTmin <= 0x7F) {
+    result = inSTmin * 1000 ;
+  }else if ((inSTmin >= 0xF1) && (inSTmin <= 0xF9)) {
+    result = (inSTmin - 0xF0) * 100 ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t validCANFDLength (const uint32_t inLength) {
+  uint32_t result = inLength ;
+  if (inLength > 48) {
+    result = 64 ;
+  }else if (inLength > 32) {
+    result = 48 ;
+  }else if (inLength > 24) {
+    result = 32 ;
+  }else if (inLength > 8) {
+    result = (inLength + 3) & ~ 3U ; // 12, 16, 20, 24
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SESSION
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_ISOTPSession::ACAN_T4_ISOTPSession (const uint32_t inTransmitIdentifier,
+                                            const uint32_t inReceiveIdentifier,
+                                            const bool inExtended) :
+mTransmitIdentifier (inTransmitIdentifier & (inExtended ? 0x1FFFFFFF : 0x7FF)),
+mReceiveIdentifier (inReceiveIdentifier & (inExtended ? 0x1FFFFFFF : 0x7FF)),
+mExtended (inExtended) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ISOTPSession::startTransmission (const uint8_t * inData, const uint32_t inLength) {
+  const bool ok = (mTxState == TxState::kIdle)
+    && (inData != nullptr)
+    && (inLength > 0)
+    && (mFrameLength >= 8) && (mFrameLength <= 64) && (validCANFDLength (mFrameLength) == mFrameLength)
+  ;
+  if (ok) {
+    mTxData = inData ;
+    mTxLength = inLength ;
+    mTxOffset = 0 ;
+    mTxDate = micros () ;
+    mTxState = TxState::kSendFirstFrame ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::abortTransmission (void) {
+  mTxState = TxState::kIdle ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::setReceiveBuffer (uint8_t * inBuffer, const uint32_t inCapacity) {
+  mRxBuffer = inBuffer ;
+  mRxCapacity = (inBuffer == nullptr) ? 0 : inCapacity ;
+  mRxOffset = 0 ;
+  mRxState = RxState::kIdle ;
+  mPendingFlowStatus = NO_PENDING_FLOW_CONTROL ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ISOTPSession::receptionCompleted (uint32_t & outLength) const {
+  const bool completed = mRxState == RxState::kCompleted ;
+  if (completed) {
+    outLength = mRxLength ;
+  }
+  return completed ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::releaseReception (void) {
+  if (mRxState == RxState::kCompleted) {
+    mRxOffset = 0 ;
+    mRxState = RxState::kIdle ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SESSION: SENDING A FRAME
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ISOTPSession::sendFrame (ACAN_T4 & inDriver,
+                                      const uint8_t * inData,
+                                      const uint32_t inLength) const {
+  CANFDMessage frame ;
+  frame.id = mTransmitIdentifier ;
+  frame.ext = mExtended ;
+  uint32_t length = inLength ;
+  if (mPadding && (length < 8)) {
+    length = 8 ;
+  }
+  length = validCANFDLength (length) ;
+  for (uint32_t i=0 ; i<inLength ; i++) {
+    frame.data [i] = inData [i] ;
+  }
+  for (uint32_t i=inLength ; i<length ; i++) {
+    frame.data [i] = mPaddingByte ;
+  }
+  frame.len = uint8_t (length) ;
+  bool sent = false ;
+  if (mFrameLength > 8) {
+    frame.type = mBitRateSwitch ? CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH : CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ;
+    sent = inDriver.tryToSendFD (frame) ;
+  }else if (inDriver.isCANFDMode ()) {
+    frame.type = CANFDMessage::CAN_DATA ;
+    sent = inDriver.tryToSendFD (frame) ;
+  }else{
+    CANMessage message ;
+    message.id = frame.id ;
+    message.ext = frame.ext ;
+    message.len = frame.len ;
+    message.data64 = frame.data64 [0] ;
+    sent = inDriver.tryToSend (message) ;
+  }
+  return sent ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ISOTPSession::sendFlowControl (ACAN_T4 & inDriver, const uint8_t inFlowStatus) {
+  const uint8_t data [3] = {uint8_t (PCI_FLOW_CONTROL | inFlowStatus), mBlockSize, mSTmin} ;
+  const bool sent = sendFrame (inDriver, data, 3) ;
+  mPendingFlowStatus = sent ? NO_PENDING_FLOW_CONTROL : inFlowStatus ;
+  return sent ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SESSION: RECEIVED FRAMES
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ISOTPSession::handle (ACAN_T4 & inDriver, const CANFDMessage & inFrame) {
+  const bool accepted = (inFrame.id == mReceiveIdentifier)
+    && (inFrame.ext == mExtended)
+    && (inFrame.type != CANFDMessage::CAN_REMOTE)
+    && (inFrame.len > 0)
+  ;
+  if (accepted) {
+    switch (inFrame.data [0] & 0xF0) {
+    case PCI_SINGLE_FRAME :
+      handleSingleFrame (inFrame) ;
+      break ;
+    case PCI_FIRST_FRAME :
+      handleFirstFrame (inDriver, inFrame) ;
+      break ;
+    case PCI_CONSECUTIVE_FRAME :
+      handleConsecutiveFrame (inDriver, inFrame) ;
+      break ;
+    case PCI_FLOW_CONTROL :
+      handleFlowControl (inFrame) ;
+      break ;
+    default : // Unknown PCI: ignored
+      break ;
+    }
+  }
+  return accepted ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::handleSingleFrame (const CANFDMessage & inFrame) {
+  const uint32_t frameLength = (inFrame.len <= 64) ? inFrame.len : 64 ;
+  uint32_t length = inFrame.data [0] & 0x0F ;
+  uint32_t offset = 1 ;
+  if ((length == 0) && (frameLength > 8)) { // Escape sequence (CANFD)
+    length = inFrame.data [1] ;
+    offset = 2 ;
+  }
+  const bool valid = (length > 0) && ((offset + length) <= frameLength) ;
+  if (!valid) {
+  //--- Ignored
+  }else if (mRxState == RxState::kCompleted) {
+    mErrors |= kReceptionNotReleased ;
+  }else if (length > mRxCapacity) {
+    mErrors |= kReceiveBufferOverflow ;
+    mRxState = RxState::kIdle ;
+  }else{
+    if (mRxState == RxState::kReceiving) {
+      mErrors |= kReceptionInterrupted ;
+    }
+    for (uint32_t i=0 ; i<length ; i++) {
+      mRxBuffer [i] = inFrame.data [offset + i] ;
+    }
+    mRxLength = length ;
+    mRxOffset = length ;
+    mRxState = RxState::kCompleted ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::handleFirstFrame (ACAN_T4 & inDriver, const CANFDMessage & inFrame) {
+  const uint32_t frameLength = (inFrame.len <= 64) ? inFrame.len : 64 ;
+  uint32_t length = (uint32_t (inFrame.data [0] & 0x0F) << 8) | inFrame.data [1] ;
+  uint32_t offset = 2 ;
+  if (length == 0) { // Escape sequence: 32-bit length
+    length = (uint32_t (inFrame.data [2]) << 24) | (uint32_t (inFrame.data [3]) << 16)
+           | (uint32_t (inFrame.data [4]) << 8) | inFrame.data [5] ;
+    offset = 6 ;
+  }
+  const bool valid = (frameLength >= 8) && (length > (frameLength - offset)) ;
+  if (!valid) {
+  //--- Ignored
+  }else if (mRxState == RxState::kCompleted) {
+    mErrors |= kReceptionNotReleased ;
+  }else if (length > mRxCapacity) {
+    mErrors |= kReceiveBufferOverflow ;
+    mRxState = RxState::kIdle ;
+    sendFlowControl (inDriver, FLOW_STATUS_OVERFLOW) ;
+  }else{
+    if (mRxState == RxState::kReceiving) {
+      mErrors |= kReceptionInterrupted ;
+    }
+    const uint32_t dataLength = frameLength - offset ;
+    for (uint32_t i=0 ; i<dataLength ; i++) {
+      mRxBuffer [i] = inFrame.data [offset + i] ;
+    }
+    mRxLength = length ;
+    mRxOffset = dataLength ;
+    mRxSequenceNumber = 1 ;
+    mRxBlockCount = 0 ;
+    mRxDate = micros () ;
+    mRxState = RxState::kReceiving ;
+    sendFlowControl (inDriver, FLOW_STATUS_CONTINUE_TO_SEND) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::handleConsecutiveFrame (ACAN_T4 & inDriver, const CANFDMessage & inFrame) {
+  if (mRxState != RxState::kReceiving) {
+  //--- Ignored
+  }else if ((inFrame.data [0] & 0x0F) != mRxSequenceNumber) {
+    mErrors |= kWrongSequenceNumber ;
+    mRxState = RxState::kIdle ;
+  }else{
+    const uint32_t frameLength = (inFrame.len <= 64) ? inFrame.len : 64 ;
+    const uint32_t remaining = mRxLength - mRxOffset ;
+    const uint32_t dataLength = ((frameLength - 1) < remaining) ? (frameLength - 1) : remaining ;
+    for (uint32_t i=0 ; i<dataLength ; i++) {
+      mRxBuffer [mRxOffset + i] = inFrame.data [1 + i] ;
+    }
+    mRxOffset += dataLength ;
+    mRxSequenceNumber = (mRxSequenceNumber + 1) & 0x0F ;
+    mRxDate = micros () ;
+    if (mRxOffset == mRxLength) {
+      mRxState = RxState::kCompleted ;
+    }else if (mBlockSize > 0) {
+      mRxBlockCount += 1 ;
+      if (mRxBlockCount == mBlockSize) {
+        mRxBlockCount = 0 ;
+        sendFlowControl (inDriver, FLOW_STATUS_CONTINUE_TO_SEND) ;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::handleFlowControl (const CANFDMessage & inFrame) {
+  if ((mTxState != TxState::kWaitFlowControl) || (inFrame.len < 3)) {
+  //--- Ignored
+  }else{
+    switch (inFrame.data [0] & 0x0F) {
+    case FLOW_STATUS_CONTINUE_TO_SEND :
+      mTxBlockRemaining = inFrame.data [1] ;
+      mTxSeparationTime = separationTime (inFrame.data [2]) ;
+      mTxDate = micros () - mTxSeparationTime ; // First consecutive frame can be sent now
+      mTxState = TxState::kSendConsecutiveFrames ;
+      break ;
+    case FLOW_STATUS_WAIT : // Restart N_Bs timer
+      mTxDate = micros () ;
+      break ;
+    case FLOW_STATUS_OVERFLOW :
+      mErrors |= kOverflowReportedByPeer ;
+      mTxState = TxState::kIdle ;
+      break ;
+    default :
+      mErrors |= kInvalidFlowControl ;
+      mTxState = TxState::kIdle ;
+      break ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SESSION: POLL
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::poll (ACAN_T4 & inDriver) {
+  const uint32_t now = micros () ;
+  const uint32_t timeout = mTimeout * 1000 ;
+//--- Reception
+  if (mPendingFlowStatus != NO_PENDING_FLOW_CONTROL) {
+    sendFlowControl (inDriver, mPendingFlowStatus) ;
+  }
+  if ((mRxState == RxState::kReceiving) && ((now - mRxDate) >= timeout)) {
+    mErrors |= kReceiveTimeout ;
+    mRxState = RxState::kIdle ;
+  }
+//--- Transmission (sending consecutive frames, mTxDate is the last submission, and the next one is
+//    not due before the separation time: N_As runs from that date)
+  pollTransmission (inDriver, now) ;
+  const uint32_t txTimeout = (mTxState == TxState::kSendConsecutiveFrames) ? (timeout + mTxSeparationTime) : timeout ;
+  if ((mTxState != TxState::kIdle) && ((now - mTxDate) >= txTimeout)) {
+    mErrors |= kTransmitTimeout ;
+    mTxState = TxState::kIdle ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTPSession::pollTransmission (ACAN_T4 & inDriver, const uint32_t inNow) {
+  uint8_t data [64] ;
+  switch (mTxState) {
+  case TxState::kIdle :
+  case TxState::kWaitFlowControl :
+    break ;
+  case TxState::kSendFirstFrame :
+    if ((mTxLength <= 7) || ((mFrameLength > 8) && (mTxLength <= uint32_t (mFrameLength - 2)))) { // Single frame
+      uint32_t offset = 1 ;
+      if (mTxLength <= 7) {
+        data [0] = uint8_t (PCI_SINGLE_FRAME | mTxLength) ;
+      }else{ // Escape sequence (CANFD)
+        data [0] = PCI_SINGLE_FRAME ;
+        data [1] = uint8_t (mTxLength) ;
+        offset = 2 ;
+      }
+      for (uint32_t i=0 ; i<mTxLength ; i++) {
+        data [offset + i] = mTxData [i] ;
+      }
+      if (sendFrame (inDriver, data, offset + mTxLength)) {
+        mTxOffset = mTxLength ;
+        mTxState = TxState::kIdle ;
+      }
+    }else{ // First frame
+      uint32_t offset = 2 ;
+      if (mTxLength <= 4095) {
+        data [0] = uint8_t (PCI_FIRST_FRAME | (mTxLength >> 8)) ;
+        data [1] = uint8_t (mTxLength) ;
+      }else{ // Escape sequence: 32-bit length
+        data [0] = PCI_FIRST_FRAME ;
+        data [1] = 0 ;
+        data [2] = uint8_t (mTxLength >> 24) ;
+        data [3] = uint8_t (mTxLength >> 16) ;
+        data [4] = uint8_t (mTxLength >> 8) ;
+        data [5] = uint8_t (mTxLength) ;
+        offset = 6 ;
+      }
+      const uint32_t dataLength = mFrameLength - offset ;
+      for (uint32_t i=0 ; i<dataLength ; i++) {
+        data [offset + i] = mTxData [i] ;
+      }
+      if (sendFrame (inDriver, data, mFrameLength)) {
+        mTxOffset = dataLength ;
+        mTxSequenceNumber = 1 ;
+        mTxDate = inNow ;
+        mTxState = TxState::kWaitFlowControl ;
+      }
+    }
+    break ;
+  case TxState::kSendConsecutiveFrames :
+  //--- Without separation time, consecutive frames are queued until the driver transmit buffer is full
+    { bool loop = (inNow - mTxDate) >= mTxSeparationTime ;
+      while (loop) {
+        const uint32_t remaining = mTxLength - mTxOffset ;
+        const uint32_t dataLength = ((uint32_t (mFrameLength) - 1) < remaining) ? (mFrameLength - 1) : remaining ;
+        data [0] = uint8_t (PCI_CONSECUTIVE_FRAME | mTxSequenceNumber) ;
+        for (uint32_t i=0 ; i<dataLength ; i++) {
+          data [1 + i] = mTxData [mTxOffset + i] ;
+        }
+        loop = sendFrame (inDriver, data, 1 + dataLength) ;
+        if (loop) {
+          mTxOffset += dataLength ;
+          mTxSequenceNumber = (mTxSequenceNumber + 1) & 0x0F ;
+          mTxDate = inNow ;
+          if (mTxOffset == mTxLength) {
+            mTxState = TxState::kIdle ;
+            loop = false ;
+          }else if (mTxBlockRemaining > 0) {
+            mTxBlockRemaining -= 1 ;
+            if (mTxBlockRemaining == 0) {
+              mTxState = TxState::kWaitFlowControl ;
+              loop = false ;
+            }
+          }
+          loop = loop && (mTxSeparationTime == 0) ;
+        }
+      }
+    }
+    break ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    ISOTP
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_ISOTP::ACAN_T4_ISOTP (ACAN_T4 & inDriver) :
+mDriver (inDriver) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTP::addSession (ACAN_T4_ISOTPSession & inSession) {
+  bool found = false ;
+  for (ACAN_T4_ISOTPSession * p = mFirstSession ; (p != nullptr) && !found ; p = p->mNextSession) {
+    found = p == & inSession ;
+  }
+  if (!found) {
+    inSession.mNextSession = mFirstSession ;
+    mFirstSession = & inSession ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ISOTP::handle (const CANMessage & inFrame) {
+  return handleFD (CANFDMessage (inFrame)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ISOTP::handleFD (const CANFDMessage & inFrame) {
+  bool handled = false ;
+  for (ACAN_T4_ISOTPSession * p = mFirstSession ; (p != nullptr) && !handled ; p = p->mNextSession) {
+    handled = p->handle (mDriver, inFrame) ;
+  }
+  return handled ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ISOTP::poll (void) {
+  for (ACAN_T4_ISOTPSession * p = mFirstSession ; p != nullptr ; p = p->mNextSession) {
+    p->poll (mDriver) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
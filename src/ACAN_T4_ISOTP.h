@@ -0,0 +1,155 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// ISO 15765-2 (ISO-TP) transport layer, on top of ACAN_T4.
+//   - CAN 2.0B (8-byte frames) and CANFD (up to 64-byte frames, TX_DL = mFrameLength);
+//   - messages up to 4095 bytes, and up to 2^32 - 1 bytes with escape sequence first frames;
+//   - block size and separation time (STmin) sent in flow control frames are settings of the
+//     session; received ones are honored;
+//   - sessions are allocated by the caller, messages are read from and written to caller buffers:
+//     there is no heap allocation;
+//   - when separation time is zero, consecutive frames are queued as long as the driver transmit
+//     buffer accepts them, so that the transmit buffer never runs dry.
+// A session is an identifier pair (transmit identifier, receive identifier), with one transmission
+// and one reception that can run concurrently. Any number of sessions can be added to an
+// ACAN_T4_ISOTP instance.
+//
+// Usage, in loop: pass every received frame to handle (or handleFD), that returns true if the
+// frame belongs to a session; then call poll, that sends frames and checks timeouts.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_ISOTPSession {
+
+//--- Constructor
+  public: ACAN_T4_ISOTPSession (const uint32_t inTransmitIdentifier,
+                                const uint32_t inReceiveIdentifier,
+                                const bool inExtended = false) ;
+
+//--- Settings
+  public: uint8_t mFrameLength = 8 ; // 8 (CAN 2.0B frames), or 12, 16, 20, 24, 32, 48, 64 (CANFD frames)
+  public: bool mBitRateSwitch = true ; // For CANFD frames
+  public: bool mPadding = true ; // Frames shorter than 8 bytes are padded
+  public: uint8_t mPaddingByte = 0xCC ;
+  public: uint8_t mBlockSize = 0 ; // Sent in flow control frames, 0: no limit
+  public: uint8_t mSTmin = 0 ; // Sent in flow control frames: 0x00-0x7F: 0-127 ms, 0xF1-0xF9: 100-900 µs
+  public: uint32_t mTimeout = 1000 ; // N_As, N_Bs and N_Cr timeouts, in ms
+
+//--- Transmission: inData should remain valid until transmission is completed. Returns false if a
+//    transmission is in progress, if inLength is 0, or if mFrameLength is invalid
+  public: bool startTransmission (const uint8_t * inData, const uint32_t inLength) ;
+  public: void abortTransmission (void) ;
+  public: inline bool isTransmitting (void) const { return mTxState != TxState::kIdle ; }
+  public: inline uint32_t transmittedLength (void) const { return mTxOffset ; }
+
+//--- Reception: a received message is stored in inBuffer; once completed, reception is suspended
+//    until releaseReception is called
+  public: void setReceiveBuffer (uint8_t * inBuffer, const uint32_t inCapacity) ;
+  public: bool receptionCompleted (uint32_t & outLength) const ;
+  public: void releaseReception (void) ;
+  public: inline bool isReceiving (void) const { return mRxState == RxState::kReceiving ; }
+  public: inline uint32_t receivedLength (void) const { return mRxOffset ; }
+
+//--- Errors: every bit denotes an error, bits are set until resetErrors is called
+  public: inline uint32_t errors (void) const { return mErrors ; }
+  public: inline void resetErrors (void) { mErrors = 0 ; }
+  public: static const uint32_t kTransmitTimeout          = 1 << 0 ; // Frame not sent, or no flow control
+  public: static const uint32_t kReceiveTimeout           = 1 << 1 ; // No consecutive frame
+  public: static const uint32_t kWrongSequenceNumber      = 1 << 2 ;
+  public: static const uint32_t kOverflowReportedByPeer   = 1 << 3 ;
+  public: static const uint32_t kReceiveBufferOverflow    = 1 << 4 ; // Message larger than receive buffer
+  public: static const uint32_t kInvalidFlowControl       = 1 << 5 ;
+  public: static const uint32_t kReceptionInterrupted     = 1 << 6 ; // New message before last frame
+  public: static const uint32_t kReceptionNotReleased     = 1 << 7 ; // Message lost
+
+//--- Identifiers
+  public: inline uint32_t transmitIdentifier (void) const { return mTransmitIdentifier ; }
+  public: inline uint32_t receiveIdentifier (void) const { return mReceiveIdentifier ; }
+
+//--- Private methods, called by ACAN_T4_ISOTP
+  private: bool handle (ACAN_T4 & inDriver, const CANFDMessage & inFrame) ;
+  private: void poll (ACAN_T4 & inDriver) ;
+  private: void pollTransmission (ACAN_T4 & inDriver, const uint32_t inNow) ;
+  private: void handleSingleFrame (const CANFDMessage & inFrame) ;
+  private: void handleFirstFrame (ACAN_T4 & inDriver, const CANFDMessage & inFrame) ;
+  private: void handleConsecutiveFrame (ACAN_T4 & inDriver, const CANFDMessage & inFrame) ;
+  private: void handleFlowControl (const CANFDMessage & inFrame) ;
+  private: bool sendFlowControl (ACAN_T4 & inDriver, const uint8_t inFlowStatus) ;
+  private: bool sendFrame (ACAN_T4 & inDriver, const uint8_t * inData, const uint32_t inLength) const ;
+
+//--- Transmission state
+  private: enum class TxState : uint8_t {kIdle, kSendFirstFrame, kWaitFlowControl, kSendConsecutiveFrames} ;
+  private: const uint8_t * mTxData = nullptr ;
+  private: uint32_t mTxLength = 0 ;
+  private: uint32_t mTxOffset = 0 ;
+  private: uint32_t mTxDate = 0 ; // Last event, in µs
+  private: uint32_t mTxSeparationTime = 0 ; // In µs
+  private: uint32_t mTxBlockRemaining = 0 ; // 0: no limit
+  private: TxState mTxState = TxState::kIdle ;
+  private: uint8_t mTxSequenceNumber = 0 ;
+
+//--- Reception state
+  private: enum class RxState : uint8_t {kIdle, kReceiving, kCompleted} ;
+  private: uint8_t * mRxBuffer = nullptr ;
+  private: uint32_t mRxCapacity = 0 ;
+  private: uint32_t mRxLength = 0 ;
+  private: uint32_t mRxOffset = 0 ;
+  private: uint32_t mRxDate = 0 ; // Last received frame, in µs
+  private: uint32_t mRxBlockCount = 0 ;
+  private: RxState mRxState = RxState::kIdle ;
+  private: uint8_t mRxSequenceNumber = 0 ;
+  private: static const uint8_t NO_PENDING_FLOW_CONTROL = 0xFF ;
+  private: uint8_t mPendingFlowStatus = NO_PENDING_FLOW_CONTROL ;
+
+//--- Properties
+  private: const uint32_t mTransmitIdentifier ;
+  private: const uint32_t mReceiveIdentifier ;
+  private: const bool mExtended ;
+  private: uint32_t mErrors = 0 ;
+  private: ACAN_T4_ISOTPSession * mNextSession = nullptr ;
+
+//--- Friend
+  friend class ACAN_T4_ISOTP ;
+
+//--- No copy
+  private : ACAN_T4_ISOTPSession (const ACAN_T4_ISOTPSession &) = delete ;
+  private : ACAN_T4_ISOTPSession & operator = (const ACAN_T4_ISOTPSession &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_ISOTP {
+
+//--- Constructor
+  public: ACAN_T4_ISOTP (ACAN_T4 & inDriver) ;
+
+//--- Add a session (the session should remain valid while the ISOTP instance is used)
+  public: void addSession (ACAN_T4_ISOTPSession & inSession) ;
+
+//--- Handle a received frame; returns true if it belongs to a session
+  public: bool handle (const CANMessage & inFrame) ;
+  public: bool handleFD (const CANFDMessage & inFrame) ;
+
+//--- Send pending frames, check timeouts (call from loop)
+  public: void poll (void) ;
+
+//--- Properties
+  private: ACAN_T4 & mDriver ;
+  private: ACAN_T4_ISOTPSession * mFirstSession = nullptr ;
+
+//--- No copy
+  private : ACAN_T4_ISOTP (const ACAN_T4_ISOTP &) = delete ;
+  private : ACAN_T4_ISOTP & operator = (const ACAN_T4_ISOTP &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,309 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_J1939.h>
+
+//--------------------------------------------------------------------------------------------------
+//    J1939-21 TRANSPORT PROTOCOL
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t PF_TP_CM = 0xEC ; // Connection management, PGN 60416
+static const uint8_t PF_TP_DT = 0xEB ; // Data transfer, PGN 60160
+static const uint8_t GLOBAL_ADDRESS = 0xFF ;
+
+static const uint8_t CM_RTS = 16 ;
+static const uint8_t CM_CTS = 17 ;
+static const uint8_t CM_END_OF_MESSAGE_ACK = 19 ;
+static const uint8_t CM_BAM = 32 ;
+static const uint8_t CM_ABORT = 255 ;
+
+static const uint32_t T1 = 750 ; // In ms, between two data packets
+static const uint32_t T2 = 1250 ; // In ms, after CTS
+
+//--------------------------------------------------------------------------------------------------
+//    SLOT
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_J1939Slot::ACAN_T4_J1939Slot (void) {
+}
+
+//--------------------------------------------------------------------------------------------------
+//    CONSTRUCTOR, BEGIN
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_J1939Transport::ACAN_T4_J1939Transport (ACAN_T4 & inDriver, const uint8_t inAddress) :
+mDriver (inDriver),
+mAddress (inAddress) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_J1939Transport::begin (ACAN_T4_J1939Slot inSlots [],
+                                    const uint32_t inSlotCount,
+                                    const ACAN_T4_J1939CallBack inCallBack) {
+  mSlots = inSlots ;
+  mSlotCount = (inSlots == nullptr) ? 0 : inSlotCount ;
+  mCallBack = inCallBack ;
+  for (uint32_t i=0 ; i<mSlotCount ; i++) {
+    mSlots [i].mBusy = false ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    FILTERS
+//--------------------------------------------------------------------------------------------------
+
+ACANPrimaryFilter ACAN_T4_J1939Transport::connectionManagementFilter (const ACANCallBackRoutine inCallBackRoutine) {
+  return ACANPrimaryFilter (kData, kExtended, 0x00FF0000, uint32_t (PF_TP_CM) << 16, inCallBackRoutine) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACANPrimaryFilter ACAN_T4_J1939Transport::dataTransferFilter (const ACANCallBackRoutine inCallBackRoutine) {
+  return ACANPrimaryFilter (kData, kExtended, 0x00FF0000, uint32_t (PF_TP_DT) << 16, inCallBackRoutine) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SLOTS
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_J1939Slot * ACAN_T4_J1939Transport::findSlot (const uint8_t inSourceAddress,
+                                                      const bool inBroadcast) const {
+  ACAN_T4_J1939Slot * result = nullptr ;
+  for (uint32_t i=0 ; (i<mSlotCount) && (result == nullptr) ; i++) {
+    ACAN_T4_J1939Slot & slot = mSlots [i] ;
+    if (slot.mBusy && (slot.mSourceAddress == inSourceAddress) && (slot.mBroadcast == inBroadcast)) {
+      result = & slot ;
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_J1939Slot * ACAN_T4_J1939Transport::allocateSlot (const uint8_t inSourceAddress,
+                                                          const bool inBroadcast) const {
+//--- A new transfer from the same source replaces the transfer in progress
+  ACAN_T4_J1939Slot * result = findSlot (inSourceAddress, inBroadcast) ;
+  for (uint32_t i=0 ; (i<mSlotCount) && (result == nullptr) ; i++) {
+    if (!mSlots [i].mBusy) {
+      result = & mSlots [i] ;
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_J1939Transport::busySlotCount (void) const {
+  uint32_t count = 0 ;
+  for (uint32_t i=0 ; i<mSlotCount ; i++) {
+    if (mSlots [i].mBusy) {
+      count += 1 ;
+    }
+  }
+  return count ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SENDING CONNECTION MANAGEMENT FRAMES
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_J1939Transport::sendConnectionManagement (const uint8_t inDestinationAddress,
+                                                       const uint8_t inControl,
+                                                       const uint8_t inByte1,
+                                                       const uint8_t inByte2,
+                                                       const uint8_t inByte3,
+                                                       const uint8_t inByte4,
+                                                       const uint32_t inPGN) {
+  CANMessage message ;
+  message.ext = true ;
+  message.id = (uint32_t (mPriority & 7) << 26) | (uint32_t (PF_TP_CM) << 16)
+             | (uint32_t (inDestinationAddress) << 8) | mAddress ;
+  message.len = 8 ;
+  message.data [0] = inControl ;
+  message.data [1] = inByte1 ;
+  message.data [2] = inByte2 ;
+  message.data [3] = inByte3 ;
+  message.data [4] = inByte4 ;
+  message.data [5] = uint8_t (inPGN) ;
+  message.data [6] = uint8_t (inPGN >> 8) ;
+  message.data [7] = uint8_t (inPGN >> 16) ;
+  if (!mDriver.tryToSend (message)) {
+    mSendErrorCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_J1939Transport::sendClearToSend (ACAN_T4_J1939Slot & ioSlot) {
+  uint32_t packets = ioSlot.mPacketCount - ioSlot.mNextPacket + 1 ;
+  if (packets > ioSlot.mMaxPacketsPerCTS) {
+    packets = ioSlot.mMaxPacketsPerCTS ;
+  }
+  if ((mPacketsPerCTS > 0) && (packets > mPacketsPerCTS)) {
+    packets = mPacketsPerCTS ;
+  }
+  ioSlot.mWindowRemaining = uint8_t (packets) ;
+  ioSlot.mTimeout = T2 ;
+  sendConnectionManagement (ioSlot.mSourceAddress, CM_CTS, uint8_t (packets), ioSlot.mNextPacket, 0xFF, 0xFF, ioSlot.mPGN) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_J1939Transport::abort (const uint8_t inDestinationAddress,
+                                    const uint8_t inReason,
+                                    const uint32_t inPGN) {
+  sendConnectionManagement (inDestinationAddress, CM_ABORT, inReason, 0xFF, 0xFF, 0xFF, inPGN) ;
+  mAbortedTransferCount += 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RECEIVED FRAMES
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_J1939Transport::handle (const CANMessage & inMessage) {
+  const uint8_t pf = uint8_t (inMessage.id >> 16) ;
+  const uint8_t destinationAddress = uint8_t (inMessage.id >> 8) ;
+  const uint8_t sourceAddress = uint8_t (inMessage.id) ;
+  const bool accepted = inMessage.ext
+    && !inMessage.rtr
+    && (inMessage.len == 8)
+    && ((pf == PF_TP_CM) || (pf == PF_TP_DT))
+    && ((destinationAddress == mAddress) || (destinationAddress == GLOBAL_ADDRESS))
+  ;
+  if (!accepted) {
+  //--- Not a transport frame for this node
+  }else if (pf == PF_TP_CM) {
+    handleConnectionManagement (sourceAddress, destinationAddress, inMessage.data) ;
+  }else{
+    handleDataTransfer (sourceAddress, destinationAddress, inMessage.data) ;
+  }
+  return accepted ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_J1939Transport::handleConnectionManagement (const uint8_t inSourceAddress,
+                                                         const uint8_t inDestinationAddress,
+                                                         const uint8_t inData []) {
+  const uint32_t pgn = inData [5] | (uint32_t (inData [6]) << 8) | (uint32_t (inData [7] & 0x03) << 16) ;
+  const bool broadcast = inDestinationAddress == GLOBAL_ADDRESS ;
+  switch (inData [0]) {
+  case CM_RTS :
+  case CM_BAM :
+    if ((inData [0] == CM_BAM) == broadcast) {
+      const uint32_t size = inData [1] | (uint32_t (inData [2]) << 8) ;
+      const uint32_t packetCount = inData [3] ;
+      const bool valid = (size > 8) && (packetCount == ((size + 6) / 7)) ;
+      ACAN_T4_J1939Slot * slot = valid ? allocateSlot (inSourceAddress, broadcast) : nullptr ;
+      if (!valid) {
+        if (!broadcast) {
+          abort (inSourceAddress, kAbortMessageTooLarge, pgn) ;
+        }
+      }else if (slot == nullptr) {
+        mRejectedTransferCount += 1 ;
+        if (!broadcast) {
+          abort (inSourceAddress, kAbortNoResource, pgn) ;
+        }
+      }else{
+        slot->mBusy = true ;
+        slot->mSourceAddress = inSourceAddress ;
+        slot->mBroadcast = broadcast ;
+        slot->mPGN = pgn ;
+        slot->mSize = uint16_t (size) ;
+        slot->mPacketCount = uint8_t (packetCount) ;
+        slot->mNextPacket = 1 ;
+        slot->mMaxPacketsPerCTS = broadcast ? 0xFF : inData [4] ;
+        slot->mDate = millis () ;
+        slot->mTimeout = T1 ;
+        if (!broadcast) {
+          sendClearToSend (*slot) ;
+        }
+      }
+    }
+    break ;
+  case CM_ABORT :
+    if (!broadcast) {
+      ACAN_T4_J1939Slot * slot = findSlot (inSourceAddress, false) ;
+      if ((slot != nullptr) && (slot->mPGN == pgn)) {
+        slot->mBusy = false ;
+        mAbortedTransferCount += 1 ;
+      }
+    }
+    break ;
+  default : // CTS, end of message acknowledgment: this node does not send multi-packet messages
+    break ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_J1939Transport::handleDataTransfer (const uint8_t inSourceAddress,
+                                                 const uint8_t inDestinationAddress,
+                                                 const uint8_t inData []) {
+  const bool broadcast = inDestinationAddress == GLOBAL_ADDRESS ;
+  ACAN_T4_J1939Slot * slot = findSlot (inSourceAddress, broadcast) ;
+  if (slot == nullptr) {
+  //--- No transfer in progress: ignored
+  }else if ((inData [0] != slot->mNextPacket) || (!broadcast && (slot->mWindowRemaining == 0))) {
+    slot->mBusy = false ;
+    if (broadcast) {
+      mAbortedTransferCount += 1 ;
+    }else{
+      abort (inSourceAddress, kAbortBadSequenceNumber, slot->mPGN) ;
+    }
+  }else{
+    const uint32_t offset = (inData [0] - 1) * 7 ;
+    const uint32_t length = ((slot->mSize - offset) < 7) ? (slot->mSize - offset) : 7 ;
+    for (uint32_t i=0 ; i<length ; i++) {
+      slot->mData [offset + i] = inData [1 + i] ;
+    }
+    slot->mDate = millis () ;
+    slot->mTimeout = T1 ;
+    if (slot->mNextPacket == slot->mPacketCount) { // Last packet
+      slot->mBusy = false ;
+      if (!broadcast) {
+        sendConnectionManagement (inSourceAddress, CM_END_OF_MESSAGE_ACK,
+                                  uint8_t (slot->mSize), uint8_t (slot->mSize >> 8), slot->mPacketCount, 0xFF,
+                                  slot->mPGN) ;
+      }
+      mCompletedMessageCount += 1 ;
+      if (nullptr != mCallBack) {
+        mCallBack (slot->mPGN, inSourceAddress, inDestinationAddress, slot->mData, slot->mSize) ;
+      }
+    }else{
+      slot->mNextPacket += 1 ;
+      if (!broadcast) {
+        slot->mWindowRemaining -= 1 ;
+        if (slot->mWindowRemaining == 0) {
+          sendClearToSend (*slot) ;
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    TIMEOUTS
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_J1939Transport::poll (void) {
+  const uint32_t now = millis () ;
+  for (uint32_t i=0 ; i<mSlotCount ; i++) {
+    ACAN_T4_J1939Slot & slot = mSlots [i] ;
+    if (slot.mBusy && ((now - slot.mDate) >= slot.mTimeout)) {
+      slot.mBusy = false ;
+      mTimeoutCount += 1 ;
+      if (!slot.mBroadcast) {
+        abort (slot.mSourceAddress, kAbortTimeout, slot.mPGN) ;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// SAE J1939-21 multi-packet transport reception (TP.CM and TP.DT, 29-bit identifiers):
+//   - BAM transfers (sent to the global address) and RTS/CTS transfers (sent to mAddress) are
+//     reassembled in caller allocated slots, one slot per transfer in progress, so transfers from
+//     many source addresses can be interleaved;
+//   - CTS, end of message acknowledgment and connection abort frames are sent automatically;
+//   - stale transfers are timed out by poll (T1 = 750 ms between data packets, T2 = 1250 ms after
+//     CTS).
+// Frames are given to handle, typically from the call back routines of the two primary filters
+// returned by connectionManagementFilter and dataTransferFilter (see dispatchReceivedMessage).
+// Completed messages are given to the message call back routine, from handle.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t ACAN_T4_J1939_MAX_MESSAGE_SIZE = 1785 ; // 255 packets of 7 bytes
+
+//--------------------------------------------------------------------------------------------------
+
+typedef void (*ACAN_T4_J1939CallBack) (const uint32_t inPGN,
+                                       const uint8_t inSourceAddress,
+                                       const uint8_t inDestinationAddress, // 0xFF for BAM
+                                       const uint8_t inData [],
+                                       const uint32_t inLength) ;
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_J1939Slot {
+  public: ACAN_T4_J1939Slot (void) ;
+
+//--- Properties (used by ACAN_T4_J1939Transport)
+  private: uint8_t mData [ACAN_T4_J1939_MAX_MESSAGE_SIZE] ;
+  private: uint32_t mPGN = 0 ;
+  private: uint32_t mDate = 0 ; // Last received frame, in ms
+  private: uint32_t mTimeout = 0 ; // In ms
+  private: uint16_t mSize = 0 ;
+  private: uint8_t mPacketCount = 0 ;
+  private: uint8_t mNextPacket = 0 ;
+  private: uint8_t mMaxPacketsPerCTS = 0 ;
+  private: uint8_t mWindowRemaining = 0 ; // Packets expected before next CTS
+  private: uint8_t mSourceAddress = 0 ;
+  private: bool mBroadcast = false ;
+  private: bool mBusy = false ;
+
+//--- Friend
+  friend class ACAN_T4_J1939Transport ;
+
+//--- No copy
+  private : ACAN_T4_J1939Slot (const ACAN_T4_J1939Slot &) = delete ;
+  private : ACAN_T4_J1939Slot & operator = (const ACAN_T4_J1939Slot &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_J1939Transport {
+
+//--- Constructor: inAddress is the address of this node
+  public: ACAN_T4_J1939Transport (ACAN_T4 & inDriver, const uint8_t inAddress) ;
+
+//--- begin: slots should remain valid while the transport is used
+  public: void begin (ACAN_T4_J1939Slot inSlots [],
+                      const uint32_t inSlotCount,
+                      const ACAN_T4_J1939CallBack inCallBack) ;
+
+//--- Settings
+  public: uint8_t mPacketsPerCTS = 16 ; // Packets requested by a CTS (limited by the sender RTS)
+  public: uint8_t mPriority = 7 ; // Priority of sent frames
+
+//--- Primary filters for TP.CM and TP.DT frames (any source, any destination)
+  public: static ACANPrimaryFilter connectionManagementFilter (const ACANCallBackRoutine inCallBackRoutine) ;
+  public: static ACANPrimaryFilter dataTransferFilter (const ACANCallBackRoutine inCallBackRoutine) ;
+
+//--- Handle a received frame; returns true if it is a TP.CM or TP.DT frame for this node
+  public: bool handle (const CANMessage & inMessage) ;
+
+//--- Time out stale transfers (call from loop)
+  public: void poll (void) ;
+
+//--- Statistics
+  public: inline uint32_t completedMessageCount (void) const { return mCompletedMessageCount ; }
+  public: inline uint32_t abortedTransferCount (void) const { return mAbortedTransferCount ; }
+  public: inline uint32_t timeoutCount (void) const { return mTimeoutCount ; }
+  public: inline uint32_t rejectedTransferCount (void) const { return mRejectedTransferCount ; } // No free slot
+  public: inline uint32_t sendErrorCount (void) const { return mSendErrorCount ; }
+  public: uint32_t busySlotCount (void) const ;
+
+//--- Connection abort reasons (J1939-21)
+  public: static const uint8_t kAbortNoResource = 1 ;
+  public: static const uint8_t kAbortTimeout = 3 ;
+  public: static const uint8_t kAbortBadSequenceNumber = 7 ;
+  public: static const uint8_t kAbortMessageTooLarge = 9 ;
+
+//--- Private methods
+  private: void handleConnectionManagement (const uint8_t inSourceAddress,
+                                            const uint8_t inDestinationAddress,
+                                            const uint8_t inData []) ;
+  private: void handleDataTransfer (const uint8_t inSourceAddress,
+                                    const uint8_t inDestinationAddress,
+                                    const uint8_t inData []) ;
+  private: ACAN_T4_J1939Slot * findSlot (const uint8_t inSourceAddress, const bool inBroadcast) const ;
+  private: ACAN_T4_J1939Slot * allocateSlot (const uint8_t inSourceAddress, const bool inBroadcast) const ;
+  private: void sendClearToSend (ACAN_T4_J1939Slot & ioSlot) ;
+  private: void sendConnectionManagement (const uint8_t inDestinationAddress,
+                                          const uint8_t inControl,
+                                          const uint8_t inByte1,
+                                          const uint8_t inByte2,
+                                          const uint8_t inByte3,
+                                          const uint8_t inByte4,
+                                          const uint32_t inPGN) ;
+  private: void abort (const uint8_t inDestinationAddress, const uint8_t inReason, const uint32_t inPGN) ;
+
+//--- Properties
+  private: ACAN_T4 & mDriver ;
+  private: ACAN_T4_J1939Slot * mSlots = nullptr ;
+  private: uint32_t mSlotCount = 0 ;
+  private: ACAN_T4_J1939CallBack mCallBack = nullptr ;
+  private: uint32_t mCompletedMessageCount = 0 ;
+  private: uint32_t mAbortedTransferCount = 0 ;
+  private: uint32_t mTimeoutCount = 0 ;
+  private: uint32_t mRejectedTransferCount = 0 ;
+  private: uint32_t mSendErrorCount = 0 ;
+  private: const uint8_t mAddress ;
+
+//--- No copy
+  private : ACAN_T4_J1939Transport (const ACAN_T4_J1939Transport &) = delete ;
+  private : ACAN_T4_J1939Transport & operator = (const ACAN_T4_J1939Transport &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: latest value slots
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+//    SLOT
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_LatestValueSlot::ACAN_T4_LatestValueSlot (const tFrameFormat inFormat,
+                                                  const uint32_t inIdentifier) :
+mIdentifier (inIdentifier & ((inFormat == kExtended) ? 0x1FFFFFFF : 0x7FF)),
+mFormat (inFormat),
+mMessage () {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_LatestValueSlot::store (const CANMessage & inMessage, const uint32_t inTimestamp) {
+  mMessage.id = inMessage.id ;
+  mMessage.ext = inMessage.ext ;
+  mMessage.type = CANFDMessage::CAN_DATA ;
+  mMessage.idx = inMessage.idx ;
+  mMessage.len = inMessage.len ;
+  mMessage.data64 [0] = inMessage.data64 ;
+  mTimestamp = inTimestamp ;
+  mSequence += 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_LatestValueSlot::storeFD (const CANFDMessage & inMessage, const uint32_t inTimestamp) {
+  mMessage = inMessage ;
+  mTimestamp = inTimestamp ;
+  mSequence += 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_LatestValueSlot::read (CANMessage & outMessage,
+                                    uint32_t & outSequence,
+                                    uint32_t & outTimestamp) const {
+  noInterrupts () ;
+    outMessage.id = mMessage.id ;
+    outMessage.ext = mMessage.ext ;
+    outMessage.rtr = false ;
+    outMessage.idx = mMessage.idx ;
+    outMessage.len = (mMessage.len > 8) ? 8 : mMessage.len ;
+    outMessage.data64 = mMessage.data64 [0] ;
+    outSequence = mSequence ;
+    outTimestamp = mTimestamp ;
+  interrupts () ;
+  return outSequence != 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_LatestValueSlot::readFD (CANFDMessage & outMessage,
+                                      uint32_t & outSequence,
+                                      uint32_t & outTimestamp) const {
+  noInterrupts () ;
+    outMessage = mMessage ;
+    outSequence = mSequence ;
+    outTimestamp = mTimestamp ;
+  interrupts () ;
+  return outSequence != 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_LatestValueSlot::readIfNew (CANMessage & outMessage,
+                                         uint32_t & ioSequence,
+                                         uint32_t & outTimestamp) const {
+  const bool isNew = mSequence != ioSequence ;
+  if (isNew) {
+    read (outMessage, ioSequence, outTimestamp) ;
+  }
+  return isNew ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_LatestValueSlot::readIfNewFD (CANFDMessage & outMessage,
+                                           uint32_t & ioSequence,
+                                           uint32_t & outTimestamp) const {
+  const bool isNew = mSequence != ioSequence ;
+  if (isNew) {
+    readFD (outMessage, ioSequence, outTimestamp) ;
+  }
+  return isNew ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SLOT TABLE
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::setLatestValueSlots (ACAN_T4_LatestValueSlot inSlots [], const uint32_t inSlotCount) {
+  noInterrupts () ;
+    mLatestValueSlots = inSlots ;
+    mLatestValueSlotCount = (inSlots == nullptr) ? 0 : inSlotCount ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    STORE (called by the receive interrupt service routine)
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4::storeLatestValue (const CANMessage & inMessage) {
+  bool stored = false ;
+  if (!inMessage.rtr) {
+    for (uint32_t i=0 ; (i<mLatestValueSlotCount) && !stored ; i++) {
+      ACAN_T4_LatestValueSlot & slot = mLatestValueSlots [i] ;
+      if (slot.matches (inMessage.id, inMessage.ext)) {
+        slot.store (inMessage, micros ()) ;
+        stored = true ;
+      }
+    }
+  }
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4::storeLatestValueFD (const CANFDMessage & inMessage) {
+  bool stored = false ;
+  if (inMessage.type != CANFDMessage::CAN_REMOTE) {
+    for (uint32_t i=0 ; (i<mLatestValueSlotCount) && !stored ; i++) {
+      ACAN_T4_LatestValueSlot & slot = mLatestValueSlots [i] ;
+      if (slot.matches (inMessage.id, inMessage.ext)) {
+        slot.storeFD (inMessage, micros ()) ;
+        stored = true ;
+      }
+    }
+  }
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Latest value slot: the receive interrupt service routine overwrites the slot with every received
+// data frame whose identifier matches the slot (see ACAN_T4::setLatestValueSlots); such a frame is
+// not stored in the driver receive buffer. The slot keeps only the newest frame, with a sequence
+// number (number of frames received since the slot was installed) and its reception date.
+// Reading is done with interrupts disabled, so the frame, its sequence number and its date are
+// always consistent.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_LatestValueSlot {
+
+//--- Constructor
+  public: ACAN_T4_LatestValueSlot (const tFrameFormat inFormat, const uint32_t inIdentifier) ;
+
+//--- Matching data frames
+  public: const uint32_t mIdentifier ;
+  public: const tFrameFormat mFormat ;
+
+//--- Sequence number of the last received frame, 0 if none has been received
+  public: inline uint32_t sequence (void) const { return mSequence ; }
+
+//--- Read the last received frame, with its sequence number and reception date (micros).
+//    Returns false if no frame has been received.
+  public: bool read (CANMessage & outMessage, uint32_t & outSequence, uint32_t & outTimestamp) const ;
+  public: bool readFD (CANFDMessage & outMessage, uint32_t & outSequence, uint32_t & outTimestamp) const ;
+
+//--- Read the last received frame if its sequence number is not ioSequence; ioSequence is updated.
+//    Frames received between two calls are overwritten: their count is the sequence number
+//    difference minus one.
+  public: bool readIfNew (CANMessage & outMessage, uint32_t & ioSequence, uint32_t & outTimestamp) const ;
+  public: bool readIfNewFD (CANFDMessage & outMessage, uint32_t & ioSequence, uint32_t & outTimestamp) const ;
+
+//--- Methods called by the receive interrupt service routine
+  public: inline bool matches (const uint32_t inIdentifier, const bool inExtended) const {
+    return (inIdentifier == mIdentifier) && ((mFormat == kExtended) == inExtended) ;
+  }
+  public: void store (const CANMessage & inMessage, const uint32_t inTimestamp) ;
+  public: void storeFD (const CANFDMessage & inMessage, const uint32_t inTimestamp) ;
+
+//--- Properties
+  private: CANFDMessage mMessage ;
+  private: volatile uint32_t mSequence = 0 ;
+  private: volatile uint32_t mTimestamp = 0 ;
+
+//--- No copy
+  private : ACAN_T4_LatestValueSlot (const ACAN_T4_LatestValueSlot &) = delete ;
+  private : ACAN_T4_LatestValueSlot & operator = (const ACAN_T4_LatestValueSlot &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,193 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: periodic frames
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+//    PERIODIC FRAME
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_PeriodicFrame::ACAN_T4_PeriodicFrame (const CANMessage & inMessage,
+                                              const uint32_t inPeriod,
+                                              const uint32_t inPhase,
+                                              const ACAN_T4_PeriodicUpdateRoutine inUpdateRoutine) :
+mPeriod ((inPeriod == 0) ? 1 : inPeriod),
+mPhase (inPhase),
+mUpdateRoutine (inUpdateRoutine),
+mMessage (inMessage) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_PeriodicFrame::ACAN_T4_PeriodicFrame (const CANFDMessage & inMessage,
+                                              const uint32_t inPeriod,
+                                              const uint32_t inPhase,
+                                              const ACAN_T4_PeriodicUpdateRoutine inUpdateRoutine) :
+mPeriod ((inPeriod == 0) ? 1 : inPeriod),
+mPhase (inPhase),
+mUpdateRoutine (inUpdateRoutine),
+mMessage (inMessage) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_PeriodicFrame::update (const CANMessage & inMessage) {
+  const CANFDMessage message (inMessage) ;
+  noInterrupts () ;
+    mMessage = message ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_PeriodicFrame::updateFD (const CANFDMessage & inMessage) {
+  noInterrupts () ;
+    mMessage = inMessage ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_PeriodicFrame::averageJitter (void) const {
+  noInterrupts () ;
+    const uint64_t sum = mJitterSum ;
+    const uint32_t count = mSentCount ;
+  interrupts () ;
+  return (count == 0) ? 0 : uint32_t (sum / count) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_PeriodicFrame::resetStatistics (void) {
+  noInterrupts () ;
+    mSentCount = 0 ;
+    mMissedCount = 0 ;
+    mMaxJitter = 0 ;
+    mJitterSum = 0 ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_PeriodicFrame::restart (const uint32_t inTick) {
+  mNextTick = inTick + mPhase ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_PeriodicFrame::submitted (const uint32_t inTick, const bool inAccepted, const uint32_t inJitter) {
+  if (inAccepted) {
+    mSentCount += 1 ;
+    mJitterSum += inJitter ;
+    if (mMaxJitter < inJitter) {
+      mMaxJitter = inJitter ;
+    }
+  }else{
+    mMissedCount += 1 ;
+  }
+//--- Next date: a missed frame is not sent again, late ticks are not caught up. If the next date
+//    is already elapsed (the frame has been disabled for more than one period), the frame is
+//    resynchronized on the current tick.
+  mNextTick += mPeriod ;
+  if (int32_t (inTick - mNextTick) >= 0) {
+    mNextTick = inTick + mPeriod ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    PERIODIC SCHEDULER
+//--------------------------------------------------------------------------------------------------
+
+static IntervalTimer gPeriodicSchedulerTimer ;
+
+volatile uint32_t ACAN_T4_PeriodicScheduler::mTick = 0 ;
+
+uint32_t ACAN_T4_PeriodicScheduler::mTickDate = 0 ;
+
+bool ACAN_T4_PeriodicScheduler::mRunning = false ;
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_PeriodicScheduler::begin (const uint8_t inPriority) {
+  end () ;
+  mTickDate = micros () ;
+  gPeriodicSchedulerTimer.priority (inPriority) ;
+  mRunning = gPeriodicSchedulerTimer.begin (timerInterruptServiceRoutine, 1000) ;
+  return mRunning ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_PeriodicScheduler::end (void) {
+  if (mRunning) {
+    gPeriodicSchedulerTimer.end () ;
+    mRunning = false ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_PeriodicScheduler::timerInterruptServiceRoutine (void) {
+  mTick += 1 ;
+  mTickDate += 1000 ;
+  ACAN_T4::can1.releaseDeferredFrames () ;
+  ACAN_T4::can2.releaseDeferredFrames () ;
+  ACAN_T4::can3.releaseDeferredFrames () ;
+  ACAN_T4::can1.sendDuePeriodicFrames (mTick, mTickDate) ;
+  ACAN_T4::can2.sendDuePeriodicFrames (mTick, mTickDate) ;
+  ACAN_T4::can3.sendDuePeriodicFrames (mTick, mTickDate) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    PERIODIC FRAME TABLE
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::setPeriodicFrames (ACAN_T4_PeriodicFrame inFrames [], const uint32_t inFrameCount) {
+  const uint32_t frameCount = (inFrames == nullptr) ? 0 : inFrameCount ;
+  noInterrupts () ;
+    const uint32_t nextTick = ACAN_T4_PeriodicScheduler::tick () + 1 ;
+    for (uint32_t i=0 ; i<frameCount ; i++) {
+      inFrames [i].restart (nextTick) ;
+    }
+    mPeriodicFrames = inFrames ;
+    mPeriodicFrameCount = frameCount ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SENDING (called by the periodic scheduler timer interrupt)
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::sendDuePeriodicFrames (const uint32_t inTick, const uint32_t inTickDate) {
+  ACAN_T4_PeriodicFrame * frames = mPeriodicFrames ;
+  const uint32_t frameCount = mPeriodicFrameCount ;
+  for (uint32_t i=0 ; i<frameCount ; i++) {
+    ACAN_T4_PeriodicFrame & frame = frames [i] ;
+    if (frame.due (inTick)) {
+      CANFDMessage & message = frame.message () ;
+      if (frame.mUpdateRoutine != nullptr) {
+        frame.mUpdateRoutine (message) ;
+      }
+      bool accepted ;
+      if (mCANFD) {
+        accepted = tryToSendFD (message) ;
+      }else{
+        CANMessage frame20B ;
+        frame20B.id = message.id ;
+        frame20B.ext = message.ext ;
+        frame20B.rtr = message.type == CANFDMessage::CAN_REMOTE ;
+        frame20B.len = (message.len > 8) ? 8 : message.len ;
+        frame20B.data64 = message.data64 [0] ;
+        accepted = tryToSend (frame20B) ;
+      }
+      const uint32_t jitter = micros () - inTickDate ;
+      frame.submitted (inTick, accepted, (int32_t (jitter) < 0) ? 0 : jitter) ;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
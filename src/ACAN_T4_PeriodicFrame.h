@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Periodic frame: a frame sent every mPeriod ms by the periodic scheduler, the first time mPhase ms
+// after it has been installed (see ACAN_T4::setPeriodicFrames). The scheduler is driven by an
+// IntervalTimer (PIT) that ticks every millisecond: due frames are submitted from the timer
+// interrupt to the driver transmit path (transmit mailbox, or transmit buffer if it is busy), so
+// sending dates do not depend on loop.
+// The application updates the payload with update(FD). Optionally, mUpdateRoutine is called by the
+// timer interrupt just before every sending, it can modify the frame (for example a rolling
+// counter and a checksum); it should be short.
+// Jitter is the delay between the scheduled date and the submission to the driver, in µs.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+
+typedef void (*ACAN_T4_PeriodicUpdateRoutine) (CANFDMessage & ioMessage) ;
+
+//--------------------------------------------------------------------------------------------------
+//   PERIODIC FRAME
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_PeriodicFrame {
+
+//--- Constructors: inPeriod and inPhase in ms (a 0 period is handled as 1 ms)
+  public: ACAN_T4_PeriodicFrame (const CANMessage & inMessage,
+                                 const uint32_t inPeriod,
+                                 const uint32_t inPhase = 0,
+                                 const ACAN_T4_PeriodicUpdateRoutine inUpdateRoutine = nullptr) ;
+
+  public: ACAN_T4_PeriodicFrame (const CANFDMessage & inMessage,
+                                 const uint32_t inPeriod,
+                                 const uint32_t inPhase = 0,
+                                 const ACAN_T4_PeriodicUpdateRoutine inUpdateRoutine = nullptr) ;
+
+//--- Settings
+  public: const uint32_t mPeriod ; // In ms
+  public: const uint32_t mPhase ; // In ms
+  public: ACAN_T4_PeriodicUpdateRoutine mUpdateRoutine ;
+  public: volatile bool mEnabled = true ; // false: the frame is not sent (periods are skipped)
+
+//--- Frame update (the whole frame is replaced within a critical section)
+  public: void update (const CANMessage & inMessage) ;
+  public: void updateFD (const CANFDMessage & inMessage) ;
+
+//--- Statistics: a frame is missed if the driver could not accept it (transmit buffer full)
+  public: inline uint32_t sentCount (void) const { return mSentCount ; }
+  public: inline uint32_t missedCount (void) const { return mMissedCount ; }
+  public: inline uint32_t maxJitter (void) const { return mMaxJitter ; } // In µs
+  public: uint32_t averageJitter (void) const ; // In µs
+  public: void resetStatistics (void) ;
+
+//--- Methods called by the periodic scheduler (inTick: ms tick count)
+  public: void restart (const uint32_t inTick) ;
+  public: inline bool due (const uint32_t inTick) const {
+    return mEnabled && (int32_t (inTick - mNextTick) >= 0) ;
+  }
+  public: inline CANFDMessage & message (void) { return mMessage ; }
+  public: void submitted (const uint32_t inTick, const bool inAccepted, const uint32_t inJitter) ;
+
+//--- Properties
+  private: CANFDMessage mMessage ;
+  private: uint32_t mNextTick = 0 ;
+  private: volatile uint32_t mSentCount = 0 ;
+  private: volatile uint32_t mMissedCount = 0 ;
+  private: volatile uint32_t mMaxJitter = 0 ;
+  private: uint64_t mJitterSum = 0 ;
+
+//--- No copy
+  private : ACAN_T4_PeriodicFrame (const ACAN_T4_PeriodicFrame &) = delete ;
+  private : ACAN_T4_PeriodicFrame & operator = (const ACAN_T4_PeriodicFrame &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//   PERIODIC SCHEDULER: a single IntervalTimer serves the periodic frames of CAN1, CAN2 and CAN3,
+//   and releases their rate limited deferred frames (see ACAN_T4_RateLimit.h)
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_PeriodicScheduler {
+
+//--- Start the 1 ms timer; returns false if no PIT channel is available. inPriority is the NVIC
+//    priority of the timer interrupt (0 is the highest priority). It should not be higher (that is
+//    numerically lower) than the mInterruptPriority of the CAN controllers: the default value is
+//    the default mInterruptPriority, so the timer interrupt never preempts a CAN interrupt.
+  public: static bool begin (const uint8_t inPriority = 128) ;
+
+//--- Stop the timer
+  public: static void end (void) ;
+
+//--- Tick count (ms), since the first call of begin
+  public: static inline uint32_t tick (void) { return mTick ; }
+
+//--- true between begin and end
+  public: static inline bool running (void) { return mRunning ; }
+
+//--- Private
+  private: static void timerInterruptServiceRoutine (void) ;
+  private: static volatile uint32_t mTick ;
+  private: static uint32_t mTickDate ; // Scheduled date of current tick (micros)
+  private: static bool mRunning ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
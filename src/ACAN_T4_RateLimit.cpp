@@ -0,0 +1,285 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: transmit rate limits
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+
+// tryToSendReturnStatus error codes are bit masks: the rate limit error should have its own bit.
+
+static_assert ((ACAN_T4::kRateLimitExceeded
+                & (ACAN_T4::kTransmitBufferOverflow
+                 | ACAN_T4::kNoAvailableMBForSendingRemoteFrame
+                 | ACAN_T4::kNoReservedMBForSendingRemoteFrame
+                 | ACAN_T4::kMessageLengthExceedsPayload
+                 | ACAN_T4::kFlexCANinCAN20BMode
+                 | ACAN_T4::kFlexCANinCANFDMode)) == 0,
+               "kRateLimitExceeded conflicts with an other send status bit") ;
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t defaultMask (const tFrameFormat inFormat) {
+  return (inFormat == kExtended) ? 0x1FFFFFFF : 0x7FF ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t tokenInterval (const uint32_t inRate) {
+  return (inRate == 0) ? 1000 * 1000 : (((1000 * 1000) < inRate) ? 1 : ((1000 * 1000) / inRate)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t bucketCapacity (const uint32_t inInterval, const uint32_t inBurst) {
+  const uint64_t capacity = uint64_t (inInterval) * ((inBurst == 0) ? 1 : inBurst) ;
+  return (capacity > UINT32_MAX) ? UINT32_MAX : uint32_t (capacity) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RATE LIMIT
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_RateLimit::ACAN_T4_RateLimit (const tFrameFormat inFormat,
+                                      const uint32_t inIdentifier,
+                                      const uint32_t inRate,
+                                      const uint32_t inBurst,
+                                      CANFDMessage inDeferBuffer [],
+                                      const uint32_t inDeferBufferSize) :
+mMask (defaultMask (inFormat)),
+mAcceptance (inIdentifier & defaultMask (inFormat)),
+mFormat (inFormat),
+mInterval (tokenInterval (inRate)),
+mBurst ((inBurst == 0) ? 1 : inBurst),
+mCapacity (bucketCapacity (mInterval, inBurst)),
+mDeferBuffer (inDeferBuffer),
+mDeferBufferSize ((inDeferBuffer == nullptr) ? 0 : inDeferBufferSize),
+mCredit (mCapacity) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_RateLimit::ACAN_T4_RateLimit (const tFrameFormat inFormat,
+                                      const uint32_t inMask,
+                                      const uint32_t inAcceptance,
+                                      const uint32_t inRate,
+                                      const uint32_t inBurst,
+                                      CANFDMessage inDeferBuffer [],
+                                      const uint32_t inDeferBufferSize) :
+mMask (inMask & defaultMask (inFormat)),
+mAcceptance (inAcceptance & inMask & defaultMask (inFormat)),
+mFormat (inFormat),
+mInterval (tokenInterval (inRate)),
+mBurst ((inBurst == 0) ? 1 : inBurst),
+mCapacity (bucketCapacity (mInterval, inBurst)),
+mDeferBuffer (inDeferBuffer),
+mDeferBufferSize ((inDeferBuffer == nullptr) ? 0 : inDeferBufferSize),
+mCredit (mCapacity) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_RateLimit::resetStatistics (void) {
+  noInterrupts () ;
+    mSentCount = 0 ;
+    mRejectedCount = 0 ;
+    mDeferredCount = 0 ;
+    mDroppedCount = 0 ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_RateLimit::restart (const uint32_t inDate) {
+  mCredit = mCapacity ;
+  mLastDate = inDate ;
+  mPendingReadIndex = 0 ;
+  mPendingCount = 0 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_RateLimit::takeToken (const uint32_t inDate) {
+//--- Refill: one µs of credit per elapsed µs, up to capacity
+  const uint32_t elapsed = inDate - mLastDate ;
+  mLastDate = inDate ;
+  mCredit = (elapsed >= (mCapacity - mCredit)) ? mCapacity : (mCredit + elapsed) ;
+//--- Take a token
+  const bool ok = mCredit >= mInterval ;
+  if (ok) {
+    mCredit -= mInterval ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_RateLimit::giveBackToken (void) {
+  mCredit = ((mCapacity - mCredit) <= mInterval) ? mCapacity : (mCredit + mInterval) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_RateLimit::defer (const CANFDMessage & inMessage) {
+//--- Deferred frames are released by the periodic scheduler: without it, they would never be sent
+  const bool ok = ACAN_T4_PeriodicScheduler::running () && (mPendingCount < mDeferBufferSize) ;
+  if (ok) {
+    uint32_t writeIndex = mPendingReadIndex + mPendingCount ;
+    if (writeIndex >= mDeferBufferSize) {
+      writeIndex -= mDeferBufferSize ;
+    }
+    mDeferBuffer [writeIndex] = inMessage ;
+    mPendingCount += 1 ;
+    mDeferredCount += 1 ;
+  }else{
+    mRejectedCount += 1 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_RateLimit::removePendingFrame (void) {
+  mPendingReadIndex = (mPendingReadIndex + 1) % mDeferBufferSize ;
+  mPendingCount -= 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RATE LIMIT TABLE
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::setRateLimits (ACAN_T4_RateLimit inLimits [], const uint32_t inLimitCount) {
+  const uint32_t limitCount = (inLimits == nullptr) ? 0 : inLimitCount ;
+  noInterrupts () ;
+    const uint32_t now = micros () ;
+    for (uint32_t i=0 ; i<limitCount ; i++) {
+      inLimits [i].restart (now) ;
+    }
+    mRateLimits = inLimits ;
+    mRateLimitCount = limitCount ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_RateLimit * ACAN_T4::findRateLimit (const uint32_t inIdentifier, const bool inExtended) const {
+  ACAN_T4_RateLimit * result = nullptr ;
+  ACAN_T4_RateLimit * limits = mRateLimits ;
+  const uint32_t limitCount = mRateLimitCount ;
+  for (uint32_t i=0 ; (i<limitCount) && (result == nullptr) ; i++) {
+    if (limits [i].matches (inIdentifier, inExtended)) {
+      result = & limits [i] ;
+    }
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RATE LIMITED SENDING (interrupts disabled)
+//--------------------------------------------------------------------------------------------------
+
+// A frame is deferred if the bucket is empty, or if previous frames of the same limit are still
+// deferred (frames are sent in order). A token is given back if the driver does not accept the
+// frame (transmit buffer full). A frame that can never be sent (see checkFrameFD) is not deferred.
+
+uint32_t ACAN_T4::rateLimitedSend (const CANMessage & inMessage, const uint32_t inLifetime) {
+  uint32_t sendStatus = 0 ;
+  ACAN_T4_RateLimit * limit = findRateLimit (inMessage.id, inMessage.ext) ;
+  if ((limit != nullptr) && ((limit->pendingCount () > 0) || !limit->takeToken (micros ()))) {
+    if (!limit->defer (CANFDMessage (inMessage))) {
+      sendStatus = kRateLimitExceeded ;
+    }
+  }else{
+    sendStatus = inMessage.rtr ? enqueueRemoteFrame (inMessage) : enqueueDataFrame (inMessage, inLifetime) ;
+    if (limit != nullptr) {
+      if (sendStatus == 0) {
+        limit->sent () ;
+      }else{
+        limit->giveBackToken () ;
+      }
+    }
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::rateLimitedSendFD (const CANFDMessage & inMessage, const uint32_t inLifetime) {
+  uint32_t sendStatus = 0 ;
+  ACAN_T4_RateLimit * limit = findRateLimit (inMessage.id, inMessage.ext) ;
+  const uint32_t frameStatus = checkFrameFD (inMessage) ;
+  if (frameStatus != 0) {
+    sendStatus = frameStatus ;
+  }else if ((limit != nullptr) && ((limit->pendingCount () > 0) || !limit->takeToken (micros ()))) {
+    if (!limit->defer (inMessage)) {
+      sendStatus = kRateLimitExceeded ;
+    }
+  }else{
+    sendStatus = (inMessage.type == CANFDMessage::CAN_REMOTE)
+      ? enqueueRemoteFrameFD (inMessage)
+      : enqueueDataFrameFD (inMessage, inLifetime) ;
+    if (limit != nullptr) {
+      if (sendStatus == 0) {
+        limit->sent () ;
+      }else{
+        limit->giveBackToken () ;
+      }
+    }
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    DEFERRED FRAMES (called by the periodic scheduler timer interrupt)
+//--------------------------------------------------------------------------------------------------
+
+// A frame the driver does not accept is retried on next tick, unless it can never be sent (the
+// payload or the mailbox layout has changed since it was deferred): it is then dropped, so that
+// it does not block the following frames of the limit.
+
+void ACAN_T4::releaseDeferredFrames (void) {
+  noInterrupts () ;
+    ACAN_T4_RateLimit * limits = mRateLimits ;
+    const uint32_t limitCount = mRateLimitCount ;
+    const uint32_t now = micros () ;
+    for (uint32_t i=0 ; i<limitCount ; i++) {
+      ACAN_T4_RateLimit & limit = limits [i] ;
+      bool released = true ;
+      while (released && (limit.pendingCount () > 0) && limit.takeToken (now)) {
+        const CANFDMessage & message = limit.pendingFrame () ;
+        uint32_t sendStatus ;
+        if (mCANFD) {
+          sendStatus = (message.type == CANFDMessage::CAN_REMOTE)
+            ? enqueueRemoteFrameFD (message)
+            : enqueueDataFrameFD (message, mTransmitFrameLifetime) ;
+        }else{
+          CANMessage frame20B ;
+          frame20B.id = message.id ;
+          frame20B.ext = message.ext ;
+          frame20B.rtr = message.type == CANFDMessage::CAN_REMOTE ;
+          frame20B.len = (message.len > 8) ? 8 : message.len ;
+          frame20B.data64 = message.data64 [0] ;
+          sendStatus = frame20B.rtr
+            ? enqueueRemoteFrame (frame20B)
+            : enqueueDataFrame (frame20B, mTransmitFrameLifetime) ;
+        }
+        released = (sendStatus & ~ (kMessageLengthExceedsPayload | kNoReservedMBForSendingRemoteFrame)) == 0 ;
+        if (sendStatus == 0) {
+          limit.removePendingFrame () ;
+          limit.sent () ;
+        }else if (released) { // Never sent: dropped
+          limit.removePendingFrame () ;
+          limit.dropped () ;
+          limit.giveBackToken () ;
+        }else{ // Driver busy: retry on next tick
+          limit.giveBackToken () ;
+        }
+      }
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
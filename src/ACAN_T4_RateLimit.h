@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Transmit rate limit: a token bucket that limits the frames sent by the application to an
+// identifier or an identifier range (see ACAN_T4::setRateLimits). The bucket holds at most mBurst
+// tokens, and is refilled at inRate tokens per second; sending a frame takes one token.
+// A frame submitted when the bucket is empty is:
+//   - rejected (tryToSend returns false), if the limit has no defer buffer;
+//   - otherwise stored in the defer buffer, and sent when a token is available: deferred frames are
+//     released by the periodic scheduler tick (see ACAN_T4_PeriodicScheduler::begin), and frames
+//     of a limit are always sent in order. A frame is rejected if the defer buffer is full, or if
+//     the periodic scheduler is not running (frames deferred before the scheduler is stopped are
+//     kept until it is started again).
+// A frame that can never be sent (length exceeds the CANFD payload, no mailbox for remote frames) is
+// never deferred: tryToSend fails. A deferred frame that can no longer be sent is dropped.
+// A deferred frame is sent with the default transmit lifetime (see mTransmitFrameLifetime).
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_RateLimit {
+
+//--- Constructors: inRate in frames per second (1 ... 1,000,000), inBurst in frames (at least 1);
+//    inDeferBuffer array is not copied, it should remain valid while the limit is installed.
+  public: ACAN_T4_RateLimit (const tFrameFormat inFormat,
+                             const uint32_t inIdentifier,
+                             const uint32_t inRate,
+                             const uint32_t inBurst,
+                             CANFDMessage inDeferBuffer [] = nullptr,
+                             const uint32_t inDeferBufferSize = 0) ;
+
+  public: ACAN_T4_RateLimit (const tFrameFormat inFormat,
+                             const uint32_t inMask,
+                             const uint32_t inAcceptance,
+                             const uint32_t inRate,
+                             const uint32_t inBurst,
+                             CANFDMessage inDeferBuffer [] = nullptr,
+                             const uint32_t inDeferBufferSize = 0) ;
+
+//--- Settings
+  public: const uint32_t mMask ;
+  public: const uint32_t mAcceptance ;
+  public: const tFrameFormat mFormat ;
+  public: const uint32_t mInterval ; // In µs, between two tokens
+  public: const uint32_t mBurst ;
+
+//--- Statistics
+  public: inline uint32_t sentCount (void) const { return mSentCount ; }
+  public: inline uint32_t rejectedCount (void) const { return mRejectedCount ; }
+  public: inline uint32_t deferredCount (void) const { return mDeferredCount ; }
+  public: inline uint32_t pendingCount (void) const { return mPendingCount ; } // Frames in defer buffer
+  public: inline uint32_t droppedCount (void) const { return mDroppedCount ; } // Deferred, never sent
+  public: void resetStatistics (void) ;
+
+//--- Methods called by the driver transmit path (interrupts disabled)
+  public: inline bool matches (const uint32_t inIdentifier, const bool inExtended) const {
+    return ((mFormat == kExtended) == inExtended) && ((inIdentifier & mMask) == mAcceptance) ;
+  }
+  public: void restart (const uint32_t inDate) ; // Full bucket
+  public: bool takeToken (const uint32_t inDate) ;
+  public: void giveBackToken (void) ;
+  public: bool defer (const CANFDMessage & inMessage) ; // Returns false if rejected
+  public: inline CANFDMessage & pendingFrame (void) { return mDeferBuffer [mPendingReadIndex] ; }
+  public: void removePendingFrame (void) ;
+  public: inline void sent (void) { mSentCount += 1 ; }
+  public: inline void dropped (void) { mDroppedCount += 1 ; }
+
+//--- Properties
+  private: const uint32_t mCapacity ; // In µs, mBurst * mInterval (saturated)
+  private: CANFDMessage * const mDeferBuffer ;
+  private: const uint32_t mDeferBufferSize ;
+  private: uint32_t mCredit = 0 ; // In µs, at most mBurst * mInterval
+  private: uint32_t mLastDate = 0 ; // micros
+  private: uint32_t mPendingReadIndex = 0 ;
+  private: volatile uint32_t mPendingCount = 0 ;
+  private: volatile uint32_t mSentCount = 0 ;
+  private: volatile uint32_t mRejectedCount = 0 ;
+  private: volatile uint32_t mDeferredCount = 0 ;
+  private: volatile uint32_t mDroppedCount = 0 ;
+
+//--- No copy
+  private : ACAN_T4_RateLimit (const ACAN_T4_RateLimit &) = delete ;
+  private : ACAN_T4_RateLimit & operator = (const ACAN_T4_RateLimit &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
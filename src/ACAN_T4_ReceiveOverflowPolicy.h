@@ -0,0 +1,29 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+
+//--------------------------------------------------------------------------------------------------
+// What happens when a frame is received while the receive buffer (or receive queue) is full:
+//   - DROP_NEWEST: the received frame is lost;
+//   - DROP_OLDEST: the oldest frame of the buffer is lost, the received frame is appended;
+//   - OVERWRITE_SAME_ID: the received frame replaces, in place, the buffered frame with the same
+//     identifier, format and kind; if there is none, the oldest frame is lost (as DROP_OLDEST).
+// In every case, the lost frame is counted as an overflow.
+//--------------------------------------------------------------------------------------------------
+
+enum class ACAN_T4_ReceiveOverflowPolicy : uint8_t {
+  DROP_NEWEST,
+  DROP_OLDEST,
+  OVERWRITE_SAME_ID
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: per filter receive queues
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+//    RECEIVE QUEUE
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_ReceiveQueue::ACAN_T4_ReceiveQueue (CANMessage inBuffer [],
+                                            const uint32_t inSize,
+                                            const ACAN_T4_ReceiveOverflowPolicy inPolicy) :
+mOverflowPolicy (inPolicy),
+mBuffer (inBuffer),
+mBufferFD (nullptr),
+mSize ((inBuffer == nullptr) ? 0 : inSize) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_ReceiveQueue::ACAN_T4_ReceiveQueue (CANFDMessage inBuffer [],
+                                            const uint32_t inSize,
+                                            const ACAN_T4_ReceiveOverflowPolicy inPolicy) :
+mOverflowPolicy (inPolicy),
+mBuffer (nullptr),
+mBufferFD (inBuffer),
+mSize ((inBuffer == nullptr) ? 0 : inSize) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ReceiveQueue::receive (CANMessage & outMessage) {
+  noInterrupts () ;
+    const bool hasMessage = (mBuffer != nullptr) && (mCount > 0) ;
+    if (hasMessage) {
+      outMessage = mBuffer [mReadIndex] ;
+      mReadIndex = (mReadIndex + 1) % mSize ;
+      mCount -= 1 ;
+    }
+  interrupts () ;
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ReceiveQueue::receiveFD (CANFDMessage & outMessage) {
+  noInterrupts () ;
+    const bool hasMessage = (mBufferFD != nullptr) && (mCount > 0) ;
+    if (hasMessage) {
+      outMessage = mBufferFD [mReadIndex] ;
+      mReadIndex = (mReadIndex + 1) % mSize ;
+      mCount -= 1 ;
+    }
+  interrupts () ;
+  return hasMessage ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_ReceiveQueue::resetCounters (void) {
+  noInterrupts () ;
+    mPeakCount = mCount ;
+    mOverflowCount = 0 ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ReceiveQueue::append (const CANMessage & inMessage) {
+  const bool full = mCount == mSize ;
+  const bool stored = (mBuffer != nullptr)
+    && acanT4AppendToReceiveRing (mBuffer, mSize, mReadIndex, mCount, mOverflowPolicy, inMessage) ;
+  if (full || !stored) {
+    mOverflowCount += 1 ;
+  }
+  if (mCount > mPeakCount) {
+    mPeakCount = mCount ;
+  }
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_ReceiveQueue::appendFD (const CANFDMessage & inMessage) {
+  const bool full = mCount == mSize ;
+  const bool stored = (mBufferFD != nullptr)
+    && acanT4AppendToReceiveRing (mBufferFD, mSize, mReadIndex, mCount, mOverflowPolicy, inMessage) ;
+  if (full || !stored) {
+    mOverflowCount += 1 ;
+  }
+  if (mCount > mPeakCount) {
+    mPeakCount = mCount ;
+  }
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RECEIVE QUEUE TABLE
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::setReceiveQueues (ACAN_T4_ReceiveQueue * inQueues [], const uint32_t inQueueCount) {
+  noInterrupts () ;
+    mReceiveQueues = inQueues ;
+    mReceiveQueueCount = (inQueues == nullptr) ? 0 : inQueueCount ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,130 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Receive queue: a receive ring, with its own overflow policy and counters, that receives the
+// frames accepted by one filter instead of the driver receive buffer (see
+// ACAN_T4::setReceiveQueues), so that a chatty filter cannot starve the others.
+// Frame storage is provided by the caller: a CANMessage array for a driver started by begin, a
+// CANFDMessage array for a driver started by beginFD.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+#include <ACAN_T4_ReceiveOverflowPolicy.h>
+
+//--------------------------------------------------------------------------------------------------
+//   RING APPEND (used by the receive interrupt service routine, for receive queues and for the
+//   driver receive buffer). Returns true if inMessage has been stored.
+//--------------------------------------------------------------------------------------------------
+
+inline bool acanT4SameFrameIdentity (const CANMessage & inA, const CANMessage & inB) {
+  return (inA.id == inB.id) && (inA.ext == inB.ext) && (inA.rtr == inB.rtr) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+inline bool acanT4SameFrameIdentity (const CANFDMessage & inA, const CANFDMessage & inB) {
+  return (inA.id == inB.id)
+    && (inA.ext == inB.ext)
+    && ((inA.type == CANFDMessage::CAN_REMOTE) == (inB.type == CANFDMessage::CAN_REMOTE)) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename MESSAGE>
+inline bool acanT4AppendToReceiveRing (MESSAGE ioRing [],
+                                       const uint32_t inSize,
+                                       volatile uint32_t & ioReadIndex,
+                                       volatile uint32_t & ioCount,
+                                       const ACAN_T4_ReceiveOverflowPolicy inPolicy,
+                                       const MESSAGE & inMessage) {
+  bool stored = inSize > 0 ;
+  if (!stored) {
+  //--- No ring
+  }else if (ioCount < inSize) {
+    uint32_t writeIndex = ioReadIndex + ioCount ;
+    if (writeIndex >= inSize) {
+      writeIndex -= inSize ;
+    }
+    ioRing [writeIndex] = inMessage ;
+    ioCount += 1 ;
+  }else if (inPolicy == ACAN_T4_ReceiveOverflowPolicy::DROP_NEWEST) {
+    stored = false ;
+  }else{
+    bool replaced = false ;
+    if (inPolicy == ACAN_T4_ReceiveOverflowPolicy::OVERWRITE_SAME_ID) {
+      uint32_t index = ioReadIndex ;
+      for (uint32_t i=0 ; (i<inSize) && !replaced ; i++) {
+        replaced = acanT4SameFrameIdentity (ioRing [index], inMessage) ;
+        if (replaced) {
+          ioRing [index] = inMessage ;
+        }
+        index += 1 ;
+        if (index == inSize) {
+          index = 0 ;
+        }
+      }
+    }
+    if (!replaced) { // Drop oldest: the received frame takes the place of the oldest one
+      ioRing [ioReadIndex] = inMessage ;
+      ioReadIndex = (ioReadIndex + 1 == inSize) ? 0 : (ioReadIndex + 1) ;
+    }
+  }
+  return stored ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   RECEIVE QUEUE
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_ReceiveQueue {
+
+//--- Constructors: inBuffer should remain valid while the queue is used
+  public: ACAN_T4_ReceiveQueue (CANMessage inBuffer [],
+                                const uint32_t inSize,
+                                const ACAN_T4_ReceiveOverflowPolicy inPolicy = ACAN_T4_ReceiveOverflowPolicy::DROP_NEWEST) ;
+
+  public: ACAN_T4_ReceiveQueue (CANFDMessage inBuffer [],
+                                const uint32_t inSize,
+                                const ACAN_T4_ReceiveOverflowPolicy inPolicy = ACAN_T4_ReceiveOverflowPolicy::DROP_NEWEST) ;
+
+//--- Overflow policy
+  public: ACAN_T4_ReceiveOverflowPolicy mOverflowPolicy ;
+
+//--- Receiving messages
+  public: bool receive (CANMessage & outMessage) ;
+  public: bool receiveFD (CANFDMessage & outMessage) ;
+
+//--- Counters
+  public: inline uint32_t size (void) const { return mSize ; }
+  public: inline uint32_t count (void) const { return mCount ; }
+  public: inline uint32_t peakCount (void) const { return mPeakCount ; }
+  public: inline uint32_t overflowCount (void) const { return mOverflowCount ; } // Lost frames
+  public: void resetCounters (void) ;
+
+//--- Methods called by the receive interrupt service routine; return true if inMessage has been
+//    stored
+  public: bool append (const CANMessage & inMessage) ;
+  public: bool appendFD (const CANFDMessage & inMessage) ;
+
+//--- Properties
+  private: CANMessage * const mBuffer ;
+  private: CANFDMessage * const mBufferFD ;
+  private: const uint32_t mSize ;
+  private: volatile uint32_t mReadIndex = 0 ;
+  private: volatile uint32_t mCount = 0 ;
+  private: volatile uint32_t mPeakCount = 0 ;
+  private: volatile uint32_t mOverflowCount = 0 ;
+
+//--- No copy
+  private : ACAN_T4_ReceiveQueue (const ACAN_T4_ReceiveQueue &) = delete ;
+  private : ACAN_T4_ReceiveQueue & operator = (const ACAN_T4_ReceiveQueue &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: frame routing between CAN1, CAN2 and CAN3
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// A frame received by a controller is checked against the routes of this controller by its
+// receive interrupt service routine; a matching frame is written in the transmit mailbox, or in
+// the transmit buffer, of the destination controller, without going through the receive buffer
+// and loop.
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+//    ROUTE
+//--------------------------------------------------------------------------------------------------
+
+static uint32_t defaultMask (const tFrameFormat inFormat) {
+  return (inFormat == kExtended) ? 0x1FFFFFFF : 0x7FF ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_Route::ACAN_T4_Route (const tFrameFormat inFormat,
+                              ACAN_T4 & inDestination) :
+mMask (0),
+mAcceptance (0),
+mFormat (inFormat),
+mDestination (& inDestination) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_Route::ACAN_T4_Route (const tFrameFormat inFormat,
+                              const uint32_t inIdentifier,
+                              ACAN_T4 & inDestination) :
+mMask (defaultMask (inFormat)),
+mAcceptance (inIdentifier & defaultMask (inFormat)),
+mFormat (inFormat),
+mDestination (& inDestination) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_Route::ACAN_T4_Route (const tFrameFormat inFormat,
+                              const uint32_t inMask,
+                              const uint32_t inAcceptance,
+                              ACAN_T4 & inDestination) :
+mMask (inMask & defaultMask (inFormat)),
+mAcceptance (inAcceptance & inMask & defaultMask (inFormat)),
+mFormat (inFormat),
+mDestination (& inDestination) {
+}
+
+//--------------------------------------------------------------------------------------------------
+//    ROUTE TABLE
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::setRoutes (ACAN_T4_Route inRoutes [], const uint32_t inRouteCount) {
+  noInterrupts () ;
+    mRoutes = inRoutes ;
+    mRouteCount = (inRoutes == nullptr) ? 0 : inRouteCount ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    ROUTING (called by the receive interrupt service routine of the source controller)
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4::routeFrame (const CANMessage & inMessage) {
+  bool routed = false ;
+  bool store = false ;
+  for (uint32_t i=0 ; i<mRouteCount ; i++) {
+    ACAN_T4_Route & route = mRoutes [i] ;
+    if (route.matches (inMessage.id, inMessage.ext)) {
+      routed = true ;
+      store |= route.mStoreInReceiveBuffer ;
+      uint32_t sendStatus ;
+      if (route.mRewriteMask == 0) {
+        sendStatus = route.mDestination->forwardFrame (inMessage) ;
+      }else{
+        CANMessage message = inMessage ;
+        message.id = route.rewrittenIdentifier (inMessage.id, inMessage.ext) ;
+        sendStatus = route.mDestination->forwardFrame (message) ;
+      }
+      if (sendStatus == 0) {
+        route.mForwardedCount += 1 ;
+      }else{
+        route.mDroppedCount += 1 ;
+      }
+    }
+  }
+  return store || !routed ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4::routeFrameFD (const CANFDMessage & inMessage) {
+  bool routed = false ;
+  bool store = false ;
+  for (uint32_t i=0 ; i<mRouteCount ; i++) {
+    ACAN_T4_Route & route = mRoutes [i] ;
+    if (route.matches (inMessage.id, inMessage.ext)) {
+      routed = true ;
+      store |= route.mStoreInReceiveBuffer ;
+      uint32_t sendStatus ;
+      if (route.mRewriteMask == 0) {
+        sendStatus = route.mDestination->forwardFrameFD (inMessage) ;
+      }else{
+        CANFDMessage message = inMessage ;
+        message.id = route.rewrittenIdentifier (inMessage.id, inMessage.ext) ;
+        sendStatus = route.mDestination->forwardFrameFD (message) ;
+      }
+      if (sendStatus == 0) {
+        route.mForwardedCount += 1 ;
+      }else{
+        route.mDroppedCount += 1 ;
+      }
+    }
+  }
+  return store || !routed ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    FORWARDING (destination controller, called by the interrupt service routine of the source
+//    controller: interrupts are disabled, as the destination interrupt may have a greater priority)
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::forwardFrame (const CANMessage & inMessage) {
+  uint32_t sendStatus = kTransmitBufferOverflow ;
+  const bool running = mCANFD ? (mTransmitBufferFD != nullptr) : (mTransmitBuffer != nullptr) ;
+  if (running && ((mGlobalStatus & kGlobalStatusInitError) == 0)) {
+    if (mCANFD) {
+      const CANFDMessage message (inMessage) ;
+      sendStatus = inMessage.rtr ? tryToSendRemoteFrameFD (message) : tryToSendDataFrameFD (message) ;
+    }else{
+      sendStatus = inMessage.rtr ? tryToSendRemoteFrame (inMessage) : tryToSendDataFrame (inMessage) ;
+    }
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4::forwardFrameFD (const CANFDMessage & inMessage) {
+  uint32_t sendStatus = kTransmitBufferOverflow ;
+  const bool running = mCANFD ? (mTransmitBufferFD != nullptr) : (mTransmitBuffer != nullptr) ;
+  if (!running || ((mGlobalStatus & kGlobalStatusInitError) != 0)) {
+  //--- Destination is not started
+  }else if (mCANFD) {
+    sendStatus = (inMessage.type == CANFDMessage::CAN_REMOTE)
+      ? tryToSendRemoteFrameFD (inMessage)
+      : tryToSendDataFrameFD (inMessage)
+    ;
+  }else if ((inMessage.type == CANFDMessage::CAN_DATA) || (inMessage.type == CANFDMessage::CAN_REMOTE)) {
+  //--- CAN 2.0B frame received by a CANFD controller, sent by a CAN 2.0B controller
+    CANMessage message ;
+    message.id = inMessage.id ;
+    message.ext = inMessage.ext ;
+    message.rtr = inMessage.type == CANFDMessage::CAN_REMOTE ;
+    message.len = (inMessage.len <= 8) ? inMessage.len : 8 ;
+    message.data64 = inMessage.data64 [0] ;
+    sendStatus = message.rtr ? tryToSendRemoteFrame (message) : tryToSendDataFrame (message) ;
+  }else{ // CANFD frame cannot be sent by a CAN 2.0B controller
+    sendStatus = kFlexCANinCAN20BMode ;
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
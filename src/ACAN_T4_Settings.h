@@ -10,6 +10,8 @@
 //--------------------------------------------------------------------------------------------------
 
 #include <ACAN_T4_T4FD_rootCANClock.h>
+#include <ACAN_T4_ReceiveOverflowPolicy.h>
+#include <ACAN_T4_CANMessage.h>
 
 //--------------------------------------------------------------------------------------------------
 
@@ -87,9 +89,50 @@ class ACAN_T4_Settings {
 //--- Receive buffer size
   public: uint16_t mReceiveBufferSize = 256 ;
 
+//--- Receive buffer overflow policy (see ACAN_T4_ReceiveOverflowPolicy.h)
+  public: ACAN_T4_ReceiveOverflowPolicy mReceiveOverflowPolicy = ACAN_T4_ReceiveOverflowPolicy::DROP_NEWEST ;
+
 //--- Transmit buffer size
   public: uint16_t mTransmitBufferSize = 16 ;
 
+//--- Transmit frame expiry: if true, every frame stored in the transmit buffer has a deadline;
+//    frames whose deadline has passed are dropped (and counted) when the transmit mailbox is
+//    refilled, instead of being sent. mTransmitFrameLifetime (in ms) is the lifetime of frames
+//    sent by tryToSend (0: no expiry), tryToSendWithLifetime sets it per frame.
+//    mExpiredTransmitFrameCallBack, if not nullptr, is called by the CAN interrupt for every
+//    dropped frame.
+  public: bool mTransmitFrameExpiry = false ;
+  public: uint32_t mTransmitFrameLifetime = 0 ;
+  public: ACANCallBackRoutine mExpiredTransmitFrameCallBack = nullptr ;
+
+//--- Polled mode: if true, the CAN interrupt is not enabled, ACAN_T4::poll should be called
+//    periodically for handling received frames and for sending buffered frames (deferred receive
+//    processing is not used in polled mode)
+  public: bool mPolledMode = false ;
+
+//--- NVIC priority of the CAN interrupt (0 is the highest priority, only the 4 upper bits are
+//    significant; 128 is the Teensyduino default priority)
+  public: uint8_t mInterruptPriority = 128 ;
+
+//--- Deferred receive processing: if true, the CAN interrupt only moves received frames to a
+//    staging buffer of mStagingBufferSize frames and refills the transmit mailbox; the frames are
+//    then processed (interrupt call backs, trace, routing, storing) by a software interrupt, whose
+//    priority is mDeferredInterruptPriority (should be lower, that is numerically greater, than
+//    mInterruptPriority)
+  public: bool mDeferredReceiveProcessing = false ;
+  public: uint8_t mDeferredInterruptPriority = 208 ;
+  public: uint16_t mStagingBufferSize = 16 ;
+
+//--- Storage provided by the application: if nullptr, begin allocates it on the heap, and end
+//    frees it. Otherwise, it is used as is, and should remain valid until end is called; the driver
+//    never frees it. Its placement selects the memory: a global array is in DTCM, DMAMEM places it
+//    in OCRAM, EXTMEM in external PSRAM.
+  public: CANMessage * mReceiveBufferStorage = nullptr ; // mReceiveBufferSize entries
+  public: CANMessage * mTransmitBufferStorage = nullptr ; // mTransmitBufferSize entries
+  public: uint32_t * mTransmitDeadlineStorage = nullptr ; // mTransmitBufferSize entries, if mTransmitFrameExpiry
+  public: CANMessage * mStagingBufferStorage = nullptr ; // mStagingBufferSize + 1 entries
+  public: ACANCallBackRoutine * mCallBackStorage = nullptr ; // 2 * (primary + secondary filter count) entries
+
 //--- Compute actual bitrate
   public: uint32_t actualBitRate (void) const ;
 
@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Compile-time signal layout, for decoding and encoding bit-packed signals of frame payloads.
+//
+// The layout (start bit, length, byte order, signedness) is given by template arguments, so that
+// every shift and mask is a compile time constant: reading a signal is one 64-bit load from data64
+// (a byte swap for Motorola signals), one shift and one mask. The bit numbering follows DBC
+// files:
+//   - Intel (little endian) signals: start bit is the least significant bit;
+//   - Motorola (big endian) signals: start bit is the most significant bit, bits are numbered
+//     7 ... 0 in byte 0, 15 ... 8 in byte 1, and so on.
+// The physical value is raw * factor + offset; factor and offset are constructor arguments.
+//
+// A frame layout is declared once, at namespace scope, for example:
+//   namespace EngineStatus {
+//     static const uint32_t kIdentifier = 0x0CF00400 ;
+//     static constexpr ACAN_T4_Signal <24, 16> kEngineSpeed (0.125f) ;
+//     static constexpr ACAN_T4_Signal <7, 12, ACAN_T4_ByteOrder::kMotorola, true> kTorque (0.5f, -100.0f) ;
+//   }
+//   const float rpm = EngineStatus::kEngineSpeed.value (message) ;
+//   EngineStatus::kTorque.setValue (message, 42.0f) ;
+//
+// A signal should lie in the frame data (8 bytes for CANMessage, 64 bytes for CANFDMessage), and
+// within 8 consecutive bytes (this is checked at compile time). Signals longer than 24 bits are
+// not exactly represented by value (float): use raw.
+// extras/ACAN_T4_DBCGenerator generates these declarations from a DBC file.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+
+enum class ACAN_T4_ByteOrder : uint8_t {kIntel, kMotorola} ;
+
+//--------------------------------------------------------------------------------------------------
+//   RAW VALUE TYPE
+//--------------------------------------------------------------------------------------------------
+
+template <bool SIGNED> struct ACAN_T4_SignalRawType { typedef uint64_t Type ; } ;
+
+template <> struct ACAN_T4_SignalRawType <true> { typedef int64_t Type ; } ;
+
+//--------------------------------------------------------------------------------------------------
+//   SIGNAL
+//--------------------------------------------------------------------------------------------------
+
+template <uint32_t START_BIT,
+          uint32_t LENGTH,
+          ACAN_T4_ByteOrder ORDER = ACAN_T4_ByteOrder::kIntel,
+          bool SIGNED = false>
+class ACAN_T4_Signal {
+
+//--- Raw value type: uint64_t, or int64_t for signed signals
+  public: typedef typename ACAN_T4_SignalRawType <SIGNED>::Type RawType ;
+
+//--- Constructor
+  public: constexpr ACAN_T4_Signal (const float inFactor = 1.0f, const float inOffset = 0.0f) :
+  mFactor (inFactor),
+  mOffset (inOffset),
+  mInverseFactor (1.0f / inFactor) {
+  }
+
+//--- Scaling
+  public: const float mFactor ;
+  public: const float mOffset ;
+  private: const float mInverseFactor ;
+
+//--- Decoding
+  public: inline RawType raw (const CANMessage & inMessage) const {
+    return extract <8> (inMessage.data64) ;
+  }
+
+  public: inline RawType raw (const CANFDMessage & inMessage) const {
+    return extract <64> (load <64> (inMessage.data64)) ;
+  }
+
+  public: inline float value (const CANMessage & inMessage) const {
+    return float (raw (inMessage)) * mFactor + mOffset ;
+  }
+
+  public: inline float value (const CANFDMessage & inMessage) const {
+    return float (raw (inMessage)) * mFactor + mOffset ;
+  }
+
+//--- Encoding (other bits of the frame data are unchanged)
+  public: inline void setRaw (CANMessage & ioMessage, const RawType inRaw) const {
+    ioMessage.data64 = insert <8> (ioMessage.data64, inRaw) ;
+  }
+
+  public: inline void setRaw (CANFDMessage & ioMessage, const RawType inRaw) const {
+    store <64> (ioMessage.data64, insert <64> (load <64> (ioMessage.data64), inRaw)) ;
+  }
+
+  public: inline void setValue (CANMessage & ioMessage, const float inValue) const {
+    setRaw (ioMessage, rawFromValue (inValue)) ;
+  }
+
+  public: inline void setValue (CANFDMessage & ioMessage, const float inValue) const {
+    setRaw (ioMessage, rawFromValue (inValue)) ;
+  }
+
+//--- Layout
+  private: static const bool MOTOROLA = ORDER == ACAN_T4_ByteOrder::kMotorola ;
+  private: static const uint64_t MASK = (LENGTH >= 64) ? ~ uint64_t (0) : ((uint64_t (1) << LENGTH) - 1) ;
+//--- Index of the most significant bit, counted from the most significant bit of byte 0
+  private: static const uint32_t MOTOROLA_MSB = (START_BIT & ~ 7U) + 7 - (START_BIT & 7) ;
+//--- Last bit of the signal: Intel, counted from the least significant bit of byte 0;
+//    Motorola, counted from the most significant bit of byte 0
+  private: static const uint32_t LAST_BIT = (MOTOROLA ? MOTOROLA_MSB : START_BIT) + LENGTH - 1 ;
+
+//--- First byte of the 64-bit word that contains the signal, in a SIZE-byte frame
+  private: static constexpr uint32_t firstByte (const uint32_t inSize) {
+    return ((START_BIT / 8) < (inSize - 8)) ? (START_BIT / 8) : (inSize - 8) ;
+  }
+
+//--- Position of the least significant bit of the signal in this word
+  private: static constexpr uint32_t shift (const uint32_t inSize) {
+    return MOTOROLA
+      ? (63 - (LAST_BIT - firstByte (inSize) * 8))
+      : (START_BIT - firstByte (inSize) * 8) ;
+  }
+
+//--- Load and store the word (byte swapped for Motorola signals)
+  private: template <uint32_t SIZE> static inline uint64_t load (const uint64_t inData64 []) {
+    uint64_t word ;
+    if ((firstByte (SIZE) % 8) == 0) {
+      word = inData64 [firstByte (SIZE) / 8] ;
+    }else{
+      memcpy (&word, ((const uint8_t *) inData64) + firstByte (SIZE), 8) ;
+    }
+    return word ;
+  }
+
+  private: template <uint32_t SIZE> static inline void store (uint64_t ioData64 [], const uint64_t inWord) {
+    if ((firstByte (SIZE) % 8) == 0) {
+      ioData64 [firstByte (SIZE) / 8] = inWord ;
+    }else{
+      memcpy (((uint8_t *) ioData64) + firstByte (SIZE), &inWord, 8) ;
+    }
+  }
+
+//--- Extract and insert the signal
+  private: template <uint32_t SIZE> static inline RawType extract (const uint64_t inWord) {
+    static_assert ((LENGTH > 0) && (LENGTH <= 64), "Invalid signal length") ;
+    static_assert (LAST_BIT < (SIZE * 8), "Signal does not fit in frame data") ;
+    static_assert ((LAST_BIT - firstByte (SIZE) * 8) < 64, "Signal spans more than 8 bytes") ;
+    const uint64_t word = MOTOROLA ? __builtin_bswap64 (inWord) : inWord ;
+    const uint64_t raw = (word >> shift (SIZE)) & MASK ;
+    return SIGNED
+      ? RawType (int64_t (raw << (64 - LENGTH)) >> (64 - LENGTH)) // Sign extension
+      : RawType (raw) ;
+  }
+
+  private: template <uint32_t SIZE> static inline uint64_t insert (const uint64_t inWord, const RawType inRaw) {
+    static_assert ((LENGTH > 0) && (LENGTH <= 64), "Invalid signal length") ;
+    static_assert (LAST_BIT < (SIZE * 8), "Signal does not fit in frame data") ;
+    static_assert ((LAST_BIT - firstByte (SIZE) * 8) < 64, "Signal spans more than 8 bytes") ;
+    const uint64_t word = MOTOROLA ? __builtin_bswap64 (inWord) : inWord ;
+    const uint64_t result = (word & ~ (MASK << shift (SIZE))) | ((uint64_t (inRaw) & MASK) << shift (SIZE)) ;
+    return MOTOROLA ? __builtin_bswap64 (result) : result ;
+  }
+
+//--- Rounded raw value
+  private: inline RawType rawFromValue (const float inValue) const {
+    const float raw = (inValue - mOffset) * mInverseFactor ;
+    return (raw >= 0.0f) ? RawType (raw + 0.5f) : RawType (int64_t (raw - 0.5f)) ;
+  }
+} ;
+
+//--------------------------------------------------------------------------------------------------
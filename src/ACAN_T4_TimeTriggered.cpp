@@ -0,0 +1,298 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver: time triggered schedule
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+//    WINDOW
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_TimeTriggeredWindow::ACAN_T4_TimeTriggeredWindow (const CANMessage & inMessage,
+                                                          const uint32_t inStart,
+                                                          const uint32_t inLength,
+                                                          const uint8_t inRepeatFactor,
+                                                          const uint8_t inCycleOffset) :
+mStart (inStart),
+mLength (inLength),
+mRepeatFactor (inRepeatFactor),
+mCycleOffset (inCycleOffset),
+mMessage (inMessage) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_TimeTriggeredWindow::ACAN_T4_TimeTriggeredWindow (const CANFDMessage & inMessage,
+                                                          const uint32_t inStart,
+                                                          const uint32_t inLength,
+                                                          const uint8_t inRepeatFactor,
+                                                          const uint8_t inCycleOffset) :
+mStart (inStart),
+mLength (inLength),
+mRepeatFactor (inRepeatFactor),
+mCycleOffset (inCycleOffset),
+mMessage (inMessage) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredWindow::update (const CANMessage & inMessage) {
+  const CANFDMessage message (inMessage) ;
+  noInterrupts () ;
+    mMessage = message ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredWindow::updateFD (const CANFDMessage & inMessage) {
+  noInterrupts () ;
+    mMessage = inMessage ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredWindow::resetStatistics (void) {
+  noInterrupts () ;
+    mSentCount = 0 ;
+    mOverrunCount = 0 ;
+    mMissedCount = 0 ;
+    mMaxStartLatency = 0 ;
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    SCHEDULE
+//--------------------------------------------------------------------------------------------------
+
+static IntervalTimer gTimeTriggeredTimer ;
+
+static ACAN_T4_TimeTriggeredSchedule * gRunningSchedule = nullptr ;
+
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_TimeTriggeredSchedule::ACAN_T4_TimeTriggeredSchedule (ACAN_T4_TimeTriggeredWindow inWindows [],
+                                                              const uint32_t inWindowCount,
+                                                              const uint32_t inBasicCycleLength,
+                                                              const uint8_t inCycleCount,
+                                                              const tFrameFormat inReferenceFormat,
+                                                              const uint32_t inReferenceIdentifier,
+                                                              const bool inTimeMaster) :
+mBasicCycleLength (inBasicCycleLength),
+mCycleCount (inCycleCount),
+mReferenceIdentifier (inReferenceIdentifier & ((inReferenceFormat == kExtended) ? 0x1FFFFFFF : 0x7FF)),
+mReferenceFormat (inReferenceFormat),
+mTimeMaster (inTimeMaster),
+mWindows (inWindows),
+mWindowCount ((inWindows == nullptr) ? 0 : inWindowCount) {
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_TimeTriggeredSchedule::begin (ACAN_T4 & inDriver,
+                                               const uint32_t inTickPeriod,
+                                               const uint8_t inPriority) {
+  uint32_t errorCode = 0 ;
+//--- Check matrix
+  bool ok = (mBasicCycleLength > 0) && (mCycleCount > 0) && (mCycleCount <= 64) && (inTickPeriod > 0) ;
+  for (uint32_t i=0 ; (i<mWindowCount) && ok ; i++) {
+    const ACAN_T4_TimeTriggeredWindow & window = mWindows [i] ;
+    ok = (window.mLength > 0)
+      && (window.mStart < mBasicCycleLength)
+      && (window.mLength <= (mBasicCycleLength - window.mStart))
+      && (window.mRepeatFactor > 0)
+      && (window.mCycleOffset < window.mRepeatFactor) ;
+  }
+  if (!ok) {
+    errorCode |= kInvalidSchedule ;
+  }
+  if ((gRunningSchedule != nullptr) || (inDriver.mTimeTriggeredSchedule != nullptr)) {
+    errorCode |= kScheduleAlreadyRunning ;
+  }
+//--- Reserve mailboxes: one per window, plus one for the reference message if time master
+  const uint32_t mailboxCount = mWindowCount + (mTimeMaster ? 1 : 0) ;
+  if ((errorCode == 0) && (mailboxCount > inDriver.timeTriggeredMailboxCapacity ())) {
+    errorCode |= kNotEnoughMailboxes ;
+  }
+//--- Start
+  if (errorCode == 0) {
+    mDriver = & inDriver ;
+    mSynchronized = false ;
+    mCycleSerial = 0 ;
+    for (uint32_t i=0 ; i<mWindowCount ; i++) {
+      mWindows [i].mPending = false ;
+      mWindows [i].mHandledCycleSerial = 0 ;
+    }
+    noInterrupts () ;
+      inDriver.mTimeTriggeredMailboxCount = mailboxCount ;
+      inDriver.mTimeTriggeredSchedule = this ;
+    interrupts () ;
+    gRunningSchedule = this ;
+    if (mTimeMaster) {
+      startCycle (mCycleCount - 1, micros () - mBasicCycleLength) ; // First cycle starts on first tick
+    }
+    gTimeTriggeredTimer.priority (inPriority) ;
+    if (!gTimeTriggeredTimer.begin (timerInterruptServiceRoutine, inTickPeriod)) {
+      errorCode |= kNoTimerAvailable ;
+      end () ;
+    }
+  }
+  return errorCode ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredSchedule::end (void) {
+  if (gRunningSchedule == this) {
+    gTimeTriggeredTimer.end () ;
+    gRunningSchedule = nullptr ;
+  }
+  if (mDriver != nullptr) {
+    noInterrupts () ;
+      for (uint32_t i=0 ; i<mWindowCount ; i++) {
+        if (mWindows [i].mPending) {
+          mDriver->abortTimeTriggeredMailbox (i) ;
+          mDriver->releaseTransmitMailbox () ;
+          mWindows [i].mPending = false ;
+        }
+      }
+      if (mTimeMaster) {
+        mDriver->abortTimeTriggeredMailbox (mWindowCount) ;
+      }
+      if (mDriver->mTimeTriggeredSchedule == this) {
+        mDriver->mTimeTriggeredSchedule = nullptr ;
+        mDriver->mTimeTriggeredMailboxCount = 0 ;
+      }
+    interrupts () ;
+    mDriver = nullptr ;
+  }
+  mSynchronized = false ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   CYCLES (interrupt context)
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredSchedule::startCycle (const uint32_t inCycle, const uint32_t inDate) {
+//--- Close windows still open from the previous cycle
+  for (uint32_t i=0 ; i<mWindowCount ; i++) {
+    if (mWindows [i].mPending) {
+      closeWindow (i) ;
+    }
+  }
+  mCycleStart = inDate ;
+  mCycle = inCycle ;
+  mCycleSerial += 1 ;
+  mSynchronized = true ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredSchedule::closeWindow (const uint32_t inWindowIndex) {
+  ACAN_T4_TimeTriggeredWindow & window = mWindows [inWindowIndex] ;
+  if (mDriver->timeTriggeredMailboxPending (inWindowIndex)) {
+    mDriver->abortTimeTriggeredMailbox (inWindowIndex) ;
+    window.mOverrunCount += 1 ;
+  }else{
+    window.mSentCount += 1 ;
+  }
+  window.mPending = false ;
+  mDriver->releaseTransmitMailbox () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredSchedule::referenceReceived (const uint8_t inCycle, const uint32_t inDate) {
+  if (!mTimeMaster) { // A time master ignores its own reference message (self reception)
+    noInterrupts () ; // The timer interrupt may have a higher priority
+      mReferenceCount += 1 ;
+      startCycle (inCycle % mCycleCount, inDate) ;
+    interrupts () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredSchedule::timerInterruptServiceRoutine (void) {
+  if (gRunningSchedule != nullptr) {
+    noInterrupts () ; // The CAN interrupt may have a higher priority
+      gRunningSchedule->tick () ;
+    interrupts () ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TimeTriggeredSchedule::tick (void) {
+  const uint32_t now = micros () ;
+  uint32_t offset = now - mCycleStart ;
+//--- Time master: send reference message at basic cycle start
+  if (mTimeMaster && (offset >= mBasicCycleLength)) {
+    const uint32_t cycleStart = (offset < (2 * mBasicCycleLength)) ? (mCycleStart + mBasicCycleLength) : now ;
+    startCycle ((mCycle + 1) % mCycleCount, cycleStart) ;
+    CANFDMessage reference ;
+    reference.id = mReferenceIdentifier ;
+    reference.ext = mReferenceFormat == kExtended ;
+    reference.type = CANFDMessage::CAN_DATA ;
+    reference.len = 1 ;
+    reference.data [0] = uint8_t (mCycle) ;
+    mDriver->writeTimeTriggeredMailbox (mWindowCount, reference) ;
+    mReferenceCount += 1 ;
+    offset = now - mCycleStart ;
+  }
+//--- Synchronization loss: no reference message within 1.5 basic cycle
+  if (mSynchronized && (offset >= (mBasicCycleLength + mBasicCycleLength / 2))) {
+    mSynchronized = false ;
+    mSynchronizationLossCount += 1 ;
+    for (uint32_t i=0 ; i<mWindowCount ; i++) {
+      if (mWindows [i].mPending) {
+        closeWindow (i) ;
+      }
+    }
+  }
+//--- Windows
+  if (mSynchronized) {
+    for (uint32_t i=0 ; i<mWindowCount ; i++) {
+      ACAN_T4_TimeTriggeredWindow & window = mWindows [i] ;
+      const uint32_t windowEnd = window.mStart + window.mLength ;
+      if (window.mPending) {
+        if (offset >= windowEnd) {
+          closeWindow (i) ;
+        }
+      }else if ((window.mHandledCycleSerial != mCycleSerial) && window.activeInCycle (mCycle)) {
+        if (offset >= windowEnd) { // Window has elapsed
+          window.mMissedCount += 1 ;
+          window.mHandledCycleSerial = mCycleSerial ;
+        }else if (offset >= window.mStart) {
+          mDriver->holdTransmitMailbox () ;
+          mDriver->writeTimeTriggeredMailbox (i, window.mMessage) ;
+          window.mPending = true ;
+          window.mHandledCycleSerial = mCycleSerial ;
+          const uint32_t latency = offset - window.mStart ;
+          if (window.mMaxStartLatency < latency) {
+            window.mMaxStartLatency = latency ;
+          }
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//    REFERENCE MESSAGE (called by the receive interrupt service routine)
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4::timeTriggeredReceive (const uint32_t inIdentifier,
+                                    const bool inExtended,
+                                    const uint8_t inFirstByte) {
+  ACAN_T4_TimeTriggeredSchedule * schedule = mTimeTriggeredSchedule ;
+  if ((schedule != nullptr) && schedule->isReference (inIdentifier, inExtended)) {
+    schedule->referenceReceived (inFirstByte, micros ()) ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Time triggered schedule (TTCAN like system matrix).
+// Time is divided into basic cycles of mBasicCycleLength µs; a matrix cycle is made of
+// mCycleCount basic cycles, numbered 0 ... mCycleCount-1. Each basic cycle starts with the
+// reference message, whose first data byte is the basic cycle number:
+//   - a time master sends the reference message itself, every mBasicCycleLength µs;
+//   - otherwise, the schedule synchronizes on the reference message received from the bus (its
+//     reception date is taken by the receive interrupt). If no reference message is received
+//     within 1.5 basic cycle, synchronization is lost and no frame is sent until the next one.
+// A window is an exclusive time window of a basic cycle, reserved for one frame: the frame is
+// written in a dedicated Tx mailbox at the window start, in the basic cycles c such that
+// c % mRepeatFactor == mCycleOffset. If it has not been sent at the window end, the transmission
+// is aborted and counted as an overrun. A window that elapses before its frame has been written
+// (late timer interrupt) is counted as missed. While synchronization is lost, the basic cycle
+// number is unknown: windows are neither handled nor counted as missed (see
+// synchronizationLossCount).
+// While a window is pending, frames sent by tryToSend / tryToSendFD stay in the transmit buffer:
+// the data frame Tx mailbox is refilled when the window closes. A frame already written in that
+// mailbox at the window start is not aborted, and remote frames are not held.
+// The schedule is driven by an IntervalTimer (PIT) that ticks every inTickPeriod µs: window starts
+// are resolved to one tick, the actual latency is measured (maxStartLatency).
+// Dedicated Tx mailboxes are taken from the mailboxes used for sending remote frames (one per
+// window, plus one for the reference message if time master). Only one schedule can run at a time.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4 ;
+
+//--------------------------------------------------------------------------------------------------
+//   WINDOW
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_TimeTriggeredWindow {
+
+//--- Constructors: inStart and inLength in µs from the basic cycle start
+  public: ACAN_T4_TimeTriggeredWindow (const CANMessage & inMessage,
+                                       const uint32_t inStart,
+                                       const uint32_t inLength,
+                                       const uint8_t inRepeatFactor = 1,
+                                       const uint8_t inCycleOffset = 0) ;
+
+  public: ACAN_T4_TimeTriggeredWindow (const CANFDMessage & inMessage,
+                                       const uint32_t inStart,
+                                       const uint32_t inLength,
+                                       const uint8_t inRepeatFactor = 1,
+                                       const uint8_t inCycleOffset = 0) ;
+
+//--- Settings
+  public: const uint32_t mStart ; // In µs
+  public: const uint32_t mLength ; // In µs
+  public: const uint8_t mRepeatFactor ;
+  public: const uint8_t mCycleOffset ;
+
+//--- Frame update (the whole frame is replaced within a critical section)
+  public: void update (const CANMessage & inMessage) ;
+  public: void updateFD (const CANFDMessage & inMessage) ;
+
+//--- Statistics
+  public: inline uint32_t sentCount (void) const { return mSentCount ; }
+  public: inline uint32_t overrunCount (void) const { return mOverrunCount ; }
+  public: inline uint32_t missedCount (void) const { return mMissedCount ; }
+  public: inline uint32_t maxStartLatency (void) const { return mMaxStartLatency ; } // In µs
+  public: void resetStatistics (void) ;
+
+//--- Methods called by the schedule
+  public: inline bool activeInCycle (const uint32_t inCycle) const {
+    return (inCycle % mRepeatFactor) == mCycleOffset ;
+  }
+
+//--- Properties
+  private: CANFDMessage mMessage ;
+  private: uint32_t mHandledCycleSerial = 0 ; // Serial number of the basic cycle the window has been handled in
+  private: bool mPending = false ; // Frame written in the mailbox, window end not reached
+  private: volatile uint32_t mSentCount = 0 ;
+  private: volatile uint32_t mOverrunCount = 0 ;
+  private: volatile uint32_t mMissedCount = 0 ;
+  private: volatile uint32_t mMaxStartLatency = 0 ;
+
+//--- Friend
+  friend class ACAN_T4_TimeTriggeredSchedule ;
+
+//--- No copy
+  private : ACAN_T4_TimeTriggeredWindow (const ACAN_T4_TimeTriggeredWindow &) = delete ;
+  private : ACAN_T4_TimeTriggeredWindow & operator = (const ACAN_T4_TimeTriggeredWindow &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//   SCHEDULE
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_TimeTriggeredSchedule {
+
+//--- Constructor: inWindows array is not copied, it should remain valid while the schedule is used
+  public: ACAN_T4_TimeTriggeredSchedule (ACAN_T4_TimeTriggeredWindow inWindows [],
+                                         const uint32_t inWindowCount,
+                                         const uint32_t inBasicCycleLength, // In µs
+                                         const uint8_t inCycleCount, // 1 ... 64
+                                         const tFrameFormat inReferenceFormat,
+                                         const uint32_t inReferenceIdentifier,
+                                         const bool inTimeMaster) ;
+
+//--- Settings
+  public: const uint32_t mBasicCycleLength ;
+  public: const uint8_t mCycleCount ;
+  public: const uint32_t mReferenceIdentifier ;
+  public: const tFrameFormat mReferenceFormat ;
+  public: const bool mTimeMaster ;
+
+//--- begin: inDriver should have been started (begin or beginFD). Returns 0 if ok, or an error
+//    code. inPriority is the NVIC priority of the timer interrupt (0 is the highest priority).
+  public: uint32_t begin (ACAN_T4 & inDriver,
+                          const uint32_t inTickPeriod = 50, // In µs
+                          const uint8_t inPriority = 32) ;
+  public: static const uint32_t kInvalidSchedule = 1 << 0 ;
+  public: static const uint32_t kNotEnoughMailboxes = 1 << 1 ;
+  public: static const uint32_t kScheduleAlreadyRunning = 1 << 2 ;
+  public: static const uint32_t kNoTimerAvailable = 1 << 3 ;
+
+//--- end: stops the timer, aborts pending frames and releases the mailboxes
+  public: void end (void) ;
+
+//--- State and statistics
+  public: inline bool synchronized (void) const { return mSynchronized ; }
+  public: inline uint32_t currentCycle (void) const { return mCycle ; }
+  public: inline uint32_t referenceCount (void) const { return mReferenceCount ; }
+  public: inline uint32_t synchronizationLossCount (void) const { return mSynchronizationLossCount ; }
+
+//--- Methods called by the receive interrupt service routine of the driver
+  public: inline bool isReference (const uint32_t inIdentifier, const bool inExtended) const {
+    return (inIdentifier == mReferenceIdentifier) && ((mReferenceFormat == kExtended) == inExtended) ;
+  }
+  public: void referenceReceived (const uint8_t inCycle, const uint32_t inDate) ;
+
+//--- Private methods
+  private: static void timerInterruptServiceRoutine (void) ;
+  private: void tick (void) ;
+  private: void startCycle (const uint32_t inCycle, const uint32_t inDate) ;
+  private: void closeWindow (const uint32_t inWindowIndex) ;
+
+//--- Properties
+  private: ACAN_T4_TimeTriggeredWindow * const mWindows ;
+  private: const uint32_t mWindowCount ;
+  private: ACAN_T4 * mDriver = nullptr ;
+  private: uint32_t mCycleStart = 0 ; // micros
+  private: uint32_t mCycleSerial = 0 ; // Incremented on every basic cycle start
+  private: volatile uint32_t mCycle = 0 ;
+  private: volatile bool mSynchronized = false ;
+  private: volatile uint32_t mReferenceCount = 0 ;
+  private: volatile uint32_t mSynchronizationLossCount = 0 ;
+
+//--- No copy
+  private : ACAN_T4_TimeTriggeredSchedule (const ACAN_T4_TimeTriggeredSchedule &) = delete ;
+  private : ACAN_T4_TimeTriggeredSchedule & operator = (const ACAN_T4_TimeTriggeredSchedule &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
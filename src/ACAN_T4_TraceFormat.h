@@ -0,0 +1,197 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Binary trace format, used by ACAN_T4_TraceRecorder for capturing bus traffic.
+// This header has no hardware dependency, it is also used by host-side tools.
+//
+// A trace is a sequence of 512-byte blocks (one SD card sector each).
+//
+// Block header (16 bytes, little endian):
+//   offset 0 : magic (4 bytes, "ACT4")
+//   offset 4 : block sequence number (uint32_t), starts at 0
+//   offset 8 : number of used bytes, header included (uint16_t)
+//   offset 10 : number of records in the block (uint16_t)
+//   offset 12 : number of frames lost since previous block (uint32_t)
+//
+// Records follow the header, a record never straddles two blocks. Record layout:
+//   offset 0 : timestamp, in µs (uint32_t, wraps around every 71 minutes)
+//   offset 4 : identifier and flags (uint32_t)
+//                bits 0 ... 28: identifier
+//                bit 29: extended frame
+//                bits 30 ... 31: frame type (CANFDMessage::Type values)
+//   offset 8 : data length (uint8_t, 0 ... 64)
+//   offset 9 : channel (uint8_t, 0 for CAN1, 1 for CAN2, 2 for CAN3)
+//   offset 10 : data bytes (none for remote frames)
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+//   BLOCK LAYOUT
+//--------------------------------------------------------------------------------------------------
+
+static const uint32_t ACAN_T4_TRACE_BLOCK_SIZE = 512 ;
+
+static const uint32_t ACAN_T4_TRACE_BLOCK_HEADER_SIZE = 16 ;
+
+static const uint32_t ACAN_T4_TRACE_BLOCK_MAGIC = 0x34544341 ; // "ACT4", little endian
+
+static const uint32_t ACAN_T4_TRACE_RECORD_HEADER_SIZE = 10 ;
+
+static const uint32_t ACAN_T4_TRACE_EXTENDED_FLAG = 1U << 29 ;
+
+static const uint32_t ACAN_T4_TRACE_TYPE_SHIFT = 30 ;
+
+//--- Frame type values, same as CANFDMessage::Type
+static const uint8_t ACAN_T4_TRACE_REMOTE = 0 ;
+static const uint8_t ACAN_T4_TRACE_DATA = 1 ;
+static const uint8_t ACAN_T4_TRACE_FD_NO_BIT_RATE_SWITCH = 2 ;
+static const uint8_t ACAN_T4_TRACE_FD_WITH_BIT_RATE_SWITCH = 3 ;
+
+//--------------------------------------------------------------------------------------------------
+//   DECODED RECORD
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_TraceRecord {
+  public: uint32_t mTimestamp = 0 ; // In µs
+  public: uint32_t mIdentifier = 0 ;
+  public: bool mExtended = false ;
+  public: uint8_t mType = ACAN_T4_TRACE_DATA ;
+  public: uint8_t mLength = 0 ;
+  public: uint8_t mChannel = 0 ;
+  public: const uint8_t * mData = nullptr ; // Points into the block, mLength bytes
+} ;
+
+//--------------------------------------------------------------------------------------------------
+//   LITTLE ENDIAN ACCESS (trace is portable, whatever the host endianness)
+//--------------------------------------------------------------------------------------------------
+
+inline void acanTraceWrite16 (uint8_t * outBytes, const uint32_t inValue) {
+  outBytes [0] = uint8_t (inValue) ;
+  outBytes [1] = uint8_t (inValue >> 8) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+inline void acanTraceWrite32 (uint8_t * outBytes, const uint32_t inValue) {
+  outBytes [0] = uint8_t (inValue) ;
+  outBytes [1] = uint8_t (inValue >> 8) ;
+  outBytes [2] = uint8_t (inValue >> 16) ;
+  outBytes [3] = uint8_t (inValue >> 24) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+inline uint32_t acanTraceRead16 (const uint8_t * inBytes) {
+  return uint32_t (inBytes [0]) | (uint32_t (inBytes [1]) << 8) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+inline uint32_t acanTraceRead32 (const uint8_t * inBytes) {
+  return
+    uint32_t (inBytes [0]) | (uint32_t (inBytes [1]) << 8) |
+    (uint32_t (inBytes [2]) << 16) | (uint32_t (inBytes [3]) << 24)
+  ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   RECORD ENCODING
+//--------------------------------------------------------------------------------------------------
+
+inline uint32_t acanTraceRecordSize (const uint8_t inType, const uint8_t inLength) {
+  return ACAN_T4_TRACE_RECORD_HEADER_SIZE + ((inType == ACAN_T4_TRACE_REMOTE) ? 0 : inLength) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// outRecord should have room for acanTraceRecordSize (inType, inLength) bytes; returns the record size
+
+inline uint32_t acanTraceEncodeRecord (uint8_t * outRecord,
+                                       const uint32_t inTimestamp,
+                                       const uint32_t inIdentifier,
+                                       const bool inExtended,
+                                       const uint8_t inType,
+                                       const uint8_t inLength,
+                                       const uint8_t inChannel,
+                                       const uint8_t * inData) {
+  acanTraceWrite32 (outRecord, inTimestamp) ;
+  acanTraceWrite32 (outRecord + 4,
+    (inIdentifier & 0x1FFFFFFF) |
+    (inExtended ? ACAN_T4_TRACE_EXTENDED_FLAG : 0) |
+    (uint32_t (inType & 3) << ACAN_T4_TRACE_TYPE_SHIFT)
+  ) ;
+  outRecord [8] = inLength ;
+  outRecord [9] = inChannel ;
+  const uint32_t dataLength = (inType == ACAN_T4_TRACE_REMOTE) ? 0 : inLength ;
+  memcpy (outRecord + ACAN_T4_TRACE_RECORD_HEADER_SIZE, inData, dataLength) ;
+  return ACAN_T4_TRACE_RECORD_HEADER_SIZE + dataLength ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns the record size, or 0 if the record is malformed (inAvailableBytes too small)
+
+inline uint32_t acanTraceDecodeRecord (const uint8_t * inRecord,
+                                       const uint32_t inAvailableBytes,
+                                       ACAN_T4_TraceRecord & outRecord) {
+  uint32_t recordSize = 0 ;
+  if (inAvailableBytes >= ACAN_T4_TRACE_RECORD_HEADER_SIZE) {
+    const uint32_t idAndFlags = acanTraceRead32 (inRecord + 4) ;
+    outRecord.mTimestamp = acanTraceRead32 (inRecord) ;
+    outRecord.mIdentifier = idAndFlags & 0x1FFFFFFF ;
+    outRecord.mExtended = (idAndFlags & ACAN_T4_TRACE_EXTENDED_FLAG) != 0 ;
+    outRecord.mType = uint8_t (idAndFlags >> ACAN_T4_TRACE_TYPE_SHIFT) ;
+    outRecord.mLength = inRecord [8] ;
+    outRecord.mChannel = inRecord [9] ;
+    outRecord.mData = inRecord + ACAN_T4_TRACE_RECORD_HEADER_SIZE ;
+    const uint32_t size = acanTraceRecordSize (outRecord.mType, outRecord.mLength) ;
+    if ((outRecord.mLength <= 64) && (size <= inAvailableBytes)) {
+      recordSize = size ;
+    }
+  }
+  return recordSize ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//   BLOCK HEADER
+//--------------------------------------------------------------------------------------------------
+
+inline void acanTraceWriteBlockHeader (uint8_t * outBlock,
+                                       const uint32_t inSequenceNumber,
+                                       const uint32_t inUsedBytes,
+                                       const uint32_t inRecordCount,
+                                       const uint32_t inLostFrameCount) {
+  acanTraceWrite32 (outBlock, ACAN_T4_TRACE_BLOCK_MAGIC) ;
+  acanTraceWrite32 (outBlock + 4, inSequenceNumber) ;
+  acanTraceWrite16 (outBlock + 8, inUsedBytes) ;
+  acanTraceWrite16 (outBlock + 10, inRecordCount) ;
+  acanTraceWrite32 (outBlock + 12, inLostFrameCount) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns false if the block is not a valid trace block
+
+inline bool acanTraceReadBlockHeader (const uint8_t * inBlock,
+                                      uint32_t & outSequenceNumber,
+                                      uint32_t & outUsedBytes,
+                                      uint32_t & outRecordCount,
+                                      uint32_t & outLostFrameCount) {
+  outSequenceNumber = acanTraceRead32 (inBlock + 4) ;
+  outUsedBytes = acanTraceRead16 (inBlock + 8) ;
+  outRecordCount = acanTraceRead16 (inBlock + 10) ;
+  outLostFrameCount = acanTraceRead32 (inBlock + 12) ;
+  return
+    (acanTraceRead32 (inBlock) == ACAN_T4_TRACE_BLOCK_MAGIC) &&
+    (outUsedBytes >= ACAN_T4_TRACE_BLOCK_HEADER_SIZE) &&
+    (outUsedBytes <= ACAN_T4_TRACE_BLOCK_SIZE)
+  ;
+}
+
+//--------------------------------------------------------------------------------------------------
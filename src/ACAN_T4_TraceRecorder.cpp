@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_TraceRecorder.h>
+
+//--------------------------------------------------------------------------------------------------
+//    CONSTRUCTOR
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_TraceRecorder::ACAN_T4_TraceRecorder (void) {
+}
+
+//--------------------------------------------------------------------------------------------------
+//    begin
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_TraceRecorder::begin (uint8_t * inBlockStorage, const uint32_t inBlockCount) {
+  const bool ok = (inBlockStorage != nullptr) && (inBlockCount >= 2) ;
+  if (ok) {
+    noInterrupts () ;
+      mBlockStorage = inBlockStorage ;
+      mBlockCount = inBlockCount ;
+      mWriteBlockIndex = 0 ;
+      mWriteOffset = ACAN_T4_TRACE_BLOCK_HEADER_SIZE ;
+      mWriteRecordCount = 0 ;
+      mSequenceNumber = 0 ;
+      mLostFrameCount = 0 ;
+      mReadBlockIndex = 0 ;
+      mFullBlockCount = 0 ;
+      mFullBlockPeakCount = 0 ;
+      mRecordedFrameCount = 0 ;
+      mTotalLostFrameCount = 0 ;
+    interrupts () ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    RECORDING
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceRecorder::record (const CANMessage & inMessage,
+                                    const uint8_t inChannel,
+                                    const uint32_t inTimestamp) {
+  append (inTimestamp,
+          inMessage.id,
+          inMessage.ext,
+          inMessage.rtr ? ACAN_T4_TRACE_REMOTE : ACAN_T4_TRACE_DATA,
+          (inMessage.len <= 8) ? inMessage.len : 8,
+          inChannel,
+          inMessage.data) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceRecorder::recordFD (const CANFDMessage & inMessage,
+                                      const uint8_t inChannel,
+                                      const uint32_t inTimestamp) {
+  append (inTimestamp,
+          inMessage.id,
+          inMessage.ext,
+          uint8_t (inMessage.type),
+          (inMessage.len <= 64) ? inMessage.len : 64,
+          inChannel,
+          inMessage.data) ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceRecorder::append (const uint32_t inTimestamp,
+                                    const uint32_t inIdentifier,
+                                    const bool inExtended,
+                                    const uint8_t inType,
+                                    const uint8_t inLength,
+                                    const uint8_t inChannel,
+                                    const uint8_t * inData) {
+//--- Critical section: a recorder may be fed by several controllers, whose interrupts may have
+//    different priorities
+  noInterrupts () ;
+    if (mBlockStorage != nullptr) {
+      const uint32_t recordSize = acanTraceRecordSize (inType, inLength) ;
+      bool ok = (mWriteOffset + recordSize) <= ACAN_T4_TRACE_BLOCK_SIZE ;
+      if (!ok) {
+        ok = closeCurrentBlock () ;
+      }
+      if (ok) {
+        mWriteOffset += acanTraceEncodeRecord (block (mWriteBlockIndex) + mWriteOffset,
+                                               inTimestamp,
+                                               inIdentifier,
+                                               inExtended,
+                                               inType,
+                                               inLength,
+                                               inChannel,
+                                               inData) ;
+        mWriteRecordCount += 1 ;
+        mRecordedFrameCount += 1 ;
+      }else{ // All blocks are full: frame is lost
+        mLostFrameCount += 1 ;
+        mTotalLostFrameCount += 1 ;
+      }
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Should be called with interrupts disabled.
+// Returns false if there is no free block for continuing recording.
+
+bool ACAN_T4_TraceRecorder::closeCurrentBlock (void) {
+//--- One block is the one being filled, so at most mBlockCount - 1 blocks can be full
+  const bool ok = (mFullBlockCount + 1) < mBlockCount ;
+  if (ok) {
+    uint8_t * currentBlock = block (mWriteBlockIndex) ;
+  //--- Zero unused bytes, for writing deterministic sectors
+    memset (currentBlock + mWriteOffset, 0, ACAN_T4_TRACE_BLOCK_SIZE - mWriteOffset) ;
+    acanTraceWriteBlockHeader (currentBlock,
+                               mSequenceNumber,
+                               mWriteOffset,
+                               mWriteRecordCount,
+                               mLostFrameCount) ;
+    mSequenceNumber += 1 ;
+    mLostFrameCount = 0 ;
+    mFullBlockCount += 1 ;
+    if (mFullBlockPeakCount < mFullBlockCount) {
+      mFullBlockPeakCount = mFullBlockCount ;
+    }
+  //--- Continue with next block
+    mWriteBlockIndex += 1 ;
+    if (mWriteBlockIndex == mBlockCount) {
+      mWriteBlockIndex = 0 ;
+    }
+    mWriteOffset = ACAN_T4_TRACE_BLOCK_HEADER_SIZE ;
+    mWriteRecordCount = 0 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceRecorder::flush (void) {
+  noInterrupts () ;
+    if ((mBlockStorage != nullptr) && ((mWriteRecordCount > 0) || (mLostFrameCount > 0))) {
+      closeCurrentBlock () ;
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    READING FULL BLOCKS
+//--------------------------------------------------------------------------------------------------
+
+const uint8_t * ACAN_T4_TraceRecorder::fullBlock (void) const {
+  return (mFullBlockCount > 0) ? block (mReadBlockIndex) : nullptr ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceRecorder::releaseBlock (void) {
+  noInterrupts () ;
+    if (mFullBlockCount > 0) {
+      mFullBlockCount -= 1 ;
+      uint32_t readBlockIndex = mReadBlockIndex + 1 ;
+      if (readBlockIndex == mBlockCount) {
+        readBlockIndex = 0 ;
+      }
+      mReadBlockIndex = readBlockIndex ;
+    }
+  interrupts () ;
+}
+
+//--------------------------------------------------------------------------------------------------
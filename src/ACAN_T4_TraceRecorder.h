@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Trace recorder: packs received frames into 512-byte blocks (see ACAN_T4_TraceFormat.h).
+// Records are appended by the driver receive interrupt service routine (see
+// ACAN_T4::setTraceRecorder), with interrupts disabled: a recorder can be shared by several
+// controllers, whatever their interrupt priorities. Full blocks are written by loop, for example on
+// a SD card.
+// Block storage is provided by the caller: with two blocks, recording is double buffered; more
+// blocks absorb longer write latencies of the card.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_CANFDMessage.h>
+#include <ACAN_T4_TraceFormat.h>
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_TraceRecorder {
+
+//--- Constructor
+  public: ACAN_T4_TraceRecorder (void) ;
+
+//--- begin: inBlockStorage should contain inBlockCount * ACAN_T4_TRACE_BLOCK_SIZE bytes,
+//    inBlockCount should be >= 2. Returns false if arguments are invalid.
+  public: bool begin (uint8_t * inBlockStorage, const uint32_t inBlockCount) ;
+
+//--- Append a frame (can be called from an interrupt service routine)
+  public: void record (const CANMessage & inMessage,
+                       const uint8_t inChannel,
+                       const uint32_t inTimestamp) ;
+
+  public: void recordFD (const CANFDMessage & inMessage,
+                         const uint8_t inChannel,
+                         const uint32_t inTimestamp) ;
+
+//--- Get the oldest full block (nullptr if none), and release it once written
+  public: const uint8_t * fullBlock (void) const ;
+  public: void releaseBlock (void) ;
+  public: inline uint32_t fullBlockCount (void) const { return mFullBlockCount ; }
+
+//--- Close the block being filled, if not empty, so that it becomes available by fullBlock
+  public: void flush (void) ;
+
+//--- Statistics
+  public: inline uint32_t recordedFrameCount (void) const { return mRecordedFrameCount ; }
+  public: inline uint32_t lostFrameCount (void) const { return mTotalLostFrameCount ; }
+  public: inline uint32_t fullBlockPeakCount (void) const { return mFullBlockPeakCount ; }
+
+//--- Private methods
+  private: void append (const uint32_t inTimestamp,
+                        const uint32_t inIdentifier,
+                        const bool inExtended,
+                        const uint8_t inType,
+                        const uint8_t inLength,
+                        const uint8_t inChannel,
+                        const uint8_t * inData) ;
+  private: bool closeCurrentBlock (void) ;
+  private: inline uint8_t * block (const uint32_t inIndex) const {
+    return mBlockStorage + inIndex * ACAN_T4_TRACE_BLOCK_SIZE ;
+  }
+
+//--- Properties
+  private: uint8_t * mBlockStorage = nullptr ;
+  private: uint32_t mBlockCount = 0 ;
+  private: uint32_t mWriteBlockIndex = 0 ;
+  private: uint32_t mWriteOffset = ACAN_T4_TRACE_BLOCK_HEADER_SIZE ;
+  private: uint32_t mWriteRecordCount = 0 ;
+  private: uint32_t mSequenceNumber = 0 ;
+  private: uint32_t mLostFrameCount = 0 ; // Since previous closed block
+  private: volatile uint32_t mReadBlockIndex = 0 ;
+  private: volatile uint32_t mFullBlockCount = 0 ;
+  private: volatile uint32_t mFullBlockPeakCount = 0 ;
+  private: volatile uint32_t mRecordedFrameCount = 0 ;
+  private: volatile uint32_t mTotalLostFrameCount = 0 ;
+
+//--- No copy
+  private : ACAN_T4_TraceRecorder (const ACAN_T4_TraceRecorder &) = delete ;
+  private : ACAN_T4_TraceRecorder & operator = (const ACAN_T4_TraceRecorder &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,239 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4_TraceReplayer.h>
+
+//--------------------------------------------------------------------------------------------------
+//    CONSTRUCTOR
+//--------------------------------------------------------------------------------------------------
+
+ACAN_T4_TraceReplayer::ACAN_T4_TraceReplayer (void) {
+}
+
+//--------------------------------------------------------------------------------------------------
+//    begin
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_TraceReplayer::begin (ACAN_T4 & inDriver,
+                                   uint8_t * inBlockStorage,
+                                   const uint32_t inBlockCount,
+                                   const uint32_t inTimeScalePercent,
+                                   const uint8_t inChannel) {
+  const bool ok = (inBlockStorage != nullptr) && (inBlockCount >= 2) ;
+  if (ok) {
+    mDriver = & inDriver ;
+    mBlockStorage = inBlockStorage ;
+    mBlockCount = inBlockCount ;
+    mReadBlockIndex = 0 ;
+    mFilledBlockCount = 0 ;
+    mReadOffset = 0 ;
+    mReadUsedBytes = 0 ;
+    mReadRemainingRecords = 0 ;
+    mEndOfTrace = false ;
+    mTimeScalePercent = inTimeScalePercent ;
+    mChannel = inChannel ;
+    mHasPendingRecord = false ;
+    mPendingDate = 0 ;
+    mStarted = false ;
+    mHasTraceOrigin = false ;
+    mPreviousTraceTimestamp = 0 ;
+    mTraceTime = 0 ;
+    mPreviousMicros = 0 ;
+    mElapsedTime = 0 ;
+    mSentFrameCount = 0 ;
+    mDroppedFrameCount = 0 ;
+    mInvalidBlockCount = 0 ;
+    mMaxTimingError = 0 ;
+    mTimingErrorSum = 0 ;
+  }
+  return ok ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    TRACE BLOCKS
+//--------------------------------------------------------------------------------------------------
+
+uint8_t * ACAN_T4_TraceReplayer::freeBlock (void) const {
+  uint8_t * result = nullptr ;
+  if ((mBlockStorage != nullptr) && (mFilledBlockCount < mBlockCount) && !mEndOfTrace) {
+    uint32_t index = mReadBlockIndex + mFilledBlockCount ;
+    if (index >= mBlockCount) {
+      index -= mBlockCount ;
+    }
+    result = block (index) ;
+  }
+  return result ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceReplayer::commitBlock (void) {
+  if (mFilledBlockCount < mBlockCount) {
+    mFilledBlockCount += 1 ;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceReplayer::endOfTrace (void) {
+  mEndOfTrace = true ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ACAN_T4_TraceReplayer::releaseBlock (void) {
+  mReadOffset = 0 ;
+  mReadBlockIndex += 1 ;
+  if (mReadBlockIndex == mBlockCount) {
+    mReadBlockIndex = 0 ;
+  }
+  mFilledBlockCount -= 1 ;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Decodes records until one matches selected channel; returns true if a record is pending
+
+bool ACAN_T4_TraceReplayer::nextRecord (void) {
+  while (!mHasPendingRecord && (mFilledBlockCount > 0)) {
+    const uint8_t * currentBlock = block (mReadBlockIndex) ;
+    if (mReadOffset == 0) { // Read block header
+      uint32_t sequenceNumber ;
+      uint32_t lostFrameCount ;
+      const bool valid = acanTraceReadBlockHeader (currentBlock,
+                                                   sequenceNumber,
+                                                   mReadUsedBytes,
+                                                   mReadRemainingRecords,
+                                                   lostFrameCount) ;
+      if (valid) {
+        mReadOffset = ACAN_T4_TRACE_BLOCK_HEADER_SIZE ;
+      }else{
+        mInvalidBlockCount += 1 ;
+        releaseBlock () ;
+      }
+    }else if (mReadRemainingRecords == 0) { // Block is exhausted
+      releaseBlock () ;
+    }else{
+      ACAN_T4_TraceRecord record ;
+      const uint32_t size = acanTraceDecodeRecord (currentBlock + mReadOffset,
+                                                   mReadUsedBytes - mReadOffset,
+                                                   record) ;
+      if (size == 0) { // Malformed record: skip the end of the block
+        mInvalidBlockCount += 1 ;
+        releaseBlock () ;
+      }else{
+        mReadOffset += size ;
+        mReadRemainingRecords -= 1 ;
+      //--- Trace time takes all channels into account
+        if (mHasTraceOrigin) {
+          mTraceTime += uint32_t (record.mTimestamp - mPreviousTraceTimestamp) ; // Modulo 2**32
+        }
+        mHasTraceOrigin = true ;
+        mPreviousTraceTimestamp = record.mTimestamp ;
+      //--- Keep record ?
+        if ((mChannel == ACAN_T4_TRACE_ALL_CHANNELS) || (mChannel == record.mChannel)) {
+          const uint32_t dataLength = (record.mType == ACAN_T4_TRACE_REMOTE) ? 0 : record.mLength ;
+          memcpy (mPendingData, record.mData, dataLength) ;
+          mPendingRecord = record ;
+          mPendingRecord.mData = mPendingData ;
+          mPendingDate = (mTraceTime * mTimeScalePercent) / 100 ;
+          mHasPendingRecord = true ;
+        }
+      }
+    }
+  }
+  return mHasPendingRecord ;
+}
+
+//--------------------------------------------------------------------------------------------------
+//    REPLAY
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_TraceReplayer::trySendPendingRecord (void) {
+  uint32_t sendStatus ;
+  if (mDriver->isCANFDMode ()) {
+    CANFDMessage message ;
+    message.id = mPendingRecord.mIdentifier ;
+    message.ext = mPendingRecord.mExtended ;
+    message.type = CANFDMessage::Type (mPendingRecord.mType) ;
+    message.len = mPendingRecord.mLength ;
+    if (mPendingRecord.mType != ACAN_T4_TRACE_REMOTE) {
+      memcpy (message.data, mPendingData, mPendingRecord.mLength) ;
+    }
+    sendStatus = mDriver->tryToSendReturnStatusFD (message) ;
+  }else if (mPendingRecord.mType > ACAN_T4_TRACE_DATA) { // CANFD frame, cannot be sent in CAN 2.0B mode
+    sendStatus = ACAN_T4::kFlexCANinCAN20BMode ;
+  }else{
+    CANMessage message ;
+    message.id = mPendingRecord.mIdentifier ;
+    message.ext = mPendingRecord.mExtended ;
+    message.rtr = mPendingRecord.mType == ACAN_T4_TRACE_REMOTE ;
+    message.len = (mPendingRecord.mLength <= 8) ? mPendingRecord.mLength : 8 ;
+    if (!message.rtr) {
+      memcpy (message.data, mPendingData, message.len) ;
+    }
+    sendStatus = mDriver->tryToSendReturnStatus (message) ;
+  }
+  return sendStatus ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_TraceReplayer::poll (void) {
+  uint32_t sentCount = 0 ;
+  if (mDriver != nullptr) {
+  //--- Update elapsed time (micros () wrap-arounds are unfolded)
+    const uint32_t now = micros () ;
+    if (!mStarted) {
+      mStarted = true ;
+      mElapsedTime = 0 ;
+    }else{
+      mElapsedTime += uint32_t (now - mPreviousMicros) ;
+    }
+    mPreviousMicros = now ;
+  //--- Send due frames
+    bool transmitBufferFull = false ;
+    while (!transmitBufferFull && nextRecord () && (mPendingDate <= mElapsedTime)) {
+      const uint64_t delay = mElapsedTime - mPendingDate ;
+      const uint32_t lateness = (delay > UINT32_MAX) ? UINT32_MAX : uint32_t (delay) ;
+      if ((mMaxLateness > 0) && (lateness > mMaxLateness)) {
+        mDroppedFrameCount += 1 ;
+        mHasPendingRecord = false ;
+      }else{
+        const uint32_t sendStatus = trySendPendingRecord () ;
+        if (sendStatus == 0) {
+          sentCount += 1 ;
+          mSentFrameCount += 1 ;
+          mTimingErrorSum += lateness ;
+          if (mMaxTimingError < lateness) {
+            mMaxTimingError = lateness ;
+          }
+          mHasPendingRecord = false ;
+        }else if (sendStatus == ACAN_T4::kTransmitBufferOverflow) { // Retry on next call
+          transmitBufferFull = true ;
+        }else{ // Frame cannot be sent by this driver
+          mDroppedFrameCount += 1 ;
+          mHasPendingRecord = false ;
+        }
+      }
+    }
+  }
+  return sentCount ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ACAN_T4_TraceReplayer::done (void) const {
+  return mEndOfTrace && (mFilledBlockCount == 0) && !mHasPendingRecord ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t ACAN_T4_TraceReplayer::averageTimingError (void) const {
+  return (mSentFrameCount == 0) ? 0 : uint32_t (mTimingErrorSum / mSentFrameCount) ;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------------------------------
+// A Teensy 4.x CAN driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/ACAN_T4
+//
+//--------------------------------------------------------------------------------------------------
+// Trace replayer: sends the frames of a trace (see ACAN_T4_TraceFormat.h) with their original
+// inter-frame timing, optionally scaled.
+// loop fills trace blocks (for example read from a SD card) and calls poll: every due frame is
+// handed to the driver, whose transmit buffer and transmit interrupt keep the Tx mailbox busy
+// for back-to-back frames.
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+#include <ACAN_T4.h>
+
+//--------------------------------------------------------------------------------------------------
+
+static const uint8_t ACAN_T4_TRACE_ALL_CHANNELS = 255 ;
+
+//--------------------------------------------------------------------------------------------------
+
+class ACAN_T4_TraceReplayer {
+
+//--- Constructor
+  public: ACAN_T4_TraceReplayer (void) ;
+
+//--- begin: inBlockStorage should contain inBlockCount * ACAN_T4_TRACE_BLOCK_SIZE bytes,
+//    inBlockCount should be >= 2. Returns false if arguments are invalid.
+//    inTimeScalePercent: 100 --> original timing, 50 --> twice as fast, 200 --> half speed
+//    inChannel: only records of this channel are sent (ACAN_T4_TRACE_ALL_CHANNELS: all records)
+  public: bool begin (ACAN_T4 & inDriver,
+                      uint8_t * inBlockStorage,
+                      const uint32_t inBlockCount,
+                      const uint32_t inTimeScalePercent = 100,
+                      const uint8_t inChannel = ACAN_T4_TRACE_ALL_CHANNELS) ;
+
+//--- Filling trace blocks: freeBlock returns a block to fill (nullptr if none), commitBlock
+//    appends it to the trace. Call endOfTrace when the whole trace has been committed.
+  public: uint8_t * freeBlock (void) const ;
+  public: void commitBlock (void) ;
+  public: void endOfTrace (void) ;
+
+//--- Replay: the first frame is sent on the first call of poll; returns the number of frames
+//    accepted by the driver during this call.
+  public: uint32_t poll (void) ;
+  public: bool done (void) const ;
+
+//--- Frames that are late by more than mMaxLateness µs are dropped (0: never drop late frames)
+  public: uint32_t mMaxLateness = 0 ;
+
+//--- Statistics (timing error is the delay between scheduled date and transmit buffer insertion)
+  public: inline uint32_t sentFrameCount (void) const { return mSentFrameCount ; }
+  public: inline uint32_t droppedFrameCount (void) const { return mDroppedFrameCount ; }
+  public: inline uint32_t invalidBlockCount (void) const { return mInvalidBlockCount ; }
+  public: inline uint32_t maxTimingError (void) const { return mMaxTimingError ; } // In µs
+  public: uint32_t averageTimingError (void) const ; // In µs
+
+//--- Private methods
+  private: bool nextRecord (void) ;
+  private: uint32_t trySendPendingRecord (void) ;
+  private: void releaseBlock (void) ;
+  private: inline uint8_t * block (const uint32_t inIndex) const {
+    return mBlockStorage + inIndex * ACAN_T4_TRACE_BLOCK_SIZE ;
+  }
+
+//--- Properties
+  private: ACAN_T4 * mDriver = nullptr ;
+  private: uint8_t * mBlockStorage = nullptr ;
+  private: uint32_t mBlockCount = 0 ;
+  private: uint32_t mReadBlockIndex = 0 ;
+  private: uint32_t mFilledBlockCount = 0 ;
+  private: uint32_t mReadOffset = 0 ; // 0: block header not read yet
+  private: uint32_t mReadUsedBytes = 0 ;
+  private: uint32_t mReadRemainingRecords = 0 ;
+  private: bool mEndOfTrace = false ;
+  private: uint32_t mTimeScalePercent = 100 ;
+  private: uint8_t mChannel = ACAN_T4_TRACE_ALL_CHANNELS ;
+//--- Pending record (decoded, not sent yet)
+  private: bool mHasPendingRecord = false ;
+  private: ACAN_T4_TraceRecord mPendingRecord ;
+  private: uint8_t mPendingData [64] ;
+  private: uint64_t mPendingDate = 0 ; // Scheduled date, in µs from replay start
+//--- Timing
+  private: bool mStarted = false ;
+  private: bool mHasTraceOrigin = false ;
+  private: uint32_t mPreviousTraceTimestamp = 0 ;
+  private: uint64_t mTraceTime = 0 ; // In µs from first record, wrap-arounds unfolded
+  private: uint32_t mPreviousMicros = 0 ;
+  private: uint64_t mElapsedTime = 0 ; // In µs from replay start
+//--- Statistics
+  private: uint32_t mSentFrameCount = 0 ;
+  private: uint32_t mDroppedFrameCount = 0 ;
+  private: uint32_t mInvalidBlockCount = 0 ;
+  private: uint32_t mMaxTimingError = 0 ;
+  private: uint64_t mTimingErrorSum = 0 ;
+
+//--- No copy
+  private : ACAN_T4_TraceReplayer (const ACAN_T4_TraceReplayer &) = delete ;
+  private : ACAN_T4_TraceReplayer & operator = (const ACAN_T4_TraceReplayer &) = delete ;
+} ;
+
+//--------------------------------------------------------------------------------------------------